@@ -0,0 +1,39 @@
+// Values shared by every draw of a frame, same layout as FrameUniforms::Data.
+#define MAX_LIGHTS 8
+
+const float PI = 3.14159265359;
+
+struct Light {
+	vec4 position;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	// Constant, linear and quadratic.
+	vec4 attenuation;
+};
+
+layout (std140, binding = 0) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrices[4];
+	vec4 sunLightPosition;
+	vec4 sunLightAmbient;
+	vec4 sunLightDiffuse;
+	vec4 sunLightSpecular;
+	Light lights[MAX_LIGHTS];
+	// Poisson disk samples in xy, 16 is the maximum number of pcf samples allowed.
+	vec4 pcfSamples[16];
+	vec4 pcfMultipliers;
+	// 5 distances, 4 per vector.
+	vec4 cascadePlanes[2];
+	int lightsNumber;
+	int pcfSamplesNumber;
+	float poissonPcfDiameter;
+	float csmBlendingOffset;
+	float shadowBiasMultiplier;
+	float shadowBiasMinimum;
+};
+
+float cascadePlaneDistance(int i) {
+	return cascadePlanes[i / 4][i % 4];
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+// Material of the draw, read from the material table.
+// Needs texCoords. DIFFUSE_MAP, NORMAL_MAP and ORM_MAP tell which textures the material has.
+// With BINDLESS the including shader must enable GL_ARB_bindless_texture first.
+layout (binding = 0) uniform sampler2D diffuseSampler;
+layout (binding = 2) uniform sampler2D normalsSampler;
+// Occlusion, roughness and metallic in red, green and blue.
+layout (binding = 3) uniform sampler2D ormSampler;
+#if !defined(BINDLESS) && defined(MAX_TEXTURE_ARRAYS)
+layout (binding = 16) uniform sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+#endif
+
+struct Material {
+	// Phong.
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+
+	// PBR.
+	float roughness, metallic;
+	// Channels of the ORM map that come from a map, the others use the values above.
+	bool hasAoMap, hasRoughnessMap, hasMetallicMap;
+};
+
+// Entry of the material table, same layout as in MaterialTable.cpp.
+struct GpuMaterial {
+	vec4 ambientShininess;
+	vec4 diffuseRoughness;
+	vec4 specularMetallic;
+	uint flags;
+	// Finest resident mip of each texture (streaming with bindless textures).
+	float minLod[3];
+	// Diffuse, normals and ORM: bindless handle, or texture array and layer (array 0xFFFFFFFF if bound to its sampler).
+	uvec2 textures[3];
+	uvec2 padding;
+};
+
+layout (std430, binding = 0) readonly buffer Materials {
+	GpuMaterial materials[];
+};
+
+uniform int materialIndex;
+// Filled from the material table by loadMaterial.
+Material material;
+
+void loadMaterial() {
+	GpuMaterial m = materials[materialIndex];
+	material.ambient = m.ambientShininess.rgb;
+	material.shininess = m.ambientShininess.a;
+	material.diffuse = m.diffuseRoughness.rgb;
+	material.roughness = m.diffuseRoughness.a;
+	material.specular = m.specularMetallic.rgb;
+	material.metallic = m.specularMetallic.a;
+	material.hasAoMap = (m.flags & 8u) != 0;
+	material.hasRoughnessMap = (m.flags & 16u) != 0;
+	material.hasMetallicMap = (m.flags & 32u) != 0;
+}
+
+// Texture of the current material, boundSampler is only used when it isn't bindless or in an array.
+vec4 sampleMaterialTexture(int slot, sampler2D boundSampler) {
+	uvec2 t = materials[materialIndex].textures[slot];
+#ifdef BINDLESS
+	// Levels finer than the resident ones are allocated but not loaded.
+	sampler2D s = sampler2D(t);
+	float lod = max(textureQueryLod(s, texCoords).y, materials[materialIndex].minLod[slot]);
+	return textureLod(s, texCoords, lod);
+#else
+#ifdef MAX_TEXTURE_ARRAYS
+	if(t.x != 0xFFFFFFFFu)
+		return texture(textureArrays[t.x], vec3(texCoords, float(t.y)));
+#endif
+	return texture(boundSampler, texCoords);
+#endif
+}
+
+// Compressed normal maps (BC5) only store x and y, z is rebuilt from them.
+vec3 sampleNormalMap() {
+	vec2 xy = sampleMaterialTexture(1, normalsSampler).rg * 2.0 - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
\ No newline at end of file
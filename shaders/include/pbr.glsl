@@ -0,0 +1,179 @@
+// Cook-Torrance lighting of the current material.
+// Needs frame.glsl, material.glsl and shadow.glsl, plus the vertex outputs of vshader.glsl.
+float DistributionGGX(vec3 N, vec3 H, float roughness);
+float GeometrySchlickGGX(float NdotV, float roughness);
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness);
+vec3 fresnelSchlick(float cosTheta, vec3 F0);
+
+vec3 calculateLightingPbr() {
+	
+	// If lighting doesn't look 100% right it's probably not this.
+	// It usually is the model normals, not the lighting done here.
+	// Set FragColor to vec4(Normal, 1.0f) to test if normals match weird lighting.
+	// If they do match it's probably the normals.
+
+	// Material properties.
+	vec3 albedo = material.diffuse;
+#ifdef DIFFUSE_MAP
+	albedo = sampleMaterialTexture(0, diffuseSampler).rgb;
+#endif
+
+	float ao = 1.0;
+	float roughness = material.roughness;
+	float metallic = material.metallic;
+#ifdef ORM_MAP
+	vec3 orm = sampleMaterialTexture(2, ormSampler).rgb;
+	if(material.hasAoMap)
+		ao = orm.r;
+	if(material.hasRoughnessMap)
+		roughness = orm.g;
+	if(material.hasMetallicMap)
+		metallic = orm.b;
+#endif
+	
+
+	vec3 N = normalize(Normal);
+#ifdef NORMAL_MAP
+	N = normalize(TBN * sampleNormalMap());
+#endif
+
+	vec3 V = normalize(-FragPos);
+
+	vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+	           
+    // reflectance equation
+    vec3 Lo = vec3(0.0);
+
+#ifdef SUN_LIGHT
+	{
+		 // calculate per-light radiance
+        vec3 L = normalize(vec3(mat3(view) * sunLightPosition.xyz));
+        vec3 H = normalize(V + L);
+        vec3 radiance     = sunLightDiffuse.rgb;    
+        
+        // cook-torrance brdf
+        float NDF = DistributionGGX(N, H, roughness);   
+		// This function generates dark edge when pixel is at 90 degrees
+		// with view vector. This is because pixel is completely "occluded"
+		// by geometry, but this makes it look odd,
+		// because it's impossible in real life.
+		// Check function to see how to fix it.
+        float G   = GeometrySmith(N, V, L, roughness);      
+        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);    
+        
+        vec3 kS = F;
+        vec3 kD = vec3(1.0) - kS;
+        kD *= 1.0 - metallic;	  
+        
+        vec3 numerator    =  NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3 specular     = numerator / denominator;  
+        
+		float shadowValue = 0.0f; 
+#ifdef SHADOWS
+		shadowValue = calculateShadow(N, L);
+#endif
+
+        // add to outgoing radiance Lo
+        float NdotL = max(dot(N, L), 0.0);                
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL * (1-shadowValue); 
+	}
+#endif
+
+    for(int i = 0; i < lightsNumber; ++i)
+    {
+        if((lightMask & (1 << i)) == 0)
+            continue;
+        // calculate per-light radiance
+        vec3 L = vec3(view * vec4(lights[i].position.xyz, 1.0f)) - FragPos;
+		float dis         = length(L);
+		L	   = normalize(L);
+        vec3 H = normalize(V + L);
+        float attenuation = 1 / (lights[i].attenuation.x + lights[i].attenuation.y * dis + 
+			lights[i].attenuation.z * (dis * dis));
+        vec3 radiance     = lights[i].diffuse.rgb * attenuation;        
+        
+        // cook-torrance brdf
+        float NDF = DistributionGGX(N, H, roughness);        
+        float G   = GeometrySmith(N, V, L, roughness);      
+        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);       
+        
+        vec3 kS = F;
+        vec3 kD = vec3(1.0) - kS;
+        kD *= 1.0 - metallic;	  
+        
+        vec3 numerator    = NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3 specular     = numerator / denominator;  
+            
+        // add to outgoing radiance Lo
+        float NdotL = max(dot(N, L), 0.0);                
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL; 
+    }   
+  
+    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 color = ambient + Lo;
+
+	return color;
+} 
+
+float DistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a      = roughness*roughness;
+    float a2     = a*a;
+    float NdotH  = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH*NdotH;
+	
+    float num   = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+	
+    return num / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = (r*r) / 8.0;
+
+    float num   = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+	
+    return num / denom;
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+	// This is the part that creates dark edge.
+	// If you want to get rid of dark edge, limit the dot product
+	// to an angle decided by you, to avoid pixels being at 90 degrees
+	// to the view vector which is impossible theoretically speaking.
+	// It's impossible because if it was at 90 degrees in real life,
+	// we wouldn't be able to actually see that pixel.
+
+	// Replace <degrees> with theoretical maximum angle accepted in degrees.
+	// float ggx2  = GeometrySchlickGGX(max(NdotV, cos(radians(<degrees>))), roughness);
+	// Example:
+	// float ggx2  = GeometrySchlickGGX(max(NdotV, cos(radians(89.995f))), roughness);
+
+	// Be careful not to set the degrees to a too low value as this 
+	// would make the fresnel effect too powerful, making pixels white.
+	// Either find a good value, or change fresnel function
+	// by also limiting the angle or final value there.
+
+	// Everything written before this comment might just be a normal, as in 3D normals, problem.
+	// Not solveable unless you use flat shading which is not always wanted.
+    float ggx2  = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1  = GeometrySchlickGGX(NdotL, roughness);
+	
+    return ggx1 * ggx2;
+}
+
+
+vec3 fresnelSchlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+} 
\ No newline at end of file
@@ -0,0 +1,64 @@
+// Blinn-Phong lighting of the current material.
+// Needs frame.glsl, material.glsl and shadow.glsl, plus the vertex outputs of vshader.glsl.
+float calculateDiffuse(vec3, vec3);
+float calculateSpecular(vec3, vec3);
+
+vec3 calculateLightingBlinnPhong(vec3 ambient, vec3 diffuse, vec3 specular) {
+	
+	vec3 texDiffuse = vec3(1.0f, 1.0f, 1.0f);
+#ifdef DIFFUSE_MAP
+	texDiffuse = sampleMaterialTexture(0, diffuseSampler).rgb;
+#endif
+
+	vec3 N = normalize(Normal);
+#ifdef NORMAL_MAP
+	N = normalize(TBN * sampleNormalMap());
+#endif
+	vec3 V = normalize(-FragPos);
+
+	vec3 amb = vec3(0,0,0);
+	vec3 diff = vec3(0,0,0);
+	vec3 spec = vec3(0,0,0);
+
+#ifdef SUN_LIGHT
+	{
+		vec3 lightDir = normalize(vec3(mat3(view) * sunLightPosition.xyz));
+		float shadowValue = 0.0f; 
+#ifdef SHADOWS
+		shadowValue = calculateShadow(N, lightDir);
+#endif
+		amb+=sunLightAmbient.rgb * ambient;
+		float localDiff = calculateDiffuse(N, lightDir);
+		vec3 halfwayDir = normalize(V + lightDir);
+		if(localDiff>0) 
+			spec+= sunLightSpecular.rgb * specular * calculateSpecular(N, halfwayDir) * (1-shadowValue);
+		diff+= sunLightDiffuse.rgb * texDiffuse * diffuse * localDiff * (1-shadowValue);
+	}
+#endif
+
+	for (int i = 0; i < lightsNumber; i++) {
+		if ((lightMask & (1 << i)) == 0)
+			continue;
+		vec3 lightDir = vec3(view * vec4(lights[i].position.xyz, 1.0f)) - FragPos;
+		float dis = length(lightDir);
+		lightDir = normalize(lightDir);
+		vec3 halfwayDir = normalize(V + lightDir);
+		float attenuation = 1 / (lights[i].attenuation.x + lights[i].attenuation.y * dis + 
+		lights[i].attenuation.z * (dis * dis));
+		amb+= lights[i].ambient.rgb * ambient * attenuation;
+		float localDiff = calculateDiffuse(N, lightDir);
+		// Only add specular if diffuse > 0.
+		if(localDiff > 0)
+			spec += lights[i].specular.rgb * calculateSpecular(N, halfwayDir) * specular * attenuation;
+		diff += lights[i].diffuse.rgb * texDiffuse * localDiff * diffuse * attenuation;
+	}
+	return (amb + diff + spec);
+}
+
+float calculateDiffuse(vec3 N, vec3 lightDir) {
+	return max(dot(N, lightDir), 0.0);
+}
+
+float calculateSpecular(vec3 N, vec3 halfwayDir) {
+	return pow(max(dot(N, halfwayDir), 0.0f), material.shininess);
+}
\ No newline at end of file
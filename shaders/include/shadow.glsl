@@ -0,0 +1,134 @@
+// Cascaded shadow maps of the sun light.
+// Needs FragPos and FragPosWorldSpace. PCF and POISSON_PCF choose the filtering.
+layout (binding = 8) uniform sampler2DArray shadowSampler;
+
+float random(vec2 co);
+vec2 rotatePcfPoint(vec2, float);
+float calculateShadowAtLayer(int layer, vec3 normal, vec3 lightDir);
+float calculatePcfShadow(vec3 projCoords, vec2 texelSize, int layer, float currentDepth, float bias);
+float calculatePoissonPcfShadow(vec3 projCoords, vec2 texelSize, int layer, float currentDepth, float bias);
+
+float calculateShadow(vec3 normal, vec3 lightDir)
+{	
+	float depthValue = abs(FragPos.z);
+    bool interpolate = false;
+	int layer = -1;
+	for (int i = 0; i < 3; ++i) {
+		if (depthValue < cascadePlaneDistance(i+1) - csmBlendingOffset/2) {
+			layer = i;
+			break;
+		} else if(depthValue < cascadePlaneDistance(i+1) + csmBlendingOffset/2) {
+			layer = i;
+			interpolate = true;
+			break;
+		}
+	}
+	if(layer == -1)
+		layer = 3;
+
+    float shadow = 0.0;
+
+	shadow = calculateShadowAtLayer(layer, normal, lightDir);
+	if(interpolate) {
+		float shadow2 = calculateShadowAtLayer(layer+1, normal, lightDir);
+		shadow = mix(shadow, shadow2, (depthValue-cascadePlaneDistance(layer+1)+csmBlendingOffset/2)/csmBlendingOffset);
+	}
+
+	// Only needed with single shadow map that doesn't cover all the scene.
+	// Since we use csm this problem doesn't arise so we don't need to perform check.
+	/*// far plane black region
+	if(projCoords.z > 1.0)
+        shadow = 0.0;*/
+
+    return shadow;
+}  
+
+float calculateShadowAtLayer(int layer, vec3 normal, vec3 lightDir) { 
+	float shadow = 0.0f;
+	vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(FragPosWorldSpace, 1.0);
+	// perform perspective divide
+	vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+	// transform to [0,1] range
+	projCoords = projCoords * 0.5 + 0.5;
+	// get depth of current fragment from light's perspective
+	float currentDepth = projCoords.z;
+	// check whether current frag pos is in shadow
+
+	// Cullface back with bias creates peter panning (shadow offset from object).
+	// Cullface front with bias doesn't shadow close surfaces behind the object.
+
+	// Default bias to modify from.
+	// float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+	float bias = max(shadowBiasMultiplier * (1.0 - dot(normal, lightDir)), shadowBiasMinimum);
+	bias *= 1 / (cascadePlaneDistance(layer+1) * 0.5f);
+
+	// Pcf.
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowSampler, 0));
+#if defined(PCF) && defined(POISSON_PCF)
+	shadow = calculatePoissonPcfShadow(projCoords, texelSize, layer, currentDepth, bias);
+#elif defined(PCF)
+	shadow = calculatePcfShadow(projCoords, texelSize, layer, currentDepth, bias);
+#else
+	// Get closest depth value from light's perspective (using [0,1] range fragPosLight as coords).
+	float closestDepth = texture(shadowSampler, vec3(projCoords.xy, layer)).r; 
+	shadow += currentDepth - bias > closestDepth ? 1.0 : 0.0;  
+#endif
+	return shadow;
+}
+
+// At higher distances and with higher poisson radius everything starts to self shadow.
+// This happens because the depth of near or adjacent pixels in distant cascades can change by a lot.
+// When this happens the bias isn't enough and we get shadow acne.
+// Either decrease poisson radius or find a way to change bias to be better.
+float calculatePoissonPcfShadow(vec3 projCoords, vec2 texelSize, int layer, float currentDepth, float bias) {
+	float shadow = 0.0f;
+	float randomValue = random(gl_FragCoord.xy);
+	for(int i = 0; i < pcfSamplesNumber; ++i) {
+		float pcfDepth = texture(shadowSampler, vec3(projCoords.xy + rotatePcfPoint(pcfSamples[i].xy, randomValue) * poissonPcfDiameter * texelSize * pcfMultipliers[layer], layer)).r;
+		shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0; 
+	}
+	shadow /= pcfSamplesNumber;
+	return shadow;
+}
+
+float calculatePcfShadow(vec3 projCoords, vec2 texelSize, int layer, float currentDepth, float bias) {
+	float shadow = 0.0f;
+	float kernel[3][3] = {
+		{1.0f, 2.0f, 1.0f},
+		{2.0f, 4.0f, 2.0f},
+		{1.0f, 2.0f, 1.0f}
+	};
+	float sum = 0.0f;
+	for(int x = 0; x < 3; ++x) {
+		for(int y = 0; y < 3; ++y) {
+			sum+=kernel[x][y];
+		}
+	}
+	for(int x = 0; x < 3; ++x) {
+		for(int y = 0; y < 3; ++y) {
+			kernel[x][y]=kernel[x][y]/sum;
+		}
+	}
+	for(int x = -1; x <= 1; ++x)
+	{
+		for(int y = -1; y <= 1; ++y)
+		{
+			float pcfDepth = texture(shadowSampler, vec3(projCoords.xy + vec2(x, y) * texelSize, layer)).r; 
+			shadow += currentDepth - bias > pcfDepth ?  kernel[x+1][y+1] : 0.0;     
+		}    
+	}
+	return shadow;
+}
+
+float random(vec2 co) {
+    return fract(sin(dot(co, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+vec2 rotatePcfPoint(vec2 p, float randomValue) {
+	float angle = randomValue * 2 * PI;
+	float s = sin(angle);
+	float c = cos(angle);
+	float xnew = p.x * c - p.y * s;
+	float ynew = p.x * s + p.y * c;
+	return vec2(xnew, ynew);
+}
\ No newline at end of file
@@ -8,8 +8,6 @@ layout (location = 3) in vec3 tanPos;
 layout (binding = 0) uniform sampler2D texSampler;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 lightSpaceMat;
 uniform mat3 NormalMat;
 
@@ -19,6 +17,9 @@ out vec3 FragPos;
 out vec3 FragPosWorldSpace;
 out mat3 TBN;
 
+// View and projection.
+#include "include/frame.glsl"
+
 void main()
 {
     FragPosWorldSpace = vec3(model * vec4(aPos, 1.0));
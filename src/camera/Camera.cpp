@@ -42,6 +42,10 @@ glm::mat4 buildViewMatrix() {
 	return glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 }
 
+glm::vec3 getCameraPosition() {
+	return cameraPos;
+}
+
 // Has to be called once per frame. Possibly near the end.
 void updateCameraTime() {
 	lastFrame = glfwGetTime();
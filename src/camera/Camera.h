@@ -6,6 +6,8 @@ void updateCamera(short, bool);
 
 glm::mat4 buildViewMatrix();
 
+glm::vec3 getCameraPosition();
+
 void updateCameraTime();
 
 void updateCameraMouse(bool, double, double);
\ No newline at end of file
@@ -13,6 +13,18 @@
 #include "post/GaussianBlur.h"
 #include "post/bloom/Bloom.h"
 #include "renderer/Skybox.h"
+#include "renderer/culling/OcclusionCulling.h"
+#include "camera/Camera.h"
+#include "model/TextureCache.h"
+#include "model/TextureStreamer.h"
+#include "model/AssetDatabase.h"
+#include "renderer/MaterialTable.h"
+#include "renderer/RenderQueue.h"
+#include "renderer/UploadQueue.h"
+#include "renderer/HotReload.h"
+#include "vfs/Vfs.h"
+#include "shader/ProgramCache.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 static void GeneralGui();
 static void ModelGui();
@@ -20,7 +32,9 @@ static void SceneGui();
 static void ModelInstanceGui();
 static void LightGui();
 static void ShadowGui();
+static void CullingGui();
 static void PostProcessingGui();
+static int pickModelInstance();
 
 void Gui::buildSimpleRendererGui() {
 	// ImGui::ShowDemoWindow();
@@ -32,6 +46,7 @@ void Gui::buildSimpleRendererGui() {
 	ModelInstanceGui();
 	LightGui();
 	ShadowGui();
+	CullingGui();
 	PostProcessingGui();
 }
 
@@ -43,6 +58,24 @@ static void GeneralGui() {
 		bool useSkybox = Skybox::getUseSkybox();
 		if (ImGui::Checkbox("Use skybox##sky", &useSkybox))
 			Skybox::setUseSkybox(useSkybox);
+
+		// Draw sorting, state changes are counted for both orders.
+		bool useSorting = RenderQueue::getUseSorting();
+		if (ImGui::Checkbox("Sort draws##general", &useSorting))
+			RenderQueue::setUseSorting(useSorting);
+		RenderQueue::Stats queueStats = RenderQueue::getStats();
+		ImGui::Text("Draws: %u", queueStats.packets);
+		ImGui::Text("Queued order: %u programs, %u instances, %u materials, %u texture sets, %u vertex arrays", queueStats.unsorted.programs,
+			queueStats.unsorted.instances, queueStats.unsorted.materials, queueStats.unsorted.textures, queueStats.unsorted.vertexArrays);
+		ImGui::Text("Submitted: %u programs, %u instances, %u materials, %u texture sets, %u vertex arrays", queueStats.sorted.programs,
+			queueStats.sorted.instances, queueStats.sorted.materials, queueStats.sorted.textures, queueStats.sorted.vertexArrays);
+		ImGui::Text("Shader variants compiled: %u", SimpleRenderer::getVariantCount());
+		bool useProgramCache = ProgramCache::getEnabled();
+		if (ImGui::Checkbox("Program binary cache", &useProgramCache))
+			ProgramCache::setEnabled(useProgramCache);
+		ProgramCache::Stats programStats = ProgramCache::getStats();
+		ImGui::Text("Programs: %u in %.1f ms, %u from cache, %u rejected, %u compiling", programStats.programs, programStats.milliseconds,
+			programStats.loaded, programStats.rejected, Shader::getPendingCount());
 	}
 }
 
@@ -56,12 +89,93 @@ static void ModelGui() {
 		ImGui::PopItemWidth();
 		ImGui::SameLine();
 		if (ImGui::Button("Load model##model")) {
-			// Should add a function that only does the second part of getAssetModel().
-			getAssetModel(char_buff);
+			// Loads the model if it isn't loaded yet.
+			getAssetModelHandle(char_buff);
 		}
+		AssetDatabase::Stats assetStats = AssetDatabase::getStats();
+		ImGui::Text("Asset index: %u models, %u parsed, %u hashed in %.1f ms", assetStats.models, assetStats.parsed,
+			assetStats.hashed, assetStats.milliseconds);
+
+		// Models kept loaded without scene users.
+		int modelCpuMb = (int)(getAssetModelCpuBudget() / (1024 * 1024)), modelGpuMb = (int)(getAssetModelGpuBudget() / (1024 * 1024));
+		bool changedCpu = ImGui::DragInt("Model cpu budget (MB)##model", &modelCpuMb, 1.0f, 0, 16384);
+		bool changedGpu = ImGui::DragInt("Model gpu budget (MB)##model", &modelGpuMb, 1.0f, 0, 16384);
+		if (changedCpu || changedGpu)
+			setAssetModelBudgets((size_t)modelCpuMb * 1024 * 1024, (size_t)modelGpuMb * 1024 * 1024);
+		AssetModelStats modelStats = getAssetModelStats();
+		ImGui::Text("Models: %u (%u unused), %.1f MB cpu, %.1f MB gpu", modelStats.models, modelStats.unused,
+			modelStats.cpuBytes / (1024.0 * 1024.0), modelStats.gpuBytes / (1024.0 * 1024.0));
+		ImGui::Text("Unused models reused: %u, evicted: %u, reloaded: %u", modelStats.reused, modelStats.evicted, modelStats.reloads);
+
+		// Shared texture cache.
+		bool useContentHash = TextureCache::getUseContentHash();
+		if (ImGui::Checkbox("Match textures by content##model", &useContentHash))
+			TextureCache::setUseContentHash(useContentHash);
+		bool compressTextures = TextureCompression::getEnabled();
+		if (ImGui::Checkbox("Compress new textures##model", &compressTextures))
+			TextureCompression::setEnabled(compressTextures);
+		bool preferBc1 = TextureCompression::getPreferBc1();
+		if (ImGui::Checkbox("BC1 for opaque colors##model", &preferBc1))
+			TextureCompression::setPreferBc1(preferBc1);
+		int textureBudgetMb = (int)(TextureCache::getBudget() / (1024 * 1024));
+		if (ImGui::DragInt("Texture cache budget (MB)##model", &textureBudgetMb, 1.0f, 0, 16384))
+			TextureCache::setBudget((size_t)textureBudgetMb * 1024 * 1024);
+		TextureCache::Stats textureStats = TextureCache::getStats();
+		ImGui::Text("Textures: %u (%u compressed, %u references, %u unused), %.1f MB", textureStats.textures, textureStats.compressed,
+			textureStats.references, textureStats.unused, textureStats.bytes / (1024.0 * 1024.0));
+		ImGui::Text("Texture cache hits: %u, by content: %u, misses: %u, evicted: %u, reloaded: %u", textureStats.hits, textureStats.contentHits,
+			textureStats.misses, textureStats.evicted, textureStats.reloads);
+
+		// Mip streaming of compressed textures.
+		bool streamTextures = TextureStreamer::getEnabled();
+		if (ImGui::Checkbox("Stream new textures##model", &streamTextures))
+			TextureStreamer::setEnabled(streamTextures);
+		int budgetMb = (int)(TextureStreamer::getBudget() / (1024 * 1024));
+		if (ImGui::DragInt("Streaming budget (MB)##model", &budgetMb, 1.0f, 16, 8192))
+			TextureStreamer::setBudget((size_t)budgetMb * 1024 * 1024);
+		TextureStreamer::Stats streamStats = TextureStreamer::getStats();
+		ImGui::Text("Streamed: %u textures, %.1f MB resident, %u loading", streamStats.textures,
+			streamStats.residentBytes / (1024.0 * 1024.0), streamStats.loading);
+		ImGui::Text("Levels loaded: %u, evicted: %u", streamStats.loadedLevels, streamStats.evictedLevels);
+
+		// Mesh and texture data copied to the gpu over several frames.
+		bool queueUploads = UploadQueue::getEnabled();
+		if (ImGui::Checkbox("Spread uploads over frames##model", &queueUploads))
+			UploadQueue::setEnabled(queueUploads);
+		int uploadMb = (int)(UploadQueue::getFrameBytes() / (1024 * 1024));
+		if (ImGui::DragInt("Upload per frame (MB)##model", &uploadMb, 0.25f, 1, 256))
+			UploadQueue::setFrameBytes((size_t)uploadMb * 1024 * 1024);
+		float uploadMs = UploadQueue::getFrameMilliseconds();
+		if (ImGui::DragFloat("Upload per frame (ms)##model", &uploadMs, 0.05f, 0.1f, 16.0f))
+			UploadQueue::setFrameMilliseconds(uploadMs);
+		UploadQueue::Stats uploadStats = UploadQueue::getStats();
+		ImGui::Text("Uploads pending: %u, %.1f MB, staging %.1f / %.1f MB", uploadStats.pending, uploadStats.pendingBytes / (1024.0 * 1024.0),
+			uploadStats.stagingUsed / (1024.0 * 1024.0), uploadStats.stagingSize / (1024.0 * 1024.0));
+		ImGui::Text("Last frame: %.2f MB in %.2f ms", uploadStats.frameBytes / (1024.0 * 1024.0), uploadStats.frameMilliseconds);
+
+		// Files read through the virtual file system.
+		Vfs::Stats vfsStats = Vfs::getStats();
+		ImGui::Text("Packs: %u with %u files", vfsStats.packs, vfsStats.packedFiles);
+		ImGui::Text("Reads: %u loose, %u packed (%.1f MB decompressed), %u async", vfsStats.looseReads, vfsStats.packedReads,
+			vfsStats.decompressedBytes / (1024.0 * 1024.0), vfsStats.asyncReads);
+
+		// Files edited while running.
+		bool hotReload = HotReload::getEnabled();
+		if (ImGui::Checkbox("Hot reload##model", &hotReload))
+			HotReload::setEnabled(hotReload);
+		HotReload::Stats reloadStats = HotReload::getStats();
+		ImGui::Text("Changed files: %u, reloaded shaders: %u, textures: %u, models: %u", reloadStats.changedFiles,
+			reloadStats.shaders, reloadStats.textures, reloadStats.models);
+
+		// Gpu material table.
+		MaterialTable::Stats materialStats = MaterialTable::getStats();
+		ImGui::Text("Materials: %u (%s), %u with textures bound per draw", materialStats.materials,
+			MaterialTable::isBindless() ? "bindless" : "texture arrays", materialStats.boundMaterials);
+		if (!MaterialTable::isBindless())
+			ImGui::Text("Texture arrays: %u, %u layers", materialStats.arrays, materialStats.arrayLayers);
 		
 		std::vector<std::string> items;
-		std::map<std::string, Model>& models = getModels();
+		const std::map<std::string, ModelHandle>& models = getModels();
 		for (auto& pair : models) {
 			items.push_back(pair.first);
 		}
@@ -91,7 +205,7 @@ static void ModelGui() {
 			ImGui::EndCombo();
 		}
 
-		Model& m = models.at(items[item_current_idx]);
+		Model& m = *getAssetModel(models.at(items[item_current_idx]));
 
 		std::vector<std::string> meshes;
 		for (int i = 0; i < m.getMeshes().size(); ++i) {
@@ -127,18 +241,23 @@ static void ModelGui() {
 		float dif[3] = { m_mesh.material.diffuse.x, m_mesh.material.diffuse.y, m_mesh.material.diffuse.z };
 		float spe[3] = { m_mesh.material.specular.x, m_mesh.material.specular.y, m_mesh.material.specular.z };
 		float shi = m_mesh.material.shininess, rou = m_mesh.material.roughness, met = m_mesh.material.metallic;
-		ImGui::DragFloat3("Ambient##model", &amb[0], 0.005f, 0.0f, 100.0f);
-		ImGui::DragFloat3("Diffuse##model", &dif[0], 0.005f, 0.0f, 100.0f);
-		ImGui::DragFloat3("Specular##model", &spe[0], 0.005f, 0.0f, 100.0f);
-		ImGui::DragFloat("Shininess##model", &shi, 0.005f);
-		ImGui::DragFloat("Roughness##model", &rou, 0.001f, 0.0f, 1.0f);
-		ImGui::DragFloat("Metallic##model", &met, 0.001f, 0.0f, 1.0f);
-		m_mesh.material.ambient = glm::vec3(amb[0], amb[1], amb[2]);
-		m_mesh.material.diffuse = glm::vec3(dif[0], dif[1], dif[2]);
-		m_mesh.material.specular = glm::vec3(spe[0], spe[1], spe[2]);
-		m_mesh.material.shininess = shi;
-		m_mesh.material.roughness = rou;
-		m_mesh.material.metallic = met;
+		bool changed = false;
+		changed |= ImGui::DragFloat3("Ambient##model", &amb[0], 0.005f, 0.0f, 100.0f);
+		changed |= ImGui::DragFloat3("Diffuse##model", &dif[0], 0.005f, 0.0f, 100.0f);
+		changed |= ImGui::DragFloat3("Specular##model", &spe[0], 0.005f, 0.0f, 100.0f);
+		changed |= ImGui::DragFloat("Shininess##model", &shi, 0.005f);
+		changed |= ImGui::DragFloat("Roughness##model", &rou, 0.001f, 0.0f, 1.0f);
+		changed |= ImGui::DragFloat("Metallic##model", &met, 0.001f, 0.0f, 1.0f);
+		// Only edits rebuild the material table entry and draw packet.
+		if (changed) {
+			m_mesh.material.ambient = glm::vec3(amb[0], amb[1], amb[2]);
+			m_mesh.material.diffuse = glm::vec3(dif[0], dif[1], dif[2]);
+			m_mesh.material.specular = glm::vec3(spe[0], spe[1], spe[2]);
+			m_mesh.material.shininess = shi;
+			m_mesh.material.roughness = rou;
+			m_mesh.material.metallic = met;
+			m_mesh.updateMaterial();
+		}
 	}
 }
 
@@ -181,7 +300,7 @@ static void ModelInstanceGui() {
 
 		if (ImGui::Button("Add new model instance##mi")) {
 			const auto& it = getModels().begin();
-			SimpleRenderer::getScene().getModelInstancesManager().getModelInstances().push_back(ModelInstance(&it->second));
+			SimpleRenderer::getScene().getModelInstancesManager().addModelInstance(ModelInstance(it->second));
 		}
 
 		// If there are no model instances don't go forward.
@@ -190,10 +309,22 @@ static void ModelInstanceGui() {
 
 		static int item_current_idx = 0; // Here we store our selection data as an index.
 		static int model_item_current_idx = 0; // Here we store our selection data as an index.
-		const char* combo_preview_value = items[item_current_idx].c_str();  // Pass in the preview value visible before opening the combo (it could be anything)
-
 		static bool updateModelSelection = false;
 
+		// Left click on the scene (not on the gui) with the cursor enabled selects what is under it.
+		ImGui::Text("Click on the scene to select an instance.");
+		if (Window::getCursorEnabled() && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !ImGui::GetIO().WantCaptureMouse) {
+			int picked = pickModelInstance();
+			if (picked >= 0) {
+				item_current_idx = picked;
+				updateModelSelection = true;
+			}
+		}
+		if (item_current_idx >= items.size())
+			item_current_idx = (int)items.size() - 1;
+
+		const char* combo_preview_value = items[item_current_idx].c_str();  // Pass in the preview value visible before opening the combo (it could be anything)
+
 		if (ImGui::BeginCombo("ModelInstance##combo", combo_preview_value))
 		{
 			for (int n = 0; n < items.size(); n++)
@@ -215,7 +346,7 @@ static void ModelInstanceGui() {
 
 		// Model selection.
 		std::vector<std::string> model_items;
-		std::map<std::string, Model>& models = getModels();
+		const std::map<std::string, ModelHandle>& models = getModels();
 		int currentModelIndex = 0;
 		for (auto& pair : models) {
 			model_items.push_back(pair.first);
@@ -238,7 +369,7 @@ static void ModelInstanceGui() {
 				const bool is_selected = (model_item_current_idx == n);
 				if (ImGui::Selectable(model_items[n].c_str(), is_selected)) {
 					model_item_current_idx = n;
-					mi.setModel(getAssetModel(model_items[n]));
+					SimpleRenderer::getScene().getModelInstancesManager().setModel(item_current_idx, getAssetModelHandle(model_items[n]));
 				}
 
 				// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
@@ -248,12 +379,41 @@ static void ModelInstanceGui() {
 			ImGui::EndCombo();
 		}
 
-		Model& m = models.at(model_items[model_item_current_idx]);
+		Model& m = *getAssetModel(models.at(model_items[model_item_current_idx]));
+
+		// Parent selection, the instance itself and its descendants can't be parents.
+		// Instances are reordered when the hierarchy changes, so the selection follows the new index.
+		ModelInstancesManager& mim = SimpleRenderer::getScene().getModelInstancesManager();
+		std::string parent_preview_value = mi.getParent() >= 0 ? items[mi.getParent()] : "None";
+		if (ImGui::BeginCombo("Parent##micombo", parent_preview_value.c_str()))
+		{
+			int newParent = -2;
+			if (ImGui::Selectable("None", mi.getParent() < 0))
+				newParent = -1;
+			for (int n = 0; n < items.size(); n++)
+			{
+				if (n == item_current_idx || mim.isDescendant(n, item_current_idx))
+					continue;
+				const bool is_selected = (mi.getParent() == n);
+				if (ImGui::Selectable(items[n].c_str(), is_selected))
+					newParent = n;
+
+				// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
+				if (is_selected)
+					ImGui::SetItemDefaultFocus();
+			}
+			ImGui::EndCombo();
+			if (newParent != -2 && newParent != mi.getParent()) {
+				item_current_idx = mim.setParent(item_current_idx, newParent);
+				return;
+			}
+		}
 
 		static float sliderLimit = 30;
 		float pos[3] = { mi.getX(), mi.getY(), mi.getZ() };
 		float rot[3] = { mi.getRotation().x, mi.getRotation().y, mi.getRotation().z };
 		float sca[3] = { mi.getScale().x, mi.getScale().y, mi.getScale().z };
+		// Relative to the parent.
 		ImGui::DragFloat3("Position##modelinstance", &pos[0], 0.005f);
 		ImGui::DragFloat3("Rotation##modelinstance", &rot[0], 0.05f);
 		ImGui::DragFloat3("Scale##modelinstance", &sca[0], 0.005f);
@@ -261,8 +421,7 @@ static void ModelInstanceGui() {
 		mi.setRotation(glm::vec3(rot[0], rot[1], rot[2]));
 		mi.setScale(glm::vec3(sca[0], sca[1], sca[2]));
 		if (ImGui::Button("Remove current model instance##mi")) {
-			std::vector<ModelInstance>& modelInstances = SimpleRenderer::getScene().getModelInstancesManager().getModelInstances();
-			modelInstances.erase(modelInstances.begin() + item_current_idx);
+			SimpleRenderer::getScene().getModelInstancesManager().removeModelInstance(item_current_idx);
 			item_current_idx > 0 ? item_current_idx-- : 0;
 			updateModelSelection = true;
 		}
@@ -390,6 +549,45 @@ static void ShadowGui() {
 	}
 }
 
+static void CullingGui() {
+	if (ImGui::CollapsingHeader("Culling##culling")) {
+		bool useOcclusionCulling = OcclusionCulling::getUseOcclusionCulling();
+		if (ImGui::Checkbox("Use occlusion culling##culling", &useOcclusionCulling))
+			OcclusionCulling::setUseOcclusionCulling(useOcclusionCulling);
+		if (useOcclusionCulling) {
+			int maxOccluders = OcclusionCulling::getMaxOccluders();
+			ImGui::DragInt("Max occluders##culling", &maxOccluders, 0.1f, 0, 256);
+			OcclusionCulling::setMaxOccluders(maxOccluders);
+			ImGui::Text("Occluders: %u (%u triangles)", OcclusionCulling::getOccluderCount(), OcclusionCulling::getOccluderTriangleCount());
+			ImGui::Text("Culled instances: %u, culled meshes: %u", OcclusionCulling::getCulledInstanceCount(), OcclusionCulling::getCulledMeshCount());
+			ImGui::Text("Culling time: %.3f ms", OcclusionCulling::getCullingTime());
+		}
+
+		const Bvh& bvh = SimpleRenderer::getScene().getModelInstancesManager().getBvh();
+		ImGui::Text("Bvh: %u instances, %u nodes, quality %.2f", bvh.getItemCount(), bvh.getNodeCount(), bvh.getQuality());
+		ImGui::Text("Transforms updated: %u", SimpleRenderer::getScene().getModelInstancesManager().getTransforms().getLastUpdateCount());
+
+		// Baked potentially visible sets.
+		VisibilityManager& vm = SimpleRenderer::getScene().getVisibilityManager();
+		bool usePvs = vm.getUsePvs();
+		if (ImGui::Checkbox("Use PVS##pvs", &usePvs))
+			vm.setUsePvs(usePvs);
+		Pvs::BakeSettings& settings = vm.getBakeSettings();
+		ImGui::DragFloat("Cell size##pvs", &settings.cellSize, 0.1f, 0.5f, 64.0f);
+		ImGui::DragInt("Voxels per cell##pvs", &settings.voxelsPerCell, 0.1f, 1, 16);
+		ImGui::DragInt("Samples per cell##pvs", &settings.samplesPerCell, 0.1f, 1, 64);
+		if (ImGui::Button("Bake PVS##pvs")) {
+			ModelInstancesManager& mim = SimpleRenderer::getScene().getModelInstancesManager();
+			mim.update();
+			vm.bake(mim);
+		}
+		if (vm.isValid())
+			ImGui::Text("Cells: %d, portals: %d, current cell: %d", vm.getCellCount(), vm.getPortalCount(), vm.getCurrentCell());
+		else
+			ImGui::Text("No valid PVS for this scene.");
+	}
+}
+
 static void PostProcessingGui() {
 	if (ImGui::CollapsingHeader("Post processing##pp")) {
 		bool usePostProcessing = PostProcessing::getUsePostProcessing();
@@ -488,4 +686,17 @@ static void PostProcessingGui() {
 			}
 		}
 	}
+}
+
+// Ray from the camera through the mouse position.
+static int pickModelInstance() {
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	float x = 2.0f * mouse.x / getWindowWidth() - 1.0f, y = 1.0f - 2.0f * mouse.y / getWindowHeight();
+	glm::mat4 projection = glm::perspective(glm::radians(SimpleRenderer::getFov()),
+		static_cast<float>(getWindowWidth()) / getWindowHeight(), SimpleRenderer::getNearPlane(), SimpleRenderer::getFarPlane());
+	glm::mat4 inverse = glm::inverse(projection * buildViewMatrix());
+	glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f), farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+	return SimpleRenderer::getScene().getModelInstancesManager().pick(origin, direction);
 }
\ No newline at end of file
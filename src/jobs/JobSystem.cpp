@@ -0,0 +1,136 @@
+#include "JobSystem.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+static std::vector<std::thread> workers;
+static std::deque<std::function<void()>> queue;
+static std::mutex queueMutex;
+static std::condition_variable queueCondition;
+static bool running = false;
+
+static void workerLoop();
+static bool runOneJob();
+
+void JobSystem::initialize() {
+	if (running)
+		return;
+	running = true;
+
+	// Leave a core for the main thread which is the one talking to the driver.
+	unsigned int count = std::thread::hardware_concurrency();
+	count = count > 1 ? count - 1 : 1;
+	for (unsigned int i = 0; i < count; ++i)
+		workers.emplace_back(workerLoop);
+}
+
+void JobSystem::terminate() {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (!running)
+			return;
+		running = false;
+	}
+	queueCondition.notify_all();
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+	queue.clear();
+}
+
+std::future<void> JobSystem::submit(std::function<void()> job) {
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+	std::future<void> future = task->get_future();
+
+	// If there are no workers run it right away, the future will be ready.
+	if (workers.empty()) {
+		(*task)();
+		return future;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back([task]() { (*task)(); });
+	}
+	queueCondition.notify_one();
+	return future;
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int, unsigned int)>& job) {
+	if (count == 0)
+		return;
+	if (batchSize == 0)
+		batchSize = 1;
+
+	unsigned int batches = (count + batchSize - 1) / batchSize;
+	if (batches == 1 || workers.empty()) {
+		job(0, count);
+		return;
+	}
+
+	// Batches are picked with an atomic counter so the caller can steal work too.
+	auto next = std::make_shared<std::atomic<unsigned int>>(0);
+	auto done = std::make_shared<std::atomic<unsigned int>>(0);
+	auto runBatches = [=, &job]() {
+		unsigned int b;
+		while ((b = next->fetch_add(1)) < batches) {
+			unsigned int begin = b * batchSize;
+			unsigned int end = begin + batchSize < count ? begin + batchSize : count;
+			job(begin, end);
+			done->fetch_add(1);
+		}
+	};
+
+	unsigned int helpers = batches - 1 < workers.size() ? batches - 1 : (unsigned int)workers.size();
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		for (unsigned int i = 0; i < helpers; ++i)
+			queue.push_back(runBatches);
+	}
+	queueCondition.notify_all();
+
+	runBatches();
+
+	// Wait for the batches taken by the workers.
+	// Run other queued jobs meanwhile so that nested parallelFor calls can't deadlock.
+	while (done->load() < batches) {
+		if (!runOneJob())
+			std::this_thread::yield();
+	}
+}
+
+unsigned int JobSystem::getWorkerCount() {
+	return (unsigned int)workers.size();
+}
+
+static bool runOneJob() {
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (queue.empty())
+			return false;
+		job = std::move(queue.front());
+		queue.pop_front();
+	}
+	job();
+	return true;
+}
+
+static void workerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, []() { return !running || !queue.empty(); });
+			if (!running && queue.empty())
+				return;
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+		job();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include <functional>
+#include <future>
+
+// Small thread pool shared by every system that wants to run work off the main thread.
+// Jobs must not do OpenGL calls, the context only lives on the main thread.
+namespace JobSystem {
+	void initialize();
+
+	// Safe to call even if it is not initialized.
+	void terminate();
+
+	// Run a job on a worker thread. Wait on the returned future to get completion.
+	std::future<void> submit(std::function<void()> job);
+
+	// Split [0, count) in batches of batchSize and run them on the workers.
+	// The calling thread helps with the batches and returns when all of them are done,
+	// so it can also be called from inside a job.
+	void parallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int begin, unsigned int end)>& job);
+
+	unsigned int getWorkerCount();
+}
\ No newline at end of file
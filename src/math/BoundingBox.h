@@ -0,0 +1,51 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis aligned bounding box.
+// Starts empty (min > max) so that the first expand sets it.
+struct BoundingBox {
+	glm::vec3 min, max;
+
+	BoundingBox() : min(glm::vec3(std::numeric_limits<float>::max())), max(glm::vec3(std::numeric_limits<float>::lowest())) { }
+	BoundingBox(const glm::vec3& mn, const glm::vec3& mx) : min(mn), max(mx) { }
+
+	bool isValid() const {
+		return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+	}
+	void expand(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+	void expand(const BoundingBox& b) {
+		if (!b.isValid())
+			return;
+		min = glm::min(min, b.min);
+		max = glm::max(max, b.max);
+	}
+	glm::vec3 getCenter() const {
+		return (min + max) * 0.5f;
+	}
+	glm::vec3 getExtent() const {
+		return max - min;
+	}
+	float getSurfaceArea() const {
+		glm::vec3 e = max - min;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+	// Returns corner i (0-7), bit 0 is x, bit 1 is y, bit 2 is z.
+	glm::vec3 getCorner(int i) const {
+		return glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+	}
+	// Box containing this box after transforming it with m.
+	// Uses the center/extent form so it doesn't have to transform all 8 corners.
+	BoundingBox transformed(const glm::mat4& m) const {
+		if (!isValid())
+			return BoundingBox();
+		glm::vec3 center = glm::vec3(m * glm::vec4(getCenter(), 1.0f));
+		glm::vec3 half = getExtent() * 0.5f;
+		glm::mat3 absM = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+		glm::vec3 newHalf = absM * half;
+		return BoundingBox(center - newHalf, center + newHalf);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <limits>
+
+static const int BIN_COUNT = 16;
+// Leaves never get bigger than this, smaller leaves are made only when SAH says it's worth it.
+static const int MAX_LEAF_ITEMS = 8, MIN_LEAF_ITEMS = 2, MAX_DEPTH = 64;
+
+static float surfaceArea(const BoundingBox& b) {
+	return b.isValid() ? b.getSurfaceArea() : 0.0f;
+}
+
+void Bvh::build(const std::vector<BoundingBox>& boxes) {
+	clear();
+	itemBounds = boxes;
+	itemLeaf.assign(boxes.size(), -1);
+	for (unsigned int i = 0; i < boxes.size(); ++i)
+		if (boxes[i].isValid())
+			items.push_back(i);
+	if (items.empty())
+		return;
+
+	// A binary tree with n leaves has 2n - 1 nodes, reserving means references stay valid while building.
+	nodes.reserve(items.size() * 2);
+	Node root;
+	root.leftFirst = 0;
+	root.count = (int)items.size();
+	root.parent = -1;
+	for (unsigned int item : items)
+		root.bounds.expand(itemBounds[item]);
+	nodes.push_back(root);
+	subdivide(0, 0);
+
+	nodeDirty.assign(nodes.size(), 0);
+	for (size_t n = 0; n < nodes.size(); ++n)
+		for (int i = 0; i < nodes[n].count; ++i)
+			itemLeaf[items[nodes[n].leftFirst + i]] = (int)n;
+	buildCost = cost = computeCost();
+}
+
+void Bvh::clear() {
+	nodes.clear();
+	items.clear();
+	itemBounds.clear();
+	itemLeaf.clear();
+	dirtyLeaves.clear();
+	nodeDirty.clear();
+	buildCost = cost = 0.0f;
+}
+
+void Bvh::subdivide(int nodeIndex, int depth) {
+	Node& node = nodes[nodeIndex];
+	if (node.count <= MIN_LEAF_ITEMS || depth >= MAX_DEPTH)
+		return;
+
+	BoundingBox centroids;
+	for (int i = 0; i < node.count; ++i)
+		centroids.expand(itemBounds[items[node.leftFirst + i]].getCenter());
+
+	// Binned SAH over the three axes.
+	int bestAxis = -1, bestSplit = 0;
+	float bestCost = std::numeric_limits<float>::max();
+	for (int axis = 0; axis < 3; ++axis) {
+		float extent = centroids.max[axis] - centroids.min[axis];
+		if (extent <= 0.0f)
+			continue;
+		BoundingBox binBounds[BIN_COUNT];
+		int binCount[BIN_COUNT] = {};
+		float scale = BIN_COUNT / extent;
+		for (int i = 0; i < node.count; ++i) {
+			const BoundingBox& b = itemBounds[items[node.leftFirst + i]];
+			int bin = std::min(BIN_COUNT - 1, (int)((b.getCenter()[axis] - centroids.min[axis]) * scale));
+			binCount[bin]++;
+			binBounds[bin].expand(b);
+		}
+		// Sweep from the right to get the area of every right side, then from the left.
+		float rightArea[BIN_COUNT];
+		int rightCount[BIN_COUNT];
+		BoundingBox acc;
+		int count = 0;
+		for (int b = BIN_COUNT - 1; b > 0; --b) {
+			acc.expand(binBounds[b]);
+			count += binCount[b];
+			rightArea[b] = surfaceArea(acc);
+			rightCount[b] = count;
+		}
+		acc = BoundingBox();
+		count = 0;
+		for (int b = 0; b < BIN_COUNT - 1; ++b) {
+			acc.expand(binBounds[b]);
+			count += binCount[b];
+			if (count == 0 || rightCount[b + 1] == 0)
+				continue;
+			float c = count * surfaceArea(acc) + rightCount[b + 1] * rightArea[b + 1];
+			if (c < bestCost) {
+				bestCost = c;
+				bestAxis = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	// Cost of a split relative to keeping a leaf, with traversal costing as much as one item test.
+	float area = surfaceArea(node.bounds);
+	bool split = bestAxis >= 0 && area + bestCost < node.count * area;
+	if (!split && node.count <= MAX_LEAF_ITEMS)
+		return;
+
+	unsigned int* first = &items[node.leftFirst];
+	unsigned int* last = first + node.count;
+	unsigned int* middle;
+	if (bestAxis >= 0) {
+		float scale = BIN_COUNT / (centroids.max[bestAxis] - centroids.min[bestAxis]);
+		float minC = centroids.min[bestAxis];
+		middle = std::partition(first, last, [&](unsigned int item) {
+			int bin = std::min(BIN_COUNT - 1, (int)((itemBounds[item].getCenter()[bestAxis] - minC) * scale));
+			return bin < bestSplit;
+		});
+	}
+	else {
+		// All centroids in the same point, split in half.
+		middle = first + node.count / 2;
+	}
+
+	int leftCount = (int)(middle - first);
+	int leftIndex = (int)nodes.size();
+	Node left, right;
+	left.leftFirst = node.leftFirst;
+	left.count = leftCount;
+	left.parent = nodeIndex;
+	right.leftFirst = node.leftFirst + leftCount;
+	right.count = node.count - leftCount;
+	right.parent = nodeIndex;
+	for (int i = 0; i < left.count; ++i)
+		left.bounds.expand(itemBounds[items[left.leftFirst + i]]);
+	for (int i = 0; i < right.count; ++i)
+		right.bounds.expand(itemBounds[items[right.leftFirst + i]]);
+	node.leftFirst = leftIndex;
+	node.count = 0;
+	nodes.push_back(left);
+	nodes.push_back(right);
+
+	subdivide(leftIndex, depth + 1);
+	subdivide(leftIndex + 1, depth + 1);
+}
+
+bool Bvh::update(unsigned int item, const BoundingBox& box) {
+	if (item >= itemLeaf.size() || itemLeaf[item] < 0)
+		return !box.isValid();
+	if (!box.isValid())
+		return false;
+	itemBounds[item] = box;
+	int leaf = itemLeaf[item];
+	if (!nodeDirty[leaf]) {
+		nodeDirty[leaf] = 1;
+		dirtyLeaves.push_back(leaf);
+	}
+	return true;
+}
+
+void Bvh::refit() {
+	if (dirtyLeaves.empty())
+		return;
+
+	// Collect dirty leaves and their ancestors once.
+	std::vector<int> dirtyNodes;
+	for (int leaf : dirtyLeaves) {
+		dirtyNodes.push_back(leaf);
+		for (int n = nodes[leaf].parent; n >= 0 && !nodeDirty[n]; n = nodes[n].parent) {
+			nodeDirty[n] = 1;
+			dirtyNodes.push_back(n);
+		}
+	}
+	dirtyLeaves.clear();
+
+	// Children are always created after their parent, so higher indices first means bottom up.
+	std::sort(dirtyNodes.begin(), dirtyNodes.end(), std::greater<int>());
+	for (int n : dirtyNodes) {
+		Node& node = nodes[n];
+		node.bounds = BoundingBox();
+		if (node.count > 0) {
+			for (int i = 0; i < node.count; ++i)
+				node.bounds.expand(itemBounds[items[node.leftFirst + i]]);
+		}
+		else {
+			node.bounds.expand(nodes[node.leftFirst].bounds);
+			node.bounds.expand(nodes[node.leftFirst + 1].bounds);
+		}
+		nodeDirty[n] = 0;
+	}
+	cost = computeCost();
+}
+
+// SAH cost of the whole tree relative to the root area.
+float Bvh::computeCost() const {
+	if (nodes.empty())
+		return 0.0f;
+	float total = 0.0f;
+	for (const auto& n : nodes)
+		total += surfaceArea(n.bounds) * (n.count > 0 ? n.count : 1);
+	float rootArea = surfaceArea(nodes[0].bounds);
+	return rootArea > 0.0f ? total / rootArea : 0.0f;
+}
+
+float Bvh::getQuality() const {
+	return buildCost > 0.0f ? cost / buildCost : 1.0f;
+}
+
+bool Bvh::isEmpty() const {
+	return nodes.empty();
+}
+
+unsigned int Bvh::getNodeCount() const {
+	return (unsigned int)nodes.size();
+}
+
+unsigned int Bvh::getItemCount() const {
+	return (unsigned int)items.size();
+}
+
+const BoundingBox& Bvh::getItemBounds(unsigned int item) const {
+	return itemBounds[item];
+}
+
+void Bvh::queryFrustum(const glm::mat4& viewProj, std::vector<unsigned int>& out, bool ignoreNear) const {
+	if (nodes.empty())
+		return;
+
+	// Planes from the rows of the matrix, inside when dot(plane.xyz, p) + plane.w >= 0.
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+	const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+		rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+	// Each stack entry keeps the planes that still have to be tested, children of a node
+	// fully inside a plane don't test it again.
+	struct Entry { int node; unsigned int mask; };
+	Entry stack[MAX_DEPTH * 2 + 2];
+	int top = 0;
+	stack[top++] = { 0, ignoreNear ? 0x2Fu : 0x3Fu };
+	while (top > 0) {
+		Entry e = stack[--top];
+		const Node& node = nodes[e.node];
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p) {
+			if (!(e.mask & (1u << p)))
+				continue;
+			const glm::vec4& pl = planes[p];
+			glm::vec3 positive(pl.x >= 0 ? node.bounds.max.x : node.bounds.min.x,
+				pl.y >= 0 ? node.bounds.max.y : node.bounds.min.y, pl.z >= 0 ? node.bounds.max.z : node.bounds.min.z);
+			if (glm::dot(glm::vec3(pl), positive) + pl.w < 0.0f) {
+				outside = true;
+				break;
+			}
+			glm::vec3 negative(pl.x >= 0 ? node.bounds.min.x : node.bounds.max.x,
+				pl.y >= 0 ? node.bounds.min.y : node.bounds.max.y, pl.z >= 0 ? node.bounds.min.z : node.bounds.max.z);
+			if (glm::dot(glm::vec3(pl), negative) + pl.w >= 0.0f)
+				e.mask &= ~(1u << p);
+		}
+		if (outside)
+			continue;
+		if (node.count > 0) {
+			// Items of a leaf are tested again unless the leaf is fully inside.
+			for (int i = 0; i < node.count; ++i) {
+				unsigned int item = items[node.leftFirst + i];
+				bool visible = true;
+				const BoundingBox& b = itemBounds[item];
+				for (int p = 0; p < 6 && visible && e.mask; ++p) {
+					if (!(e.mask & (1u << p)))
+						continue;
+					const glm::vec4& pl = planes[p];
+					glm::vec3 positive(pl.x >= 0 ? b.max.x : b.min.x, pl.y >= 0 ? b.max.y : b.min.y, pl.z >= 0 ? b.max.z : b.min.z);
+					visible = glm::dot(glm::vec3(pl), positive) + pl.w >= 0.0f;
+				}
+				if (visible)
+					out.push_back(item);
+			}
+		}
+		else {
+			stack[top++] = { node.leftFirst, e.mask };
+			stack[top++] = { node.leftFirst + 1, e.mask };
+		}
+	}
+}
+
+void Bvh::querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& out) const {
+	if (nodes.empty())
+		return;
+	float radiusSquared = radius * radius;
+	auto overlaps = [&](const BoundingBox& b) {
+		glm::vec3 d = center - glm::clamp(center, b.min, b.max);
+		return glm::dot(d, d) <= radiusSquared;
+	};
+
+	int stack[MAX_DEPTH * 2 + 2];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (!overlaps(node.bounds))
+			continue;
+		if (node.count > 0) {
+			for (int i = 0; i < node.count; ++i) {
+				unsigned int item = items[node.leftFirst + i];
+				if (overlaps(itemBounds[item]))
+					out.push_back(item);
+			}
+		}
+		else {
+			stack[top++] = node.leftFirst;
+			stack[top++] = node.leftFirst + 1;
+		}
+	}
+}
+
+// Slab test, returns entry distance or a negative number on a miss.
+static float rayBox(const BoundingBox& b, const glm::vec3& origin, const glm::vec3& invDir, float maxT) {
+	glm::vec3 t0 = (b.min - origin) * invDir, t1 = (b.max - origin) * invDir;
+	glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+	float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxT));
+	return enter <= exit ? enter : -1.0f;
+}
+
+int Bvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float& t, const std::function<bool(unsigned int, float&)>& refine) const {
+	if (nodes.empty())
+		return -1;
+	glm::vec3 invDir = 1.0f / dir;
+	float closest = std::numeric_limits<float>::max();
+	int hit = -1;
+
+	int stack[MAX_DEPTH * 2 + 2];
+	int top = 0;
+	if (rayBox(nodes[0].bounds, origin, invDir, closest) >= 0.0f)
+		stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (node.count > 0) {
+			for (int i = 0; i < node.count; ++i) {
+				unsigned int item = items[node.leftFirst + i];
+				float itemT = rayBox(itemBounds[item], origin, invDir, closest);
+				if (itemT < 0.0f)
+					continue;
+				if (refine && !refine(item, itemT))
+					continue;
+				if (itemT < closest) {
+					closest = itemT;
+					hit = (int)item;
+				}
+			}
+			continue;
+		}
+		// Visit the nearest child first so that farther ones are more likely to be skipped.
+		int a = node.leftFirst, b = node.leftFirst + 1;
+		float ta = rayBox(nodes[a].bounds, origin, invDir, closest), tb = rayBox(nodes[b].bounds, origin, invDir, closest);
+		if (ta >= 0.0f && tb >= 0.0f && ta < tb) {
+			std::swap(a, b);
+			std::swap(ta, tb);
+		}
+		if (ta >= 0.0f)
+			stack[top++] = a;
+		if (tb >= 0.0f)
+			stack[top++] = b;
+	}
+	if (hit >= 0)
+		t = closest;
+	return hit;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+
+// Bounding volume hierarchy over a set of boxes, each box is identified by its index (item).
+// Built with binned SAH. When boxes move the tree is refitted, which keeps queries correct
+// but makes them slower over time, getQuality() tells when it is worth building it again.
+class Bvh {
+public:
+	struct Node {
+		BoundingBox bounds;
+		// Interior node: index of the left child, the right one is right after it.
+		// Leaf: index of the first item in items.
+		int leftFirst;
+		// Number of items, 0 for interior nodes.
+		int count;
+		int parent;
+	};
+private:
+	std::vector<Node> nodes;
+	std::vector<unsigned int> items;
+	std::vector<BoundingBox> itemBounds;
+	// Leaf containing each item, -1 if the item is not in the tree (invalid box).
+	std::vector<int> itemLeaf;
+	std::vector<int> dirtyLeaves;
+	std::vector<unsigned char> nodeDirty;
+	float buildCost, cost;
+
+	void subdivide(int node, int depth);
+	float computeCost() const;
+public:
+	Bvh() : buildCost(0.0f), cost(0.0f) { };
+
+	// Build from scratch. Items with invalid boxes are left out.
+	void build(const std::vector<BoundingBox>& boxes);
+	void clear();
+	// Change the box of an item, takes effect on the next refit().
+	// Returns false if the item isn't in the tree, in that case it must be built again.
+	bool update(unsigned int item, const BoundingBox& box);
+	// Update bounds of nodes above changed items.
+	void refit();
+
+	// Refitted cost over cost after build, 1 is as good as a fresh build.
+	float getQuality() const;
+	bool isEmpty() const;
+	unsigned int getNodeCount() const;
+	unsigned int getItemCount() const;
+	const BoundingBox& getItemBounds(unsigned int item) const;
+
+	// Items whose box intersects the frustum. With ignoreNear objects behind the near plane are kept,
+	// which is what shadow casters need.
+	void queryFrustum(const glm::mat4& viewProj, std::vector<unsigned int>& out, bool ignoreNear = false) const;
+	// Items whose box intersects the sphere.
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& out) const;
+	// Closest item hit by the ray, -1 if none. t is the distance along dir.
+	// If refine is given it is called for every item whose box is hit, it returns false
+	// on a miss or true and a (possibly closer than box) distance on a hit.
+	int raycast(const glm::vec3& origin, const glm::vec3& dir, float& t,
+		const std::function<bool(unsigned int, float&)>& refine = nullptr) const;
+};
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "AssetDatabase.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <mutex>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "ProjectDirectory.h"
+#include "vfs/Vfs.h"
+
+static const uint32_t MAGIC = 0x42444147, VERSION = 2;
+
+static std::deque<AssetDatabase::ModelRecord> records;
+static std::unordered_map<std::string, unsigned int> nameIndices;
+static std::unordered_map<unsigned int, unsigned int> idIndices;
+static unsigned int nextId = 1;
+static bool dirty = false;
+// Imports run on workers (hot reload, the cooker) and look up records while the main thread does.
+static std::mutex mutex;
+static AssetDatabase::Stats stats;
+
+static std::string getIndexPath();
+static std::string getModelFolder(const std::string& name);
+static bool loadIndex(std::vector<AssetDatabase::ModelRecord>& loaded);
+static void saveIndex();
+static bool isCurrent(const AssetDatabase::ModelRecord& record);
+static void indexModel(AssetDatabase::ModelRecord& record);
+static void addRecord(const AssetDatabase::ModelRecord& record);
+static int64_t getWriteTime(const std::string& path);
+static uint64_t hashFile(const std::string& path);
+static uint64_t computeSourceHash(const AssetDatabase::ModelRecord& record);
+
+void AssetDatabase::initialize() {
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<ModelRecord> loaded;
+	if (!loadIndex(loaded))
+		dirty = true;
+	std::unordered_map<std::string, unsigned int> previous;
+	for (unsigned int i = 0; i < loaded.size(); ++i)
+		previous[loaded[i].name] = i;
+
+	// Folders keep their id, new folders get the next one. Removed folders leave the index.
+	std::vector<std::string> folders = Vfs::list(project_directory + "\\assets\\models", true);
+	if (folders.size() != loaded.size())
+		dirty = true;
+	for (const std::string& folder : folders) {
+		const auto& it = previous.find(folder);
+		ModelRecord record;
+		if (it != previous.end() && isCurrent(loaded[it->second])) {
+			addRecord(loaded[it->second]);
+			continue;
+		}
+		if (it != previous.end())
+			record = loaded[it->second];
+		else
+			record.id = nextId++;
+		record.name = folder;
+		indexModel(record);
+		addRecord(record);
+		dirty = true;
+	}
+	if (dirty)
+		saveIndex();
+	stats.models = (unsigned int)records.size();
+	stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void AssetDatabase::terminate() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (dirty)
+		saveIndex();
+	records.clear();
+	nameIndices.clear();
+	idIndices.clear();
+	nextId = 1;
+	stats = Stats();
+}
+
+const AssetDatabase::ModelRecord* AssetDatabase::findModel(const std::string& name) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto& it = nameIndices.find(name);
+	if (it != nameIndices.end())
+		return &records[it->second];
+	if (name.empty() || !Vfs::stat(getModelFolder(name)).directory)
+		return nullptr;
+	ModelRecord record;
+	record.id = nextId++;
+	record.name = name;
+	indexModel(record);
+	addRecord(record);
+	stats.models++;
+	dirty = true;
+	return &records.back();
+}
+
+const AssetDatabase::ModelRecord* AssetDatabase::getModel(unsigned int id) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto& it = idIndices.find(id);
+	return it != idIndices.end() ? &records[it->second] : nullptr;
+}
+
+void AssetDatabase::refreshModel(const std::string& name) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto& it = nameIndices.find(name);
+	if (it == nameIndices.end() || isCurrent(records[it->second]))
+		return;
+	indexModel(records[it->second]);
+	dirty = true;
+}
+
+const std::deque<AssetDatabase::ModelRecord>& AssetDatabase::getModels() {
+	return records;
+}
+
+AssetDatabase::Stats AssetDatabase::getStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+static void addRecord(const AssetDatabase::ModelRecord& record) {
+	nameIndices[record.name] = (unsigned int)records.size();
+	idIndices[record.id] = (unsigned int)records.size();
+	records.push_back(record);
+	if (record.id >= nextId)
+		nextId = record.id + 1;
+}
+
+// The record is current if its property files, model file and source files have the times and sizes it was indexed with.
+static bool isCurrent(const AssetDatabase::ModelRecord& record) {
+	std::string folder = getModelFolder(record.name);
+	if (getWriteTime(folder + "model_properties.txt") != record.propertiesTime ||
+		getWriteTime(folder + "texture_properties.txt") != record.texturePropertiesTime)
+		return false;
+	for (const auto& source : record.sourceFiles) {
+		Vfs::Info info = Vfs::stat(folder + source.name);
+		if (info.size != source.size || info.writeTime != source.time)
+			return false;
+	}
+	Vfs::Info model = Vfs::stat(folder + record.name + "." + record.extension);
+	return model.exists && model.size == record.fileSize && model.writeTime == record.fileTime;
+}
+
+// Parse the property files of the folder and hash the model file if it changed.
+static void indexModel(AssetDatabase::ModelRecord& record) {
+	std::string folder = getModelFolder(record.name);
+	stats.parsed++;
+
+	// "property: value" lines.
+	record.fileName = record.extension = record.loader = record.occluderProxy = "";
+	record.propertiesTime = getWriteTime(folder + "model_properties.txt");
+	std::string line;
+	try {
+		std::istringstream modFile(Vfs::open(folder + "model_properties.txt").toString());
+		while (std::getline(modFile, line)) {
+			while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+				line.pop_back();
+			size_t colon = line.find(':');
+			if (colon == std::string::npos)
+				continue;
+			size_t start = line.find_first_not_of(' ', colon + 1);
+			std::string key = line.substr(0, colon), value = start == std::string::npos ? "" : line.substr(start);
+			if (key == "fileName")
+				record.fileName = value;
+			else if (key == "fileExtension")
+				record.extension = value;
+			else if (key == "loader")
+				record.loader = value;
+			else if (key == "occluderProxy")
+				record.occluderProxy = value;
+		}
+	}
+	catch (...) {
+		std::cout << "Error while opening or reading model_properties.txt file" << std::endl;
+	}
+
+	// "mesh type name [gamma]" lines.
+	record.textures.clear();
+	record.texturePropertiesTime = getWriteTime(folder + "texture_properties.txt");
+	try {
+		std::istringstream texturePropertiesFile(Vfs::open(folder + "texture_properties.txt").toString());
+		while (std::getline(texturePropertiesFile, line)) {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			size_t first = line.find(' ');
+			if (line.empty() || first == std::string::npos)
+				continue;
+			size_t second = line.find(' ', first + 1);
+			if (second == std::string::npos)
+				continue;
+			std::string type = line.substr(first + 1, second - first - 1);
+			std::string name = line.substr(second + 1);
+			size_t third = name.find(' ');
+			AssetDatabase::TextureEntry entry;
+			entry.mesh = (unsigned int)std::stoul(line.substr(0, first));
+			entry.gammaCorrect = third != std::string::npos && name.substr(third + 1) == "gamma";
+			entry.name = third != std::string::npos ? name.substr(0, third) : name;
+			if (type == "diffuse")
+				entry.type = TextureType::DIFFUSE;
+			else if (type == "metallic")
+				entry.type = TextureType::METALLIC;
+			else if (type == "roughness")
+				entry.type = TextureType::ROUGHNESS;
+			else if (type == "normals")
+				entry.type = TextureType::NORMAL;
+			else if (type == "ao")
+				entry.type = TextureType::AMBIENT_OCCLUSION;
+			else
+				continue;
+			record.textures.push_back(entry);
+		}
+	}
+	catch (...) {
+		std::cout << "Error while opening textures properties file" << std::endl;
+	}
+
+	// The model file has the name of the folder. The content hash is the slow part, it's kept while the file doesn't change.
+	std::string modelFile = record.name + "." + record.extension;
+	Vfs::Info model = Vfs::stat(folder + modelFile);
+	uint64_t size = model.size;
+	int64_t time = model.writeTime;
+	if (!model.exists) {
+		record.fileSize = record.hash = 0;
+		record.fileTime = 0;
+	}
+	else if (size != record.fileSize || time != record.fileTime || record.hash == 0) {
+		record.fileSize = size;
+		record.fileTime = time;
+		record.hash = hashFile(folder + modelFile);
+		stats.hashed++;
+	}
+
+	record.dependencies.clear();
+	record.dependencies.push_back(modelFile);
+	if (record.extension == "obj" && Vfs::exists(folder + record.name + ".mtl"))
+		record.dependencies.push_back(record.name + ".mtl");
+	if (record.extension == "gltf" && Vfs::exists(folder + record.name + ".bin"))
+		record.dependencies.push_back(record.name + ".bin");
+	if (!record.occluderProxy.empty())
+		record.dependencies.push_back(record.occluderProxy);
+	for (const auto& texture : record.textures)
+		if (std::find(record.dependencies.begin(), record.dependencies.end(), texture.name) == record.dependencies.end())
+			record.dependencies.push_back(texture.name);
+
+	// Textures are cooked on their own, the other files are hashed like the model file.
+	std::vector<AssetDatabase::SourceFile> previous = std::move(record.sourceFiles);
+	record.sourceFiles.clear();
+	for (size_t i = 1; i < record.dependencies.size(); ++i) {
+		const std::string& name = record.dependencies[i];
+		if (std::any_of(record.textures.begin(), record.textures.end(), [&name](const AssetDatabase::TextureEntry& t) { return t.name == name; }))
+			continue;
+		AssetDatabase::SourceFile source;
+		source.name = name;
+		Vfs::Info info = Vfs::stat(folder + name);
+		source.size = info.size;
+		source.time = info.writeTime;
+		auto it = std::find_if(previous.begin(), previous.end(), [&name](const AssetDatabase::SourceFile& s) { return s.name == name; });
+		if (it != previous.end() && it->size == source.size && it->time == source.time && it->hash != 0)
+			source.hash = it->hash;
+		else if (info.exists) {
+			source.hash = hashFile(folder + name);
+			stats.hashed++;
+		}
+		record.sourceFiles.push_back(source);
+	}
+	record.sourceHash = computeSourceHash(record);
+}
+
+// FNV-1a over the hashes and the values read from the property files, no file is read.
+static uint64_t computeSourceHash(const AssetDatabase::ModelRecord& record) {
+	if (record.hash == 0)
+		return 0;
+	uint64_t h = 14695981039346656037ull;
+	auto add = [&h](const void* data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			h ^= ((const unsigned char*)data)[i];
+			h *= 1099511628211ull;
+		}
+	};
+	auto addString = [&add](const std::string& s) {
+		uint64_t size = s.size();
+		add(&size, sizeof(size));
+		add(s.data(), s.size());
+	};
+	add(&record.hash, sizeof(record.hash));
+	for (const std::string* s : { &record.fileName, &record.extension, &record.loader, &record.occluderProxy })
+		addString(*s);
+	for (const auto& texture : record.textures) {
+		uint32_t values[3] = { texture.mesh, (uint32_t)texture.type, (uint32_t)texture.gammaCorrect };
+		add(values, sizeof(values));
+		addString(texture.name);
+	}
+	for (const auto& source : record.sourceFiles) {
+		addString(source.name);
+		add(&source.size, sizeof(source.size));
+		add(&source.hash, sizeof(source.hash));
+	}
+	return h == 0 ? 1 : h;
+}
+
+static void writeString(std::ofstream& f, const std::string& s) {
+	uint32_t length = (uint32_t)s.size();
+	f.write((const char*)&length, sizeof(length));
+	f.write(s.data(), length);
+}
+
+template<typename T>
+static void writeValue(std::ofstream& f, T value) {
+	f.write((const char*)&value, sizeof(value));
+}
+
+static void saveIndex() {
+	std::string path = getIndexPath();
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		writeValue(f, MAGIC);
+		writeValue(f, VERSION);
+		writeValue(f, (uint32_t)nextId);
+		writeValue(f, (uint32_t)records.size());
+		for (const auto& record : records) {
+			writeValue(f, (uint32_t)record.id);
+			for (const std::string* s : { &record.name, &record.fileName, &record.extension, &record.loader, &record.occluderProxy })
+				writeString(f, *s);
+			writeValue(f, record.fileSize);
+			writeValue(f, record.hash);
+			writeValue(f, record.fileTime);
+			writeValue(f, record.propertiesTime);
+			writeValue(f, record.texturePropertiesTime);
+			writeValue(f, (uint32_t)record.dependencies.size());
+			for (const auto& dependency : record.dependencies)
+				writeString(f, dependency);
+			writeValue(f, (uint32_t)record.textures.size());
+			for (const auto& texture : record.textures) {
+				writeValue(f, (uint32_t)texture.mesh);
+				writeValue(f, (uint32_t)texture.type);
+				writeString(f, texture.name);
+				writeValue(f, (uint8_t)texture.gammaCorrect);
+			}
+			writeValue(f, (uint32_t)record.sourceFiles.size());
+			for (const auto& source : record.sourceFiles) {
+				writeString(f, source.name);
+				writeValue(f, source.size);
+				writeValue(f, source.hash);
+				writeValue(f, source.time);
+			}
+			writeValue(f, record.sourceHash);
+		}
+		if (!f)
+			std::cout << "Error while writing asset index " << path << std::endl;
+		dirty = !f;
+	}
+	catch (...) {
+		std::cout << "Error while writing asset index " << path << std::endl;
+	}
+}
+
+// Bounds checked reads of the mapped index.
+struct IndexReader {
+	const char* p;
+	const char* end;
+	bool ok = true;
+
+	template<typename T>
+	T read() {
+		T value = T();
+		if ((size_t)(end - p) < sizeof(T)) {
+			ok = false;
+			return value;
+		}
+		memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return value;
+	}
+	std::string readString() {
+		uint32_t length = read<uint32_t>();
+		if (!ok || (size_t)(end - p) < length) {
+			ok = false;
+			return std::string();
+		}
+		std::string s(p, length);
+		p += length;
+		return s;
+	}
+};
+
+static bool loadIndex(std::vector<AssetDatabase::ModelRecord>& loaded) {
+	MappedFile file(getIndexPath());
+	if (!file.isOpen())
+		return false;
+	IndexReader reader = { file.getData(), file.getData() + file.getSize() };
+	if (reader.read<uint32_t>() != MAGIC || reader.read<uint32_t>() != VERSION)
+		return false;
+	nextId = reader.read<uint32_t>();
+	uint32_t count = reader.read<uint32_t>();
+	for (uint32_t i = 0; i < count && reader.ok; ++i) {
+		AssetDatabase::ModelRecord record;
+		record.id = reader.read<uint32_t>();
+		for (std::string* s : { &record.name, &record.fileName, &record.extension, &record.loader, &record.occluderProxy })
+			*s = reader.readString();
+		record.fileSize = reader.read<uint64_t>();
+		record.hash = reader.read<uint64_t>();
+		record.fileTime = reader.read<int64_t>();
+		record.propertiesTime = reader.read<int64_t>();
+		record.texturePropertiesTime = reader.read<int64_t>();
+		uint32_t dependencyCount = reader.read<uint32_t>();
+		for (uint32_t d = 0; d < dependencyCount && reader.ok; ++d)
+			record.dependencies.push_back(reader.readString());
+		uint32_t textureCount = reader.read<uint32_t>();
+		for (uint32_t t = 0; t < textureCount && reader.ok; ++t) {
+			AssetDatabase::TextureEntry texture;
+			texture.mesh = reader.read<uint32_t>();
+			texture.type = (TextureType)reader.read<uint32_t>();
+			texture.name = reader.readString();
+			texture.gammaCorrect = reader.read<uint8_t>() != 0;
+			record.textures.push_back(texture);
+		}
+		uint32_t sourceCount = reader.read<uint32_t>();
+		for (uint32_t s = 0; s < sourceCount && reader.ok; ++s) {
+			AssetDatabase::SourceFile source;
+			source.name = reader.readString();
+			source.size = reader.read<uint64_t>();
+			source.hash = reader.read<uint64_t>();
+			source.time = reader.read<int64_t>();
+			record.sourceFiles.push_back(source);
+		}
+		record.sourceHash = reader.read<uint64_t>();
+		loaded.push_back(record);
+	}
+	if (!reader.ok) {
+		// A truncated index is rebuilt from the folders.
+		std::cout << "Asset index " << getIndexPath() << " is damaged, it's built again" << std::endl;
+		loaded.clear();
+		nextId = 1;
+		return false;
+	}
+	return true;
+}
+
+// Write time as a number, 0 if the file doesn't exist.
+static int64_t getWriteTime(const std::string& path) {
+	return Vfs::stat(path).writeTime;
+}
+
+// FNV-1a of the file content.
+static uint64_t hashFile(const std::string& path) {
+	Vfs::File file = Vfs::open(path);
+	uint64_t h = 14695981039346656037ull;
+	const unsigned char* data = (const unsigned char*)file.getData();
+	for (size_t i = 0; i < file.getSize(); ++i) {
+		h ^= data[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+static std::string getIndexPath() {
+	return project_directory + "\\cache\\asset_index.bin";
+}
+
+static std::string getModelFolder(const std::string& name) {
+	return project_directory + "\\assets\\models\\" + name + "\\";
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Index of every model folder in assets\models, built once at startup and saved in cache\asset_index.bin.
+// On later runs only folders whose model file, property files or source files changed (size or write time) are parsed again,
+// so loading a model never reads model_properties.txt or texture_properties.txt.
+// Ids are stable across runs and never reused.
+namespace AssetDatabase {
+	// Line of texture_properties.txt.
+	struct TextureEntry {
+		unsigned int mesh;
+		TextureType type;
+		// Relative to the model folder.
+		std::string name;
+		bool gammaCorrect;
+	};
+
+	// File read by the import other than the model file and textures (material, buffers, occluder proxy).
+	struct SourceFile {
+		// Relative to the model folder.
+		std::string name;
+		// FNV-1a of the content, only computed again when size or time change.
+		uint64_t size = 0, hash = 0;
+		int64_t time = 0;
+	};
+
+	struct ModelRecord {
+		unsigned int id = 0;
+		// Folder name, used by the engine.
+		std::string name;
+		// Values of model_properties.txt, empty if not given.
+		std::string fileName, extension, loader, occluderProxy;
+		// Model file (folder name and extension), the hash is FNV-1a of its content and is only computed again when size or time change.
+		uint64_t fileSize = 0, hash = 0;
+		int64_t fileTime = 0, propertiesTime = 0, texturePropertiesTime = 0;
+		// Files of the folder the model reads, relative to it.
+		std::vector<std::string> dependencies;
+		std::vector<TextureEntry> textures;
+		std::vector<SourceFile> sourceFiles;
+		// Combined hash of the model file, the property values and sourceFiles, cooked models are checked against it.
+		// 0 if the model file isn't there.
+		uint64_t sourceHash = 0;
+	};
+
+	struct Stats {
+		unsigned int models = 0;
+		// Folders parsed and model files hashed by this run, the rest came from the index.
+		unsigned int parsed = 0, hashed = 0;
+		float milliseconds = 0.0f;
+	};
+
+	// Load the index and bring it up to date with the folders, it's saved if anything changed.
+	void initialize();
+	// Save the index if models were indexed after initialize.
+	void terminate();
+	// nullptr if there is no such model folder. Folders added while running are indexed on their first lookup.
+	// Records don't move, pointers stay valid until terminate. Lookups are safe from any thread.
+	const ModelRecord* findModel(const std::string& name);
+	const ModelRecord* getModel(unsigned int id);
+	// Index the folder again if its files changed since the record was made, used by hot reload.
+	// The record changes in place, so it must not run while the model is being imported.
+	void refreshModel(const std::string& name);
+	const std::deque<ModelRecord>& getModels();
+	Stats getStats();
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "CookedAssets.h"
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+#include "AssetDatabase.h"
+#include "ProjectDirectory.h"
+#include "vfs/Vfs.h"
+#include "vfs/BinaryReader.h"
+
+static const uint32_t MODEL_MAGIC = 0x4C444D47, CUBEMAP_MAGIC = 0x42554347, VERSION = 1;
+
+static_assert(std::is_trivially_copyable<Material>::value, "Materials are saved as they are in memory");
+
+template<typename T>
+static void writeValue(std::ofstream& f, const T& v) {
+	f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+static void writeVector(std::ofstream& f, const std::vector<T>& v) {
+	writeValue(f, (uint32_t)v.size());
+	if (!v.empty())
+		f.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+static void writeString(std::ofstream& f, const std::string& s) {
+	writeValue(f, (uint16_t)s.size());
+	f.write(s.data(), s.size());
+}
+
+// Paths are saved relative to the project directory, so cooked data works from any folder.
+static void writePath(std::ofstream& f, const std::string& path) {
+	std::string prefix = project_directory + "\\";
+	writeString(f, path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : path);
+}
+
+static bool readPath(BinaryReader& reader, std::string& path) {
+	if (!reader.readString(path))
+		return false;
+	if (!path.empty() && std::filesystem::path(path).is_relative())
+		path = project_directory + "\\" + path;
+	return true;
+}
+
+static void writeTextureFiles(std::ofstream& f, const std::vector<ModelImport::TextureFile>& files) {
+	writeValue(f, (uint32_t)files.size());
+	for (const auto& file : files) {
+		writePath(f, file.path);
+		writeValue(f, (unsigned char)file.srgb);
+		writePath(f, file.cookedPath);
+	}
+}
+
+static bool readTextureFiles(BinaryReader& reader, std::vector<ModelImport::TextureFile>& files) {
+	uint32_t count;
+	if (!reader.read(count))
+		return false;
+	for (uint32_t i = 0; i < count; ++i) {
+		ModelImport::TextureFile file;
+		unsigned char srgb;
+		if (!readPath(reader, file.path) || !reader.read(srgb) || !readPath(reader, file.cookedPath))
+			return false;
+		file.srgb = srgb != 0;
+		files.push_back(file);
+	}
+	return true;
+}
+
+std::string CookedAssets::getModelPath(const std::string& name) {
+	return project_directory + "\\cooked\\models\\" + name + ".gmodel";
+}
+
+std::string CookedAssets::getCubemapPath(const std::string& name) {
+	return project_directory + "\\cooked\\cubemaps\\" + name + ".gcube";
+}
+
+// Kept in the asset database record, so no source file is read to decide if the cooked copy can be used.
+uint64_t CookedAssets::getSourceHash(const std::string& name) {
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	return record ? record->sourceHash : 0;
+}
+
+bool CookedAssets::saveModel(const std::string& path, uint64_t sourceHash, const ModelImport::ModelData& data) {
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		writeValue(f, MODEL_MAGIC);
+		writeValue(f, VERSION);
+		writeValue(f, sourceHash);
+		writeString(f, data.loader);
+		writeValue(f, (uint32_t)data.meshes.size());
+		for (const auto& mesh : data.meshes) {
+			writeVector(f, mesh.vertices);
+			writeVector(f, mesh.indices);
+			writeValue(f, mesh.material);
+			writeTextureFiles(f, mesh.textures.diffuse);
+			writeTextureFiles(f, mesh.textures.normals);
+			writePath(f, mesh.textures.ao);
+			writePath(f, mesh.textures.roughness);
+			writePath(f, mesh.textures.metallic);
+			writeValue(f, (unsigned char)mesh.textures.gltfChannels);
+			writePath(f, mesh.textures.ormCookedPath);
+		}
+		writeVector(f, data.occluderProxy.positions);
+		writeVector(f, data.occluderProxy.indices);
+		return (bool)f;
+	}
+	catch (...) {
+		std::cout << "Error while writing cooked model " << path << std::endl;
+		return false;
+	}
+}
+
+bool CookedAssets::loadModel(const std::string& path, uint64_t sourceHash, ModelImport::ModelData& data) {
+	Vfs::File file = Vfs::open(path);
+	if (!file.isOpen())
+		return false;
+	BinaryReader reader(file.getData(), file.getSize());
+	uint32_t magic, version, meshCount;
+	uint64_t cookedHash;
+	if (!reader.read(magic) || magic != MODEL_MAGIC || !reader.read(version) || version != VERSION || !reader.read(cookedHash))
+		return false;
+	if (sourceHash != 0 && cookedHash != sourceHash)
+		return false;
+	data = ModelImport::ModelData();
+	bool ok = reader.readString(data.loader) && reader.read(meshCount);
+	for (uint32_t i = 0; ok && i < meshCount; ++i) {
+		ModelImport::MeshData mesh;
+		unsigned char gltfChannels = 0;
+		ok = reader.readVector(mesh.vertices) && reader.readVector(mesh.indices) && reader.read(mesh.material) &&
+			readTextureFiles(reader, mesh.textures.diffuse) && readTextureFiles(reader, mesh.textures.normals) &&
+			readPath(reader, mesh.textures.ao) && readPath(reader, mesh.textures.roughness) && readPath(reader, mesh.textures.metallic) &&
+			reader.read(gltfChannels) && readPath(reader, mesh.textures.ormCookedPath);
+		mesh.textures.gltfChannels = gltfChannels != 0;
+		// Indices are checked once here, meshes trust them afterwards.
+		for (unsigned int index : mesh.indices)
+			ok = ok && index < mesh.vertices.size();
+		data.meshes.push_back(std::move(mesh));
+	}
+	ok = ok && reader.readVector(data.occluderProxy.positions) && reader.readVector(data.occluderProxy.indices);
+	if (!ok) {
+		std::cout << "Cooked model is corrupted: " << path << std::endl;
+		data = ModelImport::ModelData();
+		return false;
+	}
+	data.loader = "cooked";
+	return true;
+}
+
+bool CookedAssets::saveCubemap(const std::string& path, const CubemapFace faces[6]) {
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		writeValue(f, CUBEMAP_MAGIC);
+		writeValue(f, VERSION);
+		for (int i = 0; i < 6; ++i) {
+			writeValue(f, faces[i].width);
+			writeValue(f, faces[i].height);
+			writeValue(f, faces[i].components);
+			writeVector(f, faces[i].pixels);
+		}
+		return (bool)f;
+	}
+	catch (...) {
+		std::cout << "Error while writing cooked cubemap " << path << std::endl;
+		return false;
+	}
+}
+
+bool CookedAssets::loadCubemap(const std::string& path, CubemapFace faces[6]) {
+	Vfs::File file = Vfs::open(path);
+	if (!file.isOpen())
+		return false;
+	BinaryReader reader(file.getData(), file.getSize());
+	uint32_t magic, version;
+	if (!reader.read(magic) || magic != CUBEMAP_MAGIC || !reader.read(version) || version != VERSION)
+		return false;
+	for (int i = 0; i < 6; ++i) {
+		CubemapFace& face = faces[i];
+		if (!reader.read(face.width) || !reader.read(face.height) || !reader.read(face.components) || !reader.readVector(face.pixels) ||
+			face.pixels.size() != (size_t)face.width * face.height * face.components) {
+			std::cout << "Cooked cubemap is corrupted: " << path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ModelImport.h"
+
+// Data written offline by the cooker (tools/cooker), read through the Vfs so it can come from a pack.
+// A cooked model is the ModelImport result saved as it is, loading it skips assimp and the native readers.
+// A cooked cubemap has its faces decoded, loading it skips stb_image. Paths inside are relative to the project directory.
+namespace CookedAssets {
+	struct CubemapFace {
+		unsigned int width = 0, height = 0, components = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	// project_directory\cooked\models\<name>.gmodel
+	std::string getModelPath(const std::string& name);
+	// project_directory\cooked\cubemaps\<name>.gcube
+	std::string getCubemapPath(const std::string& name);
+	// Content hash of the files a model is imported from (model file, material or buffer files, property values),
+	// 0 if the model file isn't there, as in a shipped build with only cooked data.
+	// It's the one stored by the AssetDatabase, nothing is hashed here.
+	uint64_t getSourceHash(const std::string& name);
+
+	bool saveModel(const std::string& path, uint64_t sourceHash, const ModelImport::ModelData& data);
+	// False if there's no cooked file, it's broken or it was cooked from other sources. A sourceHash of 0 trusts the file.
+	bool loadModel(const std::string& path, uint64_t sourceHash, ModelImport::ModelData& data);
+	bool saveCubemap(const std::string& path, const CubemapFace faces[6]);
+	bool loadCubemap(const std::string& path, CubemapFace faces[6]);
+}
\ No newline at end of file
@@ -0,0 +1,509 @@
+#include "GltfLoader.h"
+#include <nlohmann/json.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "MeshProcessing.h"
+#include "vfs/Vfs.h"
+
+using json = nlohmann::json;
+
+static const uint32_t GLB_MAGIC = 0x46546C67, CHUNK_JSON = 0x4E4F534A, CHUNK_BIN = 0x004E4942;
+static const int BYTE = 5120, UNSIGNED_BYTE = 5121, SHORT = 5122, UNSIGNED_SHORT = 5123, UNSIGNED_INT = 5125, FLOAT = 5126;
+static const int TRIANGLES = 4;
+// Malformed files can have cycles in the node hierarchy.
+static const int MAX_NODE_DEPTH = 256;
+
+struct Buffer {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+// Elements of an accessor, inside a mapped buffer.
+struct Accessor {
+	const unsigned char* data = nullptr;
+	size_t count = 0, stride = 0;
+	int componentType = FLOAT, components = 1;
+	bool normalized = false;
+};
+
+// State of one load.
+struct Document {
+	json root;
+	std::filesystem::path folder, imageFolder, path;
+	std::vector<Vfs::File> files;
+	std::vector<Buffer> buffers;
+	// Absolute image paths, resolved the first time a material uses them.
+	std::vector<std::string> images;
+	std::vector<unsigned char> imageResolved;
+	// Mesh of each material, the last one is for primitives without material.
+	std::vector<int> materialMeshes;
+	std::vector<std::vector<unsigned char>> missing;
+	bool warnedMode = false;
+};
+
+static const json& getArray(const json& object, const char* key);
+static bool readBuffers(Document& doc, const Buffer& binChunk);
+static void readMaterials(Document& doc, std::vector<GltfLoader::MaterialData>& materials);
+static std::string getTexturePath(Document& doc, const json& textureInfo);
+static void processNode(Document& doc, int nodeIndex, const glm::mat4& parent, int depth, std::vector<GltfLoader::MeshData>& meshes);
+static void processMesh(Document& doc, int meshIndex, const glm::mat4& matrix, std::vector<GltfLoader::MeshData>& meshes);
+static void processPrimitive(Document& doc, const json& primitive, const glm::mat4& matrix, std::vector<GltfLoader::MeshData>& meshes);
+static bool getAccessor(const Document& doc, int index, Accessor& accessor);
+static glm::vec4 readElement(const Accessor& accessor, size_t index);
+static size_t getComponentSize(int componentType);
+static std::string decodeUri(const std::string& uri);
+
+bool GltfLoader::load(const std::string& path, const std::string& imageFolder, std::vector<MeshData>& meshes, std::vector<MaterialData>& materials) {
+	Vfs::File file = Vfs::open(path);
+	if (file.getSize() == 0) {
+		std::cout << "Error loading model " << path << std::endl;
+		return false;
+	}
+
+	// A glb has a json chunk and an optional binary chunk, the binary chunk is the first buffer.
+	// Anything else is read as a .gltf json file.
+	const char* data = file.getData();
+	size_t size = file.getSize();
+	const char* jsonBegin = data;
+	const char* jsonEnd = data + size;
+	Buffer binChunk;
+	uint32_t header[3] = {};
+	if (size >= sizeof(header))
+		memcpy(header, data, sizeof(header));
+	if (header[0] == GLB_MAGIC) {
+		if (header[1] != 2 || header[2] > size) {
+			std::cout << "Error loading model " << path << ", only glb version 2 is supported" << std::endl;
+			return false;
+		}
+		jsonBegin = jsonEnd = nullptr;
+		for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+			uint32_t chunk[2];
+			memcpy(chunk, data + offset, sizeof(chunk));
+			offset += 8;
+			if (chunk[0] > header[2] - offset)
+				break;
+			if (chunk[1] == CHUNK_JSON && !jsonBegin) {
+				jsonBegin = data + offset;
+				jsonEnd = jsonBegin + chunk[0];
+			}
+			else if (chunk[1] == CHUNK_BIN && !binChunk.data) {
+				binChunk.data = (const unsigned char*)data + offset;
+				binChunk.size = chunk[0];
+			}
+			// Chunks are 4 byte aligned.
+			offset += (chunk[0] + 3) & ~3u;
+		}
+		if (!jsonBegin) {
+			std::cout << "Error loading model " << path << ", glb without json chunk" << std::endl;
+			return false;
+		}
+	}
+
+	Document doc;
+	doc.root = json::parse(jsonBegin, jsonEnd, nullptr, false);
+	if (doc.root.is_discarded() || !doc.root.is_object()) {
+		std::cout << "Error loading model " << path << ", invalid json" << std::endl;
+		return false;
+	}
+	doc.path = path;
+	doc.folder = std::filesystem::path(path).parent_path();
+	doc.imageFolder = imageFolder;
+	try {
+		if (!readBuffers(doc, binChunk))
+			return false;
+		readMaterials(doc, materials);
+		doc.materialMeshes.assign(materials.size() + 1, -1);
+
+		// Nodes of the default scene, or every mesh untransformed if the file has no scenes.
+		const json& scenes = getArray(doc.root, "scenes");
+		int scene = doc.root.value("scene", 0);
+		if (scene >= 0 && scene < (int)scenes.size()) {
+			for (const json& node : getArray(scenes[scene], "nodes"))
+				processNode(doc, node.get<int>(), glm::mat4(1.0f), 0, meshes);
+		}
+		else {
+			for (int i = 0; i < (int)getArray(doc.root, "meshes").size(); ++i)
+				processMesh(doc, i, glm::mat4(1.0f), meshes);
+		}
+	}
+	catch (const json::exception& e) {
+		std::cout << "Error loading model " << path << ", " << e.what() << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+		MeshProcessing::computeTangentSpace(meshes[i].vertices, meshes[i].indices, doc.missing[i]);
+	return true;
+}
+
+// Buffers are the glb binary chunk or external files, read and kept until the end of the load.
+static bool readBuffers(Document& doc, const Buffer& binChunk) {
+	for (const json& b : getArray(doc.root, "buffers")) {
+		Buffer buffer;
+		size_t byteLength = b.value("byteLength", (size_t)0);
+		if (!b.contains("uri")) {
+			buffer = binChunk;
+		}
+		else {
+			std::string uri = b["uri"].get<std::string>();
+			if (uri.rfind("data:", 0) == 0) {
+				std::cout << "Error loading model " << doc.path.string() << ", data uris aren't supported" << std::endl;
+				return false;
+			}
+			std::string bufferPath = (doc.folder / decodeUri(uri)).string();
+			doc.files.push_back(Vfs::open(bufferPath));
+			buffer.data = (const unsigned char*)doc.files.back().getData();
+			buffer.size = doc.files.back().getSize();
+		}
+		if (!buffer.data || buffer.size < byteLength) {
+			std::cout << "Error loading model " << doc.path.string() << ", missing buffer data" << std::endl;
+			return false;
+		}
+		doc.buffers.push_back(buffer);
+	}
+	return true;
+}
+
+static void readMaterials(Document& doc, std::vector<GltfLoader::MaterialData>& materials) {
+	size_t imageCount = getArray(doc.root, "images").size();
+	doc.images.assign(imageCount, std::string());
+	doc.imageResolved.assign(imageCount, 0);
+	for (const json& m : getArray(doc.root, "materials")) {
+		GltfLoader::MaterialData material;
+		material.name = m.value("name", std::string());
+		const auto& pbr = m.find("pbrMetallicRoughness");
+		if (pbr != m.end()) {
+			const json& factor = getArray(*pbr, "baseColorFactor");
+			for (int i = 0; i < 4 && i < (int)factor.size(); ++i)
+				material.baseColor[i] = factor[i].get<float>();
+			material.metallic = pbr->value("metallicFactor", 1.0f);
+			material.roughness = pbr->value("roughnessFactor", 1.0f);
+			if (pbr->contains("baseColorTexture"))
+				material.baseColorMap = getTexturePath(doc, (*pbr)["baseColorTexture"]);
+			if (pbr->contains("metallicRoughnessTexture"))
+				material.metallicRoughnessMap = getTexturePath(doc, (*pbr)["metallicRoughnessTexture"]);
+		}
+		if (m.contains("normalTexture"))
+			material.normalMap = getTexturePath(doc, m["normalTexture"]);
+		if (m.contains("occlusionTexture"))
+			material.occlusionMap = getTexturePath(doc, m["occlusionTexture"]);
+		materials.push_back(material);
+	}
+}
+
+// Path of the image of a texture, images in buffer views are written in the image folder when the model changed.
+static std::string getTexturePath(Document& doc, const json& textureInfo) {
+	if (textureInfo.value("texCoord", 0) != 0)
+		std::cout << "Model " << doc.path.string() << " uses a second uv set, only the first is loaded" << std::endl;
+	const json& textures = getArray(doc.root, "textures");
+	int texture = textureInfo.value("index", -1);
+	if (texture < 0 || texture >= (int)textures.size())
+		return std::string();
+	int image = textures[texture].value("source", -1);
+	if (image < 0 || image >= (int)doc.images.size())
+		return std::string();
+	if (doc.imageResolved[image])
+		return doc.images[image];
+	doc.imageResolved[image] = 1;
+
+	const json& source = doc.root["images"][image];
+	if (source.contains("uri")) {
+		std::string uri = source["uri"].get<std::string>();
+		if (uri.rfind("data:", 0) == 0)
+			std::cout << "Model " << doc.path.string() << " has an image in a data uri, it isn't loaded" << std::endl;
+		else
+			doc.images[image] = (doc.folder / decodeUri(uri)).string();
+		return doc.images[image];
+	}
+
+	const json& views = getArray(doc.root, "bufferViews");
+	int view = source.value("bufferView", -1);
+	if (view < 0 || view >= (int)views.size())
+		return std::string();
+	int buffer = views[view].value("buffer", -1);
+	size_t offset = views[view].value("byteOffset", (size_t)0), length = views[view].value("byteLength", (size_t)0);
+	if (buffer < 0 || buffer >= (int)doc.buffers.size() || offset > doc.buffers[buffer].size || length > doc.buffers[buffer].size - offset)
+		return std::string();
+	std::string mimeType = source.value("mimeType", std::string());
+	std::filesystem::path imagePath = doc.imageFolder / ("image" + std::to_string(image) + (mimeType == "image/jpeg" ? ".jpg" : ".png"));
+	try {
+		std::error_code error;
+		bool current = std::filesystem::exists(imagePath, error) && std::filesystem::file_size(imagePath, error) == length &&
+			(int64_t)std::filesystem::last_write_time(imagePath, error).time_since_epoch().count() >= Vfs::stat(doc.path.string()).writeTime;
+		if (!current) {
+			std::filesystem::create_directories(doc.imageFolder);
+			std::ofstream out(imagePath, std::ios::binary);
+			out.write((const char*)doc.buffers[buffer].data + offset, length);
+			if (!out)
+				throw std::runtime_error("write failed");
+		}
+		doc.images[image] = imagePath.string();
+	}
+	catch (...) {
+		std::cout << "Embedded image couldn't be written at path: " << imagePath.string() << std::endl;
+	}
+	return doc.images[image];
+}
+
+static void processNode(Document& doc, int nodeIndex, const glm::mat4& parent, int depth, std::vector<GltfLoader::MeshData>& meshes) {
+	const json& nodes = getArray(doc.root, "nodes");
+	if (nodeIndex < 0 || nodeIndex >= (int)nodes.size() || depth > MAX_NODE_DEPTH)
+		return;
+	const json& node = nodes[nodeIndex];
+
+	// Either a column major matrix or translation, rotation (x, y, z, w quaternion) and scale.
+	glm::mat4 local(1.0f);
+	if (node.contains("matrix")) {
+		float m[16];
+		for (int i = 0; i < 16; ++i)
+			m[i] = node["matrix"][i].get<float>();
+		local = glm::make_mat4(m);
+	}
+	else {
+		const json& t = node.value("translation", json::array({ 0.0f, 0.0f, 0.0f }));
+		const json& r = node.value("rotation", json::array({ 0.0f, 0.0f, 0.0f, 1.0f }));
+		const json& s = node.value("scale", json::array({ 1.0f, 1.0f, 1.0f }));
+		glm::quat rotation(r[3].get<float>(), r[0].get<float>(), r[1].get<float>(), r[2].get<float>());
+		local = glm::translate(glm::mat4(1.0f), glm::vec3(t[0].get<float>(), t[1].get<float>(), t[2].get<float>())) *
+			glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(s[0].get<float>(), s[1].get<float>(), s[2].get<float>()));
+	}
+	glm::mat4 matrix = parent * local;
+
+	if (node.contains("mesh"))
+		processMesh(doc, node["mesh"].get<int>(), matrix, meshes);
+	for (const json& child : getArray(node, "children"))
+		processNode(doc, child.get<int>(), matrix, depth + 1, meshes);
+}
+
+static void processMesh(Document& doc, int meshIndex, const glm::mat4& matrix, std::vector<GltfLoader::MeshData>& meshes) {
+	const json& gltfMeshes = getArray(doc.root, "meshes");
+	if (meshIndex < 0 || meshIndex >= (int)gltfMeshes.size())
+		return;
+	for (const json& primitive : getArray(gltfMeshes[meshIndex], "primitives"))
+		processPrimitive(doc, primitive, matrix, meshes);
+}
+
+// Append the primitive to the mesh of its material, attributes are written straight into the vertices.
+static void processPrimitive(Document& doc, const json& primitive, const glm::mat4& matrix, std::vector<GltfLoader::MeshData>& meshes) {
+	if (primitive.value("mode", TRIANGLES) != TRIANGLES) {
+		if (!doc.warnedMode)
+			std::cout << "Model " << doc.path.string() << " has points or lines, only triangles are loaded" << std::endl;
+		doc.warnedMode = true;
+		return;
+	}
+	static const json noAttributes = json::object();
+	const auto& found = primitive.find("attributes");
+	const json& attributes = found != primitive.end() ? *found : noAttributes;
+	Accessor positions, normals, uvs, tangents, indices;
+	if (!getAccessor(doc, attributes.value("POSITION", -1), positions) || positions.components != 3)
+		return;
+	size_t count = positions.count;
+	// Attributes must have one element per vertex, otherwise they are generated.
+	bool hasNormals = getAccessor(doc, attributes.value("NORMAL", -1), normals) && normals.components == 3 && normals.count == count;
+	bool hasUvs = getAccessor(doc, attributes.value("TEXCOORD_0", -1), uvs) && uvs.components == 2 && uvs.count == count;
+	bool hasTangents = getAccessor(doc, attributes.value("TANGENT", -1), tangents) && tangents.components == 4 && tangents.count == count;
+	bool hasIndices = primitive.contains("indices");
+	if (hasIndices && (!getAccessor(doc, primitive["indices"].get<int>(), indices) || indices.components != 1 || indices.componentType == FLOAT))
+		return;
+
+	int material = primitive.value("material", -1);
+	if (material < 0 || material >= (int)doc.materialMeshes.size() - 1)
+		material = -1;
+	int& meshIndex = doc.materialMeshes[material >= 0 ? material : doc.materialMeshes.size() - 1];
+	if (meshIndex < 0) {
+		meshIndex = (int)meshes.size();
+		meshes.push_back(GltfLoader::MeshData());
+		meshes.back().material = material;
+		doc.missing.push_back(std::vector<unsigned char>());
+	}
+	GltfLoader::MeshData& mesh = meshes[meshIndex];
+	std::vector<unsigned char>& missing = doc.missing[meshIndex];
+
+	// Indices first, they are checked against the vertex count before anything is added.
+	size_t base = mesh.vertices.size(), firstIndex = mesh.indices.size();
+	size_t indexCount = hasIndices ? indices.count : count;
+	indexCount -= indexCount % 3;
+	mesh.indices.resize(firstIndex + indexCount);
+	unsigned int* out = mesh.indices.data() + firstIndex;
+	if (!hasIndices) {
+		for (size_t i = 0; i < indexCount; ++i)
+			out[i] = (unsigned int)i;
+	}
+	else if (indices.componentType == UNSIGNED_INT && indices.stride == sizeof(unsigned int))
+		memcpy(out, indices.data, indexCount * sizeof(unsigned int));
+	else {
+		for (size_t i = 0; i < indexCount; ++i) {
+			const unsigned char* p = indices.data + i * indices.stride;
+			if (indices.componentType == UNSIGNED_BYTE)
+				out[i] = *p;
+			else if (indices.componentType == UNSIGNED_SHORT) {
+				uint16_t v;
+				memcpy(&v, p, sizeof(v));
+				out[i] = v;
+			}
+			else {
+				uint32_t v;
+				memcpy(&v, p, sizeof(v));
+				out[i] = v;
+			}
+		}
+	}
+	for (size_t i = 0; i < indexCount; ++i) {
+		if (out[i] >= count) {
+			std::cout << "Model " << doc.path.string() << " has a primitive with indices out of range, it isn't loaded" << std::endl;
+			mesh.indices.resize(firstIndex);
+			return;
+		}
+		out[i] += (unsigned int)base;
+	}
+	// Mirroring transforms turn triangles inside out.
+	glm::mat3 linear(matrix);
+	if (glm::determinant(linear) < 0.0f)
+		for (size_t i = 0; i < indexCount; i += 3)
+			std::swap(out[i + 1], out[i + 2]);
+
+	// glTF uvs have the origin at the top left, like assimp with aiProcess_FlipUVs, so they are kept as they are.
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+	bool identity = matrix == glm::mat4(1.0f);
+	mesh.vertices.resize(base + count);
+	missing.resize(base + count, (hasNormals ? 0 : MeshProcessing::NORMAL) | (hasTangents ? 0 : MeshProcessing::TANGENT));
+	Vertex* vertices = mesh.vertices.data() + base;
+	for (size_t i = 0; i < count; ++i) {
+		Vertex& v = vertices[i];
+		glm::vec3 position = glm::vec3(readElement(positions, i));
+		v.Position = identity ? position : glm::vec3(matrix * glm::vec4(position, 1.0f));
+		v.Normal = hasNormals ? (identity ? glm::vec3(readElement(normals, i)) : normalMatrix * glm::vec3(readElement(normals, i))) : glm::vec3(0.0f);
+		v.TexCoords = hasUvs ? glm::vec2(readElement(uvs, i)) : glm::vec2(0.0f);
+		v.Tangent = hasTangents ? (identity ? glm::vec3(readElement(tangents, i)) : linear * glm::vec3(readElement(tangents, i))) : glm::vec3(0.0f);
+	}
+}
+
+// Array member of an object, empty if it isn't there.
+static const json& getArray(const json& object, const char* key) {
+	static const json empty = json::array();
+	const auto& it = object.find(key);
+	return it != object.end() && it->is_array() ? *it : empty;
+}
+
+// Resolve the buffer view of an accessor and check that every element is inside the view.
+static bool getAccessor(const Document& doc, int index, Accessor& accessor) {
+	const json& accessors = getArray(doc.root, "accessors");
+	if (index < 0 || index >= (int)accessors.size())
+		return false;
+	const json& a = accessors[index];
+	if (a.contains("sparse")) {
+		std::cout << "Model " << doc.path.string() << " has sparse accessors, they aren't supported" << std::endl;
+		return false;
+	}
+	const json& views = getArray(doc.root, "bufferViews");
+	int view = a.value("bufferView", -1);
+	if (view < 0 || view >= (int)views.size())
+		return false;
+	const json& v = views[view];
+	int buffer = v.value("buffer", -1);
+	if (buffer < 0 || buffer >= (int)doc.buffers.size())
+		return false;
+
+	std::string type = a.value("type", std::string());
+	accessor.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	accessor.componentType = a.value("componentType", 0);
+	accessor.normalized = a.value("normalized", false);
+	accessor.count = a.value("count", (size_t)0);
+	size_t elementSize = getComponentSize(accessor.componentType) * accessor.components;
+	if (elementSize == 0 || accessor.count == 0)
+		return false;
+	accessor.stride = v.value("byteStride", (size_t)0);
+	if (accessor.stride == 0)
+		accessor.stride = elementSize;
+
+	size_t viewOffset = v.value("byteOffset", (size_t)0), viewLength = v.value("byteLength", (size_t)0);
+	size_t offset = a.value("byteOffset", (size_t)0);
+	const Buffer& b = doc.buffers[buffer];
+	if (viewOffset > b.size || viewLength > b.size - viewOffset || offset > viewLength ||
+		(accessor.count - 1) * accessor.stride + elementSize > viewLength - offset) {
+		std::cout << "Model " << doc.path.string() << " has an accessor outside of its buffer" << std::endl;
+		return false;
+	}
+	accessor.data = b.data + viewOffset + offset;
+	return true;
+}
+
+// Element as floats, normalized integers are mapped to [0, 1] or [-1, 1].
+static glm::vec4 readElement(const Accessor& accessor, size_t index) {
+	glm::vec4 value(0.0f);
+	const unsigned char* p = accessor.data + index * accessor.stride;
+	if (accessor.componentType == FLOAT) {
+		memcpy(&value[0], p, accessor.components * sizeof(float));
+		return value;
+	}
+	for (int c = 0; c < accessor.components; ++c) {
+		switch (accessor.componentType) {
+		case BYTE: {
+			int8_t v;
+			memcpy(&v, p + c, sizeof(v));
+			value[c] = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v;
+			break;
+		}
+		case UNSIGNED_BYTE:
+			value[c] = accessor.normalized ? p[c] / 255.0f : p[c];
+			break;
+		case SHORT: {
+			int16_t v;
+			memcpy(&v, p + c * 2, sizeof(v));
+			value[c] = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v;
+			break;
+		}
+		case UNSIGNED_SHORT: {
+			uint16_t v;
+			memcpy(&v, p + c * 2, sizeof(v));
+			value[c] = accessor.normalized ? v / 65535.0f : v;
+			break;
+		}
+		case UNSIGNED_INT: {
+			uint32_t v;
+			memcpy(&v, p + c * 4, sizeof(v));
+			value[c] = (float)v;
+			break;
+		}
+		}
+	}
+	return value;
+}
+
+static size_t getComponentSize(int componentType) {
+	switch (componentType) {
+	case BYTE:
+	case UNSIGNED_BYTE:
+		return 1;
+	case SHORT:
+	case UNSIGNED_SHORT:
+		return 2;
+	case UNSIGNED_INT:
+	case FLOAT:
+		return 4;
+	}
+	return 0;
+}
+
+// Uris are relative paths with %XX escapes.
+static std::string decodeUri(const std::string& uri) {
+	std::string path;
+	for (size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2])) {
+			path += (char)std::stoi(uri.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+		}
+		else
+			path += uri[i];
+	}
+	return path;
+}
\ No newline at end of file
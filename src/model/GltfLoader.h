@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// glTF 2.0 reader used instead of assimp for .glb and .gltf models.
+// Binary chunks and external buffers are memory mapped and accessors are read from them straight into the
+// vertex and index arrays of the meshes, tightly packed 32 bit indices are copied with one memcpy.
+// Node transforms are baked into the vertices and primitives are grouped in one mesh per material.
+// Data uris and sparse accessors aren't supported. Like ObjLoader it must not do OpenGL operations.
+namespace GltfLoader {
+	// Metallic roughness material, glTF defaults.
+	struct MaterialData {
+		std::string name;
+		glm::vec4 baseColor = glm::vec4(1.0f);
+		float roughness = 1.0f, metallic = 1.0f;
+		// Absolute paths, empty if the material has none. Occlusion is in red, roughness in green and metallic in blue.
+		std::string baseColorMap, metallicRoughnessMap, normalMap, occlusionMap;
+	};
+
+	struct MeshData {
+		// Index in materials, -1 for primitives without material.
+		int material = -1;
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// Returns false if the file can't be read. Images embedded in buffers are written once in imageFolder,
+	// so the texture cache can find them by path.
+	bool load(const std::string& path, const std::string& imageFolder, std::vector<MeshData>& meshes, std::vector<MaterialData>& materials);
+}
\ No newline at end of file
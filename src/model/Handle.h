@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// 32 bit reference to an object in a SlotArray (or any table with generations): slot index in the low 20 bits,
+// generation of the slot in the high 12. Freeing a slot changes its generation, so handles to the old object stop
+// resolving instead of pointing at whatever takes the slot next. Generations wrap after 4095 reuses of one slot.
+// The default handle is null, valid handles are never 0. Tag is only there to keep handle types apart.
+template<typename Tag>
+class Handle {
+private:
+	uint32_t value = 0;
+public:
+	static const uint32_t INDEX_BITS = 20;
+	static const uint32_t MAX_INDEX = (1u << INDEX_BITS) - 1;
+	static const uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+
+	Handle() { };
+	// Generation must be from 1 to MAX_GENERATION.
+	Handle(uint32_t index, uint32_t generation) : value((generation << INDEX_BITS) | index) { };
+	uint32_t getIndex() const { return value & MAX_INDEX; }
+	uint32_t getGeneration() const { return value >> INDEX_BITS; }
+	uint32_t getValue() const { return value; }
+	bool isNull() const { return value == 0; }
+	bool operator==(const Handle& h) const { return value == h.value; }
+	bool operator!=(const Handle& h) const { return value != h.value; }
+
+	// Generation a slot gets when it's freed, 0 is skipped so that no handle is null.
+	static uint32_t nextGeneration(uint32_t generation) {
+		return generation >= MAX_GENERATION ? 1 : generation + 1;
+	}
+};
+
+// Objects addressed by Handle<Tag>, resolved with one index and a generation compare.
+// Slots are allocated in fixed pages that never move, so a pointer to an object stays valid until it's removed
+// (jobs can keep one while the main thread adds objects). Freed slots are reused, last freed first.
+template<typename T, typename Tag = T>
+class SlotArray {
+private:
+	static const uint32_t PAGE_SIZE = 256;
+	struct Slot {
+		alignas(T) unsigned char storage[sizeof(T)];
+		uint32_t generation = 1;
+		bool alive = false;
+	};
+	std::vector<std::unique_ptr<Slot[]>> pages;
+	std::vector<uint32_t> freeSlots;
+	uint32_t slotCount = 0, count = 0;
+
+	Slot* getSlot(uint32_t index) const { return &pages[index / PAGE_SIZE][index % PAGE_SIZE]; }
+	T* getItem(Slot* slot) const { return std::launder(reinterpret_cast<T*>(slot->storage)); }
+	Slot* find(Handle<Tag> handle) const {
+		uint32_t index = handle.getIndex();
+		if (handle.isNull() || index >= slotCount)
+			return nullptr;
+		Slot* slot = getSlot(index);
+		return slot->alive && slot->generation == handle.getGeneration() ? slot : nullptr;
+	}
+public:
+	SlotArray() { };
+	SlotArray(const SlotArray&) = delete;
+	SlotArray& operator=(const SlotArray&) = delete;
+	~SlotArray() { clear(); }
+
+	// Null handle if every index is used.
+	template<typename... Args>
+	Handle<Tag> emplace(Args&&... args) {
+		uint32_t index;
+		if (!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			if (slotCount > Handle<Tag>::MAX_INDEX)
+				return Handle<Tag>();
+			if (slotCount % PAGE_SIZE == 0)
+				pages.push_back(std::make_unique<Slot[]>(PAGE_SIZE));
+			index = slotCount++;
+		}
+		Slot* slot = getSlot(index);
+		new (slot->storage) T(std::forward<Args>(args)...);
+		slot->alive = true;
+		count++;
+		return Handle<Tag>(index, slot->generation);
+	}
+	// False if the handle was already stale.
+	bool remove(Handle<Tag> handle) {
+		Slot* slot = find(handle);
+		if (!slot)
+			return false;
+		getItem(slot)->~T();
+		slot->alive = false;
+		slot->generation = Handle<Tag>::nextGeneration(slot->generation);
+		freeSlots.push_back(handle.getIndex());
+		count--;
+		return true;
+	}
+	// nullptr for null and stale handles.
+	T* get(Handle<Tag> handle) {
+		Slot* slot = find(handle);
+		return slot ? getItem(slot) : nullptr;
+	}
+	const T* get(Handle<Tag> handle) const {
+		Slot* slot = find(handle);
+		return slot ? getItem(slot) : nullptr;
+	}
+	bool isValid(Handle<Tag> handle) const { return find(handle) != nullptr; }
+	// Calls f(handle, object) for every live object, in slot order. f must not add or remove.
+	template<typename F>
+	void forEach(F f) {
+		for (uint32_t i = 0; i < slotCount; ++i) {
+			Slot* slot = getSlot(i);
+			if (slot->alive)
+				f(Handle<Tag>(i, slot->generation), *getItem(slot));
+		}
+	}
+	template<typename F>
+	void forEach(F f) const {
+		for (uint32_t i = 0; i < slotCount; ++i) {
+			Slot* slot = getSlot(i);
+			if (slot->alive)
+				f(Handle<Tag>(i, slot->generation), (const T&)*getItem(slot));
+		}
+	}
+	// Destroys every object, all handles become stale.
+	void clear() {
+		for (uint32_t i = 0; i < slotCount; ++i) {
+			Slot* slot = getSlot(i);
+			if (!slot->alive)
+				continue;
+			getItem(slot)->~T();
+			slot->alive = false;
+			slot->generation = Handle<Tag>::nextGeneration(slot->generation);
+			freeSlots.push_back(i);
+		}
+		count = 0;
+	}
+	uint32_t size() const { return count; }
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return;
+	}
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		return;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = data ? (size_t)fileSize.QuadPart : 0;
+#else
+	file = open(path.c_str(), O_RDONLY);
+	struct stat info;
+	if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0)
+		return;
+	void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+		return;
+	data = (const char*)view;
+	size = info.st_size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+#else
+	if (data)
+		munmap((void*)data, size);
+	if (file >= 0)
+		close(file);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read only view of a whole file, mapped in memory so loaders parse it in place.
+class MappedFile {
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	// File and mapping handles, windows.h stays out of the header.
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	// Empty files aren't mapped.
+	bool isOpen() const { return data != nullptr; }
+	const char* getData() const { return data; }
+	size_t getSize() const { return size; }
+};
\ No newline at end of file
@@ -10,4 +10,6 @@ struct Material {
 
 	// PBR.
 	float roughness, metallic;
+	// Channels of the ORM texture that come from a map, the others use the values above (occlusion is 1).
+	bool hasAoMap = false, hasRoughnessMap = false, hasMetallicMap = false;
 };
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "Mesh.h"
 #include <glad/glad.h>
+#include "TextureCache.h"
+#include "renderer/MaterialTable.h"
+#include "renderer/UploadQueue.h"
+#include <cmath>
+#include <algorithm>
 
 void Mesh::setupMesh() {
     glGenVertexArrays(1, &VAO);
@@ -9,11 +14,18 @@ void Mesh::setupMesh() {
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    // Storage now, the data is copied by the upload queue over the next frames.
+    size_t vertexBytes = vertices.size() * sizeof(Vertex), indexBytes = indices.size() * sizeof(unsigned int);
+    if (vertexBytes > 0) {
+        glBufferStorage(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        uploadTicket = UploadQueue::uploadBuffer(VBO, 0, vertices.data(), vertexBytes);
+    }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-        &indices[0], GL_STATIC_DRAW);
+    if (indexBytes > 0) {
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        uploadTicket = UploadQueue::uploadBuffer(EBO, 0, indices.data(), indexBytes);
+    }
 
     // vertex positions
     glEnableVertexAttribArray(0);
@@ -31,24 +43,103 @@ void Mesh::setupMesh() {
     glBindVertexArray(0);
 }
 
+void Mesh::setupMaterial() {
+    materialHandle = MaterialTable::add(material, textures);
+}
+
+// Texture arrays copy the textures when the material is added, so it waits for their data too.
+bool Mesh::finishUpload() {
+    if (ready)
+        return true;
+    for (const auto& texture : textures)
+        uploadTicket = std::max(uploadTicket, TextureCache::getUploadTicket(texture.handle));
+    if (!UploadQueue::isDone(uploadTicket))
+        return false;
+    ready = true;
+    setupMaterial();
+    buildDrawPacket();
+    return true;
+}
+
+void Mesh::updateMaterial() {
+    MaterialTable::update(materialHandle, material);
+    buildDrawPacket();
+}
+
+void Mesh::refreshTextures() {
+    for (auto& texture : textures)
+        texture.id = TextureCache::getId(texture.handle);
+    // Texture arrays hold copies, the old layers are released and the new textures copied.
+    if (ready) {
+        MaterialTable::remove(materialHandle);
+        setupMaterial();
+    }
+    buildDrawPacket();
+}
+
+void Mesh::buildDrawPacket() {
+    drawPacket = DrawPacket();
+    drawPacket.vao = VAO;
+    drawPacket.indexCount = (unsigned int)indices.size();
+    drawPacket.materialIndex = materialHandle.getIndex();
+    drawPacket.boundsCenter = bounds.isValid() ? bounds.getCenter() : glm::vec3(0.0f);
+    // Units of the samplers in material.glsl, only the first texture of each type is used.
+    bool bind = MaterialTable::needsBinding(materialHandle);
+    for (const auto& texture : textures) {
+        unsigned int unit, feature;
+        if (texture.type == TextureType::DIFFUSE) {
+            unit = 0;
+            feature = DrawPacket::DIFFUSE_MAP;
+        }
+        else if (texture.type == TextureType::NORMAL) {
+            unit = 2;
+            feature = DrawPacket::NORMAL_MAP;
+        }
+        else if (texture.type == TextureType::ORM) {
+            unit = 3;
+            feature = DrawPacket::ORM_MAP;
+        }
+        else
+            continue;
+        if (drawPacket.features & feature)
+            continue;
+        drawPacket.features |= feature;
+        if (!bind)
+            continue;
+        drawPacket.textureUnits[drawPacket.textureCount] = unit;
+        drawPacket.textureIds[drawPacket.textureCount] = texture.id;
+        drawPacket.textureCount++;
+    }
+}
+
 void Mesh::deleteMesh() {
     // If there ever is a memory leak check this.
     
     // Delete buffers.
+    UploadQueue::cancelBuffer(VBO);
+    UploadQueue::cancelBuffer(EBO);
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    // Remember to delete textures.
+    MaterialTable::remove(materialHandle);
+    // Textures can be shared with other meshes, the cache deletes them with the last reference.
     for (const auto& tex : textures) {
-        glDeleteTextures(1, &tex.id);
+        TextureCache::release(tex.handle);
     }
 }
 
-std::vector<Texture> Mesh::getTexturesByType(TextureType tt) const {
-    std::vector<Texture> returnTextures;
-    for (int i = 0; i < textures.size(); ++i) {
-        if (textures[i].type == tt)
-            returnTextures.push_back(textures[i]);
+void Mesh::computeBounds() {
+    bounds = BoundingBox();
+    for (const auto& v : vertices)
+        bounds.expand(v.Position);
+
+    // Square root of uv area over surface area.
+    double uvArea = 0.0, area = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const Vertex& a = vertices[indices[i]], & b = vertices[indices[i + 1]], & c = vertices[indices[i + 2]];
+        area += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+        glm::vec2 e1 = b.TexCoords - a.TexCoords, e2 = c.TexCoords - a.TexCoords;
+        uvArea += std::abs(e1.x * e2.y - e1.y * e2.x);
     }
-    return returnTextures;
+    uvDensity = area > 0.0 && uvArea > 0.0 ? (float)std::sqrt(uvArea / area) : 1.0f;
 }
\ No newline at end of file
@@ -1,8 +1,12 @@
 #pragma once
 #include <vector>
 #include "Material.h"
+#include "Handle.h"
+#include <cstdint>
+#include "math/BoundingBox.h"
 #include <glm/glm.hpp>
 #include <string>
+#include <utility>
 
 struct Vertex {
 	glm::vec3 Position;
@@ -12,35 +16,83 @@ struct Vertex {
 };
 
 enum class TextureType {
-	DIFFUSE, SPECULAR, ROUGHNESS, METALLIC, NORMAL, AMBIENT_OCCLUSION
+	DIFFUSE, SPECULAR, ROUGHNESS, METALLIC, NORMAL, AMBIENT_OCCLUSION,
+	// Occlusion, roughness and metallic packed in red, green and blue.
+	ORM
 };
 
+struct Texture;
+// Reference to a texture of TextureCache.
+typedef Handle<Texture> TextureHandle;
+// Reference to an entry of MaterialTable, its index is the one shaders read.
+typedef Handle<Material> MaterialHandle;
+
 struct Texture {
+	// Cache entry the mesh holds a reference to, and its OpenGL texture.
+	TextureHandle handle;
 	unsigned int id;
 	std::string name;
 	TextureType type;
 };
 
+// Everything needed to draw a mesh, resolved when it's loaded.
+// Textures are only listed when the material table can't reference them and they must be bound per draw.
+struct DrawPacket {
+	// Texture maps of the material, they choose the shader variant.
+	enum Features {
+		DIFFUSE_MAP = 1, NORMAL_MAP = 2, ORM_MAP = 4
+	};
+	unsigned int vao, indexCount, materialIndex;
+	unsigned int features;
+	unsigned int textureCount;
+	unsigned int textureUnits[3], textureIds[3];
+	// Model space, used for depth sorting.
+	glm::vec3 boundsCenter;
+};
+
 class Mesh {
 private:
 	unsigned int VAO, VBO, EBO;
+	BoundingBox bounds;
+	float uvDensity;
+	// Entry in the material table.
+	MaterialHandle materialHandle;
+	DrawPacket drawPacket;
+	// Last upload of the buffers and textures, the mesh is drawn and gets its material once it's done.
+	uint64_t uploadTicket;
+	bool ready;
 	void setupMesh();
+	void setupMaterial();
+	void buildDrawPacket();
+	void computeBounds();
 public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
 	Material material;
-	Mesh(std::vector<Vertex>& v, std::vector<unsigned int>& i, std::vector<Texture>& t, Material& mat)
-		: vertices(v), indices(i), textures(t), material(mat), VAO(0), VBO(0), EBO(0) {
-		vertices = v;
-		indices = i;
-		textures = t;
-		material = mat;
+	// Loaders move their arrays in, the mesh keeps them for culling and picking.
+	Mesh(std::vector<Vertex> v, std::vector<unsigned int> i, std::vector<Texture> t, const Material& mat)
+		: vertices(std::move(v)), indices(std::move(i)), textures(std::move(t)), material(mat), VAO(0), VBO(0), EBO(0), uvDensity(1.0f), uploadTicket(0), ready(false) {
+		computeBounds();
 		setupMesh();
+		buildDrawPacket();
+		finishUpload();
 	};
 	void deleteMesh();
+	// True once the buffers and textures are uploaded, checked every frame until then.
+	bool finishUpload();
+	bool isReady() const { return ready; }
 	unsigned int getVao() const { return VAO; }
 	unsigned int getIndicesSize() const { return indices.size(); }
 	const Material& getMaterial() const { return material; }
-	std::vector<Texture> getTexturesByType(TextureType tt) const;
+	unsigned int getMaterialIndex() const { return materialHandle.getIndex(); }
+	// Send changes of material to the material table and rebuild the draw packet.
+	void updateMaterial();
+	// Read the ids of the textures again after TextureCache replaced some, the material is added again with them.
+	void refreshTextures();
+	const DrawPacket& getDrawPacket() const { return drawPacket; }
+	// Bounds in model space.
+	const BoundingBox& getBounds() const { return bounds; }
+	// Uv units per model space unit, averaged over the triangles. Used to choose streamed mips.
+	float getUvDensity() const { return uvDensity; }
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "MeshProcessing.h"
+#include <cmath>
+
+void MeshProcessing::computeTangentSpace(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<unsigned char>& missing) {
+	// Area weighted normals and tangents, summed over the triangles.
+	if (!missing.empty()) {
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			Vertex& a = vertices[indices[i]];
+			Vertex& b = vertices[indices[i + 1]];
+			Vertex& c = vertices[indices[i + 2]];
+			unsigned char flags = missing[indices[i]] | missing[indices[i + 1]] | missing[indices[i + 2]];
+			if (flags == 0)
+				continue;
+			glm::vec3 e1 = b.Position - a.Position, e2 = c.Position - a.Position;
+			if (flags & NORMAL) {
+				glm::vec3 faceNormal = glm::cross(e1, e2);
+				for (int k = 0; k < 3; ++k)
+					if (missing[indices[i + k]] & NORMAL)
+						vertices[indices[i + k]].Normal += faceNormal;
+			}
+			if (!(flags & TANGENT))
+				continue;
+			glm::vec2 d1 = b.TexCoords - a.TexCoords, d2 = c.TexCoords - a.TexCoords;
+			float det = d1.x * d2.y - d2.x * d1.y;
+			if (std::abs(det) < 1e-12f)
+				continue;
+			glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) / det;
+			for (int k = 0; k < 3; ++k)
+				if (missing[indices[i + k]] & TANGENT)
+					vertices[indices[i + k]].Tangent += tangent;
+		}
+	}
+	for (Vertex& v : vertices) {
+		float length = glm::length(v.Normal);
+		v.Normal = length > 0.0f ? v.Normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		// Orthogonal to the normal, any perpendicular direction if uvs don't give one.
+		glm::vec3 t = v.Tangent - v.Normal * glm::dot(v.Normal, v.Tangent);
+		if (glm::length(t) < 1e-6f)
+			t = glm::cross(v.Normal, std::abs(v.Normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+		v.Tangent = glm::normalize(t);
+	}
+}
\ No newline at end of file
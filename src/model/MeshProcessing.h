@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+#include "Mesh.h"
+
+// Vertex attributes generated by the native loaders when the file doesn't have them.
+namespace MeshProcessing {
+	// Flags of the attributes a vertex is missing.
+	enum Missing {
+		NORMAL = 1, TANGENT = 2
+	};
+
+	// Area weighted face normals are summed into vertices missing a normal and tangents from uvs into vertices
+	// missing a tangent, the sums must start at zero. Then every normal is normalized and every tangent made
+	// orthogonal to it. An empty missing vector means nothing is missing.
+	void computeTangentSpace(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<unsigned char>& missing);
+}
\ No newline at end of file
@@ -5,306 +5,240 @@
 #include <fstream>
 #include <iostream>
 #include "ProjectDirectory.h"
-#include "ModelLoader.h"
+#include "ModelImport.h"
+#include "CookedAssets.h"
+#include "AssetDatabase.h"
+#include <chrono>
 #include <vector>
 #include <map>
+#include <list>
+#include <memory>
+#include <future>
+#include <algorithm>
 #include "Mesh.h"
-// Assimp.
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
-// Name_Model map to store all assetModels.
+#include "TextureCache.h"
+#include "jobs/JobSystem.h"
+
+// Loaded model with its scene references.
+struct AssetModel {
+	Model model;
+	unsigned int references = 0;
+	// Position in unusedModels while references is 0.
+	std::list<ModelHandle>::iterator unusedPosition;
+	size_t cpuBytes, gpuBytes;
+	// False until its first scene user, taking an unused model back only counts as reuse after that.
+	bool used = false;
+	AssetModel(const std::string& name, const std::string& extension) : model(name, extension),
+		cpuBytes(model.getCpuBytes()), gpuBytes(model.getGpuBytes()) { };
+};
+
+// Slots storing all assetModels, models are built in place and never move.
 // To actually use an asset must instantiate a ModelInstance using an asset model.
-static std::map<std::string, Model> assetModels;
-
-void loadAssetModel(const std::string& modelName, const std::string& extension) {
-
-	Model assetModel(modelName, extension);
-
-	assetModels.insert({ modelName, assetModel });
+static SlotArray<AssetModel, Model> assetModels;
+// Handles of loaded models by name, and by asset id (null if not loaded).
+static std::map<std::string, ModelHandle> modelNames;
+static std::vector<ModelHandle> handlesById;
+static ModelHandle fallbackModel;
+// Models with meshes still waiting for the upload queue.
+static std::vector<ModelHandle> uploadingModels;
+// Models without references, most recently used first.
+static std::list<ModelHandle> unusedModels;
+static size_t cpuBytes = 0, gpuBytes = 0;
+static size_t cpuBudget = (size_t)1024 * 1024 * 1024, gpuBudget = (size_t)1024 * 1024 * 1024;
+static AssetModelStats modelStats;
+
+// Model imported again on a worker after one of its files changed.
+struct ModelReload {
+	// Null once the model is deleted or a newer reload started.
+	ModelHandle handle;
+	std::string name, extension;
+	ModelImport::ModelData data;
+	bool loaded = false;
+	// The files changed again during the import, it's started over when done.
+	bool again = false;
+	std::future<void> job;
+	// Built from data once the import is done, swapped in when uploaded.
+	std::vector<Mesh> meshes;
+	bool built = false;
+	std::chrono::high_resolution_clock::time_point start;
+};
+static std::vector<std::unique_ptr<ModelReload>> modelReloads;
+static unsigned int modelsVersion = 0;
+
+static void evictAssetModels();
+
+ModelHandle loadAssetModel(const std::string& modelName, const std::string& extension) {
+
+	ModelHandle handle = assetModels.emplace(modelName, extension);
+	if (handle.isNull()) {
+		std::cout << "Too many models loaded, can't load " << modelName << std::endl;
+		return handle;
+	}
+	// Make room before the new model joins the unused ones, so it's never the one evicted.
+	// Loaded models start unused, the first scene user takes them out of the list.
+	AssetModel* asset = assetModels.get(handle);
+	cpuBytes += asset->cpuBytes;
+	gpuBytes += asset->gpuBytes;
+	evictAssetModels();
+	unusedModels.push_front(handle);
+	asset->unusedPosition = unusedModels.begin();
+	if (!asset->model.finishUploads())
+		uploadingModels.push_back(handle);
+
+	modelNames[modelName] = handle;
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(modelName);
+	if (record) {
+		if (record->id >= handlesById.size())
+			handlesById.resize(record->id + 1);
+		handlesById[record->id] = handle;
+	}
+	return handle;
 }
 
 void Model::loadModel(const std::string& modelName, const std::string& extension) {
-	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(project_directory + "\\assets\\models\\" + modelName + "\\" + (modelName + "." + extension), 
-		aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeGraph | aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace);
-	if (!scene || !scene->mRootNode)
-	{
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+	// Load time is printed to compare loaders.
+	auto start = std::chrono::high_resolution_clock::now();
+	// Cooked data is used when the cooker made it from the current sources, or when the sources aren't there.
+	ModelImport::ModelData data;
+	if (!CookedAssets::loadModel(CookedAssets::getModelPath(modelName), CookedAssets::getSourceHash(modelName), data) &&
+		!ModelImport::import(modelName, extension, data))
 		return;
-	}
-	processNode(scene->mRootNode, scene);
-}
-
-void Model::processNode(aiNode* node, const aiScene* scene) {
-	// Process all the node's meshes (if any).
-	for (unsigned int i = 0; i < node->mNumMeshes; i++)
-	{
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene, node->mMeshes[i]));
-	}
-	// Then do the same for each of its children.
-	for (unsigned int i = 0; i < node->mNumChildren; i++)
-	{
-		processNode(node->mChildren[i], scene);
-	}
+	meshes = createMeshes(data);
+	occluderProxy = std::move(data.occluderProxy);
+	std::cout << "Model " << modelName << " loaded in " <<
+		std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms (" <<
+		data.loader << ")." << std::endl;
+
+	// Model bounds are used by culling.
+	bounds = BoundingBox();
+	for (const auto& m : meshes)
+		bounds.expand(m.getBounds());
 }
 
-// Read texture properties file and update vectors passed.
-typedef std::vector<TextureGammaContainer> tgContainer;
-static void createTextureVectorsFromPropertiesFile(tgContainer& diff, tgContainer& metal, tgContainer& rough, tgContainer& norm, unsigned int meshIndex, const std::string& name) {
-	
-	// File is opened for each mesh.
-	// This is inefficient so should be changed.
-	// Possibly make this as a single read for everything.
-	try {
-		std::ifstream texturePropertiesFile(project_directory + "\\assets\\models\\" + name + "\\" + "texture_properties.txt");
-		// Build texture vectors.
-		std::string line;
-		while (std::getline(texturePropertiesFile, line)) {
-
-			// Skip line if empty
-			if (std::strcmp(line.c_str(), "") == 0)
-				continue;
-
-			// Get index of mesh of our file line.
-			// If it's not the same index skip the line.
-			int spaceIndex = line.find(' ');
-			std::string subline = line.substr(0, spaceIndex);
-			line = line.substr(spaceIndex + 1);
-			unsigned int lineMeshIndex = std::stoi(subline);
-
-			if (lineMeshIndex == meshIndex) {
-
-				// Texture type string.
-				spaceIndex = line.find(' ');
-				std::string type = line.substr(0, spaceIndex);
-
-				// Texture file name.
-				line = line.substr(spaceIndex + 1);
-				spaceIndex = line.find(' ');
-				std::string textureName = line;
-				// If there is another space it means gamma is specified.
-				// In this case modify textuer file name so it doens't include "gamma".
-				if (spaceIndex != std::string::npos)
-					textureName = line.substr(0, spaceIndex);
-
-				TextureGammaContainer container;
-				container.gammaCorrect = false;
-
-				// Read if there is gamma.
-				if (spaceIndex != std::string::npos) {
-
-					std::string applyGamma = line.substr(spaceIndex + 1);
-					if (std::strcmp(applyGamma.c_str(), "gamma") == 0)
-						container.gammaCorrect = true;
-				}
-
-				if (std::strcmp(type.c_str(), "diffuse") == 0) {
-					container.name = textureName;
-					diff.push_back(container);
-				}
-				else if (std::strcmp(type.c_str(), "metallic") == 0) {
-					container.name = textureName;
-					metal.push_back(container);
-				}
-				else if (std::strcmp(type.c_str(), "roughness") == 0) {
-					container.name = textureName;
-					rough.push_back(container);
-				}
-				else if (std::strcmp(type.c_str(), "normals") == 0) {
-					container.name = textureName;
-					norm.push_back(container);
-				}
-			}
-		}
-		texturePropertiesFile.close();
-	}
-	catch (...) {
-		std::cout << "Error while opening textures properties file" << std::endl;
+std::vector<Mesh> Model::createMeshes(ModelImport::ModelData& data) {
+	std::vector<Mesh> created;
+	created.reserve(data.meshes.size());
+	for (auto& meshData : data.meshes) {
+		Material mat = meshData.material;
+		std::vector<Texture> textures = loadMeshTextures(meshData.textures, mat);
+		created.push_back(Mesh(std::move(meshData.vertices), std::move(meshData.indices), std::move(textures), mat));
 	}
+	return created;
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, unsigned int meshIndex) {
+std::vector<Texture> Model::loadMeshTextures(const ModelImport::MeshTextures& files, Material& mat) {
 
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
 
-	// Vertices, normals, texture coordinates, tangents.
-	for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-		Vertex ver;
-		ver.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-		ver.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-		ver.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
-		if (mesh->mTextureCoords[0]) {
-			glm::vec2 vec;
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
-			ver.TexCoords = vec;
+	// Textures.
+	std::vector<Texture> diffuseMaps = loadMaterialTextures(files.diffuse, TextureType::DIFFUSE);
+	textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+
+	// Occlusion, roughness and metallic maps are packed in one texture, so the shader does one fetch.
+	if (files.hasOrm()) {
+		static const int gltfSourceChannels[3] = { 0, 1, 2 };
+		Texture texture;
+		texture.handle = TextureCache::acquireOrm(files.ao, files.roughness, files.metallic,
+			files.gltfChannels ? gltfSourceChannels : nullptr, files.ormCookedPath);
+		texture.id = TextureCache::getId(texture.handle);
+		texture.type = TextureType::ORM;
+		texture.name = "orm";
+		if (texture.id != 0) {
+			textures.push_back(texture);
+			mat.hasAoMap = !files.ao.empty();
+			mat.hasRoughnessMap = !files.roughness.empty();
+			mat.hasMetallicMap = !files.metallic.empty();
 		}
-		else
-			ver.TexCoords = glm::vec2(0.0f, 0.0f);
-		vertices.push_back(ver);
-	}
-
-	for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
-		aiFace face = mesh->mFaces[t];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
 	}
 
-	// Material (including textures).
-	Material mat;
-	mat.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
-	mat.diffuse = glm::vec3(0.7f, 0.7f, 0.7f);
-	mat.specular = glm::vec3(0.7f, 0.7f, 0.7f);
-	mat.shininess = 100;
-	mat.roughness = 0.4f;
-	mat.metallic = 0.0f;
-	if (mesh->mMaterialIndex >= 0) {
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		aiColor4D ambient;
-		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambient) == AI_SUCCESS)
-			mat.ambient = glm::vec3(ambient.r, ambient.g, ambient.b);
-		aiColor4D diffuse;
-		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diffuse) == AI_SUCCESS)
-			mat.diffuse = glm::vec3(diffuse.r, diffuse.g, diffuse.b);
-		aiColor4D specular;
-		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &specular) == AI_SUCCESS)
-			mat.specular = glm::vec3(specular.r, specular.g, specular.b);
-		ai_real shininess;
-		if (aiGetMaterialFloat(material, AI_MATKEY_SHININESS, &shininess) == AI_SUCCESS)
-			mat.shininess = shininess;
-		ai_real roughness;
-		if (aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &roughness) == AI_SUCCESS)
-			mat.roughness = roughness;
-		ai_real metallic;
-		if (aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &metallic) == AI_SUCCESS)
-			mat.metallic = metallic;
-
-		std::vector<TextureGammaContainer> diffuseTextures, metallicTextures, roughnessTextures, normalsTextures;
-		
-		createTextureVectorsFromPropertiesFile(diffuseTextures, metallicTextures, roughnessTextures, normalsTextures, meshIndex, name);
-
-		// Textures.
-		std::vector<Texture> diffuseMaps = loadMaterialTextures(diffuseTextures, TextureType::DIFFUSE);
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-		std::vector<Texture> roughnessMaps = loadMaterialTextures(roughnessTextures, TextureType::ROUGHNESS);
-		textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
-
-		std::vector<Texture> metallicMaps = loadMaterialTextures(metallicTextures, TextureType::METALLIC);
-		textures.insert(textures.end(), metallicMaps.begin(), metallicMaps.end());
-
-		std::vector<Texture> normalsMaps = loadMaterialTextures(normalsTextures, TextureType::NORMAL);
-		textures.insert(textures.end(), normalsMaps.begin(), normalsMaps.end());
-	}
-	return Mesh(vertices, indices, textures, mat);
+	std::vector<Texture> normalsMaps = loadMaterialTextures(files.normals, TextureType::NORMAL);
+	textures.insert(textures.end(), normalsMaps.begin(), normalsMaps.end());
+	return textures;
 }
 
-std::vector<Texture> Model::loadMaterialTextures(const std::vector<TextureGammaContainer>& textureNames, TextureType textureType) {
+std::vector<Texture> Model::loadMaterialTextures(const std::vector<ModelImport::TextureFile>& files, TextureType textureType) {
 
 	std::vector<Texture> textures;
 
-	for (unsigned int i = 0; i < textureNames.size(); i++)
+	// Textures shared by meshes or models come from TextureCache, each mesh holds a reference.
+	for (unsigned int i = 0; i < files.size(); i++)
 	{
-		std::string textureName = textureNames[i].name;
-		bool skip = false;
-		for (int j = 0; j < modelTextures.size(); ++j) {
-			if (std::strcmp(modelTextures[j].name.data(), textureName.data()) == 0) {
-				textures.push_back(modelTextures[j]);
-				skip = true;
-				std::cout << "skip" << std::endl;
-				break;
-			}
-		}
-		if (!skip) {
-			Texture texture;
-			texture.id = textureFromFile(textureName, textureNames[i].gammaCorrect);
-			texture.type = textureType;
-			texture.name = textureName;
-			textures.push_back(texture);
-		}
+		Texture texture;
+		texture.handle = textureFromFile(files[i], textureType);
+		texture.id = TextureCache::getId(texture.handle);
+		texture.type = textureType;
+		texture.name = files[i].path;
+		textures.push_back(texture);
 	}
 	return textures;
 }
 
-unsigned int Model::textureFromFile(const std::string& fileName, bool gammaCorrect) {
-
-	std::string completePath = project_directory + "\\assets\\models\\" + name + "\\" + fileName;
+TextureHandle Model::textureFromFile(const ModelImport::TextureFile& file, TextureType textureType) {
+	return TextureCache::acquire(file.path, file.srgb, ModelImport::getUsage(textureType), file.cookedPath);
+}
 
-	// std::cout << fileName << std::endl;
+// Return handle of model in assetModels.
+ModelHandle getAssetModelHandle(const std::string& name) {
+	// Loaded models are found by the id of their asset record.
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	if (record && record->id < handlesById.size() && assetModels.isValid(handlesById[record->id]))
+		return handlesById[record->id];
+	const auto& it = modelNames.find(name);
+	if (it != modelNames.end())
+		return it->second;
+
+	// Load model if it was not found, the extension comes from the asset index.
+	if (!record)
+		std::cout << "Model " << name << " isn't in the asset index" << std::endl;
+	return loadAssetModel(name, record ? record->extension : "");
+}
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+Model* getAssetModel(ModelHandle handle) {
+	if (handle.isNull())
+		return nullptr;
+	AssetModel* asset = assetModels.get(handle);
+	if (!asset) {
+		// Deleted model, draw the fallback instead.
+		asset = assetModels.get(getFallbackAssetModel());
+	}
+	return asset ? &asset->model : nullptr;
+}
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(completePath.c_str(), &width, &height, &nrComponents, 0);
+Model* getAssetModel(const std::string& name) {
+	AssetModel* asset = assetModels.get(getAssetModelHandle(name));
+	return asset ? &asset->model : nullptr;
+}
 
-	if (data)
-	{
-		GLenum format = GL_RGBA;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// Might want to change this.
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << completePath << std::endl;
-		stbi_image_free(data);
-		return 0;
+// The fallback holds a reference of its own, so it's never evicted.
+ModelHandle getFallbackAssetModel() {
+	if (!assetModels.isValid(fallbackModel)) {
+		fallbackModel = getAssetModelHandle("default_cube");
+		acquireAssetModel(fallbackModel);
 	}
+	return fallbackModel;
+}
 
-	return textureID;
+const std::map<std::string, ModelHandle>& getModels() {
+	return modelNames;
 }
 
-// Return model in assetModels map.
-// Returns const model so you can't modify it.
-Model* getAssetModel(const std::string& name) {
-	// Iterator to model we want.
-	// If the model we are looking for isn't there find returns end iterator.
-	const auto& it = assetModels.find(name);
-	if (it != assetModels.end())
-		return &it->second;
-
-	// Load model if it was not found.
-	std::string extension, lineString;
-	try {
-		std::ifstream modFile(project_directory + "\\assets\\models\\" + name + "\\model_properties.txt");
-
-		while (std::getline(modFile, lineString)) {
-			if (lineString.find("fileExtension") == 0)
-				extension = lineString.substr(lineString.find(' ') + 1);
+void finishAssetModelUploads() {
+	for (size_t i = 0; i < uploadingModels.size();) {
+		AssetModel* asset = assetModels.get(uploadingModels[i]);
+		if (!asset || asset->model.finishUploads()) {
+			uploadingModels[i] = uploadingModels.back();
+			uploadingModels.pop_back();
 		}
+		else
+			++i;
 	}
-	catch (...) {
-		std::cout << "Error while opening or reading model_properties.txt file" << std::endl;
-	}
-	
-	loadAssetModel(name, extension);
-
-	return &assetModels.at(name);
 }
 
-std::map<std::string, Model>& getModels() {
-	return assetModels;
+bool Model::finishUploads() {
+	bool done = true;
+	for (auto& m : meshes)
+		done = m.finishUpload() && done;
+	return done;
 }
 
 // Not to confuse with global delete model.
@@ -317,20 +251,236 @@ void Model::deleteModel() {
 
 // We don't check for whether name exists or not.
 // If it doesn't, program probably crashes.
-// Also if you delete a model that is used
-// in a ModelInstance it may cause problems. 
+// Instances using the model keep their handle,
+// it resolves to the fallback model from now on.
 void deleteAssetModel(const std::string& name) {
-	Model& m = assetModels.at(name);
-	m.deleteModel();
-	assetModels.erase(name);
+	ModelHandle handle = modelNames.at(name);
+	AssetModel* asset = assetModels.get(handle);
+	asset->model.deleteModel();
+	if (asset->references == 0)
+		unusedModels.erase(asset->unusedPosition);
+	cpuBytes -= asset->cpuBytes;
+	gpuBytes -= asset->gpuBytes;
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	if (record && record->id < handlesById.size())
+		handlesById[record->id] = ModelHandle();
+	assetModels.remove(handle);
+	modelNames.erase(name);
+	// Instances of the model draw the fallback from now on, with its bounds and meshes.
+	modelsVersion++;
 }
 
-// Deletes all asset models.
-// To use at the end of the program.
-void deleteAllAssetModels() {
-	for (auto m : assetModels) {
-		deleteAssetModel(m.first);
+// Deletes all asset models, used or not.
+// Scenes release their models instead, this is for the end of the program.
+void deleteAllAssetModels(bool includeFallback) {
+	// At the end of the program reloads still running are dropped.
+	if (includeFallback) {
+		for (auto& r : modelReloads) {
+			if (r->job.valid())
+				r->job.wait();
+			for (auto& m : r->meshes)
+				m.deleteMesh();
+		}
+		modelReloads.clear();
+	}
+	for (auto it = modelNames.begin(); it != modelNames.end();) {
+		// Copy the name, deleting erases its node.
+		std::string name = (it++)->first;
+		if (includeFallback || modelNames.at(name) != fallbackModel)
+			deleteAssetModel(name);
+	}
+}
+
+void acquireAssetModel(ModelHandle handle) {
+	AssetModel* asset = assetModels.get(handle);
+	if (!asset)
+		return;
+	if (asset->references++ == 0) {
+		unusedModels.erase(asset->unusedPosition);
+		modelStats.reused += asset->used ? 1 : 0;
+		asset->used = true;
+	}
+}
+
+void releaseAssetModel(ModelHandle handle) {
+	AssetModel* asset = assetModels.get(handle);
+	if (!asset || asset->references == 0)
+		return;
+	if (--asset->references > 0)
+		return;
+	unusedModels.push_front(handle);
+	asset->unusedPosition = unusedModels.begin();
+	evictAssetModels();
+}
+
+// Deletes unused models, least recently used first, until both budgets are met.
+// Used models are never deleted, even if they alone go over a budget.
+static void evictAssetModels() {
+	while ((cpuBytes > cpuBudget || gpuBytes > gpuBudget) && !unusedModels.empty()) {
+		ModelHandle handle = unusedModels.back();
+		deleteAssetModel(assetModels.get(handle)->model.getName());
+		modelStats.evicted++;
+	}
+}
+
+size_t getAssetModelCpuBudget() {
+	return cpuBudget;
+}
+
+size_t getAssetModelGpuBudget() {
+	return gpuBudget;
+}
+
+void setAssetModelBudgets(size_t cpu, size_t gpu) {
+	cpuBudget = cpu;
+	gpuBudget = gpu;
+	evictAssetModels();
+}
+
+AssetModelStats getAssetModelStats() {
+	AssetModelStats s = modelStats;
+	s.models = assetModels.size();
+	s.unused = (unsigned int)unusedModels.size();
+	s.cpuBytes = cpuBytes;
+	s.gpuBytes = gpuBytes;
+	return s;
+}
+
+void Model::replaceMeshes(std::vector<Mesh>&& newMeshes, OccluderMesh&& newOccluderProxy) {
+	deleteModel();
+	meshes = std::move(newMeshes);
+	occluderProxy = std::move(newOccluderProxy);
+	bounds = BoundingBox();
+	for (const auto& m : meshes)
+		bounds.expand(m.getBounds());
+}
+
+void Model::refreshTextures(const std::vector<TextureHandle>& textures) {
+	for (auto& m : meshes) {
+		bool uses = false;
+		for (const auto& texture : m.textures)
+			uses = uses || std::find(textures.begin(), textures.end(), texture.handle) != textures.end();
+		if (uses)
+			m.refreshTextures();
+	}
+}
+
+bool reloadAssetModel(const std::string& name) {
+	const auto& it = modelNames.find(name);
+	if (it == modelNames.end())
+		return false;
+	for (auto& r : modelReloads) {
+		if (r->handle != it->second)
+			continue;
+		// The import reads the asset record, it can't change until it's done.
+		if (!r->built) {
+			r->again = true;
+			return true;
+		}
+		r->handle = ModelHandle();
+	}
+	AssetDatabase::refreshModel(name);
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	std::unique_ptr<ModelReload> r = std::make_unique<ModelReload>();
+	r->handle = it->second;
+	r->name = name;
+	r->extension = record ? record->extension : "";
+	r->start = std::chrono::high_resolution_clock::now();
+	// Edited sources are imported, cooked data is for unchanged ones.
+	ModelReload* target = r.get();
+	r->job = JobSystem::submit([target]() { target->loaded = ModelImport::import(target->name, target->extension, target->data); });
+	modelReloads.push_back(std::move(r));
+	return true;
+}
+
+void updateAssetModelReloads() {
+	std::vector<std::string> again;
+	for (size_t i = 0; i < modelReloads.size();) {
+		ModelReload& r = *modelReloads[i];
+		AssetModel* asset = assetModels.get(r.handle);
+		bool done = false;
+		if (!r.built) {
+			if (r.job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++i;
+				continue;
+			}
+			r.job.get();
+			if (r.again && asset)
+				again.push_back(r.name);
+			else if (!r.loaded && asset)
+				std::cout << "Model " << r.name << " failed to reload, the previous one is kept." << std::endl;
+			else if (asset) {
+				// Meshes are built aside, the old ones are drawn until the new ones are uploaded.
+				r.meshes = asset->model.createMeshes(r.data);
+				r.built = true;
+			}
+			done = !r.built;
+		}
+		if (r.built) {
+			bool uploaded = true;
+			for (auto& m : r.meshes)
+				uploaded = m.finishUpload() && uploaded;
+			if (!asset) {
+				for (auto& m : r.meshes)
+					m.deleteMesh();
+				done = true;
+			}
+			else if (uploaded) {
+				cpuBytes -= asset->cpuBytes;
+				gpuBytes -= asset->gpuBytes;
+				asset->model.replaceMeshes(std::move(r.meshes), std::move(r.data.occluderProxy));
+				asset->cpuBytes = asset->model.getCpuBytes();
+				asset->gpuBytes = asset->model.getGpuBytes();
+				cpuBytes += asset->cpuBytes;
+				gpuBytes += asset->gpuBytes;
+				modelsVersion++;
+				modelStats.reloads++;
+				std::cout << "Model " << r.name << " reloaded in " <<
+					std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - r.start).count() << " ms." << std::endl;
+				done = true;
+			}
+		}
+		if (done) {
+			modelReloads[i] = std::move(modelReloads.back());
+			modelReloads.pop_back();
+		}
+		else
+			++i;
 	}
+	for (const std::string& name : again)
+		reloadAssetModel(name);
+}
+
+void refreshAssetModelTextures(const std::vector<TextureHandle>& textures) {
+	assetModels.forEach([&textures](ModelHandle, AssetModel& asset) {
+		asset.model.refreshTextures(textures);
+	});
+	for (auto& r : modelReloads)
+		for (auto& m : r->meshes)
+			for (const auto& texture : m.textures)
+				if (std::find(textures.begin(), textures.end(), texture.handle) != textures.end()) {
+					m.refreshTextures();
+					break;
+				}
+}
+
+unsigned int getAssetModelsVersion() {
+	return modelsVersion;
+}
+
+size_t Model::getCpuBytes() const {
+	size_t bytes = occluderProxy.positions.size() * sizeof(glm::vec3) + occluderProxy.indices.size() * sizeof(unsigned int);
+	for (const auto& m : meshes)
+		bytes += m.vertices.size() * sizeof(Vertex) + m.indices.size() * sizeof(unsigned int);
+	return bytes;
+}
+
+// Vertex and index buffers hold the same arrays, textures are counted by TextureCache.
+size_t Model::getGpuBytes() const {
+	size_t bytes = 0;
+	for (const auto& m : meshes)
+		bytes += m.vertices.size() * sizeof(Vertex) + m.indices.size() * sizeof(unsigned int);
+	return bytes;
 }
 
 Model::~Model() {
@@ -2,24 +2,23 @@
 #include <string>
 #include <map>
 #include <glm/glm.hpp>
-#include <assimp/scene.h>
 #include "Mesh.h"
+#include "ModelImport.h"
+#include "Handle.h"
 #include <iostream>
-
-struct TextureGammaContainer {
-	std::string name;
-	bool gammaCorrect;
-};
+#include "math/BoundingBox.h"
 
 class Model {
 private:
 	std::vector<Mesh> meshes;
-	std::vector<Texture> modelTextures;
+	BoundingBox bounds;
+	OccluderMesh occluderProxy;
+	// Cooked data if there is some for the current sources, otherwise the model file through ModelImport.
 	void loadModel(const std::string& modelName, const std::string& extension);
-	void processNode(aiNode* node, const aiScene* scene);
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene, unsigned int meshIndex);
-	std::vector<Texture> loadMaterialTextures(const std::vector<TextureGammaContainer>& textureNames, TextureType textureType);
-	unsigned int textureFromFile(const std::string& name, bool gammaCorrect);
+	// Textures of a mesh from the cache, the material gets the channels its ORM texture has.
+	std::vector<Texture> loadMeshTextures(const ModelImport::MeshTextures& files, Material& mat);
+	std::vector<Texture> loadMaterialTextures(const std::vector<ModelImport::TextureFile>& files, TextureType textureType);
+	TextureHandle textureFromFile(const ModelImport::TextureFile& file, TextureType textureType);
 	std::string name, extension;
 public:
 	Model(const std::string& modelName, const std::string& modelExtension) : name(modelName), extension(modelExtension) {
@@ -34,10 +33,65 @@ public:
 	const std::vector<Mesh>& getMeshes() const { return meshes; }
 	std::vector<Mesh>& getMeshes() { return meshes; }
 	std::string getName() const { return name; }
+	// Bounds in model space of all meshes.
+	const BoundingBox& getBounds() const { return bounds; }
+	bool hasOccluderProxy() const { return !occluderProxy.indices.empty(); }
+	const OccluderMesh& getOccluderProxy() const { return occluderProxy; }
+	// Memory of the vertex and index arrays kept in ram (occluder proxy included) and of the mesh buffers.
+	size_t getCpuBytes() const;
+	size_t getGpuBytes() const;
+	// True once every mesh is uploaded, see Mesh::finishUpload.
+	bool finishUploads();
+	// Meshes of imported data with their textures from the cache, the arrays are moved out of data.
+	std::vector<Mesh> createMeshes(ModelImport::ModelData& data);
+	// Delete the meshes and use new ones, used by hot reload.
+	void replaceMeshes(std::vector<Mesh>&& newMeshes, OccluderMesh&& newOccluderProxy);
+	// Meshes using one of the textures read their ids again.
+	void refreshTextures(const std::vector<TextureHandle>& textures);
 };
 
-void loadAssetModel(const std::string&, const std::string&);
+// Reference to an asset model, scene data stores these instead of names or pointers.
+// Meshes are addressed by the handle of their model and their index in it.
+typedef Handle<Model> ModelHandle;
+
+ModelHandle loadAssetModel(const std::string&, const std::string&);
 void deleteAssetModel(const std::string&);
-void deleteAllAssetModels();
+// The fallback model is kept unless asked, it's only deleted when the renderer terminates.
+void deleteAllAssetModels(bool includeFallback = false);
+// Loads the model if it isn't loaded yet, null handle if it can't be created.
+ModelHandle getAssetModelHandle(const std::string&);
+// One index and generation check. Stale handles (model deleted) give the fallback model, null handles nullptr.
+Model* getAssetModel(ModelHandle);
 Model* getAssetModel(const std::string&);
-std::map<std::string, Model>& getModels();
\ No newline at end of file
+// Model drawn in place of deleted ones (default_cube), loaded on first use.
+ModelHandle getFallbackAssetModel();
+// Name to handle of every loaded model, sorted by name.
+const std::map<std::string, ModelHandle>& getModels();
+// Once per frame after UploadQueue::update, meshes whose data arrived become drawable.
+void finishAssetModelUploads();
+
+// Models are counted by their scene users (ModelInstancesManager holds one reference per instance).
+// Models without references stay loaded so the next scene can use them again, the least recently used
+// are deleted when loaded models go over the cpu or gpu budget. Textures do the same in TextureCache.
+struct AssetModelStats {
+	unsigned int models = 0, unused = 0;
+	size_t cpuBytes = 0, gpuBytes = 0;
+	unsigned int reused = 0, evicted = 0, reloads = 0;
+};
+void acquireAssetModel(ModelHandle);
+void releaseAssetModel(ModelHandle);
+size_t getAssetModelCpuBudget();
+size_t getAssetModelGpuBudget();
+void setAssetModelBudgets(size_t cpuBytes, size_t gpuBytes);
+AssetModelStats getAssetModelStats();
+
+// Hot reload: the model is imported again on a worker, its meshes are replaced once the new ones are uploaded.
+// Handles and instances stay the same. If the import fails the old meshes stay. False if the model isn't loaded.
+bool reloadAssetModel(const std::string& name);
+// Once per frame, while nothing reads the meshes on other threads (culling).
+void updateAssetModelReloads();
+// Meshes using these textures read their ids again, after TextureCache::updateReloads.
+void refreshAssetModelTextures(const std::vector<TextureHandle>& textures);
+// Changes every time a reload replaces the meshes of a model or a model is deleted, so users of model bounds
+// and mesh counts know they are stale.
+unsigned int getAssetModelsVersion();
\ No newline at end of file
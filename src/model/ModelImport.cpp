@@ -0,0 +1,294 @@
+#include "ModelImport.h"
+#include <iostream>
+#include "ProjectDirectory.h"
+#include "ObjLoader.h"
+#include "GltfLoader.h"
+#include "AssetDatabase.h"
+#include "vfs/AssimpIOSystem.h"
+// Assimp.
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+static void processNode(const std::string& name, aiNode* node, const aiScene* scene, ModelImport::ModelData& data);
+static ModelImport::MeshData processMesh(const std::string& name, aiMesh* mesh, const aiScene* scene, unsigned int meshIndex);
+static bool importObj(const std::string& name, const std::string& path, ModelImport::ModelData& data);
+static bool importGltf(const std::string& name, const std::string& path, ModelImport::ModelData& data);
+static ModelImport::MeshTextures resolveTextures(const std::string& name, unsigned int meshIndex, const MaterialMaps* fileMaps = nullptr);
+static void importOccluderProxy(const std::string& name, OccluderMesh& proxy);
+
+bool ModelImport::import(const std::string& name, const std::string& extension, ModelData& data) {
+	std::string path = project_directory + "\\assets\\models\\" + name + "\\" + (name + "." + extension);
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	std::string loader = record ? record->loader : "";
+	bool gltf = extension == "glb" || extension == "gltf";
+	bool native = (extension == "obj" && loader == "native") || (gltf && loader != "assimp");
+	data.loader = native ? "native" : "assimp";
+	if (native) {
+		if (!(gltf ? importGltf(name, path, data) : importObj(name, path, data)))
+			return false;
+	}
+	else {
+		Assimp::Importer import;
+		import.SetIOHandler(new VfsIOSystem());
+		const aiScene* scene = import.ReadFile(path,
+			aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeGraph | aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace);
+		if (!scene || !scene->mRootNode)
+		{
+			std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+			return false;
+		}
+		processNode(name, scene->mRootNode, scene, data);
+	}
+	importOccluderProxy(name, data.occluderProxy);
+	return true;
+}
+
+Material ModelImport::getDefaultMaterial() {
+	Material mat;
+	mat.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	mat.diffuse = glm::vec3(0.7f, 0.7f, 0.7f);
+	mat.specular = glm::vec3(0.7f, 0.7f, 0.7f);
+	mat.shininess = 100;
+	mat.roughness = 0.4f;
+	mat.metallic = 0.0f;
+	return mat;
+}
+
+// Normal maps keep x and y (BC5), single channel maps keep red (BC4), colors keep everything (BC7).
+TextureCompression::Usage ModelImport::getUsage(TextureType type) {
+	if (type == TextureType::NORMAL)
+		return TextureCompression::Usage::NORMAL;
+	if (type == TextureType::ROUGHNESS || type == TextureType::METALLIC || type == TextureType::AMBIENT_OCCLUSION)
+		return TextureCompression::Usage::DATA;
+	return TextureCompression::Usage::COLOR;
+}
+
+// Load low poly occluder proxy if model_properties.txt has a line like (read from the asset index):
+// occluderProxy: proxy.obj
+// Only positions and indices are kept.
+static void importOccluderProxy(const std::string& name, OccluderMesh& proxy) {
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	std::string proxyName = record ? record->occluderProxy : "";
+	if (proxyName.empty())
+		return;
+
+	Assimp::Importer import;
+	import.SetIOHandler(new VfsIOSystem());
+	const aiScene* scene = import.ReadFile(project_directory + "\\assets\\models\\" + name + "\\" + proxyName,
+		aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices);
+	if (!scene) {
+		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+		return;
+	}
+	for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+		const aiMesh* mesh = scene->mMeshes[m];
+		unsigned int base = proxy.positions.size();
+		for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+			proxy.positions.push_back(glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z));
+		for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+			if (mesh->mFaces[f].mNumIndices != 3)
+				continue;
+			for (unsigned int j = 0; j < 3; ++j)
+				proxy.indices.push_back(base + mesh->mFaces[f].mIndices[j]);
+		}
+	}
+}
+
+static void processNode(const std::string& name, aiNode* node, const aiScene* scene, ModelImport::ModelData& data) {
+	// Process all the node's meshes (if any).
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	{
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		data.meshes.push_back(processMesh(name, mesh, scene, node->mMeshes[i]));
+	}
+	// Then do the same for each of its children.
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	{
+		processNode(name, node->mChildren[i], scene, data);
+	}
+}
+
+static ModelImport::MeshData processMesh(const std::string& name, aiMesh* mesh, const aiScene* scene, unsigned int meshIndex) {
+
+	ModelImport::MeshData data;
+	std::vector<Vertex>& vertices = data.vertices;
+	std::vector<unsigned int>& indices = data.indices;
+
+	vertices.reserve(mesh->mNumVertices);
+	indices.reserve((size_t)mesh->mNumFaces * 3);
+
+	// Vertices, normals, texture coordinates, tangents.
+	for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+		Vertex ver;
+		ver.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+		ver.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+		ver.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+		if (mesh->mTextureCoords[0]) {
+			glm::vec2 vec;
+			vec.x = mesh->mTextureCoords[0][i].x;
+			vec.y = mesh->mTextureCoords[0][i].y;
+			ver.TexCoords = vec;
+		}
+		else
+			ver.TexCoords = glm::vec2(0.0f, 0.0f);
+		vertices.push_back(ver);
+	}
+
+	for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
+		aiFace face = mesh->mFaces[t];
+		for (unsigned int j = 0; j < face.mNumIndices; j++)
+			indices.push_back(face.mIndices[j]);
+	}
+
+	// Material (including textures).
+	Material& mat = data.material;
+	mat = ModelImport::getDefaultMaterial();
+	if (mesh->mMaterialIndex >= 0) {
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		aiColor4D ambient;
+		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambient) == AI_SUCCESS)
+			mat.ambient = glm::vec3(ambient.r, ambient.g, ambient.b);
+		aiColor4D diffuse;
+		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diffuse) == AI_SUCCESS)
+			mat.diffuse = glm::vec3(diffuse.r, diffuse.g, diffuse.b);
+		aiColor4D specular;
+		if (aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &specular) == AI_SUCCESS)
+			mat.specular = glm::vec3(specular.r, specular.g, specular.b);
+		ai_real shininess;
+		if (aiGetMaterialFloat(material, AI_MATKEY_SHININESS, &shininess) == AI_SUCCESS)
+			mat.shininess = shininess;
+		ai_real roughness;
+		if (aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &roughness) == AI_SUCCESS)
+			mat.roughness = roughness;
+		ai_real metallic;
+		if (aiGetMaterialFloat(material, AI_MATKEY_ROUGHNESS_FACTOR, &metallic) == AI_SUCCESS)
+			mat.metallic = metallic;
+
+		data.textures = resolveTextures(name, meshIndex);
+	}
+	return data;
+}
+
+static bool importObj(const std::string& name, const std::string& path, ModelImport::ModelData& data) {
+	std::vector<ObjLoader::MeshData> meshData;
+	std::vector<ObjLoader::MaterialData> materials;
+	if (!ObjLoader::load(path, meshData, materials))
+		return false;
+	std::string folder = project_directory + "\\assets\\models\\" + name + "\\";
+	data.meshes.reserve(meshData.size());
+	for (unsigned int i = 0; i < meshData.size(); ++i) {
+		ObjLoader::MeshData& objMesh = meshData[i];
+		if (objMesh.indices.empty())
+			continue;
+		// Same defaults as meshes loaded with assimp.
+		ModelImport::MeshData mesh;
+		Material& mat = mesh.material;
+		mat = ModelImport::getDefaultMaterial();
+		// Mtl maps are relative to the model folder.
+		MaterialMaps maps;
+		if (objMesh.material >= 0) {
+			const ObjLoader::MaterialData& objMaterial = materials[objMesh.material];
+			mat.ambient = objMaterial.ambient;
+			mat.diffuse = objMaterial.diffuse;
+			mat.specular = objMaterial.specular;
+			mat.shininess = objMaterial.shininess;
+			mat.roughness = objMaterial.roughness;
+			mat.metallic = objMaterial.metallic;
+			maps.diffuse = objMaterial.diffuseMap.empty() ? "" : folder + objMaterial.diffuseMap;
+			maps.normal = objMaterial.normalMap.empty() ? "" : folder + objMaterial.normalMap;
+			maps.roughness = objMaterial.roughnessMap.empty() ? "" : folder + objMaterial.roughnessMap;
+			maps.metallic = objMaterial.metallicMap.empty() ? "" : folder + objMaterial.metallicMap;
+		}
+		mesh.textures = resolveTextures(name, (unsigned int)data.meshes.size(), &maps);
+		mesh.vertices = std::move(objMesh.vertices);
+		mesh.indices = std::move(objMesh.indices);
+		data.meshes.push_back(std::move(mesh));
+	}
+	return true;
+}
+
+static bool importGltf(const std::string& name, const std::string& path, ModelImport::ModelData& data) {
+	std::vector<GltfLoader::MeshData> meshData;
+	std::vector<GltfLoader::MaterialData> materials;
+	// Images embedded in a glb are extracted next to the other caches.
+	if (!GltfLoader::load(path, project_directory + "\\cache\\models\\" + name, meshData, materials))
+		return false;
+	data.meshes.reserve(meshData.size());
+	for (unsigned int i = 0; i < meshData.size(); ++i) {
+		GltfLoader::MeshData& gltfMesh = meshData[i];
+		if (gltfMesh.indices.empty())
+			continue;
+		// Phong values are the same defaults as meshes loaded with assimp, pbr values come from the material.
+		ModelImport::MeshData mesh;
+		Material& mat = mesh.material;
+		mat = ModelImport::getDefaultMaterial();
+		MaterialMaps maps;
+		maps.gltfChannels = true;
+		if (gltfMesh.material >= 0) {
+			const GltfLoader::MaterialData& gltfMaterial = materials[gltfMesh.material];
+			mat.diffuse = glm::vec3(gltfMaterial.baseColor);
+			mat.roughness = gltfMaterial.roughness;
+			mat.metallic = gltfMaterial.metallic;
+			maps.diffuse = gltfMaterial.baseColorMap;
+			maps.normal = gltfMaterial.normalMap;
+			maps.occlusion = gltfMaterial.occlusionMap;
+			maps.roughness = maps.metallic = gltfMaterial.metallicRoughnessMap;
+		}
+		mesh.textures = resolveTextures(name, (unsigned int)data.meshes.size(), &maps);
+		mesh.vertices = std::move(gltfMesh.vertices);
+		mesh.indices = std::move(gltfMesh.indices);
+		data.meshes.push_back(std::move(mesh));
+	}
+	return true;
+}
+
+// Texture properties of the mesh come from the asset index, texture_properties.txt isn't read again.
+// Names in it are relative to the model folder.
+static ModelImport::MeshTextures resolveTextures(const std::string& name, unsigned int meshIndex, const MaterialMaps* fileMaps) {
+	ModelImport::MeshTextures textures;
+	std::vector<ModelImport::TextureFile> aoTextures, roughnessTextures, metallicTextures;
+	const AssetDatabase::ModelRecord* record = AssetDatabase::findModel(name);
+	std::string folder = project_directory + "\\assets\\models\\" + name + "\\";
+	if (record) {
+		for (const auto& texture : record->textures) {
+			if (texture.mesh != meshIndex)
+				continue;
+			ModelImport::TextureFile file;
+			file.path = folder + texture.name;
+			file.srgb = texture.gammaCorrect;
+			if (texture.type == TextureType::DIFFUSE)
+				textures.diffuse.push_back(file);
+			else if (texture.type == TextureType::METALLIC)
+				metallicTextures.push_back(file);
+			else if (texture.type == TextureType::ROUGHNESS)
+				roughnessTextures.push_back(file);
+			else if (texture.type == TextureType::NORMAL)
+				textures.normals.push_back(file);
+			else if (texture.type == TextureType::AMBIENT_OCCLUSION)
+				aoTextures.push_back(file);
+		}
+	}
+	// Channels of the glTF map only apply if the properties file doesn't replace any of the packed maps.
+	textures.gltfChannels = fileMaps && fileMaps->gltfChannels && aoTextures.empty() && roughnessTextures.empty() && metallicTextures.empty();
+	if (fileMaps) {
+		// Colors are in sRGB, the other maps are data.
+		if (textures.diffuse.empty() && !fileMaps->diffuse.empty())
+			textures.diffuse.push_back({ fileMaps->diffuse, true, "" });
+		if (textures.normals.empty() && !fileMaps->normal.empty())
+			textures.normals.push_back({ fileMaps->normal, false, "" });
+		if (textures.gltfChannels || !fileMaps->gltfChannels) {
+			if (aoTextures.empty() && !fileMaps->occlusion.empty())
+				aoTextures.push_back({ fileMaps->occlusion, false, "" });
+			if (roughnessTextures.empty() && !fileMaps->roughness.empty())
+				roughnessTextures.push_back({ fileMaps->roughness, false, "" });
+			if (metallicTextures.empty() && !fileMaps->metallic.empty())
+				metallicTextures.push_back({ fileMaps->metallic, false, "" });
+		}
+	}
+	// Only the first map of each packed channel is used.
+	textures.ao = aoTextures.empty() ? "" : aoTextures[0].path;
+	textures.roughness = roughnessTextures.empty() ? "" : roughnessTextures[0].path;
+	textures.metallic = metallicTextures.empty() ? "" : metallicTextures[0].path;
+	return textures;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "TextureCompression.h"
+
+// Texture maps a model file gives to a mesh, used for the types texture_properties.txt doesn't list.
+// Paths are absolute, empty for missing maps. glTF packs occlusion, roughness and metallic in red, green and blue.
+struct MaterialMaps {
+	std::string diffuse, normal, occlusion, roughness, metallic;
+	bool gltfChannels = false;
+};
+
+// Cpu only triangle soup used by occlusion culling.
+// Authored in the model folder as a low poly proxy (see model_properties.txt occluderProxy).
+struct OccluderMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+};
+
+// Cpu side of loading a model: the model file read with assimp or a native reader, then for every mesh its
+// arrays, material values and the texture files it uses (texture_properties.txt first, maps of the file after).
+// No OpenGL calls, so the cooker runs it offline and Model turns the result into meshes.
+namespace ModelImport {
+	struct TextureFile {
+		// Absolute.
+		std::string path;
+		bool srgb = false;
+		// Dds written by the cooker, used when the source file isn't there. Empty if not cooked.
+		std::string cookedPath;
+	};
+
+	struct MeshTextures {
+		std::vector<TextureFile> diffuse, normals;
+		// Occlusion, roughness and metallic, packed in one texture. Empty paths are missing maps.
+		std::string ao, roughness, metallic;
+		// Channels of the maps are the glTF ones instead of grey.
+		bool gltfChannels = false;
+		std::string ormCookedPath;
+		bool hasOrm() const { return !ao.empty() || !roughness.empty() || !metallic.empty(); }
+	};
+
+	struct MeshData {
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		Material material;
+		MeshTextures textures;
+	};
+
+	struct ModelData {
+		std::vector<MeshData> meshes;
+		OccluderMesh occluderProxy;
+		// Reader that made it, "native", "assimp" or "cooked".
+		std::string loader;
+	};
+
+	// False if the model file can't be read. Extension comes from the asset index.
+	bool import(const std::string& name, const std::string& extension, ModelData& data);
+	// Defaults of meshes whose file doesn't say.
+	Material getDefaultMaterial();
+	// Compressed format of a texture type.
+	TextureCompression::Usage getUsage(TextureType type);
+}
\ No newline at end of file
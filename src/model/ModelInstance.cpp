@@ -1,8 +1,19 @@
 #include "ModelInstance.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 bool ModelInstance::checkDrawability() {
 	bool flag = true;
-	if (model == nullptr)
+	if (model.isNull())
 		flag = false;
 	return flag;
+}
+
+glm::mat4 ModelInstance::buildModelMatrix() const {
+	glm::mat4 m = glm::mat4(1.0f);
+	m = glm::translate(m, glm::vec3(posX, posY, posZ));
+	m = glm::rotate(m, glm::radians(rotation).z, glm::vec3(0, 0, 1));
+	m = glm::rotate(m, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+	m = glm::rotate(m, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+	m = glm::scale(m, scale);
+	return m;
 }
\ No newline at end of file
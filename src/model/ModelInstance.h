@@ -4,6 +4,7 @@
 
 // Class used to represent an instance of a model.
 // So things like what model to use, its position, its rotation...
+// Position, rotation and scale are relative to the parent instance if there is one.
 class ModelInstance {
 private:
 	float posX, posY, posZ;
@@ -14,16 +15,20 @@ private:
 	// Remember, used only to determine if it is drawable, 
 	// so it doesn't mean everything is initialized, only the necessary things.
 	bool drawable;
-	const Model* model;
+	// Resolved on use, a deleted model draws as the fallback model.
+	ModelHandle model;
+	// Set when something affecting world bounds changes, used to refit the scene bvh.
+	bool changed = false;
+	int parent = -1;
 	bool checkDrawability();
 public:
-	ModelInstance() : posX(0), posY(0), posZ(0), model(nullptr),
+	ModelInstance() : posX(0), posY(0), posZ(0), model(),
 		scale(glm::vec3(1.0f, 1.0f, 1.0f)), rotation(glm::vec3(0.0f, 0.0f, 0.0f)), drawable(false) { };
-	ModelInstance(const Model* m) : posX(0), posY(0), posZ(0), model(m),
-		scale(glm::vec3(1.0f, 1.0f, 1.0f)), rotation(glm::vec3(0.0f, 0.0f, 0.0f)), drawable(true) { };
-	ModelInstance(float x, float y, float z, const glm::vec3& rot, const glm::vec3& sca, const Model* m) :
-		posX(x), posY(y), posZ(z), model(m), scale(sca), rotation(rot), drawable(true) { };
-	ModelInstance(float x, float y, float z) : posX(x), posY(y), posZ(z), model(nullptr),
+	ModelInstance(ModelHandle m) : posX(0), posY(0), posZ(0), model(m),
+		scale(glm::vec3(1.0f, 1.0f, 1.0f)), rotation(glm::vec3(0.0f, 0.0f, 0.0f)), drawable(!m.isNull()) { };
+	ModelInstance(float x, float y, float z, const glm::vec3& rot, const glm::vec3& sca, ModelHandle m) :
+		posX(x), posY(y), posZ(z), model(m), scale(sca), rotation(rot), drawable(!m.isNull()) { };
+	ModelInstance(float x, float y, float z) : posX(x), posY(y), posZ(z), model(),
 		scale(glm::vec3(1.0f, 1.0f, 1.0f)), rotation(glm::vec3(0.0f, 0.0f, 0.0f)), drawable(false) { };
 	float getX() const {
 		return posX;
@@ -35,9 +40,15 @@ public:
 		return posZ;
 	}
 	const Model* getModel() const {
+		return getAssetModel(model);
+	}
+	ModelHandle getModelHandle() const {
 		return model;
 	}
 	void setPosition(const glm::vec3& pos) {
+		if (pos == glm::vec3(posX, posY, posZ))
+			return;
+		changed = true;
 		posX = pos.x;
 		posY = pos.y;
 		posZ = pos.z;
@@ -46,19 +57,30 @@ public:
 		return scale;
 	}
 	void setScale(const glm::vec3& s) {
+		changed = changed || s != scale;
 		scale = s;
 	}
 	glm::vec3 getRotation() const {
 		return rotation;
 	}
 	void setRotation(const glm::vec3& r) {
+		changed = changed || r != rotation;
 		rotation = r;
 
 	}
-	void setModel(const Model* m) {
+	void setModel(ModelHandle m) {
+		changed = changed || m != model;
 		model = m;
 		// After setting model, which is required for rendering, we check if the model is now drawable, and set it.
 		drawable = checkDrawability();
 	}
 	bool isDrawable() const { return drawable; }
+	bool hasChanged() const { return changed; }
+	void clearChanged() { changed = false; }
+	// Index of the parent instance in the scene, -1 for none.
+	// Only ModelInstancesManager changes it, since it keeps instances ordered by hierarchy.
+	int getParent() const { return parent; }
+	void setParent(int p) { parent = p; }
+	// Model matrix built from position, rotation and scale, relative to the parent.
+	glm::mat4 buildModelMatrix() const;
 };
\ No newline at end of file
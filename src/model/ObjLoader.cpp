@@ -0,0 +1,445 @@
+#include "ObjLoader.h"
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <iostream>
+#include "jobs/JobSystem.h"
+#include "MeshProcessing.h"
+#include "vfs/Vfs.h"
+
+// Corner index not given (f 1//2) or not valid.
+static const int MISSING = INT_MIN;
+// Negative obj indices count back from the last element read, which another chunk may have read.
+// They are stored as (chunk relative index - RELATIVE_BIAS) until chunk offsets are known.
+static const int RELATIVE_BIAS = 1 << 30;
+// Smallest chunk worth a job.
+static const size_t CHUNK_SIZE = 1 << 20;
+
+struct MaterialSwitch {
+	unsigned int face;
+	std::string name;
+};
+
+// Lines of the file parsed by one job.
+struct Chunk {
+	const char* begin;
+	const char* end;
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	// Position, uv and normal of every corner.
+	std::vector<int> corners;
+	// First corner of each face, the last entry is one past the last corner.
+	std::vector<unsigned int> faceStarts;
+	std::vector<MaterialSwitch> materials;
+	std::vector<std::string> libraries;
+	unsigned int positionOffset = 0, uvOffset = 0, normalOffset = 0;
+};
+
+// Faces [firstFace, lastFace) of a chunk that use the same material.
+struct Run {
+	unsigned int chunk, firstFace, lastFace;
+};
+
+// Open addressing table from (position, uv, normal) to the vertex made for them.
+class VertexTable {
+private:
+	struct Slot {
+		int position, uv, normal;
+		unsigned int vertex;
+	};
+	std::vector<Slot> slots;
+	size_t mask;
+public:
+	explicit VertexTable(size_t corners);
+	// Returns true and the existing vertex, or false after storing newVertex.
+	bool findOrInsert(int position, int uv, int normal, unsigned int newVertex, unsigned int& vertex);
+};
+
+static void parseChunk(Chunk& chunk);
+static void resolveChunk(Chunk& chunk, unsigned int positionCount, unsigned int uvCount, unsigned int normalCount);
+static void buildMesh(const std::vector<Chunk>& chunks, const std::vector<Run>& runs, const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals, ObjLoader::MeshData& mesh);
+static bool isSpace(char c);
+static const char* skipSpaces(const char* p, const char* e);
+static bool isKeyword(const char* p, const char* e, const char* keyword);
+static std::string readName(const char* p, const char* e);
+static const char* parseFloat(const char* p, const char* e, float& value);
+static glm::vec3 parseVec3(const char* p, const char* e);
+
+bool ObjLoader::load(const std::string& path, std::vector<MeshData>& meshes, std::vector<MaterialData>& materials) {
+	Vfs::File file = Vfs::open(path);
+	if (file.getSize() == 0) {
+		std::cout << "Error loading model " << path << std::endl;
+		return false;
+	}
+
+	// Chunks end after a new line so that no line is split.
+	const char* data = file.getData();
+	const char* dataEnd = data + file.getSize();
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(file.getSize() / CHUNK_SIZE, (JobSystem::getWorkerCount() + 1) * 4));
+	std::vector<Chunk> chunks(chunkCount);
+	const char* p = data;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		const char* end = i + 1 == chunkCount ? dataEnd : data + file.getSize() * (i + 1) / chunkCount;
+		if (end < p)
+			end = p;
+		const char* newLine = (const char*)memchr(end, '\n', dataEnd - end);
+		end = newLine ? newLine + 1 : dataEnd;
+		chunks[i].begin = p;
+		chunks[i].end = end;
+		p = end;
+	}
+	JobSystem::parallelFor((unsigned int)chunkCount, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+			parseChunk(chunks[i]);
+	});
+
+	// Offsets of each chunk in the whole file, then indices can be made absolute.
+	unsigned int positionCount = 0, uvCount = 0, normalCount = 0;
+	for (Chunk& chunk : chunks) {
+		chunk.positionOffset = positionCount;
+		chunk.uvOffset = uvCount;
+		chunk.normalOffset = normalCount;
+		positionCount += (unsigned int)chunk.positions.size();
+		uvCount += (unsigned int)chunk.uvs.size();
+		normalCount += (unsigned int)chunk.normals.size();
+	}
+	JobSystem::parallelFor((unsigned int)chunkCount, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+			resolveChunk(chunks[i], positionCount, uvCount, normalCount);
+	});
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	positions.reserve(positionCount);
+	uvs.reserve(uvCount);
+	normals.reserve(normalCount);
+	for (Chunk& chunk : chunks) {
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+	}
+
+	// Materials of every mtllib, then group faces by the material they use.
+	std::filesystem::path folder = std::filesystem::path(path).parent_path();
+	for (const Chunk& chunk : chunks)
+		for (const std::string& library : chunk.libraries)
+			loadMaterials((folder / library).string(), materials);
+	std::unordered_map<std::string, unsigned int> groupOfName;
+	std::vector<std::vector<Run>> groups;
+	std::vector<int> groupMaterials;
+	std::string current;
+	bool hasCurrent = false;
+	auto getGroup = [&](const std::string& name, bool named) {
+		std::string key = named ? name : std::string("\0", 1);
+		auto it = groupOfName.find(key);
+		if (it != groupOfName.end())
+			return it->second;
+		int material = -1;
+		for (size_t m = 0; named && m < materials.size(); ++m)
+			if (materials[m].name == name)
+				material = (int)m;
+		groups.emplace_back();
+		groupMaterials.push_back(material);
+		groupOfName.insert({ key, (unsigned int)groups.size() - 1 });
+		return (unsigned int)groups.size() - 1;
+	};
+	for (unsigned int c = 0; c < chunkCount; ++c) {
+		const Chunk& chunk = chunks[c];
+		unsigned int faceCount = (unsigned int)chunk.faceStarts.size() - 1;
+		unsigned int first = 0;
+		for (size_t s = 0; s <= chunk.materials.size(); ++s) {
+			unsigned int last = s < chunk.materials.size() ? chunk.materials[s].face : faceCount;
+			if (last > first) {
+				unsigned int group = getGroup(current, hasCurrent);
+				groups[group].push_back({ c, first, last });
+			}
+			if (s < chunk.materials.size()) {
+				current = chunk.materials[s].name;
+				hasCurrent = true;
+			}
+			first = last;
+		}
+	}
+
+	meshes.assign(groups.size(), MeshData());
+	JobSystem::parallelFor((unsigned int)groups.size(), 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int g = begin; g < end; ++g) {
+			meshes[g].material = groupMaterials[g];
+			buildMesh(chunks, groups[g], positions, uvs, normals, meshes[g]);
+		}
+	});
+	return true;
+}
+
+bool ObjLoader::loadMaterials(const std::string& path, std::vector<MaterialData>& materials) {
+	Vfs::File file = Vfs::open(path);
+	if (!file.isOpen()) {
+		std::cout << "Error loading material library " << path << std::endl;
+		return false;
+	}
+
+	MaterialData* material = nullptr;
+	const char* p = file.getData();
+	const char* end = p + file.getSize();
+	while (p < end) {
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (!lineEnd)
+			lineEnd = end;
+		const char* e = lineEnd > p && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+		const char* l = skipSpaces(p, e);
+		p = lineEnd < end ? lineEnd + 1 : end;
+
+		if (isKeyword(l, e, "newmtl")) {
+			materials.emplace_back();
+			material = &materials.back();
+			material->name = readName(l + 6, e);
+			continue;
+		}
+		if (!material)
+			continue;
+		// Options of texture maps (-bm 1.0 ...) come before the file name, only the last word is kept.
+		auto lastWord = [e](const char* s) {
+			const char* w = e;
+			while (w > s && isSpace(w[-1]))
+				--w;
+			const char* wordEnd = w;
+			while (w > s && !isSpace(w[-1]))
+				--w;
+			return std::string(w, wordEnd);
+		};
+		if (isKeyword(l, e, "Ka"))
+			material->ambient = parseVec3(l + 2, e);
+		else if (isKeyword(l, e, "Kd"))
+			material->diffuse = parseVec3(l + 2, e);
+		else if (isKeyword(l, e, "Ks"))
+			material->specular = parseVec3(l + 2, e);
+		else if (isKeyword(l, e, "Ns"))
+			parseFloat(l + 2, e, material->shininess);
+		else if (isKeyword(l, e, "Pr"))
+			parseFloat(l + 2, e, material->roughness);
+		else if (isKeyword(l, e, "Pm"))
+			parseFloat(l + 2, e, material->metallic);
+		else if (isKeyword(l, e, "map_Kd"))
+			material->diffuseMap = lastWord(l + 6);
+		else if (isKeyword(l, e, "map_Bump") || isKeyword(l, e, "map_bump"))
+			material->normalMap = lastWord(l + 8);
+		else if (isKeyword(l, e, "bump") || isKeyword(l, e, "norm"))
+			material->normalMap = lastWord(l + 4);
+		else if (isKeyword(l, e, "map_Pr"))
+			material->roughnessMap = lastWord(l + 6);
+		else if (isKeyword(l, e, "map_Pm"))
+			material->metallicMap = lastWord(l + 6);
+	}
+	return true;
+}
+
+// Index of a face corner, obj indices start from 1 and negative ones are relative to the last element.
+static const char* parseIndex(const char* p, const char* e, unsigned int count, int& index) {
+	int value = 0;
+	if (p < e && *p == '+')
+		++p;
+	auto result = std::from_chars(p, e, value);
+	if (result.ec != std::errc())
+		return nullptr;
+	if (value > 0)
+		index = value - 1;
+	else if (value < 0)
+		index = (int)count + value - RELATIVE_BIAS;
+	else
+		index = MISSING;
+	return result.ptr;
+}
+
+static void parseFace(const char* p, const char* e, Chunk& chunk) {
+	unsigned int start = (unsigned int)chunk.corners.size();
+	unsigned int positionCount = (unsigned int)chunk.positions.size(), uvCount = (unsigned int)chunk.uvs.size(),
+		normalCount = (unsigned int)chunk.normals.size();
+	while ((p = skipSpaces(p, e)) < e) {
+		int position, uv = MISSING, normal = MISSING;
+		const char* q = parseIndex(p, e, positionCount, position);
+		if (!q)
+			break;
+		if (q < e && *q == '/') {
+			++q;
+			if (q < e && *q != '/')
+				q = parseIndex(q, e, uvCount, uv);
+			if (q && q < e && *q == '/')
+				q = parseIndex(q + 1, e, normalCount, normal);
+			if (!q)
+				break;
+		}
+		chunk.corners.push_back(position);
+		chunk.corners.push_back(uv);
+		chunk.corners.push_back(normal);
+		p = q;
+	}
+	// Points and lines aren't drawn.
+	if (chunk.corners.size() - start < 9)
+		chunk.corners.resize(start);
+	else
+		chunk.faceStarts.push_back(start / 3);
+}
+
+static void parseChunk(Chunk& chunk) {
+	const char* p = chunk.begin;
+	while (p < chunk.end) {
+		const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+		if (!lineEnd)
+			lineEnd = chunk.end;
+		const char* e = lineEnd > p && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+		const char* l = skipSpaces(p, e);
+		p = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+
+		if (isKeyword(l, e, "v"))
+			chunk.positions.push_back(parseVec3(l + 1, e));
+		else if (isKeyword(l, e, "vt")) {
+			glm::vec2 uv(0.0f);
+			parseFloat(parseFloat(l + 2, e, uv.x), e, uv.y);
+			chunk.uvs.push_back(uv);
+		}
+		else if (isKeyword(l, e, "vn"))
+			chunk.normals.push_back(parseVec3(l + 2, e));
+		else if (isKeyword(l, e, "f"))
+			parseFace(l + 1, e, chunk);
+		else if (isKeyword(l, e, "usemtl"))
+			chunk.materials.push_back({ (unsigned int)chunk.faceStarts.size(), readName(l + 6, e) });
+		else if (isKeyword(l, e, "mtllib"))
+			chunk.libraries.push_back(readName(l + 6, e));
+	}
+	chunk.faceStarts.push_back((unsigned int)chunk.corners.size() / 3);
+}
+
+// Make indices absolute, the ones out of range become MISSING.
+static void resolveChunk(Chunk& chunk, unsigned int positionCount, unsigned int uvCount, unsigned int normalCount) {
+	const unsigned int offsets[3] = { chunk.positionOffset, chunk.uvOffset, chunk.normalOffset };
+	const unsigned int counts[3] = { positionCount, uvCount, normalCount };
+	for (size_t i = 0; i < chunk.corners.size(); ++i) {
+		int& index = chunk.corners[i];
+		if (index == MISSING)
+			continue;
+		long long absolute = index < 0 ? (long long)offsets[i % 3] + index + RELATIVE_BIAS : index;
+		index = absolute >= 0 && absolute < counts[i % 3] ? (int)absolute : MISSING;
+	}
+}
+
+// Triangulate the faces of the runs as fans, share vertices with the same indices,
+// compute normals where the file has none and tangents from uvs.
+static void buildMesh(const std::vector<Chunk>& chunks, const std::vector<Run>& runs, const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals, ObjLoader::MeshData& mesh) {
+	size_t cornerCount = 0;
+	for (const Run& run : runs)
+		cornerCount += chunks[run.chunk].faceStarts[run.lastFace] - chunks[run.chunk].faceStarts[run.firstFace];
+	VertexTable table(cornerCount);
+	mesh.vertices.reserve(cornerCount / 2);
+	mesh.indices.reserve(cornerCount * 2);
+	std::vector<unsigned char> missing;
+	std::vector<unsigned int> face;
+
+	for (const Run& run : runs) {
+		const Chunk& chunk = chunks[run.chunk];
+		for (unsigned int f = run.firstFace; f < run.lastFace; ++f) {
+			face.clear();
+			bool valid = true;
+			for (unsigned int c = chunk.faceStarts[f]; c < chunk.faceStarts[f + 1]; ++c) {
+				const int* corner = &chunk.corners[c * 3];
+				if (corner[0] == MISSING) {
+					valid = false;
+					break;
+				}
+				unsigned int vertex;
+				if (!table.findOrInsert(corner[0], corner[1], corner[2], (unsigned int)mesh.vertices.size(), vertex)) {
+					Vertex v;
+					v.Position = positions[corner[0]];
+					// Same as aiProcess_FlipUVs.
+					v.TexCoords = corner[1] == MISSING ? glm::vec2(0.0f) : glm::vec2(uvs[corner[1]].x, 1.0f - uvs[corner[1]].y);
+					v.Normal = corner[2] == MISSING ? glm::vec3(0.0f) : normals[corner[2]];
+					v.Tangent = glm::vec3(0.0f);
+					mesh.vertices.push_back(v);
+					missing.push_back(MeshProcessing::TANGENT | (corner[2] == MISSING ? MeshProcessing::NORMAL : 0));
+				}
+				face.push_back(vertex);
+			}
+			if (!valid)
+				continue;
+			for (size_t i = 1; i + 1 < face.size(); ++i) {
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i]);
+				mesh.indices.push_back(face[i + 1]);
+			}
+		}
+	}
+
+	MeshProcessing::computeTangentSpace(mesh.vertices, mesh.indices, missing);
+}
+
+VertexTable::VertexTable(size_t corners) {
+	size_t capacity = 16;
+	while (capacity < corners * 2)
+		capacity *= 2;
+	slots.assign(capacity, { -1, 0, 0, 0 });
+	mask = capacity - 1;
+}
+
+bool VertexTable::findOrInsert(int position, int uv, int normal, unsigned int newVertex, unsigned int& vertex) {
+	uint64_t h = (uint64_t)(uint32_t)position * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uint32_t)uv * 0xC2B2AE3D27D4EB4Full ^
+		(uint64_t)(uint32_t)normal * 0x165667B19E3779F9ull;
+	h ^= h >> 29;
+	for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+		Slot& slot = slots[i];
+		if (slot.position == -1) {
+			slot = { position, uv, normal, newVertex };
+			vertex = newVertex;
+			return false;
+		}
+		if (slot.position == position && slot.uv == uv && slot.normal == normal) {
+			vertex = slot.vertex;
+			return true;
+		}
+	}
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t';
+}
+
+static const char* skipSpaces(const char* p, const char* e) {
+	while (p < e && isSpace(*p))
+		++p;
+	return p;
+}
+
+// Line starts with keyword followed by a space.
+static bool isKeyword(const char* p, const char* e, const char* keyword) {
+	size_t length = strlen(keyword);
+	return (size_t)(e - p) > length && memcmp(p, keyword, length) == 0 && isSpace(p[length]);
+}
+
+// Rest of the line without surrounding spaces, names can contain spaces.
+static std::string readName(const char* p, const char* e) {
+	p = skipSpaces(p, e);
+	while (e > p && isSpace(e[-1]))
+		--e;
+	return std::string(p, e);
+}
+
+// Value is left unchanged if there is no number.
+static const char* parseFloat(const char* p, const char* e, float& value) {
+	p = skipSpaces(p, e);
+	if (p < e && *p == '+')
+		++p;
+	auto result = std::from_chars(p, e, value);
+	return result.ec == std::errc() ? result.ptr : p;
+}
+
+static glm::vec3 parseVec3(const char* p, const char* e) {
+	glm::vec3 v(0.0f);
+	p = parseFloat(p, e, v.x);
+	p = parseFloat(p, e, v.y);
+	parseFloat(p, e, v.z);
+	return v;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Obj and mtl reader used instead of assimp for models with "loader: native" in model_properties.txt.
+// The file is memory mapped and split in chunks of lines parsed on the job system workers, numbers are read
+// with std::from_chars. Polygons are triangulated as fans, negative (relative) indices are supported and
+// faces are grouped in one mesh per material, in order of first use.
+// Like ModelLoader before it, it must not do OpenGL operations.
+namespace ObjLoader {
+	struct MaterialData {
+		std::string name;
+		glm::vec3 ambient = glm::vec3(0.1f), diffuse = glm::vec3(0.7f), specular = glm::vec3(0.7f);
+		float shininess = 100.0f, roughness = 0.4f, metallic = 0.0f;
+		// Relative to the mtl file, empty if the material has none.
+		std::string diffuseMap, normalMap, roughnessMap, metallicMap;
+	};
+
+	struct MeshData {
+		// Index in materials, -1 for faces without usemtl.
+		int material = -1;
+		// Uvs are flipped like aiProcess_FlipUVs, tangents are computed per vertex.
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// Returns false if the file can't be read. Materials come from the mtllib files next to it.
+	bool load(const std::string& path, std::vector<MeshData>& meshes, std::vector<MaterialData>& materials);
+	// Only newmtl, Ka, Kd, Ks, Ns, Pr, Pm, map_Kd, map_Bump (bump, norm), map_Pr and map_Pm are read.
+	bool loadMaterials(const std::string& path, std::vector<MaterialData>& materials);
+}
\ No newline at end of file
@@ -0,0 +1,685 @@
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "renderer/GLExtensions.h"
+#include "renderer/UploadQueue.h"
+#include "vfs/Vfs.h"
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <future>
+#include <memory>
+#include "jobs/JobSystem.h"
+
+namespace TextureCache {
+	// What a texture is made from, kept to load it again when one of the files changes.
+	struct Source {
+		std::string paths[3];
+		bool srgb = false, orm = false;
+		TextureCompression::Usage usage = TextureCompression::Usage::COLOR;
+		// sourceChannels of acquireOrm, if it was given.
+		bool hasChannels = false;
+		int channels[3] = {};
+	};
+
+	struct Entry {
+		unsigned int id;
+		std::string pathKey;
+		uint64_t contentKey;
+		unsigned int references;
+		size_t bytes;
+		bool compressed;
+		uint64_t handle;
+		uint64_t uploadTicket;
+		Source source;
+		// Position in unusedTextures while references is 0.
+		std::list<TextureHandle>::iterator unusedPosition;
+	};
+}
+
+static std::unordered_map<std::string, TextureHandle> pathIds;
+static std::unordered_map<uint64_t, TextureHandle> contentIds;
+static SlotArray<TextureCache::Entry, Texture> entries;
+// 1x1 white texture stale handles resolve to, created when first needed.
+static unsigned int fallbackId = 0;
+// Released textures, most recently released first.
+static std::list<TextureHandle> unusedTextures;
+static size_t residentBytes = 0, budget = (size_t)2048 * 1024 * 1024;
+static bool useContentHash = false;
+static TextureCache::Stats stats;
+
+// Texture loaded again on a worker after one of its files changed, then uploaded next to the old one.
+struct Reload {
+	// Null once a newer reload of the same texture started.
+	TextureHandle handle;
+	TextureCache::Source source;
+	// Filled by the job.
+	bool loaded = false, compressed = false, cached = false;
+	TextureCompression::Image image;
+	std::string cachePath;
+	std::vector<unsigned char> pixels;
+	int width = 0, height = 0, components = 0;
+	std::future<void> job;
+	// New texture, 0 until the job is done.
+	unsigned int id = 0;
+	size_t bytes = 0;
+	uint64_t ticket = 0;
+	std::chrono::high_resolution_clock::time_point start;
+};
+static std::vector<std::unique_ptr<Reload>> reloads;
+// Textures replaced by reloads with their bindless handles, deleted on the next update when nothing uses them anymore.
+static std::vector<std::pair<unsigned int, uint64_t>> replacedTextures;
+
+static std::string resolvePath(const std::string& path, bool srgb, TextureCompression::Usage usage);
+static uint64_t hashContent(const unsigned char* bytes, size_t size, bool srgb, TextureCompression::Usage usage);
+static unsigned int upload(const unsigned char* data, int width, int height, int components, bool srgb, size_t& bytes);
+static TextureHandle addEntry(const std::string& key, uint64_t contentKey, unsigned int id, size_t bytes, bool compressed, const TextureCache::Source& source);
+static void addEntryReference(TextureCache::Entry& entry);
+static void deleteEntry(TextureHandle handle);
+static void evict();
+static unsigned int uploadCompressed(const std::string& cachePath, TextureCompression::Image& image, bool cached);
+static unsigned char samplePacked(const unsigned char* data, int width, int height, int x, int y, int targetWidth, int targetHeight);
+static std::string getChannelKey(const int* sourceChannels);
+static void loadReload(Reload& reload);
+static void deleteTexture(unsigned int id, uint64_t bindlessHandle);
+
+TextureHandle TextureCache::acquire(const std::string& path, bool srgb, TextureCompression::Usage usage, const std::string& cookedPath) {
+	std::string key = resolvePath(path, srgb, usage);
+	const auto& it = pathIds.find(key);
+	if (it != pathIds.end()) {
+		addEntryReference(*entries.get(it->second));
+		stats.hits++;
+		return it->second;
+	}
+	Source source;
+	source.paths[0] = path;
+	source.srgb = srgb;
+	source.usage = usage;
+
+	// Compressed cache first, it avoids reading and decoding the source image.
+	bool compress = TextureCompression::getEnabled();
+	std::string cachePath;
+	TextureCompression::Image image;
+	if (compress) {
+		// Without the source (shipped cooked data) the cache path can't be computed, the model knows it.
+		cachePath = !cookedPath.empty() && !Vfs::exists(path) ? cookedPath : TextureCompression::getCachePath(path, usage, srgb);
+		if (!useContentHash && TextureCompression::loadDds(cachePath, image, TextureStreamer::getEnabled() ? TextureStreamer::INITIAL_SIZE : 0))
+			return addEntry(key, 0, uploadCompressed(cachePath, image, true), TextureCompression::getImageBytes(image), true, source);
+	}
+
+	Vfs::File file = Vfs::open(path);
+	if (file.getSize() == 0) {
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+		return TextureHandle();
+	}
+
+	// Same image under another path, share it and remember the new path too.
+	uint64_t contentKey = 0;
+	if (useContentHash) {
+		contentKey = hashContent((const unsigned char*)file.getData(), file.getSize(), srgb, usage);
+		const auto& cit = contentIds.find(contentKey);
+		if (cit != contentIds.end()) {
+			addEntryReference(*entries.get(cit->second));
+			pathIds[key] = cit->second;
+			stats.contentHits++;
+			return cit->second;
+		}
+	}
+
+	if (compress && TextureCompression::loadDds(cachePath, image, TextureStreamer::getEnabled() ? TextureStreamer::INITIAL_SIZE : 0))
+		return addEntry(key, contentKey, uploadCompressed(cachePath, image, true), TextureCompression::getImageBytes(image), true, source);
+
+	// Compression works on rgba, otherwise the image is uploaded with its own channels.
+	int width, height, components;
+	unsigned char* data = stbi_load_from_memory((const unsigned char*)file.getData(), (int)file.getSize(), &width, &height, &components, compress ? 4 : 0);
+	if (!data) {
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+		return TextureHandle();
+	}
+	unsigned int id;
+	size_t bytes;
+	if (compress) {
+		TextureCompression::compress(data, width, height, usage, srgb, image);
+		bool cached = TextureCompression::saveDds(cachePath, image);
+		if (!cached)
+			std::cout << "Compressed texture couldn't be cached at path: " << cachePath << std::endl;
+		id = uploadCompressed(cachePath, image, cached);
+		bytes = TextureCompression::getImageBytes(image);
+	}
+	else
+		id = upload(data, width, height, components, srgb, bytes);
+	stbi_image_free(data);
+	return addEntry(key, contentKey, id, bytes, compress, source);
+}
+
+static TextureHandle addEntry(const std::string& key, uint64_t contentKey, unsigned int id, size_t bytes, bool compressed, const TextureCache::Source& source) {
+	TextureCache::Entry entry;
+	entry.id = id;
+	entry.pathKey = key;
+	entry.contentKey = contentKey;
+	entry.references = 1;
+	entry.bytes = bytes;
+	entry.compressed = compressed;
+	entry.handle = 0;
+	// Uploads of the texture were the last ones queued.
+	entry.uploadTicket = UploadQueue::getLastTicket();
+	entry.source = source;
+	TextureHandle handle = entries.emplace(entry);
+	if (handle.isNull()) {
+		std::cout << "Too many textures in the cache" << std::endl;
+		TextureStreamer::remove(id);
+		glDeleteTextures(1, &id);
+		return handle;
+	}
+	pathIds[key] = handle;
+	if (useContentHash)
+		contentIds[contentKey] = handle;
+	stats.misses++;
+	residentBytes += bytes;
+	evict();
+	return handle;
+}
+
+TextureHandle TextureCache::acquireOrm(const std::string& aoPath, const std::string& roughnessPath, const std::string& metallicPath, const int* sourceChannels,
+	const std::string& cookedPath) {
+	std::string paths[3] = { aoPath, roughnessPath, metallicPath };
+	std::string key = "orm";
+	for (const auto& path : paths)
+		key += "|" + (path.empty() ? std::string() : resolvePath(path, false, TextureCompression::Usage::PACKED));
+	// Channels are part of the key, the same image can be packed differently.
+	std::string channelKey = getChannelKey(sourceChannels);
+	key += channelKey;
+	const auto& it = pathIds.find(key);
+	if (it != pathIds.end()) {
+		addEntryReference(*entries.get(it->second));
+		stats.hits++;
+		return it->second;
+	}
+	Source source;
+	for (int i = 0; i < 3; ++i)
+		source.paths[i] = paths[i];
+	source.orm = true;
+	source.hasChannels = sourceChannels != nullptr;
+	for (int i = 0; i < 3 && sourceChannels; ++i)
+		source.channels[i] = sourceChannels[i];
+	source.usage = TextureCompression::Usage::PACKED;
+
+	bool compress = TextureCompression::getEnabled();
+	std::string cachePath;
+	TextureCompression::Image image;
+	if (compress) {
+		std::vector<std::string> cacheSources(paths, paths + 3);
+		if (sourceChannels)
+			cacheSources.push_back(channelKey);
+		bool sources = false;
+		for (const auto& path : paths)
+			sources = sources || (!path.empty() && Vfs::exists(path));
+		cachePath = !cookedPath.empty() && !sources ? cookedPath : TextureCompression::getCachePath(cacheSources, TextureCompression::Usage::PACKED, false);
+		if (TextureCompression::loadDds(cachePath, image, TextureStreamer::getEnabled() ? TextureStreamer::INITIAL_SIZE : 0))
+			return addEntry(key, 0, uploadCompressed(cachePath, image, true), TextureCompression::getImageBytes(image), true, source);
+	}
+
+	// The three files are read together.
+	std::shared_future<Vfs::File> reads[3];
+	for (int i = 0; i < 3; ++i)
+		if (!paths[i].empty())
+			reads[i] = Vfs::openAsync(paths[i]);
+	Vfs::File files[3];
+	for (int i = 0; i < 3; ++i)
+		if (!paths[i].empty())
+			files[i] = reads[i].get();
+	std::vector<unsigned char> rgba;
+	int width, height;
+	if (!packOrm(paths, files, sourceChannels, rgba, width, height))
+		return TextureHandle();
+
+	unsigned int id;
+	size_t bytes;
+	if (compress) {
+		TextureCompression::compress(rgba.data(), width, height, TextureCompression::Usage::PACKED, false, image);
+		bool cached = TextureCompression::saveDds(cachePath, image);
+		if (!cached)
+			std::cout << "Compressed texture couldn't be cached at path: " << cachePath << std::endl;
+		id = uploadCompressed(cachePath, image, cached);
+		bytes = TextureCompression::getImageBytes(image);
+	}
+	else
+		id = upload(rgba.data(), width, height, 4, false, bytes);
+	return addEntry(key, 0, id, bytes, compress, source);
+}
+
+// Each map is decoded as a single channel, the packed texture takes the size of the largest.
+bool TextureCache::packOrm(const std::string paths[3], const Vfs::File files[3], const int* sourceChannels, std::vector<unsigned char>& rgba, int& width, int& height) {
+	unsigned char* sources[3] = { nullptr, nullptr, nullptr };
+	int widths[3] = {};
+	int heights[3] = {};
+	width = height = 0;
+	for (int i = 0; i < 3; ++i) {
+		if (paths[i].empty())
+			continue;
+		int components;
+		if (files[i].getSize() > 0)
+			sources[i] = stbi_load_from_memory((const unsigned char*)files[i].getData(), (int)files[i].getSize(), &widths[i], &heights[i], &components, sourceChannels ? 4 : 1);
+		if (!sources[i]) {
+			std::cout << "Texture failed to load at path: " << paths[i] << std::endl;
+			continue;
+		}
+		// Keep only the chosen channel, in place.
+		if (sourceChannels) {
+			size_t pixels = (size_t)widths[i] * heights[i];
+			for (size_t p = 0; p < pixels; ++p)
+				sources[i][p] = sources[i][p * 4 + sourceChannels[i]];
+		}
+		width = std::max(width, widths[i]);
+		height = std::max(height, heights[i]);
+	}
+	if (width == 0 || height == 0)
+		return false;
+	const unsigned char defaults[3] = { 255, 255, 0 };
+	rgba.assign((size_t)width * height * 4, 0);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			unsigned char* p = &rgba[((size_t)y * width + x) * 4];
+			for (int i = 0; i < 3; ++i)
+				p[i] = sources[i] ? samplePacked(sources[i], widths[i], heights[i], x, y, width, height) : defaults[i];
+			p[3] = 255;
+		}
+	}
+	for (int i = 0; i < 3; ++i)
+		stbi_image_free(sources[i]);
+
+	return true;
+}
+
+static std::string getChannelKey(const int* sourceChannels) {
+	if (!sourceChannels)
+		return "";
+	return "channels " + std::to_string(sourceChannels[0]) + std::to_string(sourceChannels[1]) + std::to_string(sourceChannels[2]);
+}
+
+// Bilinear sample of a map smaller than the packed texture.
+static unsigned char samplePacked(const unsigned char* data, int width, int height, int x, int y, int targetWidth, int targetHeight) {
+	if (width == targetWidth && height == targetHeight)
+		return data[(size_t)y * width + x];
+	float u = std::max(0.0f, (x + 0.5f) * width / targetWidth - 0.5f), v = std::max(0.0f, (y + 0.5f) * height / targetHeight - 0.5f);
+	int x0 = std::min((int)u, width - 1), y0 = std::min((int)v, height - 1);
+	int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+	float fx = u - x0, fy = v - y0;
+	float top = data[(size_t)y0 * width + x0] * (1.0f - fx) + data[(size_t)y0 * width + x1] * fx;
+	float bottom = data[(size_t)y1 * width + x0] * (1.0f - fx) + data[(size_t)y1 * width + x1] * fx;
+	return (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+}
+
+// Textures in the dds cache can be streamed, they start with their small mips only.
+static unsigned int uploadCompressed(const std::string& cachePath, TextureCompression::Image& image, bool cached) {
+	unsigned int initialLevel = 0;
+	if (cached && TextureStreamer::getEnabled()) {
+		initialLevel = TextureStreamer::getInitialLevel(image);
+		for (unsigned int i = 0; i < initialLevel; ++i)
+			image.levels[i] = std::vector<unsigned char>();
+	}
+	unsigned int id = TextureCompression::upload(image);
+	if (initialLevel > 0) {
+		// Upload sets the base level to the first resident mip, with shader clamping sampling starts from 0.
+		if (TextureStreamer::getShaderClamp())
+			glTextureParameteri(id, GL_TEXTURE_BASE_LEVEL, 0);
+		TextureStreamer::add(id, cachePath, image, initialLevel);
+	}
+	return id;
+}
+
+unsigned int TextureCache::getId(TextureHandle handle) {
+	if (handle.isNull())
+		return 0;
+	const Entry* entry = entries.get(handle);
+	if (entry)
+		return entry->id;
+	if (fallbackId == 0) {
+		const unsigned char white[4] = { 255, 255, 255, 255 };
+		size_t bytes;
+		fallbackId = upload(white, 1, 1, 4, false, bytes);
+	}
+	return fallbackId;
+}
+
+uint64_t TextureCache::getUploadTicket(TextureHandle handle) {
+	const Entry* entry = entries.get(handle);
+	return entry ? entry->uploadTicket : 0;
+}
+
+void TextureCache::addReference(TextureHandle handle) {
+	Entry* entry = entries.get(handle);
+	if (entry)
+		addEntryReference(*entry);
+}
+
+// Cache hits can take back a released texture.
+static void addEntryReference(TextureCache::Entry& entry) {
+	if (entry.references++ == 0)
+		unusedTextures.erase(entry.unusedPosition);
+}
+
+void TextureCache::release(TextureHandle handle) {
+	Entry* entry = entries.get(handle);
+	if (!entry || entry->references == 0)
+		return;
+	if (--entry->references > 0)
+		return;
+	unusedTextures.push_front(handle);
+	entry->unusedPosition = unusedTextures.begin();
+	evict();
+}
+
+// Deletes unused textures, least recently released first, until the cache fits its budget.
+static void evict() {
+	while (residentBytes > budget && !unusedTextures.empty()) {
+		deleteEntry(unusedTextures.back());
+		stats.evicted++;
+	}
+}
+
+static void deleteEntry(TextureHandle handle) {
+	TextureCache::Entry* entry = entries.get(handle);
+	if (entry->references == 0)
+		unusedTextures.erase(entry->unusedPosition);
+	residentBytes -= entry->bytes;
+	// More than one path can point to the same texture when content hashing is used.
+	for (auto p = pathIds.begin(); p != pathIds.end();) {
+		if (p->second == handle)
+			p = pathIds.erase(p);
+		else
+			++p;
+	}
+	const auto& cit = contentIds.find(entry->contentKey);
+	if (cit != contentIds.end() && cit->second == handle)
+		contentIds.erase(cit);
+	deleteTexture(entry->id, entry->handle);
+	entries.remove(handle);
+}
+
+static void deleteTexture(unsigned int id, uint64_t bindlessHandle) {
+	TextureStreamer::remove(id);
+	UploadQueue::cancelTexture(id);
+	if (bindlessHandle != 0)
+		GLExtensions::makeTextureHandleNonResident(bindlessHandle);
+	glDeleteTextures(1, &id);
+}
+
+unsigned int TextureCache::reload(const std::string& path) {
+	std::string key = Vfs::getKey(path);
+	bool compress = TextureCompression::getEnabled();
+	unsigned int count = 0;
+	entries.forEach([&](TextureHandle handle, Entry& entry) {
+		bool uses = false;
+		for (const auto& source : entry.source.paths)
+			uses = uses || (!source.empty() && Vfs::getKey(source) == key);
+		if (!uses)
+			return;
+		// A newer edit wins over a reload still running.
+		for (auto& r : reloads)
+			if (r->handle == handle)
+				r->handle = TextureHandle();
+		std::unique_ptr<Reload> r = std::make_unique<Reload>();
+		r->handle = handle;
+		r->source = entry.source;
+		r->compressed = compress;
+		r->start = std::chrono::high_resolution_clock::now();
+		Reload* target = r.get();
+		r->job = JobSystem::submit([target]() { loadReload(*target); });
+		reloads.push_back(std::move(r));
+		count++;
+	});
+	return count;
+}
+
+// Worker side: decode and compress like the first load, no OpenGL calls.
+static void loadReload(Reload& r) {
+	const TextureCache::Source& source = r.source;
+	const int* sourceChannels = source.hasChannels ? source.channels : nullptr;
+	if (source.orm) {
+		Vfs::File files[3];
+		for (int i = 0; i < 3; ++i)
+			if (!source.paths[i].empty())
+				files[i] = Vfs::open(source.paths[i]);
+		if (!TextureCache::packOrm(source.paths, files, sourceChannels, r.pixels, r.width, r.height))
+			return;
+		r.components = 4;
+	}
+	else {
+		Vfs::File file = Vfs::open(source.paths[0]);
+		unsigned char* data = file.getSize() == 0 ? nullptr :
+			stbi_load_from_memory((const unsigned char*)file.getData(), (int)file.getSize(), &r.width, &r.height, &r.components, r.compressed ? 4 : 0);
+		if (!data)
+			return;
+		if (r.compressed)
+			r.components = 4;
+		r.pixels.assign(data, data + (size_t)r.width * r.height * r.components);
+		stbi_image_free(data);
+	}
+	if (r.compressed) {
+		std::vector<std::string> cacheSources(source.paths, source.paths + (source.orm ? 3 : 1));
+		if (sourceChannels)
+			cacheSources.push_back(getChannelKey(sourceChannels));
+		r.cachePath = TextureCompression::getCachePath(cacheSources, source.usage, source.srgb);
+		TextureCompression::compress(r.pixels.data(), r.width, r.height, source.usage, source.srgb, r.image);
+		r.cached = TextureCompression::saveDds(r.cachePath, r.image);
+		r.pixels = std::vector<unsigned char>();
+	}
+	r.loaded = true;
+}
+
+std::vector<TextureHandle> TextureCache::updateReloads() {
+	// Users of the textures replaced last time moved to the new ones.
+	for (const auto& replaced : replacedTextures)
+		deleteTexture(replaced.first, replaced.second);
+	replacedTextures.clear();
+
+	std::vector<TextureHandle> swapped;
+	for (size_t i = 0; i < reloads.size();) {
+		Reload& r = *reloads[i];
+		Entry* entry = entries.get(r.handle);
+		bool done = false;
+		if (r.id == 0) {
+			if (r.job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++i;
+				continue;
+			}
+			r.job.get();
+			if (!r.loaded || !entry) {
+				if (entry)
+					std::cout << "Texture " << r.source.paths[0] << " failed to reload, the previous one is kept." << std::endl;
+				done = true;
+			}
+			else if (r.compressed) {
+				r.id = uploadCompressed(r.cachePath, r.image, r.cached);
+				r.bytes = TextureCompression::getImageBytes(r.image);
+			}
+			else
+				r.id = upload(r.pixels.data(), r.width, r.height, r.components, r.source.srgb, r.bytes);
+			r.ticket = UploadQueue::getLastTicket();
+		}
+		// The old texture is drawn until the new one has all of its data.
+		if (!done && !entry) {
+			deleteTexture(r.id, 0);
+			done = true;
+		}
+		else if (!done && UploadQueue::isDone(r.ticket)) {
+			replacedTextures.push_back({ entry->id, entry->handle });
+			residentBytes = residentBytes - entry->bytes + r.bytes;
+			entry->id = r.id;
+			entry->bytes = r.bytes;
+			entry->compressed = r.compressed;
+			entry->handle = 0;
+			entry->uploadTicket = r.ticket;
+			// The content is new, other paths with the old content can't share it anymore.
+			const auto& cit = contentIds.find(entry->contentKey);
+			if (cit != contentIds.end() && cit->second == r.handle)
+				contentIds.erase(cit);
+			entry->contentKey = 0;
+			swapped.push_back(r.handle);
+			stats.reloads++;
+			std::cout << "Texture " << r.source.paths[0] << " reloaded in " <<
+				std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - r.start).count() << " ms." << std::endl;
+			done = true;
+		}
+		if (done) {
+			reloads[i] = std::move(reloads.back());
+			reloads.pop_back();
+		}
+		else
+			++i;
+	}
+	if (!swapped.empty())
+		evict();
+	return swapped;
+}
+
+uint64_t TextureCache::getBindlessHandle(TextureHandle handle) {
+	Entry* entry = entries.get(handle);
+	if (!entry)
+		return 0;
+	if (entry->handle == 0) {
+		entry->handle = GLExtensions::getTextureHandle(entry->id);
+		GLExtensions::makeTextureHandleResident(entry->handle);
+	}
+	return entry->handle;
+}
+
+void TextureCache::terminate() {
+	// Reload jobs write in their Reload, they're done before it goes.
+	for (auto& r : reloads) {
+		if (r->job.valid())
+			r->job.wait();
+		if (r->id != 0)
+			glDeleteTextures(1, &r->id);
+	}
+	reloads.clear();
+	for (const auto& replaced : replacedTextures)
+		deleteTexture(replaced.first, replaced.second);
+	replacedTextures.clear();
+	TextureStreamer::terminate();
+	entries.forEach([](TextureHandle, Entry& entry) {
+		if (entry.handle != 0)
+			GLExtensions::makeTextureHandleNonResident(entry.handle);
+		glDeleteTextures(1, &entry.id);
+	});
+	glDeleteTextures(1, &fallbackId);
+	fallbackId = 0;
+	unusedTextures.clear();
+	residentBytes = 0;
+	entries.clear();
+	pathIds.clear();
+	contentIds.clear();
+	stats = Stats();
+}
+
+size_t TextureCache::getBudget() {
+	return budget;
+}
+
+void TextureCache::setBudget(size_t bytes) {
+	budget = bytes;
+	evict();
+}
+
+bool TextureCache::getUseContentHash() {
+	return useContentHash;
+}
+
+void TextureCache::setUseContentHash(bool b) {
+	useContentHash = b;
+}
+
+TextureCache::Stats TextureCache::getStats() {
+	Stats s = stats;
+	s.textures = entries.size();
+	s.references = 0;
+	s.bytes = 0;
+	s.compressed = 0;
+	s.unused = (unsigned int)unusedTextures.size();
+	entries.forEach([&s](TextureHandle, const Entry& entry) {
+		s.references += entry.references;
+		s.bytes += entry.bytes;
+		s.compressed += entry.compressed ? 1 : 0;
+	});
+	return s;
+}
+
+// Paths are case insensitive on windows, so they are compared normalized and lower case.
+static std::string resolvePath(const std::string& path, bool srgb, TextureCompression::Usage usage) {
+	std::string key;
+	try {
+		key = std::filesystem::path(path).lexically_normal().string();
+	}
+	catch (...) {
+		key = path;
+	}
+	for (char& c : key) {
+		if (c == '/')
+			c = '\\';
+		c = (char)std::tolower((unsigned char)c);
+	}
+	return key + (srgb ? "|srgb|" : "|linear|") + std::to_string((int)usage);
+}
+
+// FNV-1a, the flag and the usage are mixed in so sRGB and linear versions of an image, and versions compressed
+// for other uses (colors, normals, data), stay separate like in resolvePath.
+static uint64_t hashContent(const unsigned char* bytes, size_t size, bool srgb, TextureCompression::Usage usage) {
+	uint64_t h = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+	h ^= srgb ? 1 : 2;
+	h *= 1099511628211ull;
+	h ^= (uint64_t)usage + 1;
+	h *= 1099511628211ull;
+	return h;
+}
+
+static unsigned int upload(const unsigned char* data, int width, int height, int components, bool srgb, size_t& bytes) {
+	GLenum format = GL_RGBA;
+	if (components == 1)
+		format = GL_RED;
+	else if (components == 2)
+		format = GL_RG;
+	else if (components == 3)
+		format = GL_RGB;
+	// Colors marked as gamma corrected are converted to linear by the sampler.
+	GLenum internalFormat = GL_RGBA8;
+	if (components == 1)
+		internalFormat = GL_R8;
+	else if (components == 2)
+		internalFormat = GL_RG8;
+	else if (components == 3)
+		internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+	else if (srgb)
+		internalFormat = GL_SRGB8_ALPHA8;
+
+	// Storage for the full mip chain now, level 0 is copied by the upload queue and the chain built after it.
+	unsigned int textureID;
+	glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+	int levels = (int)std::floor(std::log2(std::max(width, height))) + 1;
+	glTextureStorage2D(textureID, levels, internalFormat, width, height);
+	UploadQueue::uploadTexture(textureID, 0, width, height, format, components,
+		std::vector<unsigned char>(data, data + (size_t)width * height * components));
+	UploadQueue::generateMipmaps(textureID);
+
+	// Might want to change this.
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Base level plus a third for the mip chain.
+	bytes = (size_t)width * height * components * 4 / 3;
+	return textureID;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "TextureCompression.h"
+#include "Mesh.h"
+#include "vfs/Vfs.h"
+
+// Engine wide cache of 2D textures loaded from files.
+// Textures are keyed by resolved path and sRGB flag, optionally also by a hash of the file content,
+// so an image used by many meshes or models is decoded and uploaded once.
+// With compression enabled images are block compressed on first use and later read from the dds cache.
+// Every acquire must be matched by a release. Textures without references stay in the cache and are deleted,
+// least recently released first, only when the cache goes over its memory budget.
+// Textures are referenced by handle, a released texture resolves to a white fallback instead of a dead id.
+namespace TextureCache {
+	struct Stats {
+		unsigned int textures = 0, references = 0;
+		// Estimated gpu memory, mipmaps included. Compressed textures count their blocks.
+		size_t bytes = 0;
+		unsigned int hits = 0, misses = 0;
+		// Files with a different path but the same content as a cached texture.
+		unsigned int contentHits = 0;
+		unsigned int compressed = 0;
+		// Textures kept without references, and how many of them were deleted for the budget.
+		unsigned int unused = 0, evicted = 0;
+		// Textures replaced by hot reload.
+		unsigned int reloads = 0;
+	};
+
+	// Returns the texture with one more reference, null handle if the file can't be loaded.
+	// usage chooses the compressed format. cookedPath is the dds the cooker made, read when the file isn't there.
+	TextureHandle acquire(const std::string& path, bool srgb, TextureCompression::Usage usage = TextureCompression::Usage::COLOR,
+		const std::string& cookedPath = "");
+	// Occlusion, roughness and metallic maps packed in the red, green and blue channels of one texture.
+	// Empty paths are missing maps, their channels are 1, 1 and 0.
+	// sourceChannels picks the channel read from each map (glTF has roughness in green and metallic in blue),
+	// by default maps are read as grey.
+	TextureHandle acquireOrm(const std::string& aoPath, const std::string& roughnessPath, const std::string& metallicPath, const int* sourceChannels = nullptr,
+		const std::string& cookedPath = "");
+	// Cpu side of acquireOrm, also used by the cooker: the maps (files read from paths) packed in rgba pixels.
+	// False if none can be decoded.
+	bool packOrm(const std::string paths[3], const Vfs::File files[3], const int* sourceChannels, std::vector<unsigned char>& rgba, int& width, int& height);
+	// OpenGL texture, 0 for the null handle and the fallback texture for stale handles.
+	unsigned int getId(TextureHandle handle);
+	// Data is copied by the UploadQueue, the texture can be sampled once this ticket is done. 0 for stale handles.
+	uint64_t getUploadTicket(TextureHandle handle);
+	// One more reference to an already acquired texture.
+	void addReference(TextureHandle handle);
+	void release(TextureHandle handle);
+	// Resident bindless handle of a cached texture, created the first time it's asked, 0 if the handle is stale.
+	// Needs ARB_bindless_texture. The texture parameters can't change anymore once it has a handle.
+	uint64_t getBindlessHandle(TextureHandle handle);
+	// Estimated gpu memory of all cached textures, used or not. Only unused ones are deleted to meet it.
+	size_t getBudget();
+	void setBudget(size_t bytes);
+	// Load again, on a worker, every cached texture made from the file. Returns how many are reloading.
+	unsigned int reload(const std::string& path);
+	// Once per frame: uploads the reloaded textures and swaps in those whose data arrived. Handles stay the same,
+	// the returned ones have a new id that their users must read again (see Mesh::refreshTextures).
+	// The old textures are deleted on the next call. If a file can't be loaded the old texture stays.
+	std::vector<TextureHandle> updateReloads();
+	// Delete everything, to be called at the end of the program.
+	void terminate();
+
+	// Hash file content to find identical images with different paths, off by default.
+	bool getUseContentHash();
+	void setUseContentHash(bool);
+	Stats getStats();
+}
\ No newline at end of file
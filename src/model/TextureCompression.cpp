@@ -0,0 +1,623 @@
+#include "TextureCompression.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "renderer/UploadQueue.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+#include "ProjectDirectory.h"
+#include "jobs/JobSystem.h"
+#include "vfs/Vfs.h"
+
+// S3TC isn't core, so glad doesn't define it.
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+
+using namespace TextureCompression;
+
+// Bump when the encoder output changes, old cache files are then ignored.
+static const unsigned int ENCODER_VERSION = 1;
+static const unsigned int BLOCK_ROWS_PER_JOB = 4;
+
+static bool enabled = true, preferBc1 = false;
+
+struct Level {
+	unsigned int width, height;
+	std::vector<unsigned char> pixels;
+};
+
+static void buildMips(const unsigned char* rgba, unsigned int width, unsigned int height, Usage usage, bool srgb, std::vector<Level>& out);
+static void encodeLevel(const Level& level, Format format, std::vector<unsigned char>& out);
+static void encodeBc1(const unsigned char* block, unsigned char* out);
+static void encodeBc4(const unsigned char* values, unsigned char* out);
+static void encodeBc7(const unsigned char* block, unsigned char* out);
+static unsigned int getBlockBytes(Format format);
+static unsigned int getDxgiFormat(Format format, bool srgb);
+static bool fromDxgiFormat(unsigned int dxgi, Format& format, bool& srgb);
+static unsigned int getGlFormat(Format format, bool srgb);
+
+void TextureCompression::compress(const unsigned char* rgba, unsigned int width, unsigned int height, Usage usage, bool srgb, Image& out) {
+	Format format = Format::BC7;
+	if (usage == Usage::NORMAL)
+		format = Format::BC5;
+	else if (usage == Usage::DATA)
+		format = Format::BC4;
+	else if (usage == Usage::COLOR && preferBc1 && glfwExtensionSupported("GL_EXT_texture_compression_s3tc")) {
+		bool opaque = true;
+		for (size_t i = 3; i < (size_t)width * height * 4 && opaque; i += 4)
+			opaque = rgba[i] == 255;
+		if (opaque)
+			format = Format::BC1;
+	}
+
+	std::vector<Level> mips;
+	buildMips(rgba, width, height, usage, srgb, mips);
+	out.format = format;
+	// Only colors are stored as sRGB, the other formats have no sRGB version.
+	out.srgb = srgb && usage == Usage::COLOR;
+	out.width = width;
+	out.height = height;
+	out.levels.resize(mips.size());
+	for (size_t i = 0; i < mips.size(); ++i)
+		encodeLevel(mips[i], format, out.levels[i]);
+}
+
+// Dds layout, a DX10 header follows the main one so that BC4, BC5 and BC7 can be described.
+struct DdsPixelFormat {
+	uint32_t size, flags, fourCC, rgbBitCount, rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DdsHeader {
+	uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+	uint32_t reserved1[11];
+	DdsPixelFormat pixelFormat;
+	uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct DdsHeaderDx10 {
+	uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+};
+
+static const uint32_t DDS_MAGIC = 0x20534444, DX10_FOURCC = 0x30315844;
+
+bool TextureCompression::saveDds(const std::string& path, const Image& image) {
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		if (!f)
+			return false;
+		DdsHeader header = {};
+		header.size = sizeof(DdsHeader);
+		// Caps, height, width, pixel format, mipmap count, linear size.
+		header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+		header.height = image.height;
+		header.width = image.width;
+		header.pitchOrLinearSize = image.levels.empty() ? 0 : (uint32_t)image.levels[0].size();
+		header.mipMapCount = (uint32_t)image.levels.size();
+		header.pixelFormat.size = sizeof(DdsPixelFormat);
+		header.pixelFormat.flags = 0x4;
+		header.pixelFormat.fourCC = DX10_FOURCC;
+		// Texture, mipmap, complex.
+		header.caps = 0x1000 | 0x400000 | 0x8;
+		DdsHeaderDx10 dx10 = {};
+		dx10.dxgiFormat = getDxgiFormat(image.format, image.srgb);
+		dx10.resourceDimension = 3;
+		dx10.arraySize = 1;
+		f.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+		f.write((const char*)&header, sizeof(header));
+		f.write((const char*)&dx10, sizeof(dx10));
+		for (const auto& level : image.levels)
+			f.write((const char*)level.data(), level.size());
+		return (bool)f;
+	}
+	catch (...) {
+		std::cout << "Error while writing compressed texture " << path << std::endl;
+		return false;
+	}
+}
+
+bool TextureCompression::loadDds(const std::string& path, Image& image, unsigned int maxSize) {
+	try {
+		// Mapped, levels above maxSize are skipped without being read.
+		Vfs::File f = Vfs::open(path);
+		const char* data = f.getData();
+		size_t size = f.getSize(), offset = 0;
+		auto read = [&](void* out, size_t bytes) {
+			if (size - offset < bytes)
+				return false;
+			std::memcpy(out, data + offset, bytes);
+			offset += bytes;
+			return true;
+		};
+		uint32_t magic = 0;
+		DdsHeader header;
+		DdsHeaderDx10 dx10;
+		if (!read(&magic, sizeof(magic)) || !read(&header, sizeof(header)) || magic != DDS_MAGIC || header.pixelFormat.fourCC != DX10_FOURCC)
+			return false;
+		if (!read(&dx10, sizeof(dx10)) || !fromDxgiFormat(dx10.dxgiFormat, image.format, image.srgb) || header.width == 0 || header.height == 0)
+			return false;
+		image.width = header.width;
+		image.height = header.height;
+		unsigned int levels = std::max(1u, header.mipMapCount);
+		image.levels.assign(levels, std::vector<unsigned char>());
+		for (unsigned int i = 0; i < levels; ++i) {
+			unsigned int bytes = getLevelBytes(image, i);
+			if (size - offset < bytes)
+				return false;
+			if (maxSize == 0 || std::max(std::max(1u, image.width >> i), std::max(1u, image.height >> i)) <= maxSize)
+				image.levels[i].assign(data + offset, data + offset + bytes);
+			offset += bytes;
+		}
+		return true;
+	}
+	catch (...) {
+		std::cout << "Error while reading compressed texture " << path << std::endl;
+		return false;
+	}
+}
+
+std::string TextureCompression::getCachePath(const std::string& sourcePath, Usage usage, bool srgb) {
+	return getCachePath(std::vector<std::string>{ sourcePath }, usage, srgb);
+}
+
+std::string TextureCompression::getCachePath(const std::vector<std::string>& sourcePaths, Usage usage, bool srgb) {
+	std::string key;
+	for (const auto& sourcePath : sourcePaths) {
+		for (char c : sourcePath)
+			key += (char)std::tolower((unsigned char)(c == '/' ? '\\' : c));
+		// Packed files keep the size and write time of their source, the key doesn't change once cooked.
+		Vfs::Info info = sourcePath.empty() ? Vfs::Info() : Vfs::stat(sourcePath);
+		if (info.exists && !info.directory)
+			key += "|" + std::to_string(info.size) + "|" + std::to_string(info.writeTime);
+		key += ";";
+	}
+	key += "|" + std::to_string((int)usage) + (srgb ? "|srgb" : "|linear") + (preferBc1 ? "|bc1" : "") + "|v" + std::to_string(ENCODER_VERSION);
+	// FNV-1a.
+	uint64_t h = 14695981039346656037ull;
+	for (char c : key) {
+		h ^= (unsigned char)c;
+		h *= 1099511628211ull;
+	}
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)h);
+	return project_directory + "\\cache\\textures\\" + name + ".dds";
+}
+
+unsigned int TextureCompression::upload(Image& image) {
+	unsigned int textureID;
+	glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+	GLenum internalFormat = getGlFormat(image.format, image.srgb);
+	glTextureStorage2D(textureID, (GLsizei)image.levels.size(), internalFormat, image.width, image.height);
+	// Smallest levels first, so a texture is complete from the bottom of its chain up.
+	unsigned int baseLevel = (unsigned int)image.levels.size() - 1;
+	for (unsigned int i = (unsigned int)image.levels.size(); i-- > 0;) {
+		if (image.levels[i].empty())
+			break;
+		unsigned int w = std::max(1u, image.width >> i), h = std::max(1u, image.height >> i);
+		UploadQueue::uploadCompressedTexture(textureID, i, w, h, internalFormat, std::move(image.levels[i]));
+		image.levels[i] = std::vector<unsigned char>();
+		baseLevel = i;
+	}
+	glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glTextureParameteri(textureID, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+
+	// Might want to change this.
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
+
+// Storage of all levels, also the ones not loaded.
+size_t TextureCompression::getImageBytes(const Image& image) {
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < image.levels.size(); ++i)
+		bytes += getLevelBytes(image, i);
+	return bytes;
+}
+
+unsigned int TextureCompression::getLevelBytes(const Image& image, unsigned int level) {
+	unsigned int w = std::max(1u, image.width >> level), h = std::max(1u, image.height >> level);
+	return ((w + 3) / 4) * ((h + 3) / 4) * getBlockBytes(image.format);
+}
+
+bool TextureCompression::getEnabled() {
+	return enabled;
+}
+
+void TextureCompression::setEnabled(bool b) {
+	enabled = b;
+}
+
+bool TextureCompression::getPreferBc1() {
+	return preferBc1;
+}
+
+void TextureCompression::setPreferBc1(bool b) {
+	preferBc1 = b;
+}
+
+static float srgbToLinear(float c) {
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c) {
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Box filtered mip chain. sRGB colors are averaged in linear space and normals are renormalized.
+static void buildMips(const unsigned char* rgba, unsigned int width, unsigned int height, Usage usage, bool srgb, std::vector<Level>& out) {
+	bool linearize = srgb && usage == Usage::COLOR;
+	float toLinear[256];
+	for (int i = 0; i < 256; ++i)
+		toLinear[i] = linearize ? srgbToLinear(i / 255.0f) : i / 255.0f;
+
+	out.clear();
+	out.push_back({ width, height, std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4) });
+	std::vector<float> current((size_t)width * height * 4);
+	for (size_t i = 0; i < current.size(); ++i)
+		current[i] = (i & 3) == 3 ? rgba[i] / 255.0f : toLinear[rgba[i]];
+
+	unsigned int w = width, h = height;
+	while (w > 1 || h > 1) {
+		unsigned int nw = std::max(1u, w / 2), nh = std::max(1u, h / 2);
+		std::vector<float> next((size_t)nw * nh * 4);
+		Level level{ nw, nh, std::vector<unsigned char>(next.size()) };
+		for (unsigned int y = 0; y < nh; ++y) {
+			for (unsigned int x = 0; x < nw; ++x) {
+				unsigned int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+				unsigned int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+				float* dst = &next[((size_t)y * nw + x) * 4];
+				for (int c = 0; c < 4; ++c) {
+					dst[c] = 0.25f * (current[((size_t)y0 * w + x0) * 4 + c] + current[((size_t)y0 * w + x1) * 4 + c] +
+						current[((size_t)y1 * w + x0) * 4 + c] + current[((size_t)y1 * w + x1) * 4 + c]);
+				}
+				if (usage == Usage::NORMAL) {
+					float n[3] = { dst[0] * 2.0f - 1.0f, dst[1] * 2.0f - 1.0f, dst[2] * 2.0f - 1.0f };
+					float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 1e-6f) {
+						for (int c = 0; c < 3; ++c)
+							dst[c] = n[c] / length * 0.5f + 0.5f;
+					}
+				}
+				unsigned char* d = &level.pixels[((size_t)y * nw + x) * 4];
+				for (int c = 0; c < 4; ++c) {
+					float v = (c < 3 && linearize) ? linearToSrgb(dst[c]) : dst[c];
+					d[c] = (unsigned char)std::clamp((int)(v * 255.0f + 0.5f), 0, 255);
+				}
+			}
+		}
+		out.push_back(std::move(level));
+		current = std::move(next);
+		w = nw;
+		h = nh;
+	}
+}
+
+// Blocks rows are split between workers, edges of sizes that aren't multiples of 4 are clamped.
+static void encodeLevel(const Level& level, Format format, std::vector<unsigned char>& out) {
+	unsigned int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	unsigned int blockBytes = getBlockBytes(format);
+	out.assign((size_t)blocksX * blocksY * blockBytes, 0);
+	JobSystem::parallelFor(blocksY, BLOCK_ROWS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+		unsigned char block[64], channel[16];
+		for (unsigned int by = begin; by < end; ++by) {
+			for (unsigned int bx = 0; bx < blocksX; ++bx) {
+				for (unsigned int i = 0; i < 16; ++i) {
+					unsigned int x = std::min(bx * 4 + (i & 3), level.width - 1), y = std::min(by * 4 + (i >> 2), level.height - 1);
+					std::memcpy(&block[i * 4], &level.pixels[((size_t)y * level.width + x) * 4], 4);
+				}
+				unsigned char* dst = &out[((size_t)by * blocksX + bx) * blockBytes];
+				if (format == Format::BC1)
+					encodeBc1(block, dst);
+				else if (format == Format::BC7)
+					encodeBc7(block, dst);
+				else {
+					for (unsigned int i = 0; i < 16; ++i)
+						channel[i] = block[i * 4];
+					encodeBc4(channel, dst);
+					if (format == Format::BC5) {
+						for (unsigned int i = 0; i < 16; ++i)
+							channel[i] = block[i * 4 + 1];
+						encodeBc4(channel, dst + 8);
+					}
+				}
+			}
+		}
+	});
+}
+
+// Mean and main axis of the block colors (power iteration on the covariance), channels is 3 or 4.
+static void principalAxis(const float (*px)[4], int channels, float* mean, float* axis) {
+	for (int c = 0; c < 4; ++c) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			mean[c] += px[i][c];
+		mean[c] /= 16.0f;
+	}
+	float cov[4][4] = {};
+	for (int i = 0; i < 16; ++i)
+		for (int a = 0; a < channels; ++a)
+			for (int b = 0; b < channels; ++b)
+				cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+	for (int c = 0; c < 4; ++c)
+		axis[c] = c < channels ? 1.0f : 0.0f;
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		float next[4] = {}, length = 0.0f;
+		for (int a = 0; a < channels; ++a) {
+			for (int b = 0; b < channels; ++b)
+				next[a] += cov[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+		if (length < 1e-12f)
+			break;
+		length = std::sqrt(length);
+		for (int a = 0; a < channels; ++a)
+			axis[a] = next[a] / length;
+	}
+}
+
+static uint16_t to565(const float* c) {
+	int r = std::clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = std::clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = std::clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void from565(uint16_t c, int* rgb) {
+	int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints at the extremes of the main axis, always in 4 color mode.
+static void encodeBc1(const unsigned char* block, unsigned char* out) {
+	float px[16][4], mean[4], axis[4];
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 4; ++c)
+			px[i][c] = c < 3 ? block[i * 4 + c] : 0.0f;
+	principalAxis(px, 3, mean, axis);
+	float tMin = 1e30f, tMax = -1e30f;
+	for (int i = 0; i < 16; ++i) {
+		float t = (px[i][0] - mean[0]) * axis[0] + (px[i][1] - mean[1]) * axis[1] + (px[i][2] - mean[2]) * axis[2];
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+	float e0[3], e1[3];
+	for (int c = 0; c < 3; ++c) {
+		e0[c] = mean[c] + axis[c] * tMax;
+		e1[c] = mean[c] + axis[c] * tMin;
+	}
+	uint16_t c0 = to565(e0), c1 = to565(e1);
+	if (c0 < c1)
+		std::swap(c0, c1);
+	uint32_t indices = 0;
+	if (c0 != c1) {
+		int palette[4][3];
+		from565(c0, palette[0]);
+		from565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; ++p) {
+				int error = 0;
+				for (int c = 0; c < 3; ++c) {
+					int d = block[i * 4 + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+	out[0] = c0 & 0xFF;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xFF;
+	out[3] = c1 >> 8;
+	for (int i = 0; i < 4; ++i)
+		out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// Min and max as endpoints, in 8 value mode (first endpoint greater).
+static void encodeBc4(const unsigned char* values, unsigned char* out) {
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; ++i) {
+		lo = std::min(lo, (int)values[i]);
+		hi = std::max(hi, (int)values[i]);
+	}
+	out[0] = (unsigned char)hi;
+	out[1] = (unsigned char)lo;
+	uint64_t indices = 0;
+	if (hi != lo) {
+		int palette[8];
+		palette[0] = hi;
+		palette[1] = lo;
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * hi + i * lo + 3) / 7;
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 8; ++p) {
+				int error = std::abs(values[i] - palette[p]);
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Mode6 {
+	// 7 bit endpoints and their p bits.
+	int q0[4], q1[4], p0, p1;
+	int indices[16];
+	int error;
+};
+
+// Quantize endpoints with the given p bits and pick the closest palette entry for each pixel.
+static void evaluateBc7(const unsigned char* block, const float* e0, const float* e1, int p0, int p1, Bc7Mode6& out) {
+	int palette[16][4], v0[4], v1[4];
+	for (int c = 0; c < 4; ++c) {
+		out.q0[c] = std::clamp((int)std::lround((e0[c] - p0) / 2.0f), 0, 127);
+		out.q1[c] = std::clamp((int)std::lround((e1[c] - p1) / 2.0f), 0, 127);
+		v0[c] = (out.q0[c] << 1) | p0;
+		v1[c] = (out.q1[c] << 1) | p1;
+	}
+	out.p0 = p0;
+	out.p1 = p1;
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 4; ++c)
+			palette[i][c] = ((64 - BC7_WEIGHTS[i]) * v0[c] + BC7_WEIGHTS[i] * v1[c] + 32) >> 6;
+	out.error = 0;
+	for (int i = 0; i < 16; ++i) {
+		int best = 0, bestError = INT32_MAX;
+		for (int p = 0; p < 16; ++p) {
+			int error = 0;
+			for (int c = 0; c < 4; ++c) {
+				int d = block[i * 4 + c] - palette[p][c];
+				error += d * d;
+			}
+			if (error < bestError) {
+				bestError = error;
+				best = p;
+			}
+		}
+		out.indices[i] = best;
+		out.error += bestError;
+	}
+}
+
+// Mode 6 only: one subset, 7 bit RGBA endpoints with a p bit each and 4 bit indices.
+// Endpoints start from the main axis, then are refined once with least squares on the chosen indices.
+static void encodeBc7(const unsigned char* block, unsigned char* out) {
+	float px[16][4], mean[4], axis[4];
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 4; ++c)
+			px[i][c] = block[i * 4 + c];
+	principalAxis(px, 4, mean, axis);
+	float tMin = 1e30f, tMax = -1e30f;
+	for (int i = 0; i < 16; ++i) {
+		float t = 0.0f;
+		for (int c = 0; c < 4; ++c)
+			t += (px[i][c] - mean[c]) * axis[c];
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+	float e0[4], e1[4];
+	for (int c = 0; c < 4; ++c) {
+		e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+		e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+	}
+
+	Bc7Mode6 best, candidate;
+	best.error = INT32_MAX;
+	for (int pass = 0; pass < 2 && best.error > 0; ++pass) {
+		for (int p = 0; p < 4; ++p) {
+			evaluateBc7(block, e0, e1, p & 1, p >> 1, candidate);
+			if (candidate.error < best.error)
+				best = candidate;
+		}
+		// Least squares endpoints for the best indices.
+		float aa = 0, ab = 0, bb = 0, ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			float b = BC7_WEIGHTS[best.indices[i]] / 64.0f, a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 4; ++c) {
+				ax[c] += a * px[i][c];
+				bx[c] += b * px[i][c];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f)
+			break;
+		for (int c = 0; c < 4; ++c) {
+			e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+			e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+		}
+	}
+
+	// The first index is stored with 3 bits, so its top bit must be 0.
+	if (best.indices[0] >= 8) {
+		for (int c = 0; c < 4; ++c)
+			std::swap(best.q0[c], best.q1[c]);
+		std::swap(best.p0, best.p1);
+		for (int i = 0; i < 16; ++i)
+			best.indices[i] = 15 - best.indices[i];
+	}
+
+	std::memset(out, 0, 16);
+	unsigned int bit = 0;
+	auto write = [&](unsigned int value, unsigned int bits) {
+		for (unsigned int b = 0; b < bits; ++b, ++bit)
+			if ((value >> b) & 1)
+				out[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+	};
+	// Mode 6 is six 0 bits and a 1.
+	write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		write(best.q0[c], 7);
+		write(best.q1[c], 7);
+	}
+	write(best.p0, 1);
+	write(best.p1, 1);
+	for (int i = 0; i < 16; ++i)
+		write(best.indices[i], i == 0 ? 3 : 4);
+}
+
+static unsigned int getBlockBytes(Format format) {
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+static unsigned int getDxgiFormat(Format format, bool srgb) {
+	switch (format) {
+	case Format::BC1: return srgb ? 72 : 71;
+	case Format::BC4: return 80;
+	case Format::BC5: return 83;
+	default: return srgb ? 99 : 98;
+	}
+}
+
+static bool fromDxgiFormat(unsigned int dxgi, Format& format, bool& srgb) {
+	srgb = dxgi == 72 || dxgi == 99;
+	if (dxgi == 71 || dxgi == 72)
+		format = Format::BC1;
+	else if (dxgi == 80)
+		format = Format::BC4;
+	else if (dxgi == 83)
+		format = Format::BC5;
+	else if (dxgi == 98 || dxgi == 99)
+		format = Format::BC7;
+	else
+		return false;
+	return true;
+}
+
+static unsigned int getGlFormat(Format format, bool srgb) {
+	switch (format) {
+	case Format::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case Format::BC4: return GL_COMPRESSED_RED_RGTC1;
+	case Format::BC5: return GL_COMPRESSED_RG_RGTC2;
+	default: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+}
\ No newline at end of file
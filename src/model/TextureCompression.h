@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Block compression of textures at import time.
+// Images are encoded once with precomputed mipmaps and cached as dds files in cache\textures,
+// later loads upload the blocks directly with glCompressedTextureSubImage2D.
+namespace TextureCompression {
+	// What the texture is used for, it decides the format.
+	enum class Usage {
+		// Albedo, BC7 (BC1 for opaque images if preferred).
+		COLOR,
+		// Tangent space normal map, BC5 with x and y only, z is rebuilt in the shader.
+		NORMAL,
+		// Single channel data like roughness or metallic, BC4 from the red channel.
+		DATA,
+		// Channel packed data (occlusion, roughness, metallic), BC7 without sRGB.
+		PACKED
+	};
+
+	enum class Format {
+		BC1, BC4, BC5, BC7
+	};
+
+	struct Image {
+		Format format = Format::BC7;
+		bool srgb = false;
+		unsigned int width = 0, height = 0;
+		// Mip levels, from the full size image down to 1x1.
+		std::vector<std::vector<unsigned char>> levels;
+	};
+
+	// rgba is width * height * 4 bytes, top row first like stb_image.
+	void compress(const unsigned char* rgba, unsigned int width, unsigned int height, Usage usage, bool srgb, Image& out);
+	bool saveDds(const std::string& path, const Image& image);
+	// Levels whose larger side is above maxSize (0 for no limit) are not read and left empty.
+	bool loadDds(const std::string& path, Image& image, unsigned int maxSize = 0);
+	// Dds file for a source image, named after its path, size and modification time, so edits invalidate it.
+	std::string getCachePath(const std::string& sourcePath, Usage usage, bool srgb);
+	// Same for images built from several sources, empty paths are allowed.
+	std::string getCachePath(const std::vector<std::string>& sourcePaths, Usage usage, bool srgb);
+	// New texture with immutable storage for all levels, returns its id.
+	// Only levels with data are uploaded, the base level is the first of them. Their data is moved to the
+	// UploadQueue, which copies it over the next frames, so the levels of image are left empty.
+	unsigned int upload(Image& image);
+	unsigned int getLevelBytes(const Image& image, unsigned int level);
+	size_t getImageBytes(const Image& image);
+
+	bool getEnabled();
+	void setEnabled(bool);
+	// Use BC1 (4 bits per pixel) instead of BC7 (8 bits per pixel) for opaque color textures.
+	bool getPreferBc1();
+	void setPreferBc1(bool);
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "TextureStreamer.h"
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "jobs/JobSystem.h"
+
+// Frames a texture keeps its mips after it was last seen.
+static const unsigned int KEEP_FRAMES = 120;
+static const unsigned int MAX_LOADS = 4;
+
+struct Load {
+	std::future<void> job;
+	TextureCompression::Image image;
+	unsigned int level;
+	bool ok;
+};
+
+struct Streamed {
+	std::string path;
+	// Levels are empty, only size and format are used.
+	TextureCompression::Image info;
+	unsigned int initialLevel, residentLevel, targetLevel;
+	// Finest level asked this frame, levelCount if not asked.
+	float wantedLevel;
+	unsigned int lastRequestFrame;
+	bool shaderClamp;
+	std::shared_ptr<Load> load;
+};
+
+static std::unordered_map<unsigned int, Streamed> textures;
+static bool enabled = true, shaderClamp = false;
+static size_t budget = (size_t)512 * 1024 * 1024;
+static unsigned int frame = 0;
+static TextureStreamer::Stats stats;
+
+static size_t residentBytes(const Streamed& t, unsigned int level);
+static void finishLoad(unsigned int id, Streamed& t);
+static void startLoad(Streamed& t);
+
+unsigned int TextureStreamer::getInitialLevel(const TextureCompression::Image& image) {
+	unsigned int level = 0;
+	while (level + 1 < image.levels.size() && std::max(image.width >> level, image.height >> level) > TextureStreamer::INITIAL_SIZE)
+		++level;
+	return level;
+}
+
+void TextureStreamer::add(unsigned int id, const std::string& ddsPath, const TextureCompression::Image& image, unsigned int initialLevel) {
+	Streamed t;
+	t.path = ddsPath;
+	t.info.format = image.format;
+	t.info.srgb = image.srgb;
+	t.info.width = image.width;
+	t.info.height = image.height;
+	t.info.levels.resize(image.levels.size());
+	t.initialLevel = t.residentLevel = t.targetLevel = initialLevel;
+	t.wantedLevel = (float)image.levels.size();
+	t.lastRequestFrame = frame;
+	t.shaderClamp = shaderClamp;
+	textures[id] = std::move(t);
+}
+
+void TextureStreamer::remove(unsigned int id) {
+	const auto& it = textures.find(id);
+	if (it == textures.end())
+		return;
+	if (it->second.load)
+		it->second.load->job.wait();
+	textures.erase(it);
+}
+
+void TextureStreamer::request(unsigned int id, float uvPerPixel) {
+	const auto& it = textures.find(id);
+	if (it == textures.end())
+		return;
+	Streamed& t = it->second;
+	// Texels covered by a pixel along the larger side, each mip halves them.
+	float texelsPerPixel = std::max(t.info.width, t.info.height) * uvPerPixel;
+	float level = texelsPerPixel > 1.0f ? std::log2(texelsPerPixel) : 0.0f;
+	t.wantedLevel = std::min(t.wantedLevel, level);
+	t.lastRequestFrame = frame;
+}
+
+void TextureStreamer::update() {
+	++frame;
+
+	// Upload what finished loading.
+	unsigned int loading = 0;
+	for (auto& pair : textures) {
+		Streamed& t = pair.second;
+		if (t.load && t.load->job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			finishLoad(pair.first, t);
+		if (t.load)
+			loading++;
+	}
+
+	// Textures seen recently get the level they need, the others go back to their initial mips.
+	size_t total = 0;
+	std::vector<Streamed*> order;
+	for (auto& pair : textures) {
+		Streamed& t = pair.second;
+		if (frame - t.lastRequestFrame <= KEEP_FRAMES)
+			t.targetLevel = std::min(t.initialLevel, (unsigned int)std::max(0.0f, std::floor(t.wantedLevel)));
+		else
+			t.targetLevel = t.initialLevel;
+		t.wantedLevel = (float)t.info.levels.size();
+		total += residentBytes(t, t.targetLevel);
+		order.push_back(&t);
+	}
+
+	// Over budget, the least recently used textures drop one level at a time.
+	if (total > budget) {
+		std::sort(order.begin(), order.end(), [](const Streamed* a, const Streamed* b) {
+			if (a->lastRequestFrame != b->lastRequestFrame)
+				return a->lastRequestFrame < b->lastRequestFrame;
+			return a->targetLevel < b->targetLevel;
+		});
+		bool dropped = true;
+		while (total > budget && dropped) {
+			dropped = false;
+			for (Streamed* t : order) {
+				if (total <= budget)
+					break;
+				if (t->targetLevel < t->initialLevel) {
+					total -= TextureCompression::getLevelBytes(t->info, t->targetLevel);
+					t->targetLevel++;
+					dropped = true;
+				}
+			}
+		}
+	}
+
+	for (auto& pair : textures) {
+		Streamed& t = pair.second;
+		// Loads in flight are finished first, the budget is applied again next frame.
+		if (t.load)
+			continue;
+		if (t.targetLevel > t.residentLevel) {
+			// Contents of dropped levels are invalidated so the driver can discard them.
+			if (!t.shaderClamp)
+				glTextureParameteri(pair.first, GL_TEXTURE_BASE_LEVEL, t.targetLevel);
+			for (unsigned int level = t.residentLevel; level < t.targetLevel; ++level)
+				glInvalidateTexImage(pair.first, level);
+			stats.evictedLevels += t.targetLevel - t.residentLevel;
+			t.residentLevel = t.targetLevel;
+		}
+		else if (t.targetLevel < t.residentLevel && loading < MAX_LOADS) {
+			startLoad(t);
+			loading++;
+		}
+	}
+}
+
+void TextureStreamer::terminate() {
+	for (auto& pair : textures)
+		if (pair.second.load)
+			pair.second.load->job.wait();
+	textures.clear();
+	stats = Stats();
+}
+
+unsigned int TextureStreamer::getResidentLevel(unsigned int id) {
+	const auto& it = textures.find(id);
+	return it == textures.end() ? 0 : it->second.residentLevel;
+}
+
+bool TextureStreamer::getEnabled() {
+	return enabled;
+}
+
+void TextureStreamer::setEnabled(bool b) {
+	enabled = b;
+}
+
+size_t TextureStreamer::getBudget() {
+	return budget;
+}
+
+void TextureStreamer::setBudget(size_t bytes) {
+	budget = bytes;
+}
+
+bool TextureStreamer::getShaderClamp() {
+	return shaderClamp;
+}
+
+void TextureStreamer::setShaderClamp(bool b) {
+	shaderClamp = b;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() {
+	Stats s = stats;
+	s.textures = (unsigned int)textures.size();
+	s.loading = 0;
+	s.residentBytes = 0;
+	for (const auto& pair : textures) {
+		s.loading += pair.second.load ? 1 : 0;
+		s.residentBytes += residentBytes(pair.second, pair.second.residentLevel);
+	}
+	return s;
+}
+
+static size_t residentBytes(const Streamed& t, unsigned int level) {
+	size_t bytes = 0;
+	for (unsigned int i = level; i < t.info.levels.size(); ++i)
+		bytes += TextureCompression::getLevelBytes(t.info, i);
+	return bytes;
+}
+
+// Only reading the file runs on a worker, the upload needs the context.
+static void startLoad(Streamed& t) {
+	auto load = std::make_shared<Load>();
+	load->level = t.targetLevel;
+	load->ok = false;
+	std::string path = t.path;
+	unsigned int maxSize = std::max(std::max(1u, t.info.width >> load->level), std::max(1u, t.info.height >> load->level));
+	load->job = JobSystem::submit([load, path, maxSize]() {
+		load->ok = TextureCompression::loadDds(path, load->image, maxSize);
+	});
+	t.load = load;
+}
+
+static void finishLoad(unsigned int id, Streamed& t) {
+	std::shared_ptr<Load> load = t.load;
+	t.load.reset();
+	load->job.get();
+	// The cache file might have been deleted or replaced.
+	if (!load->ok || load->image.levels.size() != t.info.levels.size() || load->image.format != t.info.format ||
+		load->image.width != t.info.width || load->image.height != t.info.height) {
+		std::cout << "Texture streaming failed for " << t.path << ", keeping its current mips." << std::endl;
+		t.initialLevel = t.residentLevel;
+		return;
+	}
+	GLenum internalFormat;
+	glGetTextureLevelParameteriv(id, t.residentLevel, GL_TEXTURE_INTERNAL_FORMAT, (GLint*)&internalFormat);
+	for (unsigned int level = load->level; level < t.residentLevel; ++level) {
+		unsigned int w = std::max(1u, t.info.width >> level), h = std::max(1u, t.info.height >> level);
+		const auto& data = load->image.levels[level];
+		glCompressedTextureSubImage2D(id, level, 0, 0, w, h, internalFormat, (GLsizei)data.size(), data.data());
+	}
+	if (!t.shaderClamp)
+		glTextureParameteri(id, GL_TEXTURE_BASE_LEVEL, load->level);
+	stats.loadedLevels += t.residentLevel - load->level;
+	t.residentLevel = load->level;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "TextureCompression.h"
+
+// Mip streaming of compressed textures.
+// Textures are created with only their small mips, the renderer reports how many uv units each visible mesh
+// covers per screen pixel and finer mips are read from the dds cache on the job system, then uploaded here.
+// GL_TEXTURE_BASE_LEVEL clamps sampling to what is resident, or the shader does it with getResidentLevel()
+// when texture parameters can't change (bindless handles). When the resident total goes above the budget
+// the textures used least recently drop their finest mips.
+namespace TextureStreamer {
+	// Mips up to this size are always resident.
+	const unsigned int INITIAL_SIZE = 64;
+
+	struct Stats {
+		unsigned int textures = 0, loading = 0;
+		size_t residentBytes = 0;
+		unsigned int loadedLevels = 0, evictedLevels = 0;
+	};
+
+	// First level created with the texture, the ones above it are streamed.
+	unsigned int getInitialLevel(const TextureCompression::Image& image);
+	// Texture created from image (levels from initialLevel resident), finer levels are read from ddsPath.
+	void add(unsigned int id, const std::string& ddsPath, const TextureCompression::Image& image, unsigned int initialLevel);
+	void remove(unsigned int id);
+	// Called for each texture of a visible mesh, uvPerPixel is how much uv space a screen pixel covers.
+	void request(unsigned int id, float uvPerPixel);
+	// To be called every frame, finishes loads, applies the budget and starts new loads.
+	void update();
+	void terminate();
+	// Finest resident level of a texture, 0 for textures that aren't streamed.
+	unsigned int getResidentLevel(unsigned int id);
+
+	bool getEnabled();
+	// Only affects textures loaded after the change.
+	void setEnabled(bool);
+	size_t getBudget();
+	void setBudget(size_t bytes);
+	// Leave GL_TEXTURE_BASE_LEVEL at 0, the shader clamps the sampled level itself.
+	// Only affects textures loaded after the change.
+	bool getShaderClamp();
+	void setShaderClamp(bool);
+	Stats getStats();
+}
\ No newline at end of file
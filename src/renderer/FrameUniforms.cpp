@@ -0,0 +1,30 @@
+#include "FrameUniforms.h"
+#include <glad/glad.h>
+#include <cstddef>
+
+static_assert(sizeof(FrameUniforms::Data) == 1424, "FrameUniforms::Data must match the std140 layout of Frame.");
+static_assert(offsetof(FrameUniforms::Data, lights) == 448, "FrameUniforms::Data must match the std140 layout of Frame.");
+static_assert(offsetof(FrameUniforms::Data, lightsNumber) == 1392, "FrameUniforms::Data must match the std140 layout of Frame.");
+
+static FrameUniforms::Data data;
+static unsigned int buffer = 0;
+
+void FrameUniforms::initialize() {
+	data = Data();
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, sizeof(Data), nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+void FrameUniforms::terminate() {
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+FrameUniforms::Data& FrameUniforms::get() {
+	return data;
+}
+
+void FrameUniforms::upload() {
+	glNamedBufferSubData(buffer, 0, sizeof(Data), &data);
+	glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Values that are the same for every draw of a frame, kept in one uniform buffer (std140) so that every
+// shader variant sees them without setting uniforms program by program. Same layout as Frame in
+// shaders/include/frame.glsl. Systems write their part in get(), upload() sends it once per frame.
+namespace FrameUniforms {
+	// Uniform buffer binding.
+	const unsigned int BINDING = 0;
+	const int MAX_LIGHT_COUNT = 8;
+	const int MAX_CASCADES = 4;
+	const int MAX_PCF_SAMPLES = 16;
+
+	struct Light {
+		glm::vec4 position, ambient, diffuse, specular;
+		// Constant, linear and quadratic in xyz.
+		glm::vec4 attenuation;
+	};
+
+	struct Data {
+		glm::mat4 view, projection;
+		glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+		glm::vec4 sunPosition, sunAmbient, sunDiffuse, sunSpecular;
+		Light lights[MAX_LIGHT_COUNT];
+		// Poisson disk samples in xy.
+		glm::vec4 pcfSamples[MAX_PCF_SAMPLES];
+		glm::vec4 pcfMultipliers;
+		// MAX_CASCADES + 1 distances, 4 per vector.
+		glm::vec4 cascadePlaneDistances[2];
+		int lightsNumber, pcfSamplesNumber;
+		float poissonPcfDiameter, csmBlendingOffset;
+		float shadowBiasMultiplier, shadowBiasMinimum;
+		float padding[2];
+	};
+
+	void initialize();
+	void terminate();
+	Data& get();
+	// Upload and bind, after every system wrote its values and before drawing.
+	void upload();
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "GLExtensions.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+typedef GLuint64(APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static const GLenum COMPLETION_STATUS_KHR = 0x91B1;
+
+static PFNGLGETTEXTUREHANDLEARBPROC getTextureHandleARB = nullptr;
+static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResidentARB = nullptr;
+static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResidentARB = nullptr;
+static bool bindlessTexture = false;
+static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreadsKHR = nullptr;
+static bool parallelShaderCompile = false;
+
+void GLExtensions::initialize() {
+	if (glfwExtensionSupported("GL_ARB_bindless_texture")) {
+		getTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)glfwGetProcAddress("glGetTextureHandleARB");
+		makeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+		makeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+		bindlessTexture = getTextureHandleARB && makeTextureHandleResidentARB && makeTextureHandleNonResidentARB;
+	}
+	std::cout << "Bindless textures " << (bindlessTexture ? "supported." : "not supported, using texture arrays.") << std::endl;
+
+	// Both versions have the same enum, only the function name differs.
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	parallelShaderCompile = maxShaderCompilerThreadsKHR != nullptr;
+	// 0xFFFFFFFF lets the driver choose the number of threads.
+	if (parallelShaderCompile)
+		maxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	std::cout << "Parallel shader compile " << (parallelShaderCompile ? "supported." : "not supported, programs are checked when used.") << std::endl;
+}
+
+bool GLExtensions::hasBindlessTexture() {
+	return bindlessTexture;
+}
+
+uint64_t GLExtensions::getTextureHandle(unsigned int texture) {
+	return getTextureHandleARB(texture);
+}
+
+void GLExtensions::makeTextureHandleResident(uint64_t handle) {
+	makeTextureHandleResidentARB(handle);
+}
+
+void GLExtensions::makeTextureHandleNonResident(uint64_t handle) {
+	makeTextureHandleNonResidentARB(handle);
+}
+
+bool GLExtensions::hasParallelShaderCompile() {
+	return parallelShaderCompile;
+}
+
+// Without the extension the status query would be an error, the next status query waits instead.
+bool GLExtensions::isProgramComplete(unsigned int program) {
+	if (!parallelShaderCompile)
+		return true;
+	int complete = 0;
+	glGetProgramiv(program, COMPLETION_STATUS_KHR, &complete);
+	return complete != 0;
+}
\ No newline at end of file
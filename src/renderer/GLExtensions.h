@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+// Extensions that glad (core 4.6 only) doesn't load.
+// Functions are loaded through glfw at initialization, each one must only be used if its extension is supported.
+namespace GLExtensions {
+	// After the context is current.
+	void initialize();
+
+	// ARB_bindless_texture.
+	bool hasBindlessTexture();
+	uint64_t getTextureHandle(unsigned int texture);
+	void makeTextureHandleResident(uint64_t handle);
+	void makeTextureHandleNonResident(uint64_t handle);
+
+	// KHR_parallel_shader_compile (or the ARB version), enabled with as many driver threads as it wants.
+	bool hasParallelShaderCompile();
+	// GL_COMPLETION_STATUS_KHR of a program, true when compiling and linking finished.
+	bool isProgramComplete(unsigned int program);
+}
\ No newline at end of file
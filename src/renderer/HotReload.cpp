@@ -0,0 +1,105 @@
+#include "HotReload.h"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include "ProjectDirectory.h"
+#include "vfs/Vfs.h"
+#include "vfs/FileWatcher.h"
+#include "shader/Shader.h"
+#include "model/Model.h"
+#include "model/TextureCache.h"
+#include "culling/OcclusionCulling.h"
+
+static bool enabled = true;
+static HotReload::Stats stats;
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+	return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool isImage(const std::string& key) {
+	static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".hdr", ".psd", ".gif" };
+	for (const char* extension : extensions) {
+		std::string e(extension);
+		if (key.size() > e.size() && key.compare(key.size() - e.size(), e.size(), e) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Loaded model of a folder, keys are lowercase and model names aren't.
+static std::string findModelName(const std::string& folder) {
+	for (const auto& pair : getModels()) {
+		std::string name = pair.first;
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		if (name == folder)
+			return pair.first;
+	}
+	return "";
+}
+
+static void reloadFile(const std::string& path) {
+	std::string key = Vfs::getKey(path);
+	if (Vfs::stat(path).packed) {
+		std::cout << "Hot reload: " << key << " is in a pack, the loose file is ignored." << std::endl;
+		return;
+	}
+	stats.changedFiles++;
+	if (startsWith(key, "shaders\\")) {
+		stats.shaders += Shader::reloadFile(path);
+		return;
+	}
+	// Textures are found by their files, anything else in a model folder (model file, property files) reloads the model.
+	const std::string models = "assets\\models\\";
+	if (!startsWith(key, models))
+		return;
+	unsigned int textures = TextureCache::reload(path);
+	stats.textures += textures;
+	size_t end = key.find('\\', models.size());
+	if (textures > 0 || isImage(key) || end == std::string::npos)
+		return;
+	std::string name = findModelName(key.substr(models.size(), end - models.size()));
+	if (!name.empty() && reloadAssetModel(name))
+		stats.models++;
+}
+
+void HotReload::initialize() {
+	if (enabled && !FileWatcher::start({ project_directory + "\\assets", project_directory + "\\shaders" }))
+		std::cout << "Hot reload can't watch the asset and shader folders." << std::endl;
+}
+
+void HotReload::terminate() {
+	FileWatcher::stop();
+}
+
+void HotReload::update() {
+	if (FileWatcher::isRunning())
+		for (const std::string& path : FileWatcher::poll())
+			reloadFile(path);
+
+	// Reloads started earlier keep going when disabled, only new changes are ignored.
+	std::vector<TextureHandle> textures = TextureCache::updateReloads();
+	if (!textures.empty())
+		refreshAssetModelTextures(textures);
+	// Meshes are replaced, culling must not be reading them.
+	OcclusionCulling::waitForResults();
+	updateAssetModelReloads();
+}
+
+bool HotReload::getEnabled() {
+	return enabled;
+}
+
+void HotReload::setEnabled(bool e) {
+	if (e == enabled)
+		return;
+	enabled = e;
+	if (enabled)
+		initialize();
+	else
+		terminate();
+}
+
+HotReload::Stats HotReload::getStats() {
+	return stats;
+}
\ No newline at end of file
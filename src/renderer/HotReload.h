@@ -0,0 +1,21 @@
+#pragma once
+
+// Files edited while the engine runs are loaded again: shaders, textures and models (model files and property files).
+// FileWatcher reports the changed files, shaders are compiled again and textures and models loaded on workers,
+// then swapped in once ready. Handles, instances and materials stay, what fails to load keeps the previous version.
+// Files hidden by a mounted pack are ignored, hot reload is for the loose files of development.
+namespace HotReload {
+	struct Stats {
+		unsigned int changedFiles = 0, shaders = 0, textures = 0, models = 0;
+	};
+
+	// Watches project_directory\assets and project_directory\shaders.
+	void initialize();
+	void terminate();
+	// Once per frame after UploadQueue::update, before anything is drawn.
+	void update();
+
+	bool getEnabled();
+	void setEnabled(bool);
+	Stats getStats();
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "Light.h"
 #include <iostream>
 #include <string>
+#include <cmath>
+#include <limits>
 
 void Light::print() {
 	std::string finalString = "";
@@ -10,4 +12,18 @@ void Light::print() {
 	finalString.append("Specular: " + std::to_string(specular.x) + " " + std::to_string(specular.y) + " " + std::to_string(specular.z) + "\n");
 	finalString.append("Constant: " + std::to_string(constant) + "\nLinear: " + std::to_string(linear) + "\nQuadratic: " + std::to_string(quadratic));
 	std::cout << finalString << std::endl;
+}
+
+float Light::getInfluenceRadius() const {
+	// Solve constant + linear * d + quadratic * d^2 = 256 * brightest component.
+	float brightest = std::fmax(std::fmax(std::fmax(diffuse.x, diffuse.y), std::fmax(diffuse.z, specular.x)),
+		std::fmax(std::fmax(specular.y, specular.z), std::fmax(std::fmax(ambient.x, ambient.y), ambient.z)));
+	float k = constant - 256.0f * brightest;
+	if (k >= 0.0f)
+		return 0.0f;
+	if (quadratic > 0.0f)
+		return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * k)) / (2.0f * quadratic);
+	if (linear > 0.0f)
+		return -k / linear;
+	return std::numeric_limits<float>::max();
 }
\ No newline at end of file
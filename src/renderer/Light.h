@@ -97,4 +97,6 @@ public:
 		update = lu;
 	}
 	void print();
+	// Distance after which the light contributes less than 1/256, used to find what it can reach.
+	float getInfluenceRadius() const;
 };
\ No newline at end of file
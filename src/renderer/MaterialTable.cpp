@@ -0,0 +1,369 @@
+#include "MaterialTable.h"
+#include <glad/glad.h>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include "GLExtensions.h"
+#include "model/TextureCache.h"
+#include "model/TextureStreamer.h"
+
+// Same layout as GpuMaterial in fshader.glsl (std430).
+struct GpuMaterial {
+	glm::vec4 ambientShininess, diffuseRoughness, specularMetallic;
+	unsigned int flags;
+	float minLod[3];
+	// Bindless handle, or array index and layer (array index NOT_IN_ARRAY if bound per draw).
+	unsigned int textures[3][2];
+	unsigned int padding[2];
+};
+static_assert(sizeof(GpuMaterial) == 96, "GpuMaterial must match the shader layout.");
+
+enum MaterialFlags : unsigned int {
+	DIFFUSE_MAP = 1, NORMALS_MAP = 2, ORM_MAP = 4, AO_MAP = 8, ROUGHNESS_MAP = 16, METALLIC_MAP = 32
+};
+enum Slot { DIFFUSE_SLOT, NORMALS_SLOT, ORM_SLOT, SLOT_COUNT };
+static const unsigned int NOT_IN_ARRAY = 0xFFFFFFFF;
+
+struct MaterialTextures {
+	unsigned int ids[SLOT_COUNT];
+	bool alive, bound;
+};
+
+struct TextureArray {
+	unsigned int id;
+	int width, height, levels;
+	GLenum internalFormat;
+	unsigned int capacity, used;
+	std::vector<unsigned int> freeLayers;
+};
+
+struct ArrayLayer {
+	unsigned int array, layer, references;
+};
+
+static std::vector<GpuMaterial> materials;
+static std::vector<MaterialTextures> materialTextures;
+static std::vector<unsigned int> freeIndices;
+// Generation of each index, changed when it's freed.
+static std::vector<uint32_t> generations;
+static std::vector<TextureArray> arrays;
+// Layer of each texture copied in an array.
+static std::unordered_map<unsigned int, ArrayLayer> layers;
+static unsigned int buffer = 0, bufferCapacity = 0;
+static unsigned int arrayLimit = 0;
+static int maxLayers = 256;
+static bool bindless = false, dirty = true;
+static MaterialTable::Stats stats;
+
+static void setFactors(GpuMaterial& gpu, const Material& material);
+static bool isLive(MaterialHandle handle);
+static void setTexture(GpuMaterial& gpu, MaterialTextures& textures, Slot slot, const Texture& texture);
+static bool acquireLayer(unsigned int id, unsigned int& array, unsigned int& layer);
+static void releaseLayer(unsigned int id);
+static void growArray(TextureArray& a);
+static void refreshMinLods();
+
+void MaterialTable::initialize() {
+	bindless = GLExtensions::hasBindlessTexture();
+	if (bindless) {
+		// Handles freeze the texture parameters, so streamed mips are clamped in the shader.
+		TextureStreamer::setShaderClamp(true);
+	}
+	else {
+		TextureStreamer::setEnabled(false);
+		int units = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		arrayLimit = (unsigned int)std::clamp(units - (int)FIRST_ARRAY_UNIT, 0, (int)MAX_ARRAYS);
+	}
+	glCreateBuffers(1, &buffer);
+	dirty = true;
+}
+
+void MaterialTable::terminate() {
+	for (const auto& a : arrays)
+		glDeleteTextures(1, &a.id);
+	glDeleteBuffers(1, &buffer);
+	buffer = bufferCapacity = 0;
+	arrays.clear();
+	layers.clear();
+	materials.clear();
+	materialTextures.clear();
+	freeIndices.clear();
+	generations.clear();
+	stats = Stats();
+}
+
+MaterialHandle MaterialTable::add(const Material& material, const std::vector<Texture>& textures) {
+	GpuMaterial gpu = {};
+	MaterialTextures mt = {};
+	mt.alive = true;
+	setFactors(gpu, material);
+	// Only the first texture of each type is used.
+	for (const auto& texture : textures) {
+		if (texture.type == TextureType::DIFFUSE && !(gpu.flags & DIFFUSE_MAP)) {
+			gpu.flags |= DIFFUSE_MAP;
+			setTexture(gpu, mt, DIFFUSE_SLOT, texture);
+		}
+		else if (texture.type == TextureType::NORMAL && !(gpu.flags & NORMALS_MAP)) {
+			gpu.flags |= NORMALS_MAP;
+			setTexture(gpu, mt, NORMALS_SLOT, texture);
+		}
+		else if (texture.type == TextureType::ORM && !(gpu.flags & ORM_MAP)) {
+			gpu.flags |= ORM_MAP;
+			setTexture(gpu, mt, ORM_SLOT, texture);
+		}
+	}
+
+	unsigned int index;
+	if (!freeIndices.empty()) {
+		index = freeIndices.back();
+		freeIndices.pop_back();
+		materials[index] = gpu;
+		materialTextures[index] = mt;
+	}
+	else {
+		index = (unsigned int)materials.size();
+		materials.push_back(gpu);
+		materialTextures.push_back(mt);
+		generations.push_back(1);
+	}
+	dirty = true;
+	return MaterialHandle(index, generations[index]);
+}
+
+static bool isLive(MaterialHandle handle) {
+	unsigned int index = handle.getIndex();
+	return !handle.isNull() && index < materials.size() && generations[index] == handle.getGeneration() && materialTextures[index].alive;
+}
+
+void MaterialTable::update(MaterialHandle handle, const Material& material) {
+	if (!isLive(handle))
+		return;
+	unsigned int index = handle.getIndex();
+	GpuMaterial gpu = materials[index];
+	setFactors(gpu, material);
+	// Called every frame by the gui, only upload real changes.
+	if (std::memcmp(&gpu, &materials[index], sizeof(GpuMaterial)) != 0) {
+		materials[index] = gpu;
+		dirty = true;
+	}
+}
+
+void MaterialTable::remove(MaterialHandle handle) {
+	if (!isLive(handle))
+		return;
+	unsigned int index = handle.getIndex();
+	MaterialTextures& mt = materialTextures[index];
+	for (int slot = 0; slot < SLOT_COUNT; ++slot)
+		if (!bindless && mt.ids[slot] != 0 && materials[index].textures[slot][0] != NOT_IN_ARRAY)
+			releaseLayer(mt.ids[slot]);
+	mt = MaterialTextures();
+	materials[index] = GpuMaterial();
+	generations[index] = MaterialHandle::nextGeneration(generations[index]);
+	freeIndices.push_back(index);
+}
+
+void MaterialTable::bind() {
+	if (bindless && TextureStreamer::getShaderClamp())
+		refreshMinLods();
+	if (dirty) {
+		// The buffer only grows, an empty one can't be bound.
+		if (materials.size() > bufferCapacity || bufferCapacity == 0) {
+			bufferCapacity = std::max((unsigned int)materials.size(), 1u);
+			glNamedBufferData(buffer, bufferCapacity * sizeof(GpuMaterial), nullptr, GL_DYNAMIC_DRAW);
+		}
+		if (!materials.empty())
+			glNamedBufferSubData(buffer, 0, materials.size() * sizeof(GpuMaterial), materials.data());
+		stats.uploads++;
+		dirty = false;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffer);
+	for (unsigned int i = 0; i < arrays.size(); ++i)
+		glBindTextureUnit(FIRST_ARRAY_UNIT + i, arrays[i].id);
+}
+
+bool MaterialTable::needsBinding(MaterialHandle handle) {
+	return !isLive(handle) || materialTextures[handle.getIndex()].bound;
+}
+
+bool MaterialTable::isBindless() {
+	return bindless;
+}
+
+std::vector<std::string> MaterialTable::getShaderDefines() {
+	if (bindless)
+		return { "BINDLESS" };
+	if (arrayLimit > 0)
+		return { "MAX_TEXTURE_ARRAYS " + std::to_string(arrayLimit) };
+	return {};
+}
+
+MaterialTable::Stats MaterialTable::getStats() {
+	Stats s = stats;
+	s.materials = 0;
+	s.boundMaterials = 0;
+	for (const auto& mt : materialTextures) {
+		s.materials += mt.alive ? 1 : 0;
+		s.boundMaterials += mt.alive && mt.bound ? 1 : 0;
+	}
+	s.arrays = (unsigned int)arrays.size();
+	s.arrayLayers = (unsigned int)layers.size();
+	return s;
+}
+
+static void setFactors(GpuMaterial& gpu, const Material& material) {
+	gpu.ambientShininess = glm::vec4(material.ambient, material.shininess);
+	gpu.diffuseRoughness = glm::vec4(material.diffuse, material.roughness);
+	gpu.specularMetallic = glm::vec4(material.specular, material.metallic);
+	gpu.flags &= ~(AO_MAP | ROUGHNESS_MAP | METALLIC_MAP);
+	gpu.flags |= (material.hasAoMap ? (unsigned int)AO_MAP : 0u) | (material.hasRoughnessMap ? (unsigned int)ROUGHNESS_MAP : 0u) |
+		(material.hasMetallicMap ? (unsigned int)METALLIC_MAP : 0u);
+}
+
+static void setTexture(GpuMaterial& gpu, MaterialTextures& textures, Slot slot, const Texture& texture) {
+	unsigned int id = texture.id;
+	textures.ids[slot] = id;
+	if (bindless) {
+		uint64_t handle = TextureCache::getBindlessHandle(texture.handle);
+		gpu.textures[slot][0] = (unsigned int)(handle & 0xFFFFFFFF);
+		gpu.textures[slot][1] = (unsigned int)(handle >> 32);
+		gpu.minLod[slot] = (float)TextureStreamer::getResidentLevel(id);
+		return;
+	}
+	unsigned int array, layer;
+	if (acquireLayer(id, array, layer)) {
+		gpu.textures[slot][0] = array;
+		gpu.textures[slot][1] = layer;
+	}
+	else {
+		gpu.textures[slot][0] = NOT_IN_ARRAY;
+		textures.bound = true;
+	}
+}
+
+// Copies the texture in a layer of an array with the same size, mips and format.
+static bool acquireLayer(unsigned int id, unsigned int& array, unsigned int& layer) {
+	const auto& it = layers.find(id);
+	if (it != layers.end()) {
+		it->second.references++;
+		array = it->second.array;
+		layer = it->second.layer;
+		return true;
+	}
+	if (arrayLimit == 0)
+		return false;
+
+	int width = 0, height = 0, levels = 0, baseLevel = 0;
+	GLint format = 0;
+	glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	glGetTextureParameteriv(id, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+	glGetTextureParameteriv(id, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	// Streamed textures miss their finest mips.
+	if (width <= 0 || height <= 0 || baseLevel != 0)
+		return false;
+	// Cache textures have immutable storage, compressed or not. A texture with mutable storage is taken with a full mip chain.
+	if (levels == 0)
+		levels = (int)std::floor(std::log2(std::max(width, height))) + 1;
+	// Storage needs a sized format.
+	if (format == GL_RED)
+		format = GL_R8;
+	else if (format == GL_RG)
+		format = GL_RG8;
+	else if (format == GL_RGB)
+		format = GL_RGB8;
+	else if (format == GL_RGBA)
+		format = GL_RGBA8;
+
+	TextureArray* target = nullptr;
+	for (auto& a : arrays) {
+		if (a.width == width && a.height == height && a.levels == levels && a.internalFormat == (GLenum)format &&
+			(!a.freeLayers.empty() || a.used < a.capacity || a.capacity < (unsigned int)maxLayers)) {
+			target = &a;
+			break;
+		}
+	}
+	if (!target) {
+		if (arrays.size() >= arrayLimit)
+			return false;
+		TextureArray a;
+		a.width = width;
+		a.height = height;
+		a.levels = levels;
+		a.internalFormat = format;
+		a.capacity = std::min(4u, (unsigned int)maxLayers);
+		a.used = 0;
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &a.id);
+		glTextureStorage3D(a.id, levels, format, width, height, a.capacity);
+		glTextureParameteri(a.id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(a.id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(a.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(a.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		arrays.push_back(a);
+		target = &arrays.back();
+	}
+
+	if (!target->freeLayers.empty()) {
+		layer = target->freeLayers.back();
+		target->freeLayers.pop_back();
+	}
+	else {
+		if (target->used == target->capacity)
+			growArray(*target);
+		layer = target->used++;
+	}
+	for (int level = 0; level < levels; ++level)
+		glCopyImageSubData(id, GL_TEXTURE_2D, level, 0, 0, 0, target->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+			std::max(1, width >> level), std::max(1, height >> level), 1);
+	array = (unsigned int)(target - arrays.data());
+	layers[id] = { array, layer, 1 };
+	return true;
+}
+
+static void releaseLayer(unsigned int id) {
+	const auto& it = layers.find(id);
+	if (it == layers.end() || --it->second.references > 0)
+		return;
+	arrays[it->second.array].freeLayers.push_back(it->second.layer);
+	layers.erase(it);
+}
+
+// Twice the layers, the old ones are copied on the gpu.
+static void growArray(TextureArray& a) {
+	unsigned int capacity = std::min(a.capacity * 2, (unsigned int)maxLayers);
+	unsigned int id;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id);
+	glTextureStorage3D(id, a.levels, a.internalFormat, a.width, a.height, capacity);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	for (int level = 0; level < a.levels; ++level)
+		glCopyImageSubData(a.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(1, a.width >> level), std::max(1, a.height >> level), a.used);
+	glDeleteTextures(1, &a.id);
+	a.id = id;
+	a.capacity = capacity;
+}
+
+// Streamed textures keep all their levels allocated, the shader must not sample below the resident ones.
+static void refreshMinLods() {
+	for (size_t i = 0; i < materials.size(); ++i) {
+		const MaterialTextures& mt = materialTextures[i];
+		if (!mt.alive)
+			continue;
+		for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+			if (mt.ids[slot] == 0)
+				continue;
+			float level = (float)TextureStreamer::getResidentLevel(mt.ids[slot]);
+			if (materials[i].minLod[slot] != level) {
+				materials[i].minLod[slot] = level;
+				dirty = true;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "model/Mesh.h"
+
+// Materials of every mesh compiled into one shader storage buffer, a draw only needs the material index.
+// Each entry holds the material factors and its diffuse, normal and ORM textures: bindless handles when
+// ARB_bindless_texture is available, otherwise a layer in a texture array shared by textures of the same
+// size, mip count and format. Textures that don't fit in an array are bound per draw to their usual units.
+namespace MaterialTable {
+	// Shader storage binding of the table and texture unit of the first array.
+	const unsigned int BINDING = 0;
+	const unsigned int FIRST_ARRAY_UNIT = 16;
+	const unsigned int MAX_ARRAYS = 8;
+
+	struct Stats {
+		unsigned int materials = 0;
+		// Materials with textures bound per draw.
+		unsigned int boundMaterials = 0;
+		unsigned int arrays = 0, arrayLayers = 0;
+		unsigned int uploads = 0;
+	};
+
+	// After the context is current and before models are loaded.
+	// Without bindless textures streaming is turned off, texture arrays need every mip resident.
+	void initialize();
+	void terminate();
+	// Returns the handle of the new material, textures must stay alive until remove.
+	// Indices are reused, removed handles are ignored by update and remove.
+	MaterialHandle add(const Material& material, const std::vector<Texture>& textures);
+	// New factors for a material, its textures don't change.
+	void update(MaterialHandle handle, const Material& material);
+	void remove(MaterialHandle handle);
+	// Upload changes and bind the table and texture arrays, once per frame before drawing.
+	void bind();
+	// True if the material textures must be bound before drawing with it.
+	bool needsBinding(MaterialHandle handle);
+	bool isBindless();
+	// Defines the main shader must be compiled with.
+	std::vector<std::string> getShaderDefines();
+	Stats getStats();
+}
\ No newline at end of file
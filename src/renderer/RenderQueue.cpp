@@ -0,0 +1,230 @@
+#include "RenderQueue.h"
+#include <glad/glad.h>
+#include <vector>
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+struct SortItem {
+	uint64_t key;
+	unsigned int packet;
+};
+
+struct Queue {
+	std::vector<RenderQueue::Packet> packets;
+	std::vector<SortItem> order;
+};
+
+// Uniform locations of a program submitted with.
+struct Locations {
+	unsigned int program = 0;
+	int model, normal, lightMask, materialIndex, defaultColor;
+};
+
+static const int DEPTH_BITS = 24;
+static Queue queues[(int)RenderQueue::Pass::COUNT];
+static std::vector<RenderQueue::Instance> instances;
+static std::vector<SortItem> scratch;
+static glm::mat4 queueView;
+static float queueNear = 0.1f, queueFar = 200.0f;
+static bool useSorting = true;
+static RenderQueue::Stats stats;
+static std::vector<Locations> locations;
+// Shader::getDeletedCount when locations was last emptied.
+static unsigned int locationsDeletedCount = 0;
+
+static uint64_t makeKey(const RenderQueue::Packet& packet);
+static void radixSort(std::vector<SortItem>& items);
+static void countChanges(const Queue& queue, RenderQueue::StateChanges& changes);
+static const Locations& getLocations(unsigned int program);
+static void getFeatureKeywords(const ShaderVariants& variants, unsigned int* featureKeywords);
+
+void RenderQueue::begin(const glm::mat4& view, float nearPlane, float farPlane) {
+	for (auto& queue : queues) {
+		queue.packets.clear();
+		queue.order.clear();
+	}
+	instances.clear();
+	queueView = view;
+	queueNear = nearPlane;
+	queueFar = farPlane;
+	stats = Stats();
+}
+
+unsigned int RenderQueue::addInstance(const Instance& instance) {
+	instances.push_back(instance);
+	return (unsigned int)instances.size() - 1;
+}
+
+void RenderQueue::add(Pass pass, const DrawPacket& draw, unsigned int instance) {
+	Packet packet;
+	packet.draw = draw;
+	packet.instance = instance;
+	packet.variant = pass == Pass::UNLIT ? 0 : draw.features;
+	Queue& queue = queues[(int)pass];
+	queue.order.push_back({ makeKey(packet), (unsigned int)queue.packets.size() });
+	queue.packets.push_back(packet);
+}
+
+void RenderQueue::sort() {
+	for (auto& queue : queues) {
+		stats.packets += (unsigned int)queue.packets.size();
+		countChanges(queue, stats.unsorted);
+		if (useSorting)
+			radixSort(queue.order);
+		countChanges(queue, stats.sorted);
+	}
+}
+
+void RenderQueue::submit(Pass pass, ShaderVariants& variants, unsigned int keywords) {
+	const Queue& queue = queues[(int)pass];
+	if (queue.order.empty())
+		return;
+	bool unlit = pass == Pass::UNLIT;
+	unsigned int featureKeywords[8];
+	getFeatureKeywords(variants, featureKeywords);
+
+	unsigned int lastVariant = 0xFFFFFFFF, lastInstance = 0xFFFFFFFF, lastMaterial = 0xFFFFFFFF, lastVao = 0xFFFFFFFF;
+	unsigned int id = 0;
+	const Locations* location = nullptr;
+	for (const SortItem& item : queue.order) {
+		const Packet& packet = queue.packets[item.packet];
+		const DrawPacket& draw = packet.draw;
+		// Uniforms belong to the program, a new one needs all of them again.
+		if (packet.variant != lastVariant) {
+			id = variants.get(keywords | featureKeywords[packet.variant & 7], keywords).getShaderID();
+			glUseProgram(id);
+			location = &getLocations(id);
+			lastVariant = packet.variant;
+			lastInstance = lastMaterial = 0xFFFFFFFF;
+		}
+		if (packet.instance != lastInstance) {
+			const Instance& instance = instances[packet.instance];
+			glProgramUniformMatrix4fv(id, location->model, 1, GL_FALSE, glm::value_ptr(instance.model));
+			glProgramUniformMatrix3fv(id, location->normal, 1, GL_FALSE, glm::value_ptr(instance.normal));
+			glProgramUniform1i(id, location->lightMask, instance.lightMask);
+			if (unlit)
+				glProgramUniform3f(id, location->defaultColor, instance.color.x, instance.color.y, instance.color.z);
+			lastInstance = packet.instance;
+		}
+		if (draw.materialIndex != lastMaterial) {
+			glProgramUniform1i(id, location->materialIndex, draw.materialIndex);
+			if (!unlit)
+				for (unsigned int t = 0; t < draw.textureCount; ++t)
+					glBindTextureUnit(draw.textureUnits[t], draw.textureIds[t]);
+			lastMaterial = draw.materialIndex;
+		}
+		if (draw.vao != lastVao) {
+			glBindVertexArray(draw.vao);
+			lastVao = draw.vao;
+		}
+		glDrawElements(GL_TRIANGLES, draw.indexCount, GL_UNSIGNED_INT, 0);
+	}
+	glBindVertexArray(0);
+}
+
+void RenderQueue::prepare(ShaderVariants& variants, unsigned int keywords) {
+	unsigned int featureKeywords[8];
+	getFeatureKeywords(variants, featureKeywords);
+	for (unsigned int f = 0; f < 8; ++f)
+		variants.prepare(keywords | featureKeywords[f]);
+}
+
+bool RenderQueue::getUseSorting() {
+	return useSorting;
+}
+
+void RenderQueue::setUseSorting(bool b) {
+	useSorting = b;
+}
+
+RenderQueue::Stats RenderQueue::getStats() {
+	return stats;
+}
+
+// Variant 8 bits, material 16, depth 24, vertex array 16.
+// Materials and vertex arrays past 16 bits only group less well, the order stays valid.
+static uint64_t makeKey(const RenderQueue::Packet& packet) {
+	const RenderQueue::Instance& instance = instances[packet.instance];
+	float depth = -(queueView * instance.model * glm::vec4(packet.draw.boundsCenter, 1.0f)).z;
+	float t = glm::clamp((depth - queueNear) / (queueFar - queueNear), 0.0f, 1.0f);
+	uint64_t quantized = (uint64_t)(t * ((1 << DEPTH_BITS) - 1));
+	return ((uint64_t)(packet.variant & 0xFF) << 56) | ((uint64_t)(packet.draw.materialIndex & 0xFFFF) << 40) |
+		(quantized << 16) | (uint64_t)(packet.draw.vao & 0xFFFF);
+}
+
+// Least significant digit first, 8 bits at a time. Digits that are the same for every key are skipped.
+static void radixSort(std::vector<SortItem>& items) {
+	if (items.size() < 2)
+		return;
+	scratch.resize(items.size());
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[256] = {};
+		for (const SortItem& item : items)
+			counts[(item.key >> shift) & 0xFF]++;
+		if (counts[(items[0].key >> shift) & 0xFF] == items.size())
+			continue;
+		size_t offset = 0;
+		for (size_t& count : counts) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+		for (const SortItem& item : items)
+			scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+		items.swap(scratch);
+	}
+}
+
+static void countChanges(const Queue& queue, RenderQueue::StateChanges& changes) {
+	unsigned int lastVariant = 0xFFFFFFFF, lastInstance = 0xFFFFFFFF, lastMaterial = 0xFFFFFFFF, lastVao = 0xFFFFFFFF;
+	for (const SortItem& item : queue.order) {
+		const RenderQueue::Packet& packet = queue.packets[item.packet];
+		if (packet.variant != lastVariant) {
+			changes.programs++;
+			lastVariant = packet.variant;
+			lastInstance = lastMaterial = 0xFFFFFFFF;
+		}
+		if (packet.instance != lastInstance)
+			changes.instances++;
+		if (packet.draw.materialIndex != lastMaterial) {
+			changes.materials++;
+			if (packet.draw.textureCount > 0)
+				changes.textures++;
+		}
+		if (packet.draw.vao != lastVao)
+			changes.vertexArrays++;
+		lastInstance = packet.instance;
+		lastMaterial = packet.draw.materialIndex;
+		lastVao = packet.draw.vao;
+	}
+}
+
+// Variants are few, a linear search is enough.
+static const Locations& getLocations(unsigned int program) {
+	// A deleted program's id can come back as another program, with other locations.
+	if (locationsDeletedCount != Shader::getDeletedCount()) {
+		locations.clear();
+		locationsDeletedCount = Shader::getDeletedCount();
+	}
+	for (const Locations& l : locations)
+		if (l.program == program)
+			return l;
+	Locations l;
+	l.program = program;
+	l.model = glGetUniformLocation(program, "model");
+	l.normal = glGetUniformLocation(program, "NormalMat");
+	l.lightMask = glGetUniformLocation(program, "lightMask");
+	l.materialIndex = glGetUniformLocation(program, "materialIndex");
+	l.defaultColor = glGetUniformLocation(program, "defaultColor");
+	locations.push_back(l);
+	return locations.back();
+}
+
+// Keywords of every combination of features.
+static void getFeatureKeywords(const ShaderVariants& variants, unsigned int* featureKeywords) {
+	unsigned int diffuse = variants.getKeywordMask("DIFFUSE_MAP"), normal = variants.getKeywordMask("NORMAL_MAP"),
+		orm = variants.getKeywordMask("ORM_MAP");
+	for (unsigned int f = 0; f < 8; ++f)
+		featureKeywords[f] = (f & DrawPacket::DIFFUSE_MAP ? diffuse : 0) | (f & DrawPacket::NORMAL_MAP ? normal : 0) |
+			(f & DrawPacket::ORM_MAP ? orm : 0);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "model/Mesh.h"
+#include "shader/ShaderVariants.h"
+
+// Visible draws of a frame, collected as small packets and sorted before they are submitted.
+// Each packet has a 64 bit key: shader variant, material, quantized view depth and vertex array, from the
+// highest bits down. Sorting groups draws that share state and draws them front to back inside a material,
+// which helps early depth testing. Submission only changes the state that differs from the previous draw.
+namespace RenderQueue {
+	enum class Pass {
+		OPAQUE,
+		// Flat colored, no lighting (light cubes).
+		UNLIT,
+		COUNT
+	};
+
+	// Per instance uniforms, shared by the packets of its meshes.
+	struct Instance {
+		glm::mat4 model;
+		// View space normal matrix.
+		glm::mat3 normal;
+		int lightMask;
+		// Unlit pass only.
+		glm::vec3 color;
+	};
+
+	// Copy of the mesh draw packet, submission only reads queue memory.
+	struct Packet {
+		DrawPacket draw;
+		unsigned int instance;
+		// Features of the draw that select the shader variant, DrawPacket::Features.
+		unsigned int variant;
+	};
+
+	// State changes a list of packets needs.
+	struct StateChanges {
+		unsigned int programs = 0, instances = 0, materials = 0, textures = 0, vertexArrays = 0;
+	};
+
+	struct Stats {
+		unsigned int packets = 0;
+		// Changes in submission order and in the order draws were queued.
+		StateChanges sorted, unsorted;
+	};
+
+	// Empties the queue, depth of packets is measured with view.
+	void begin(const glm::mat4& view, float nearPlane, float farPlane);
+	// Returns the index packets of the instance use.
+	unsigned int addInstance(const Instance& instance);
+	void add(Pass pass, const DrawPacket& draw, unsigned int instance);
+	// Sort every pass, after all packets are added.
+	void sort();
+	// Draw the packets of a pass. Each packet uses the variant with keywords and the keywords of its features
+	// (DIFFUSE_MAP, NORMAL_MAP, ORM_MAP) defined, the unlit pass ignores features.
+	// Until a variant is compiled, packets use a ready one with keywords and fewer features.
+	void submit(Pass pass, ShaderVariants& variants, unsigned int keywords);
+	// Start compiling the variants of every combination of features with keywords.
+	void prepare(ShaderVariants& variants, unsigned int keywords);
+
+	// Off keeps the queued order, to compare state changes.
+	bool getUseSorting();
+	void setUseSorting(bool);
+	// Statistics of the last frame.
+	Stats getStats();
+}
\ No newline at end of file
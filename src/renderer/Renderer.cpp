@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "model/Model.h"
+#include "model/TextureCache.h"
+#include "model/AssetDatabase.h"
 #include "shader/Shader.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -13,6 +15,15 @@
 #include "post/PostProcessing.h"
 #include "shadow/Shadow.h"
 #include "Skybox.h"
+#include "jobs/JobSystem.h"
+#include "vfs/Vfs.h"
+#include "culling/OcclusionCulling.h"
+#include "GLExtensions.h"
+#include "MaterialTable.h"
+#include "FrameUniforms.h"
+#include "UploadQueue.h"
+#include "HotReload.h"
+#include "shader/ProgramCache.h"
 
 static Shader program;
 static void (*renderFunctionPointer)();
@@ -27,6 +38,15 @@ void render() {
 	   in Window.cpp. */
 	updateCameraTime();
 
+	// Programs the driver finished compiling since last frame are checked and saved in the binary cache.
+	Shader::update();
+
+	// Copies of mesh and texture data for this frame, meshes that got all of theirs can be drawn.
+	UploadQueue::update();
+	finishAssetModelUploads();
+	// Edited shaders, textures and models, swapped in when ready.
+	HotReload::update();
+
 	// Call specific render function.
 	// Each render function represents a different renderer.
 	// Each renderer must do everything by itself apart managing camera.
@@ -43,6 +63,29 @@ void initRenderer(void (*initF)(), void (*renderF)(), void (*terminateF)()) {
 	initFunctionPointer = initF;
 	terminateFunctionPointer = terminateF;
 
+	// Worker threads used by culling and other cpu side systems.
+	JobSystem::initialize();
+	// Packs are mounted before anything is read.
+	Vfs::initialize();
+	// Model folders and their property files, before any model is loaded.
+	AssetDatabase::initialize();
+	AssetDatabase::Stats assetStats = AssetDatabase::getStats();
+	std::cout << "Asset index: " << assetStats.models << " models, " << assetStats.parsed << " parsed and " <<
+		assetStats.hashed << " hashed in " << assetStats.milliseconds << " ms." << std::endl;
+	OcclusionCulling::initialize();
+
+	// Material table before any model is loaded, meshes add their materials to it.
+	GLExtensions::initialize();
+	MaterialTable::initialize();
+	// Values shared by every shader variant, shadows write theirs in it.
+	FrameUniforms::initialize();
+	// Staging ring, before anything is uploaded.
+	UploadQueue::initialize();
+	// Watches the asset and shader folders.
+	HotReload::initialize();
+	// Drawn for lights and in place of deleted models, kept until terminate.
+	getFallbackAssetModel();
+
 	// NOT NEEDED ANYMORE!
 	// ---------------------------------------------- //
 	// Load default models.
@@ -71,14 +114,24 @@ void initRenderer(void (*initF)(), void (*renderF)(), void (*terminateF)()) {
 	(*initFunctionPointer)();
 
 	// Initialize shadows.
-	// Must be done after initFunctionPointer because shadow initializing has dependencies on SimpleRenderer program.
+	// Must be done after initFunctionPointer because shadow initializing has dependencies on SimpleRenderer.
 	Shadow::initialize();
+
+	// Startup programs, a run with every binary in the cache (warm) against one without (cold).
+	ProgramCache::Stats programStats = ProgramCache::getStats();
+	// Compiled programs are only submitted, the time is what startup waited for.
+	std::cout << "Shader programs: " << programStats.programs << " in " << programStats.milliseconds << " ms, " <<
+		programStats.loaded << " from the binary cache (" << (programStats.loaded == programStats.programs ? "warm" : "cold") << "), " <<
+		Shader::getPendingCount() << " still compiling." << std::endl;
 }
 
 void terminateRenderer() {
 
 	// Terminate what needs to be terminated.
-	deleteAllAssetModels();
+	HotReload::terminate();
+	// Culling jobs read the occluder proxies of the models, wait for them first.
+	OcclusionCulling::terminate();
+	deleteAllAssetModels(true);
 
 	// Terminate post processing and shadows.
 	PostProcessing::terminate();
@@ -90,4 +143,17 @@ void terminateRenderer() {
 	// Can't be removed.
 	// Calls terminate function of renderer we passed.
 	(*terminateFunctionPointer)();
+
+	// Models release their textures, this deletes whatever is left.
+	MaterialTable::terminate();
+	TextureCache::terminate();
+	FrameUniforms::terminate();
+	UploadQueue::terminate();
+	// Saves models indexed while running.
+	AssetDatabase::terminate();
+
+	// Workers go last.
+	JobSystem::terminate();
+	// After the workers, reads queued on them use the mounted packs.
+	Vfs::terminate();
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "ProjectDirectory.h"
 #include <iostream>
 #include "shader/Shader.h"
+#include "vfs/Vfs.h"
+#include "model/CookedAssets.h"
 
 static Shader program;
 static unsigned int textureID, VAO, VBO;
@@ -31,19 +33,33 @@ void Skybox::initialize() {
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-	int width, height, nrChannels;
-	for (int i = 0; i < faces.size(); ++i) {
-
-		unsigned char* data = stbi_load((project_directory + "\\assets\\cubemaps\\" +
-			cubemapName + "\\" + faces[i] + "." + extensionType).c_str(), &width, &height, &nrChannels, 0);
-		if (data) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else {
-			std::cout << "Cubemap texture loading failed." << std::endl;
-			stbi_image_free(data);
+	// Cooked faces are already decoded.
+	CookedAssets::CubemapFace cooked[6];
+	if (CookedAssets::loadCubemap(CookedAssets::getCubemapPath(cubemapName), cooked)) {
+		for (int i = 0; i < 6; ++i)
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, cooked[i].width, cooked[i].height, 0,
+				cooked[i].components == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, cooked[i].pixels.data());
+	}
+	else {
+		// Faces are read together, decoded one by one.
+		std::vector<std::shared_future<Vfs::File>> files;
+		for (int i = 0; i < faces.size(); ++i)
+			files.push_back(Vfs::openAsync(project_directory + "\\assets\\cubemaps\\" + cubemapName + "\\" + faces[i] + "." + extensionType));
+		int width, height, nrChannels;
+		for (int i = 0; i < faces.size(); ++i) {
+
+			const Vfs::File& file = files[i].get();
+			unsigned char* data = file.getSize() == 0 ? nullptr :
+				stbi_load_from_memory((const unsigned char*)file.getData(), (int)file.getSize(), &width, &height, &nrChannels, 0);
+			if (data) {
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+					0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+				stbi_image_free(data);
+			}
+			else {
+				std::cout << "Cubemap texture loading failed." << std::endl;
+				stbi_image_free(data);
+			}
 		}
 	}
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
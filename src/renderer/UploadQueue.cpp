@@ -0,0 +1,321 @@
+#include "UploadQueue.h"
+#include <glad/glad.h>
+#include <deque>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	// Data is copied by rows, the unit a copy can be split at: bytes for buffers, pixel rows or block rows for textures.
+	struct Request {
+		enum Kind { BUFFER, TEXTURE, COMPRESSED_TEXTURE, MIPMAPS };
+		Kind kind;
+		uint64_t ticket;
+		unsigned int object;
+		unsigned int level = 0, width = 0, height = 0, format = 0;
+		size_t offset = 0;
+		size_t rowBytes = 1, rows = 0, nextRow = 0;
+		std::vector<unsigned char> data;
+	};
+
+	// Ring bytes written during one frame, free again once the fence is signaled.
+	struct FrameFence {
+		GLsync fence;
+		size_t bytes;
+	};
+}
+
+static const size_t STAGING_SIZE = 32 * 1024 * 1024;
+// Offsets in the ring, enough for every pixel and vertex type.
+static const size_t ALIGNMENT = 16;
+
+static std::deque<Request> requests;
+static std::deque<FrameFence> fences;
+static unsigned int staging = 0;
+static unsigned char* mapped = nullptr;
+// Next byte to write and bytes not reclaimed yet, the oldest of them start used bytes before head.
+static size_t head = 0, used = 0, frameUsed = 0;
+static uint64_t lastTicket = 0;
+static bool enabled = true;
+static size_t frameBytes = 16 * 1024 * 1024;
+static float frameMilliseconds = 2.0f;
+static UploadQueue::Stats stats;
+
+static uint64_t push(Request& r);
+static void issue(const Request& r, bool staged, size_t source, size_t firstRow, size_t rows);
+static bool allocate(size_t rowBytes, size_t& rows, size_t& offset);
+static void reclaim();
+
+void UploadQueue::initialize() {
+	glCreateBuffers(1, &staging);
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glNamedBufferStorage(staging, STAGING_SIZE, nullptr, flags);
+	mapped = (unsigned char*)glMapNamedBufferRange(staging, 0, STAGING_SIZE, flags);
+	head = used = frameUsed = 0;
+}
+
+void UploadQueue::terminate() {
+	requests.clear();
+	for (const auto& f : fences)
+		glDeleteSync(f.fence);
+	fences.clear();
+	if (staging != 0) {
+		glUnmapNamedBuffer(staging);
+		glDeleteBuffers(1, &staging);
+	}
+	staging = 0;
+	mapped = nullptr;
+	head = used = frameUsed = 0;
+	stats = Stats();
+}
+
+uint64_t UploadQueue::uploadBuffer(unsigned int buffer, size_t offset, const void* data, size_t size) {
+	Request r;
+	r.kind = Request::BUFFER;
+	r.object = buffer;
+	r.offset = offset;
+	r.rows = size;
+	r.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+	return push(r);
+}
+
+uint64_t UploadQueue::uploadTexture(unsigned int texture, unsigned int level, unsigned int width, unsigned int height,
+	unsigned int format, unsigned int pixelBytes, std::vector<unsigned char> data) {
+	Request r;
+	r.kind = Request::TEXTURE;
+	r.object = texture;
+	r.level = level;
+	r.width = width;
+	r.height = height;
+	r.format = format;
+	r.rowBytes = (size_t)width * pixelBytes;
+	r.rows = height;
+	r.data = std::move(data);
+	return push(r);
+}
+
+uint64_t UploadQueue::uploadCompressedTexture(unsigned int texture, unsigned int level, unsigned int width, unsigned int height,
+	unsigned int internalFormat, std::vector<unsigned char> data) {
+	Request r;
+	r.kind = Request::COMPRESSED_TEXTURE;
+	r.object = texture;
+	r.level = level;
+	r.width = width;
+	r.height = height;
+	r.format = internalFormat;
+	// Rows of 4x4 blocks.
+	r.rows = (height + 3) / 4;
+	r.rowBytes = data.size() / r.rows;
+	r.data = std::move(data);
+	return push(r);
+}
+
+uint64_t UploadQueue::generateMipmaps(unsigned int texture) {
+	Request r;
+	r.kind = Request::MIPMAPS;
+	r.object = texture;
+	return push(r);
+}
+
+// Disabled or without staging ring, uploads are done now from memory.
+// Not while older ones are queued, they must stay in order.
+static uint64_t push(Request& r) {
+	r.ticket = ++lastTicket;
+	if ((!enabled || !mapped) && requests.empty()) {
+		if (r.kind != Request::MIPMAPS)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		issue(r, false, 0, 0, r.rows);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return r.ticket;
+	}
+	requests.push_back(std::move(r));
+	return lastTicket;
+}
+
+void UploadQueue::cancelBuffer(unsigned int buffer) {
+	requests.erase(std::remove_if(requests.begin(), requests.end(), [buffer](const Request& r) {
+		return r.kind == Request::BUFFER && r.object == buffer;
+	}), requests.end());
+}
+
+void UploadQueue::cancelTexture(unsigned int texture) {
+	requests.erase(std::remove_if(requests.begin(), requests.end(), [texture](const Request& r) {
+		return r.kind != Request::BUFFER && r.object == texture;
+	}), requests.end());
+}
+
+// Requests finish in order, so everything before the first one still queued is done.
+bool UploadQueue::isDone(uint64_t ticket) {
+	return requests.empty() || ticket < requests.front().ticket;
+}
+
+uint64_t UploadQueue::getLastTicket() {
+	return lastTicket;
+}
+
+void UploadQueue::update() {
+	reclaim();
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t copied = 0;
+	frameUsed = 0;
+	bool unpackBound = false;
+	while (!requests.empty()) {
+		Request& r = requests.front();
+		if (r.kind == Request::MIPMAPS) {
+			glGenerateTextureMipmap(r.object);
+			requests.pop_front();
+			continue;
+		}
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (copied >= frameBytes || ms >= frameMilliseconds)
+			break;
+
+		if (!unpackBound) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			unpackBound = true;
+		}
+		// A row that can never fit in the ring goes straight from memory.
+		if (r.rowBytes > STAGING_SIZE) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			issue(r, false, 0, r.nextRow, r.rows - r.nextRow);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+			copied += (r.rows - r.nextRow) * r.rowBytes;
+			stats.direct++;
+			requests.pop_front();
+			continue;
+		}
+		// At least one row, so that rows larger than the budget still move.
+		size_t rows = std::min(r.rows - r.nextRow, std::max<size_t>(1, (frameBytes - copied) / r.rowBytes));
+		size_t offset;
+		if (!allocate(r.rowBytes, rows, offset))
+			break;
+		size_t bytes = rows * r.rowBytes;
+		std::memcpy(mapped + offset, r.data.data() + r.nextRow * r.rowBytes, bytes);
+		issue(r, true, offset, r.nextRow, rows);
+		r.nextRow += rows;
+		copied += bytes;
+		if (r.nextRow == r.rows)
+			requests.pop_front();
+	}
+	if (unpackBound) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	if (frameUsed > 0)
+		fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameUsed });
+
+	stats.frameBytes = copied;
+	stats.frameMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Source is an offset in the staging ring when staged, otherwise the rows are read from the request data.
+static void issue(const Request& r, bool staged, size_t source, size_t firstRow, size_t rows) {
+	const void* pixels = staged ? (const void*)source : (const void*)(r.data.data() + firstRow * r.rowBytes);
+	switch (r.kind) {
+	case Request::BUFFER:
+		if (staged)
+			glCopyNamedBufferSubData(staging, r.object, source, r.offset + firstRow, rows);
+		else
+			glNamedBufferSubData(r.object, r.offset + firstRow, rows, pixels);
+		break;
+	case Request::TEXTURE:
+		glTextureSubImage2D(r.object, r.level, 0, (GLint)firstRow, r.width, (GLsizei)rows, r.format, GL_UNSIGNED_BYTE, pixels);
+		break;
+	case Request::COMPRESSED_TEXTURE: {
+		// The last block row can be shorter than 4 pixels.
+		unsigned int y = (unsigned int)firstRow * 4;
+		unsigned int h = std::min((unsigned int)rows * 4, r.height - y);
+		glCompressedTextureSubImage2D(r.object, r.level, 0, y, r.width, h, r.format, (GLsizei)(rows * r.rowBytes), pixels);
+		break;
+	}
+	case Request::MIPMAPS:
+		glGenerateTextureMipmap(r.object);
+		break;
+	}
+}
+
+// Contiguous room for up to rows rows after head, or from the start of the ring when that fits more.
+// rows is lowered to what fits, false if not even one row does.
+static bool allocate(size_t rowBytes, size_t& rows, size_t& offset) {
+	if (used == 0)
+		head = 0;
+	size_t aligned = (head + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	size_t tail = (head + STAGING_SIZE - used) % STAGING_SIZE;
+	size_t fitEnd = 0, fitStart = 0;
+	if (used < STAGING_SIZE && (tail < head || used == 0)) {
+		// Free from head to the end and from the start to tail.
+		fitEnd = aligned < STAGING_SIZE ? (STAGING_SIZE - aligned) / rowBytes : 0;
+		fitStart = tail / rowBytes;
+	}
+	else if (tail > head)
+		fitEnd = aligned < tail ? (tail - aligned) / rowBytes : 0;
+
+	size_t padding;
+	if (fitEnd >= rows || fitEnd >= fitStart) {
+		rows = std::min(rows, fitEnd);
+		offset = aligned;
+		padding = aligned - head;
+	}
+	else {
+		// The end of the ring is skipped.
+		rows = std::min(rows, fitStart);
+		offset = 0;
+		padding = STAGING_SIZE - head;
+	}
+	if (rows == 0)
+		return false;
+	size_t bytes = padding + rows * rowBytes;
+	used += bytes;
+	frameUsed += bytes;
+	head = offset + rows * rowBytes;
+	return true;
+}
+
+// Frames the gpu finished copying give back their part of the ring, oldest first.
+static void reclaim() {
+	while (!fences.empty()) {
+		GLenum status = glClientWaitSync(fences.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(fences.front().fence);
+		used -= fences.front().bytes;
+		fences.pop_front();
+	}
+}
+
+bool UploadQueue::getEnabled() {
+	return enabled;
+}
+
+// Queued uploads are still copied over the next frames.
+void UploadQueue::setEnabled(bool b) {
+	enabled = b;
+}
+
+size_t UploadQueue::getFrameBytes() {
+	return frameBytes;
+}
+
+void UploadQueue::setFrameBytes(size_t bytes) {
+	frameBytes = std::max<size_t>(bytes, 1);
+}
+
+float UploadQueue::getFrameMilliseconds() {
+	return frameMilliseconds;
+}
+
+void UploadQueue::setFrameMilliseconds(float ms) {
+	frameMilliseconds = ms;
+}
+
+UploadQueue::Stats UploadQueue::getStats() {
+	Stats s = stats;
+	s.pending = (unsigned int)requests.size();
+	s.pendingBytes = 0;
+	for (const auto& r : requests)
+		s.pendingBytes += (r.rows - r.nextRow) * r.rowBytes;
+	s.stagingUsed = used;
+	s.stagingSize = mapped ? STAGING_SIZE : 0;
+	return s;
+}
\ No newline at end of file
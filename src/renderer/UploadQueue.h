@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Copies of mesh and texture data to the gpu, spread over frames.
+// Data is kept by the queue until update() copies it, in order, into a persistently mapped staging ring and
+// from there to the destination (copy between buffers, or pixel unpack buffer for textures). Each frame copies
+// until the byte or time budget is spent, a fence per frame tells when its part of the ring can be reused.
+// Every upload returns a ticket, the destination can be used once isDone(ticket) is true.
+// Must only be used on the main thread.
+namespace UploadQueue {
+	struct Stats {
+		unsigned int pending = 0;
+		size_t pendingBytes = 0, stagingUsed = 0, stagingSize = 0;
+		size_t frameBytes = 0;
+		float frameMilliseconds = 0.0f;
+		// Rows larger than the ring, copied straight from memory.
+		unsigned int direct = 0;
+	};
+
+	void initialize();
+	// Pending uploads are dropped.
+	void terminate();
+	// Buffer must have storage for offset + size bytes.
+	uint64_t uploadBuffer(unsigned int buffer, size_t offset, const void* data, size_t size);
+	// Level of a texture with storage, unsigned bytes with pixelBytes per pixel in format (GL_RED, GL_RGB...).
+	uint64_t uploadTexture(unsigned int texture, unsigned int level, unsigned int width, unsigned int height,
+		unsigned int format, unsigned int pixelBytes, std::vector<unsigned char> data);
+	// Level of a block compressed texture with storage, internalFormat is the one of the storage.
+	uint64_t uploadCompressedTexture(unsigned int texture, unsigned int level, unsigned int width, unsigned int height,
+		unsigned int internalFormat, std::vector<unsigned char> data);
+	// Mipmaps built after the uploads queued before it.
+	uint64_t generateMipmaps(unsigned int texture);
+	// Drop the uploads not done yet of an object that is going to be deleted.
+	void cancelBuffer(unsigned int buffer);
+	void cancelTexture(unsigned int texture);
+	bool isDone(uint64_t ticket);
+	// Ticket of the last queued upload, 0 if nothing was queued.
+	uint64_t getLastTicket();
+	// To be called every frame before drawing.
+	void update();
+
+	// Disabled, uploads are done when queued like before.
+	bool getEnabled();
+	void setEnabled(bool);
+	size_t getFrameBytes();
+	void setFrameBytes(size_t bytes);
+	float getFrameMilliseconds();
+	void setFrameMilliseconds(float ms);
+	Stats getStats();
+}
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "DepthRasterizer.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include "jobs/JobSystem.h"
+
+// True if the clip space vertex is between the camera and its near plane, or behind the camera.
+// The gpu clips those away, so triangles touching them are not rasterized.
+// Skipping triangles only means less occlusion, never wrong culling.
+static inline bool beforeNearPlane(const glm::vec4& c) {
+	return c.z < -c.w || c.w <= 0.0f;
+}
+
+DepthRasterizer::DepthRasterizer(int w, int h) : width(w), height(h), tilesX(w / TILE_WIDTH), tilesY(h / TILE_HEIGHT),
+	viewProjection(glm::mat4(1.0f)), depth(w * h, 0.0f), bins(tilesX * tilesY) { }
+
+void DepthRasterizer::clear(const glm::mat4& viewProj) {
+	viewProjection = viewProj;
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	triangles.clear();
+	for (auto& b : bins)
+		b.clear();
+}
+
+void DepthRasterizer::setupTriangles(const void* positions, size_t stride, unsigned int vertexCount, const unsigned int* indices,
+	unsigned int indexCount, const glm::mat4& model, std::vector<ScreenTriangle>& out) const {
+
+	const glm::mat4 mvp = viewProjection * model;
+
+	// Transform every vertex once.
+	std::vector<glm::vec4> clip(vertexCount);
+	const unsigned char* p = static_cast<const unsigned char*>(positions);
+	for (unsigned int i = 0; i < vertexCount; ++i) {
+		const glm::vec3& pos = *reinterpret_cast<const glm::vec3*>(p + i * stride);
+		clip[i] = mvp * glm::vec4(pos, 1.0f);
+	}
+
+	const float w = static_cast<float>(width), h = static_cast<float>(height);
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3) {
+		const glm::vec4& c0 = clip[indices[i]];
+		const glm::vec4& c1 = clip[indices[i + 1]];
+		const glm::vec4& c2 = clip[indices[i + 2]];
+		if (beforeNearPlane(c0) || beforeNearPlane(c1) || beforeNearPlane(c2))
+			continue;
+
+		// Trivially outside one of the side planes.
+		if ((c0.x > c0.w && c1.x > c1.w && c2.x > c2.w) || (c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
+			(c0.y > c0.w && c1.y > c1.w && c2.y > c2.w) || (c0.y < -c0.w && c1.y < -c1.w && c2.y < -c2.w) ||
+			(c0.z > c0.w && c1.z > c1.w && c2.z > c2.w))
+			continue;
+
+		ScreenTriangle tri;
+		const glm::vec4* c[3] = { &c0, &c1, &c2 };
+		for (int j = 0; j < 3; ++j) {
+			float invW = 1.0f / c[j]->w;
+			tri.v[j] = glm::vec3((c[j]->x * invW * 0.5f + 0.5f) * w, (c[j]->y * invW * 0.5f + 0.5f) * h, invW);
+		}
+
+		// Back faces and degenerate triangles. Front faces are counter clockwise like in the renderer.
+		float area = (tri.v[1].x - tri.v[0].x) * (tri.v[2].y - tri.v[0].y) - (tri.v[1].y - tri.v[0].y) * (tri.v[2].x - tri.v[0].x);
+		if (area <= 0.0f)
+			continue;
+
+		out.push_back(tri);
+	}
+}
+
+void DepthRasterizer::binTriangles(const std::vector<ScreenTriangle>& tris) {
+	for (const auto& tri : tris) {
+		unsigned int index = (unsigned int)triangles.size();
+		triangles.push_back(tri);
+
+		float minX = std::min({ tri.v[0].x, tri.v[1].x, tri.v[2].x });
+		float maxX = std::max({ tri.v[0].x, tri.v[1].x, tri.v[2].x });
+		float minY = std::min({ tri.v[0].y, tri.v[1].y, tri.v[2].y });
+		float maxY = std::max({ tri.v[0].y, tri.v[1].y, tri.v[2].y });
+
+		int tx0 = std::max(0, static_cast<int>(minX) / TILE_WIDTH);
+		int tx1 = std::min(tilesX - 1, static_cast<int>(maxX) / TILE_WIDTH);
+		int ty0 = std::max(0, static_cast<int>(minY) / TILE_HEIGHT);
+		int ty1 = std::min(tilesY - 1, static_cast<int>(maxY) / TILE_HEIGHT);
+		for (int ty = ty0; ty <= ty1; ++ty)
+			for (int tx = tx0; tx <= tx1; ++tx)
+				bins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+void DepthRasterizer::rasterize() {
+	JobSystem::parallelFor(tilesX * tilesY, 4, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int t = begin; t < end; ++t)
+			rasterizeTile(t);
+	});
+}
+
+void DepthRasterizer::rasterizeTile(int tile) {
+	const int tileX0 = (tile % tilesX) * TILE_WIDTH, tileY0 = (tile / tilesX) * TILE_HEIGHT;
+	float* tileDepth = &depth[tile * TILE_WIDTH * TILE_HEIGHT];
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (unsigned int index : bins[tile]) {
+		const ScreenTriangle& tri = triangles[index];
+
+		// Bounding box clamped to the tile. Start x is aligned to 4 for the SSE loop.
+		int minX = std::max(tileX0, static_cast<int>(std::floor(std::min({ tri.v[0].x, tri.v[1].x, tri.v[2].x }))));
+		int maxX = std::min(tileX0 + TILE_WIDTH, static_cast<int>(std::ceil(std::max({ tri.v[0].x, tri.v[1].x, tri.v[2].x }))));
+		int minY = std::max(tileY0, static_cast<int>(std::floor(std::min({ tri.v[0].y, tri.v[1].y, tri.v[2].y }))));
+		int maxY = std::min(tileY0 + TILE_HEIGHT, static_cast<int>(std::ceil(std::max({ tri.v[0].y, tri.v[1].y, tri.v[2].y }))));
+		if (minX >= maxX || minY >= maxY)
+			continue;
+		minX &= ~3;
+
+		// Edge functions in the form A*x + B*y + C, positive inside.
+		// Edge i goes from vertex i to vertex i+1 and is the barycentric weight of the opposite vertex.
+		float A[3], B[3], C[3];
+		for (int e = 0; e < 3; ++e) {
+			const glm::vec3& a = tri.v[e];
+			const glm::vec3& b = tri.v[(e + 1) % 3];
+			A[e] = a.y - b.y;
+			B[e] = b.x - a.x;
+			C[e] = -(A[e] * a.x + B[e] * a.y);
+		}
+		float area = A[0] * tri.v[2].x + B[0] * tri.v[2].y + C[0];
+		float invArea = 1.0f / area;
+
+		// Depth plane. Edge 1 (v1->v2) weights v0, edge 2 (v2->v0) weights v1, edge 0 (v0->v1) weights v2.
+		float zA = (A[1] * tri.v[0].z + A[2] * tri.v[1].z + A[0] * tri.v[2].z) * invArea;
+		float zB = (B[1] * tri.v[0].z + B[2] * tri.v[1].z + B[0] * tri.v[2].z) * invArea;
+		float zC = (C[1] * tri.v[0].z + C[2] * tri.v[1].z + C[0] * tri.v[2].z) * invArea;
+
+		const __m128 a0 = _mm_set1_ps(A[0]), a1 = _mm_set1_ps(A[1]), a2 = _mm_set1_ps(A[2]), za = _mm_set1_ps(zA);
+
+		for (int y = minY; y < maxY; ++y) {
+			float py = y + 0.5f;
+			__m128 row0 = _mm_set1_ps(B[0] * py + C[0]);
+			__m128 row1 = _mm_set1_ps(B[1] * py + C[1]);
+			__m128 row2 = _mm_set1_ps(B[2] * py + C[2]);
+			__m128 rowZ = _mm_set1_ps(zB * py + zC);
+			float* line = tileDepth + (y - tileY0) * TILE_WIDTH - tileX0;
+
+			for (int x = minX; x < maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(za, px), rowZ);
+				__m128 old = _mm_loadu_ps(line + x);
+				__m128 closest = _mm_max_ps(old, z);
+				_mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, old)));
+			}
+		}
+	}
+}
+
+bool DepthRasterizer::isBoxVisible(const BoundingBox& worldBox) const {
+	if (!worldBox.isValid())
+		return false;
+
+	float minX = std::numeric_limits<float>::max(), minY = minX, maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+	float nearestZ = 0.0f;
+	bool allBeyondFar = true;
+	int behindCount = 0, left = 0, right = 0, bottom = 0, top = 0;
+	for (int i = 0; i < 8; ++i) {
+		glm::vec4 c = viewProjection * glm::vec4(worldBox.getCorner(i), 1.0f);
+		left += c.x < -c.w;
+		right += c.x > c.w;
+		bottom += c.y < -c.w;
+		top += c.y > c.w;
+		if (beforeNearPlane(c)) {
+			behindCount++;
+			continue;
+		}
+		if (c.z <= c.w)
+			allBeyondFar = false;
+		float invW = 1.0f / c.w;
+		float sx = (c.x * invW * 0.5f + 0.5f) * width, sy = (c.y * invW * 0.5f + 0.5f) * height;
+		minX = std::min(minX, sx);
+		maxX = std::max(maxX, sx);
+		minY = std::min(minY, sy);
+		maxY = std::max(maxY, sy);
+		nearestZ = std::max(nearestZ, invW);
+	}
+	// Entirely before the near plane or outside a side plane it can't be seen.
+	// Crossing the near plane we can't say anything.
+	if (behindCount == 8 || left == 8 || right == 8 || bottom == 8 || top == 8)
+		return false;
+	if (behindCount > 0)
+		return true;
+	if (allBeyondFar)
+		return false;
+
+	int x0 = std::max(0, static_cast<int>(std::floor(minX))), x1 = std::min(width, static_cast<int>(std::ceil(maxX)));
+	int y0 = std::max(0, static_cast<int>(std::floor(minY))), y1 = std::min(height, static_cast<int>(std::ceil(maxY)));
+	if (x0 >= x1 || y0 >= y1)
+		return false;
+
+	// Visible if any covered pixel is farther than the nearest point of the box.
+	const __m128 boxZ = _mm_set1_ps(nearestZ);
+	for (int ty = y0 / TILE_HEIGHT; ty <= (y1 - 1) / TILE_HEIGHT; ++ty) {
+		for (int tx = x0 / TILE_WIDTH; tx <= (x1 - 1) / TILE_WIDTH; ++tx) {
+			const int tileX0 = tx * TILE_WIDTH, tileY0 = ty * TILE_HEIGHT;
+			const float* tileDepth = &depth[(ty * tilesX + tx) * TILE_WIDTH * TILE_HEIGHT];
+			int rx0 = std::max(x0, tileX0) & ~3, rx1 = std::min(x1, tileX0 + TILE_WIDTH);
+			int ry0 = std::max(y0, tileY0), ry1 = std::min(y1, tileY0 + TILE_HEIGHT);
+			for (int y = ry0; y < ry1; ++y) {
+				const float* line = tileDepth + (y - tileY0) * TILE_WIDTH - tileX0;
+				for (int x = rx0; x < rx1; x += 4) {
+					int lanes = 0;
+					for (int l = 0; l < 4; ++l)
+						if (x + l >= x0 && x + l < x1)
+							lanes |= 1 << l;
+					__m128 farther = _mm_cmplt_ps(_mm_loadu_ps(line + x), boxZ);
+					if (_mm_movemask_ps(farther) & lanes)
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "math/BoundingBox.h"
+
+// Triangle already projected to the rasterizer screen.
+// x and y are in pixels, z is 1/w (bigger is closer, 0 is infinitely far).
+struct ScreenTriangle {
+	glm::vec3 v[3];
+};
+
+// Low resolution cpu depth buffer used for occlusion culling.
+// The buffer is split in tiles stored one after the other so that each tile
+// can be rasterized by a different worker and stays in cache while doing so.
+// Inner loops work on 4 pixels at a time with SSE2.
+class DepthRasterizer {
+public:
+	static const int TILE_WIDTH = 32, TILE_HEIGHT = 16;
+private:
+	int width, height, tilesX, tilesY;
+	glm::mat4 viewProjection;
+	std::vector<float> depth;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int>> bins;
+	void rasterizeTile(int tile);
+public:
+	// Width must be a multiple of TILE_WIDTH and height of TILE_HEIGHT.
+	DepthRasterizer(int w = 256, int h = 128);
+
+	// Clears depth, triangles and bins. Call before adding occluders.
+	void clear(const glm::mat4& viewProj);
+
+	// Transform, clip and cull triangles of an occluder and append them to out.
+	// Doesn't touch the rasterizer state so it can be called from many threads at once.
+	// positions points to the first position and stride is the distance in bytes between two of them.
+	void setupTriangles(const void* positions, size_t stride, unsigned int vertexCount, const unsigned int* indices,
+		unsigned int indexCount, const glm::mat4& model, std::vector<ScreenTriangle>& out) const;
+
+	// Add triangles to the bins of the tiles they touch. Single threaded.
+	void binTriangles(const std::vector<ScreenTriangle>& tris);
+
+	// Rasterize every tile in parallel.
+	void rasterize();
+
+	// Conservative test, returns false only if the box is surely hidden (or off screen).
+	// Thread safe once rasterize() returned.
+	bool isBoxVisible(const BoundingBox& worldBox) const;
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	unsigned int getTriangleCount() const { return (unsigned int)triangles.size(); }
+};
\ No newline at end of file
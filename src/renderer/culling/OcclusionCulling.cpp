@@ -0,0 +1,208 @@
+#include "OcclusionCulling.h"
+#include "DepthRasterizer.h"
+#include "jobs/JobSystem.h"
+#include <future>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// What the job needs from an instance, copied on the main thread
+// so that gui changes can't race with the workers.
+struct InstanceSnapshot {
+	const Model* model;
+	glm::mat4 matrix;
+	unsigned int meshOffset;
+};
+
+struct OccluderCandidate {
+	const void* positions;
+	size_t stride;
+	unsigned int vertexCount;
+	const unsigned int* indices;
+	unsigned int indexCount;
+	unsigned int instance;
+	float score;
+};
+
+static DepthRasterizer* rasterizer = nullptr;
+static std::future<void> cullingJob;
+static bool useOcclusionCulling = true, resultsValid = false;
+static int maxOccluders = 32;
+// Meshes with more triangles than this are too expensive to be occluders.
+// They can still be occluders if the model has an authored proxy.
+static const unsigned int MAX_OCCLUDER_MESH_TRIANGLES = 4096, MAX_OCCLUDER_TRIANGLES = 32768;
+// Minimum (size / distance)^2 for a mesh to be considered as occluder.
+static const float MIN_OCCLUDER_SCORE = 0.02f;
+
+static glm::mat4 frameViewProj;
+static glm::vec3 frameCameraPosition;
+static std::vector<InstanceSnapshot> snapshot;
+static std::vector<unsigned char> instanceVisible, meshVisible;
+static unsigned int occluderCount = 0, occluderTriangleCount = 0, culledInstanceCount = 0, culledMeshCount = 0;
+static float cullingTime = 0.0f;
+
+static void cull();
+static float occluderScore(const BoundingBox& worldBox);
+
+void OcclusionCulling::initialize() {
+	if (rasterizer == nullptr)
+		rasterizer = new DepthRasterizer();
+}
+
+void OcclusionCulling::terminate() {
+	waitForResults();
+	delete rasterizer;
+	rasterizer = nullptr;
+	resultsValid = false;
+}
+
+void OcclusionCulling::beginFrame(const glm::mat4& viewProj, const glm::vec3& cameraPosition, const std::vector<ModelInstance>& instances, const TransformCache& transforms) {
+	waitForResults();
+	resultsValid = false;
+	if (!useOcclusionCulling || rasterizer == nullptr)
+		return;
+
+	frameViewProj = viewProj;
+	frameCameraPosition = cameraPosition;
+	snapshot.clear();
+	unsigned int meshOffset = 0;
+	for (unsigned int i = 0; i < instances.size(); ++i) {
+		const Model* m = instances[i].isDrawable() ? instances[i].getModel() : nullptr;
+		snapshot.push_back({ m, m ? transforms.getWorldMatrix(i) : glm::mat4(1.0f), meshOffset });
+		if (m)
+			meshOffset += (unsigned int)m->getMeshes().size();
+	}
+	instanceVisible.assign(snapshot.size(), 1);
+	meshVisible.assign(meshOffset, 1);
+
+	cullingJob = JobSystem::submit(cull);
+}
+
+void OcclusionCulling::waitForResults() {
+	if (cullingJob.valid()) {
+		cullingJob.get();
+		resultsValid = true;
+	}
+}
+
+bool OcclusionCulling::isInstanceVisible(unsigned int instance) {
+	if (!useOcclusionCulling || !resultsValid || instance >= instanceVisible.size())
+		return true;
+	return instanceVisible[instance] != 0;
+}
+
+bool OcclusionCulling::isMeshVisible(unsigned int instance, unsigned int mesh) {
+	if (!useOcclusionCulling || !resultsValid || instance >= snapshot.size())
+		return true;
+	unsigned int index = snapshot[instance].meshOffset + mesh;
+	return index >= meshVisible.size() || meshVisible[index] != 0;
+}
+
+static float occluderScore(const BoundingBox& worldBox) {
+	glm::vec3 toBox = worldBox.getCenter() - frameCameraPosition;
+	float radius = glm::length(worldBox.getExtent()) * 0.5f;
+	float distanceSquared = glm::dot(toBox, toBox);
+	// Camera inside the bounds, very likely a good occluder (walls, floors).
+	if (distanceSquared <= radius * radius)
+		return 1.0f;
+	return radius * radius / distanceSquared;
+}
+
+// Runs on a worker.
+static void cull() {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// 1. Pick occluders. Authored proxies first, then big enough low poly meshes.
+	std::vector<OccluderCandidate> candidates;
+	for (unsigned int i = 0; i < snapshot.size(); ++i) {
+		const InstanceSnapshot& s = snapshot[i];
+		if (s.model == nullptr)
+			continue;
+		if (s.model->hasOccluderProxy()) {
+			const OccluderMesh& proxy = s.model->getOccluderProxy();
+			float score = occluderScore(s.model->getBounds().transformed(s.matrix));
+			candidates.push_back({ proxy.positions.data(), sizeof(glm::vec3), (unsigned int)proxy.positions.size(),
+				proxy.indices.data(), (unsigned int)proxy.indices.size(), i, score * 2.0f });
+			continue;
+		}
+		for (const auto& mesh : s.model->getMeshes()) {
+			unsigned int indexCount = (unsigned int)mesh.indices.size();
+			if (indexCount == 0 || indexCount / 3 > MAX_OCCLUDER_MESH_TRIANGLES)
+				continue;
+			float score = occluderScore(mesh.getBounds().transformed(s.matrix));
+			if (score < MIN_OCCLUDER_SCORE)
+				continue;
+			candidates.push_back({ &mesh.vertices[0].Position, sizeof(Vertex), (unsigned int)mesh.vertices.size(),
+				mesh.indices.data(), indexCount, i, score });
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.score > b.score; });
+
+	unsigned int triangleBudget = MAX_OCCLUDER_TRIANGLES, chosen = 0;
+	for (; chosen < candidates.size() && chosen < (unsigned int)maxOccluders; ++chosen) {
+		unsigned int tris = candidates[chosen].indexCount / 3;
+		if (tris > triangleBudget)
+			break;
+		triangleBudget -= tris;
+	}
+	candidates.resize(chosen);
+
+	// 2. Transform and set up occluder triangles in parallel, then bin them.
+	rasterizer->clear(frameViewProj);
+	std::vector<std::vector<ScreenTriangle>> setup(candidates.size());
+	JobSystem::parallelFor((unsigned int)candidates.size(), 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int c = begin; c < end; ++c) {
+			const OccluderCandidate& oc = candidates[c];
+			rasterizer->setupTriangles(oc.positions, oc.stride, oc.vertexCount, oc.indices, oc.indexCount,
+				snapshot[oc.instance].matrix, setup[c]);
+		}
+	});
+	for (const auto& tris : setup)
+		rasterizer->binTriangles(tris);
+
+	// 3. Rasterize tiles in parallel.
+	rasterizer->rasterize();
+
+	// 4. Test instance bounds, then mesh bounds of visible instances.
+	std::atomic<unsigned int> culledInstances(0), culledMeshes(0);
+	JobSystem::parallelFor((unsigned int)snapshot.size(), 16, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i) {
+			const InstanceSnapshot& s = snapshot[i];
+			if (s.model == nullptr)
+				continue;
+			const std::vector<Mesh>& meshes = s.model->getMeshes();
+			if (!rasterizer->isBoxVisible(s.model->getBounds().transformed(s.matrix))) {
+				instanceVisible[i] = 0;
+				culledInstances++;
+				continue;
+			}
+			// Single mesh models were already tested with the instance bounds.
+			if (meshes.size() < 2)
+				continue;
+			for (unsigned int m = 0; m < meshes.size(); ++m) {
+				if (!rasterizer->isBoxVisible(meshes[m].getBounds().transformed(s.matrix))) {
+					meshVisible[s.meshOffset + m] = 0;
+					culledMeshes++;
+				}
+			}
+		}
+	});
+
+	occluderCount = (unsigned int)candidates.size();
+	occluderTriangleCount = rasterizer->getTriangleCount();
+	culledInstanceCount = culledInstances;
+	culledMeshCount = culledMeshes;
+	cullingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool OcclusionCulling::getUseOcclusionCulling() { return useOcclusionCulling; }
+void OcclusionCulling::setUseOcclusionCulling(bool b) { useOcclusionCulling = b; }
+
+int OcclusionCulling::getMaxOccluders() { return maxOccluders; }
+void OcclusionCulling::setMaxOccluders(int n) { maxOccluders = n > 0 ? n : 0; }
+
+unsigned int OcclusionCulling::getOccluderCount() { return occluderCount; }
+unsigned int OcclusionCulling::getOccluderTriangleCount() { return occluderTriangleCount; }
+unsigned int OcclusionCulling::getCulledInstanceCount() { return culledInstanceCount; }
+unsigned int OcclusionCulling::getCulledMeshCount() { return culledMeshCount; }
+float OcclusionCulling::getCullingTime() { return cullingTime; }
\ No newline at end of file
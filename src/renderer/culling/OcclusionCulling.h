@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "model/ModelInstance.h"
+#include "scene/TransformCache.h"
+
+// Cpu occlusion culling.
+// A few big occluders (authored proxies or auto selected meshes) are rasterized
+// in a small cpu depth buffer on the worker threads, then instance and mesh bounds are tested against it.
+// No gpu readback is needed, so the work overlaps with the shadow pass and the gpu finishing the previous frame.
+namespace OcclusionCulling {
+	void initialize();
+
+	// Safe to call even if it is not initialized.
+	void terminate();
+
+	// Snapshot instances and start culling on the workers.
+	// Must be followed by waitForResults() before using visibility.
+	// Transforms must be up to date with the instances.
+	void beginFrame(const glm::mat4& viewProj, const glm::vec3& cameraPosition, const std::vector<ModelInstance>& instances, const TransformCache& transforms);
+
+	// Blocks until culling started in beginFrame is done.
+	void waitForResults();
+
+	// Both return true if culling is disabled or the index wasn't part of the snapshot.
+	bool isInstanceVisible(unsigned int instance);
+	bool isMeshVisible(unsigned int instance, unsigned int mesh);
+
+	bool getUseOcclusionCulling();
+	void setUseOcclusionCulling(bool);
+	int getMaxOccluders();
+	void setMaxOccluders(int);
+
+	// Statistics of the last culled frame.
+	unsigned int getOccluderCount();
+	unsigned int getOccluderTriangleCount();
+	unsigned int getCulledInstanceCount();
+	unsigned int getCulledMeshCount();
+	float getCullingTime();
+}
\ No newline at end of file
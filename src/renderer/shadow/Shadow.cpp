@@ -9,6 +9,7 @@
 #include "window/Window.h"
 #include "camera/Camera.h"
 #include "PoissonDisk.h"
+#include "renderer/FrameUniforms.h"
 #include <cmath>
 
 static Shader program;
@@ -19,13 +20,15 @@ static bool useShadows = true, usePcf = true, usePoissonPcf = true;
 static float poissonPcfDiameter = 6.0f, csmBlendingOffset = 1.0f, csmPlanesDistanceInterpolationFactor = 0.35f, csmZMultiplier = 20.0f, shadowBiasMultiplier = 0.015f, shadowBiasMinimum = 0.0015f;
 static std::vector<glm::mat4> lightSpaceMatrices;
 static std::vector<float> pcfMultipliers, csmPlanes;
+static std::vector<unsigned int> casters;
+static std::vector<unsigned char> isCaster;
 
 static void prepareDraw(const glm::mat4& proj, const glm::mat4& view);
 static void draw();
 static std::vector<glm::vec4> getFrustumCoordinatesWorldSpace(const glm::mat4& proj, const glm::mat4& mView);
 static glm::vec3 getCenterCoordinateFromCorners(const std::vector<glm::vec4>& corners);
 static glm::mat4 getProjectionMatrixFromCorners(std::vector<float>& pcfMult, const std::vector<glm::vec4>& corners, const glm::mat4& view, float zMult);
-static void updatePoissonDisk(const std::vector<glm::vec2>& pcfSamples, const Shader& program);
+static void updatePoissonDisk(const std::vector<glm::vec2>& pcfSamples);
 static std::vector<float> buildClipPlanes(float near, float far, int numberOfVolumes);
 
 void Shadow::initialize() {
@@ -55,8 +58,7 @@ void Shadow::initialize() {
 
 	// Set up poisson disk pcf.
 	std::vector<glm::vec2> pcfPoints = PoissonDisk::generatePoissonDisk(poissonPcfSamples);
-	const Shader& spProgram = SimpleRenderer::getProgram();
-	updatePoissonDisk(pcfPoints, spProgram);
+	updatePoissonDisk(pcfPoints);
 }
 
 void Shadow::shadowPass(const glm::mat4& proj, const glm::mat4& view) {
@@ -134,19 +136,26 @@ void prepareDraw(const glm::mat4& proj, const glm::mat4& view) {
 }
 
 void draw() {
-	std::vector<ModelInstance>& modelInstances = SimpleRenderer::getScene().getModelInstancesManager().getModelInstances();
-	for (const auto& mi : modelInstances) {
-		if (mi.isDrawable()) {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, glm::vec3(mi.getX(), mi.getY(), mi.getZ()));
-			model = glm::rotate(model, glm::radians(mi.getRotation()).z, glm::vec3(0, 0, 1));
-			model = glm::rotate(model, glm::radians(mi.getRotation().x), glm::vec3(1, 0, 0));
-			model = glm::rotate(model, glm::radians(mi.getRotation().y), glm::vec3(0, 1, 0));
-			model = glm::scale(model, mi.getScale());
-
-			program.setMat4("model", model);
+	ModelInstancesManager& instancesManager = SimpleRenderer::getScene().getModelInstancesManager();
+	std::vector<ModelInstance>& modelInstances = instancesManager.getModelInstances();
+
+	// Casters are what is inside at least one cascade volume or between it and the sun,
+	// so the near plane of each cascade is ignored.
+	casters.clear();
+	for (const auto& m : lightSpaceMatrices)
+		instancesManager.getBvh().queryFrustum(m, casters, true);
+	isCaster.assign(modelInstances.size(), 0);
+	for (unsigned int i : casters)
+		isCaster[i] = 1;
+
+	for (unsigned int i = 0; i < modelInstances.size(); ++i) {
+		const ModelInstance& mi = modelInstances[i];
+		if (isCaster[i] && mi.isDrawable()) {
+			program.setMat4("model", instancesManager.getTransforms().getWorldMatrix(i));
 
 			for (const auto& mesh : mi.getModel()->getMeshes()) {
+				if (!mesh.isReady())
+					continue;
 
 				glBindVertexArray(mesh.getVao());
 				glDrawElements(GL_TRIANGLES, mesh.getIndicesSize(), GL_UNSIGNED_INT, 0);
@@ -156,32 +165,32 @@ void draw() {
 	}
 }
 
-void Shadow::setShadowParametersForRendering(const Shader& mainProgram) {
-	mainProgram.setBool("useShadows", Shadow::getUseShadows());
-	mainProgram.setBool("usePcf", Shadow::getUsePcf());
-	mainProgram.setBool("usePoissonPcf", Shadow::getUsePoissonPcf());
-	mainProgram.setFloat("poissonPcfDiameter", Shadow::getPoissonPcfDiameter());
-	mainProgram.setFloat("csmBlendingOffset", csmBlendingOffset);
-	mainProgram.setFloat("shadowBiasMultiplier", shadowBiasMultiplier);
-	mainProgram.setFloat("shadowBiasMinimum", shadowBiasMinimum);
+// Shadows, pcf and poisson pcf on or off are shader keywords chosen by the renderer.
+void Shadow::setShadowParametersForRendering() {
+	FrameUniforms::Data& frame = FrameUniforms::get();
+	frame.poissonPcfDiameter = Shadow::getPoissonPcfDiameter();
+	frame.csmBlendingOffset = csmBlendingOffset;
+	frame.shadowBiasMultiplier = shadowBiasMultiplier;
+	frame.shadowBiasMinimum = shadowBiasMinimum;
 
 	// Set shadow matrices and texture.
 	for (int i = 0; i < csmLayers; ++i) {
-		mainProgram.setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", lightSpaceMatrices[i]);
-		mainProgram.setFloat("pcfMultipliers[" + std::to_string(i) + "]", pcfMultipliers[i]);
+		frame.lightSpaceMatrices[i] = lightSpaceMatrices[i];
+		frame.pcfMultipliers[i] = pcfMultipliers[i];
 	}
 	for (int i = 0; i < csmLayers + 1; ++i) {
-		mainProgram.setFloat("cascadePlaneDistances[" + std::to_string(i) + "]", csmPlanes[i]);
+		frame.cascadePlaneDistances[i / 4][i % 4] = csmPlanes[i];
 	}
 	glActiveTexture(GL_TEXTURE8);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, Shadow::getTextureId());
 }
 
 // Update poisson pcf samples in shader.
-static void updatePoissonDisk(const std::vector<glm::vec2>& pcfSamples, const Shader& program) {
-	program.setInt("pcfSamplesNumber", pcfSamples.size());
+static void updatePoissonDisk(const std::vector<glm::vec2>& pcfSamples) {
+	FrameUniforms::Data& frame = FrameUniforms::get();
+	frame.pcfSamplesNumber = (int)pcfSamples.size();
 	for (int i = 0; i < pcfSamples.size(); i++) {
-		program.setVec2("pcfSamples[" + std::to_string(i) + "]", pcfSamples[i]);
+		frame.pcfSamples[i] = glm::vec4(pcfSamples[i], 0.0f, 0.0f);
 	}
 }
 
@@ -312,8 +321,7 @@ int Shadow::getPoissonPcfSamplesNumber() {
 void Shadow::setPoissonPcfSamplesNumber(int n) {
 	poissonPcfSamples = n <= 16 ? n : 16;
 	std::vector<glm::vec2> pcfPoints = PoissonDisk::generatePoissonDisk(poissonPcfSamples);
-	const Shader& spProgram = SimpleRenderer::getProgram();
-	updatePoissonDisk(pcfPoints, spProgram);
+	updatePoissonDisk(pcfPoints);
 }
 
 bool Shadow::getUsePcf() { return usePcf; }
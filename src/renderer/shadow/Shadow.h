@@ -8,7 +8,8 @@ namespace Shadow {
 	unsigned int getTextureId();
 	Shader& getShader();
 	glm::mat4& getLightSpaceMatrix();
-	void setShadowParametersForRendering(const Shader& program);
+	// Writes shadow values in the frame uniforms and binds the shadow maps.
+	void setShadowParametersForRendering();
 	void terminate();
 	bool getUsePcf();
 	bool getUsePoissonPcf();
@@ -22,19 +22,33 @@
 #include "post/PostProcessing.h"
 #include "renderer/shadow/Shadow.h"
 #include "renderer/Skybox.h"
+#include "renderer/culling/OcclusionCulling.h"
+#include "model/TextureStreamer.h"
+#include "renderer/MaterialTable.h"
+#include "renderer/RenderQueue.h"
+#include "renderer/FrameUniforms.h"
+#include <algorithm>
 
-static Shader program;
+static ShaderVariants program;
 
 static Scene currentScene;
 
-static void draw(const ModelInstance&, const glm::mat4& view);
+static void queueInstance(RenderQueue::Pass pass, const ModelInstance&, const glm::mat4& view, int instanceIndex = -1, const glm::vec3& color = glm::vec3(1.0f));
 static void prepareFrame(const glm::mat4& projection, const glm::mat4& view);
 static void prepareLights(const glm::mat4& view);
-static void drawLights(const glm::mat4& view);
-static void prepareTextures(const Mesh&);
+static unsigned int buildPassKeywords();
+static void queueLights(const glm::mat4& view);
+static void buildLightMasks(const Bvh& bvh, unsigned int instanceCount);
+static void requestTextureMips(const Mesh& mesh, const glm::mat4& model);
 
 static bool usePbr = true;
 static float nearPlane = 0.1f, farPlane = 200.0f, fov = 45.0f;
+// Instances inside the camera frustum and lights reaching each instance, reused every frame.
+static std::vector<unsigned int> frustumInstances, lightQuery;
+static std::vector<int> lightMasks;
+// Screen pixels covered by a world unit at distance 1, and camera position, for texture streaming.
+static float pixelsPerUnit = 1.0f;
+static glm::vec3 streamingCameraPosition;
 
 void SimpleRenderer::render() {
 
@@ -43,8 +57,26 @@ void SimpleRenderer::render() {
 	view = buildViewMatrix();
 	glm::mat4 projection = glm::mat4(1.0f);
 	projection = glm::perspective(glm::radians(fov), static_cast<float>(getWindowWidth()) / getWindowHeight(), nearPlane, farPlane);
+
+	// Upload streamed mips loaded since last frame and start loading the ones drawing asked for.
+	TextureStreamer::update();
+	pixelsPerUnit = getWindowHeight() * projection[1][1] * 0.5f;
+	streamingCameraPosition = getCameraPosition();
+
+	// Update cached matrices and refit the bvh with instances moved since last frame,
+	// every pass and spatial query below uses them.
+	ModelInstancesManager& instancesManager = currentScene.getModelInstancesManager();
+	instancesManager.update();
+	const Bvh& bvh = instancesManager.getBvh();
+
+	// Start occlusion culling on the workers, it runs while the shadow pass is submitted.
+	std::vector<ModelInstance>& modelInstances = instancesManager.getModelInstances();
+	OcclusionCulling::beginFrame(projection * view, getCameraPosition(), modelInstances, instancesManager.getTransforms());
+	VisibilityManager& visibility = currentScene.getVisibilityManager();
+	visibility.update(getCameraPosition(), instancesManager);
 	
 	// Shadow pass.
+	// Shadow casters are not occlusion culled, something hidden from the camera can still cast a visible shadow.
 	Shadow::shadowPass(projection, view);
 
 	// Prepare frame for drawing.
@@ -56,16 +88,27 @@ void SimpleRenderer::render() {
 	ImGui::NewFrame();
 
 	prepareLights(view);
-
-	// Draw instances of models and set default color for the ones that have no texture.
-	program.setBool("useLighting", true);
-	for (const auto& mi : currentScene.getModelInstancesManager().getModelInstances()) {
-		draw(mi, view);
+	buildLightMasks(bvh, (unsigned int)modelInstances.size());
+
+	// Frustum culling, sorted so instances are drawn in scene order.
+	frustumInstances.clear();
+	bvh.queryFrustum(projection * view, frustumInstances);
+	std::sort(frustumInstances.begin(), frustumInstances.end());
+
+	// Queue visible meshes, sort them to share state and draw them.
+	RenderQueue::begin(view, nearPlane, farPlane);
+	OcclusionCulling::waitForResults();
+	for (unsigned int i : frustumInstances) {
+		if (visibility.isInstanceVisible(i) && OcclusionCulling::isInstanceVisible(i))
+			queueInstance(RenderQueue::Pass::OPAQUE, modelInstances[i], view, i);
 	}
+	queueLights(view);
+	RenderQueue::sort();
+	RenderQueue::submit(RenderQueue::Pass::OPAQUE, program, buildPassKeywords());
 
 	// Draw lights before post processing to see actual color of lights.
 	// If we don't the colors we see might not be accurate.
-	drawLights(view);
+	RenderQueue::submit(RenderQueue::Pass::UNLIT, program, program.getKeywordMask("UNLIT"));
 
 	// Draw skybox.
 	// Skybox is the last thing to be rendered before post processing.
@@ -86,17 +129,25 @@ void SimpleRenderer::render() {
 
 void SimpleRenderer::initRenderer() {
 	// PROJECT_FOLDER is string macro so it get concatenated with "".
-	program = Shader(project_directory + "\\shaders\\vshader.glsl", project_directory + "\\shaders\\fshader.glsl");
+	// Materials come from the material table, how it references textures depends on the hardware.
+	// Variants are compiled the first time a combination of keywords is drawn.
+	program = ShaderVariants(project_directory + "\\shaders\\vshader.glsl", project_directory + "\\shaders\\fshader.glsl", MaterialTable::getShaderDefines());
 	
 	// Load scene.
 	currentScene = Scene("test");
 	currentScene.initialize();
+
+	// Variants the first frames are likely to need compile in parallel, draws use simpler ones until they are ready.
+	RenderQueue::prepare(program, buildPassKeywords());
+	program.prepare(program.getKeywordMask("UNLIT"));
 }
 
 void SimpleRenderer::terminateRenderer() {
 
 	// Terminate scene.
 	currentScene.terminate();
+
+	program.clear();
 }
 
 // Stuff to do before rendering.
@@ -112,8 +163,6 @@ static void prepareFrame(const glm::mat4& projection, const glm::mat4& view) {
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glUseProgram(program.getShaderID());
-
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 
@@ -121,126 +170,127 @@ static void prepareFrame(const glm::mat4& projection, const glm::mat4& view) {
 	glFrontFace(GL_CCW);
 	glCullFace(GL_BACK);
 
-	program.setMat4("view", view);
+	FrameUniforms::Data& frame = FrameUniforms::get();
+	frame.view = view;
+	frame.projection = projection;
 
-	program.setMat4("projection", projection);
+	// Materials changed since last frame and texture arrays.
+	MaterialTable::bind();
 
-	program.setBool("usePbr", usePbr);
+	Shadow::setShadowParametersForRendering();
+}
 
-	Shadow::setShadowParametersForRendering(program);
+// Keywords constant for the whole opaque pass, the ones of each material are added by the render queue.
+static unsigned int buildPassKeywords() {
+	unsigned int keywords = 0;
+	if (usePbr)
+		keywords |= program.getKeywordMask("PBR");
+	if (currentScene.getLightsManager().getUseSunLight()) {
+		keywords |= program.getKeywordMask("SUN_LIGHT");
+		if (Shadow::getUseShadows()) {
+			keywords |= program.getKeywordMask("SHADOWS");
+			if (Shadow::getUsePcf())
+				keywords |= program.getKeywordMask("PCF");
+			if (Shadow::getUsePcf() && Shadow::getUsePoissonPcf())
+				keywords |= program.getKeywordMask("POISSON_PCF");
+		}
+	}
+	return keywords;
 }
 
-// Set light parameters in shader.
+// Write light parameters in the frame uniforms and upload them, after prepareFrame.
 static void prepareLights(const glm::mat4& view) {
 
 	// Update SunLight.
-	currentScene.getLightsManager().updateSunLight(program);
+	currentScene.getLightsManager().updateSunLight();
 
-	// Do after changing number of lights.
-	// Do not put code between this line and the next for.
-	program.setInt("lightsNumber", currentScene.getLightsManager().getSize());
+	FrameUniforms::get().lightsNumber = currentScene.getLightsManager().getSize();
 
 	for (int i = 0; i < currentScene.getLightsManager().getSize(); ++i) {
-		currentScene.getLightsManager().updateLight(program, i);
+		currentScene.getLightsManager().updateLight(i);
 	}
+
+	// Every variant reads the same buffer.
+	FrameUniforms::upload();
 }
 
-static void drawLights(const glm::mat4& view) {
+static void queueLights(const glm::mat4& view) {
 
-	// Get default_cube asset and change its position every time we render it.
-	ModelInstance lmi(0, 0, 0, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), getAssetModel("default_cube"));
-	program.setBool("useTexture", false);
-	program.setBool("useLighting", false);
+	// The fallback model is default_cube, change its position every time we render it.
+	ModelInstance lmi(0, 0, 0, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), getFallbackAssetModel());
 	// Draw sun.
 	// Looks wrong because it's directional.
 	if (currentScene.getLightsManager().getUseSunLight()) {
 		SunLight& sl = currentScene.getLightsManager().getSunLight();
-		program.setVec3("defaultColor", sl.getDiffuse());
 		lmi.setPosition(glm::vec3(sl.getPosition().x, sl.getPosition().y, sl.getPosition().z));
-		draw(lmi, view);
+		queueInstance(RenderQueue::Pass::UNLIT, lmi, view, -1, sl.getDiffuse());
 	}
 	for (int i = 0; i < currentScene.getLightsManager().getSize(); ++i) {
 		Light& l = currentScene.getLightsManager().getLight(i);
-		program.setVec3("defaultColor", l.getDiffuse());
 		lmi.setPosition(glm::vec3(l.getPosition().x, l.getPosition().y, l.getPosition().z));
-		draw(lmi, view);
+		queueInstance(RenderQueue::Pass::UNLIT, lmi, view, -1, l.getDiffuse());
 	}
 }
 
-static void prepareTextures(const Mesh& mesh) {
-
-	// Prepare textures in shader program.
-	if (mesh.getTexturesByType(TextureType::DIFFUSE).size() > 0) {
-		program.setBool("material.hasDiffuseMap", true);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, mesh.getTexturesByType(TextureType::DIFFUSE)[0].id);
-	}
-	else
-		program.setBool("material.hasDiffuseMap", false);
-
-	if (mesh.getTexturesByType(TextureType::NORMAL).size() > 0) {
-		program.setBool("material.hasNormalsMap", true);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, mesh.getTexturesByType(TextureType::NORMAL)[0].id);
-	}
-	else
-		program.setBool("material.hasNormalsMap", false);
-
-	if (mesh.getTexturesByType(TextureType::ROUGHNESS).size() > 0) {
-		program.setBool("material.hasRoughnessMap", true);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, mesh.getTexturesByType(TextureType::ROUGHNESS)[0].id);
-	}
-	else
-		program.setBool("material.hasRoughnessMap", false);
+// instanceIndex is the index in the scene model instances, used for culling results.
+// Pass -1 for instances that are not part of the scene (light cubes), color is used by the unlit pass.
+static void queueInstance(RenderQueue::Pass pass, const ModelInstance& mi, const glm::mat4& view, int instanceIndex, const glm::vec3& color) {
 
-	if (mesh.getTexturesByType(TextureType::METALLIC).size() > 0) {
-		program.setBool("material.hasMetallicMap", true);
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, mesh.getTexturesByType(TextureType::METALLIC)[0].id);
+	if (mi.isDrawable()) {
+		RenderQueue::Instance instance;
+		// Scene instances use cached matrices, the view has no scale so its 3x3 part applies directly.
+		if (instanceIndex >= 0) {
+			const TransformCache& transforms = currentScene.getModelInstancesManager().getTransforms();
+			instance.model = transforms.getWorldMatrix(instanceIndex);
+			instance.normal = glm::mat3(view) * transforms.getNormalMatrix(instanceIndex);
+		}
+		else {
+			instance.model = mi.buildModelMatrix();
+			instance.normal = glm::mat3(glm::transpose(glm::inverse(view * instance.model)));
+		}
+		instance.lightMask = instanceIndex >= 0 && (size_t)instanceIndex < lightMasks.size() ? lightMasks[instanceIndex] : -1;
+		instance.color = color;
+		unsigned int queued = RenderQueue::addInstance(instance);
+
+		const std::vector<Mesh>& meshes = mi.getModel()->getMeshes();
+		for (unsigned int m = 0; m < meshes.size(); ++m) {
+			const Mesh& mesh = meshes[m];
+			// Still uploading.
+			if (!mesh.isReady())
+				continue;
+			if (instanceIndex >= 0 && (!OcclusionCulling::isMeshVisible(instanceIndex, m) ||
+				!currentScene.getVisibilityManager().isMeshVisible(instanceIndex, m)))
+				continue;
+			if (instanceIndex >= 0)
+				requestTextureMips(mesh, instance.model);
+			RenderQueue::add(pass, mesh.getDrawPacket(), queued);
+		}
 	}
-	else
-		program.setBool("material.hasMetallicMap", false);
 }
 
-static void draw(const ModelInstance& mi, const glm::mat4& view) {
-
-	if (mi.isDrawable()) {
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(mi.getX(), mi.getY(), mi.getZ()));
-		model = glm::rotate(model, glm::radians(mi.getRotation()).z, glm::vec3(0, 0, 1));
-		model = glm::rotate(model, glm::radians(mi.getRotation().x), glm::vec3(1, 0, 0));
-		model = glm::rotate(model, glm::radians(mi.getRotation().y), glm::vec3(0, 1, 0));
-		model = glm::scale(model, mi.getScale());
-
-		glm::mat3 normal = glm::mat3(1.0f);
-		normal = glm::mat3(glm::transpose(glm::inverse(view * model)));
-
-		program.setMat4("model", model);
-		program.setMat3("NormalMat", normal);
-
-		program.setBool("useTexture", true);
-
-		for (const auto& mesh : mi.getModel()->getMeshes()) {
-			// Phong.
-			program.setVec3("material.ambient", mesh.getMaterial().ambient);
-			program.setVec3("material.diffuse", mesh.getMaterial().diffuse);
-			program.setVec3("material.specular", mesh.getMaterial().specular);
-			program.setFloat("material.shininess", mesh.getMaterial().shininess);
-
-			// PBR.
-			program.setFloat("material.roughness", mesh.getMaterial().roughness);
-			program.setFloat("material.metallic", mesh.getMaterial().metallic);
-
-			// General.
-
-			// Textures.
-			prepareTextures(mesh);
+// Uv space covered by a screen pixel at the closest point of the mesh, scaled by the largest axis of the model matrix.
+static void requestTextureMips(const Mesh& mesh, const glm::mat4& model) {
+	if (mesh.textures.empty())
+		return;
+	BoundingBox box = mesh.getBounds().transformed(model);
+	glm::vec3 closest = glm::clamp(streamingCameraPosition, box.min, box.max);
+	float distance = std::max(glm::length(closest - streamingCameraPosition), nearPlane);
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float uvPerPixel = mesh.getUvDensity() * distance / (std::max(scale, 1e-6f) * pixelsPerUnit);
+	for (const auto& texture : mesh.textures)
+		TextureStreamer::request(texture.id, uvPerPixel);
+}
 
-			glBindVertexArray(mesh.getVao());
-			glDrawElements(GL_TRIANGLES, mesh.getIndicesSize(), GL_UNSIGNED_INT, 0);
-			glBindVertexArray(0);
-		}
+// Point lights only affect instances within their influence radius.
+static void buildLightMasks(const Bvh& bvh, unsigned int instanceCount) {
+	lightMasks.assign(instanceCount, 0);
+	LightsManager& lightsManager = currentScene.getLightsManager();
+	for (int l = 0; l < lightsManager.getSize(); ++l) {
+		const Light& light = lightsManager.getLight(l);
+		lightQuery.clear();
+		bvh.querySphere(light.getPosition(), light.getInfluenceRadius(), lightQuery);
+		for (unsigned int i : lightQuery)
+			lightMasks[i] |= 1 << l;
 	}
 }
 
@@ -260,8 +310,8 @@ bool SimpleRenderer::getUsePbr() {
 	return usePbr;
 }
 
-const Shader& SimpleRenderer::getProgram() {
-	return program;
+unsigned int SimpleRenderer::getVariantCount() {
+	return program.getVariantCount();
 }
 
 float SimpleRenderer::getNearPlane() {
@@ -1,7 +1,7 @@
 #pragma once
 #include "model/ModelInstance.h"
 #include <vector>
-#include "shader/Shader.h"
+#include "shader/ShaderVariants.h"
 #include "scene/Scene.h"
 
 namespace SimpleRenderer {
@@ -10,7 +10,8 @@ namespace SimpleRenderer {
 	void terminateRenderer();
 	void setUsePbr(bool);
 	bool getUsePbr();
-	const Shader& getProgram();
+	// Variants of the main shader compiled so far.
+	unsigned int getVariantCount();
 	float getNearPlane();
 	float getFarPlane();
 	float getFov();
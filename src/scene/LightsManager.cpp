@@ -1,69 +1,38 @@
 #include "Scene.h"
 #include "ProjectDirectory.h"
+#include "renderer/FrameUniforms.h"
+#include "vfs/Vfs.h"
 #include <fstream>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-void LightsManager::initialize()
+void LightsManager::initialize(const SceneFile::Data& data)
 {
-	// First check if file exists. If it doesn't create it and skip reading step.
+	// New scenes have neither a json file nor a binary one, the json file is created empty.
+	// Cooked scenes can be only a binary file, and packed scenes exist without a loose file.
 	try {
-		std::ifstream filePath(project_directory + "\\assets\\scenes\\" + sceneName + "\\lights.json");
-		if (!filePath) {
-			filePath.close();
+		if (!data.binary && !Vfs::exists(project_directory + "\\assets\\scenes\\" + sceneName + "\\lights.json")) {
 			std::fstream newFile;
 			newFile.open(project_directory + "\\assets\\scenes\\" + sceneName + "\\lights.json", std::ios::out);
 			newFile.close();
 			return;
-		} else {
-			filePath.close();
 		}
 	}
 	catch (...) {
 		std::cout << "Error while checking existence/creating scene directory." << std::endl;
 	}
 
-	// Read Lights and add them to lights vector.
-	try {
-		std::ifstream f(project_directory + "\\assets\\scenes\\" + sceneName + "\\lights.json");
-		json data = json::parse(f);
-
-		glm::vec3 sunPosition(data["sunLight"]["position"][0],
-			data["sunLight"]["position"][1], data["sunLight"]["position"][2]);
-		glm::vec3 sunAmbient(data["sunLight"]["ambient"][0],
-			data["sunLight"]["ambient"][1], data["sunLight"]["ambient"][2]);
-		glm::vec3 sunDiffuse(data["sunLight"]["diffuse"][0],
-			data["sunLight"]["diffuse"][1], data["sunLight"]["diffuse"][2]);
-		glm::vec3 sunSpecular(data["sunLight"]["specular"][0],
-			data["sunLight"]["specular"][1], data["sunLight"]["specular"][2]);
-
-		sunLight = SunLight(sunPosition, sunAmbient, sunDiffuse, sunSpecular);
-
+	// Add the lights of the scene file to lights vector.
+	if (data.sun.present) {
+		sunLight = SunLight(data.sun.position, data.sun.ambient, data.sun.diffuse, data.sun.specular);
 		// Enable sunLight if its value is true.
-		useSunLight = data["sunLight"]["useSunLight"];
-
-		int lightsNumber = data["lights"].size();
-		for (int i = 0; i < lightsNumber; ++i) {
-			glm::vec3 position(data["lights"][i]["position"][0],
-				data["lights"][i]["position"][1], data["lights"][i]["position"][2]);
-			glm::vec3 ambient(data["lights"][i]["ambient"][0],
-				data["lights"][i]["ambient"][1], data["lights"][i]["ambient"][2]);
-			glm::vec3 diffuse(data["lights"][i]["diffuse"][0],
-				data["lights"][i]["diffuse"][1], data["lights"][i]["diffuse"][2]);
-			glm::vec3 specular(data["lights"][i]["specular"][0],
-				data["lights"][i]["specular"][1], data["lights"][i]["specular"][2]);
-			float constant = data["lights"][i]["constant"];
-			float linear = data["lights"][i]["linear"];
-			float quadratic = data["lights"][i]["quadratic"];
-
-			lights.push_back(Light(position, ambient, diffuse, specular, constant, linear, quadratic));
-		}
-		// Remember to close the file.
-		f.close();
+		useSunLight = data.sun.use != 0;
 	}
-	catch (...) {
-		std::cout << "Error while loading scene lights." << std::endl;
+	lights.reserve(data.lightCount);
+	for (uint32_t i = 0; i < data.lightCount; ++i) {
+		const SceneFile::Light& l = data.lights[i];
+		lights.push_back(Light(l.position, l.ambient, l.diffuse, l.specular, l.constant, l.linear, l.quadratic));
 	}
 }
 
@@ -118,6 +87,28 @@ void LightsManager::save() {
 	}
 }
 
+void LightsManager::writeSceneData(SceneFile::Data& data) {
+	data.sun.position = sunLight.getPosition();
+	data.sun.ambient = sunLight.getAmbient();
+	data.sun.diffuse = sunLight.getDiffuse();
+	data.sun.specular = sunLight.getSpecular();
+	data.sun.present = 1;
+	data.sun.use = useSunLight ? 1 : 0;
+	data.parsedLights.reserve(lights.size());
+	for (const Light& l : lights) {
+		SceneFile::Light light;
+		light.position = l.getPosition();
+		light.ambient = l.getAmbient();
+		light.diffuse = l.getDiffuse();
+		light.specular = l.getSpecular();
+		light.constant = l.getConstant();
+		light.linear = l.getLinear();
+		light.quadratic = l.getQuadratic();
+		data.parsedLights.push_back(light);
+	}
+	data.setParsed();
+}
+
 Light& LightsManager::getLight(int index) {
 	if (index < MAX_LIGHTS)
 		return lights[index];
@@ -165,86 +156,27 @@ bool LightsManager::getUseSunLight() {
 }
 
 // Must be called every frame.
-// Function to update shader values of light if they changed.
-void LightsManager::updateSunLight(Shader& program)
+// Writes the sun light in the frame uniforms, every shader variant reads it from there.
+void LightsManager::updateSunLight()
 {
-	program.setBool("useSunLight", useSunLight);
-
-	if (useSunLight) {
-		switch (sunLight.getUpdate()) {
-		case SunLightUpdate::FALSE:
-			break;
-		case SunLightUpdate::POSITION:
-			program.setVec3("sunLight.position", sunLight.getPosition());
-			sunLight.resetUpdate();
-			break;
-		case SunLightUpdate::AMBIENT:
-			program.setVec3("sunLight.ambient", sunLight.getAmbient());
-			sunLight.resetUpdate();
-			break;
-		case SunLightUpdate::DIFFUSE:
-			program.setVec3("sunLight.diffuse", sunLight.getDiffuse());
-			sunLight.resetUpdate();
-			break;
-		case SunLightUpdate::SPECULAR:
-			program.setVec3("sunLight.specular", sunLight.getSpecular());
-			sunLight.resetUpdate();
-			break;
-		case SunLightUpdate::MULTIPLE:
-			program.setVec3("sunLight.position", sunLight.getPosition());
-			program.setVec3("sunLight.ambient", sunLight.getAmbient());
-			program.setVec3("sunLight.diffuse", sunLight.getDiffuse());
-			program.setVec3("sunLight.specular", sunLight.getSpecular());
-			sunLight.resetUpdate();
-			break;
-		}
-	}
+	FrameUniforms::Data& frame = FrameUniforms::get();
+	frame.sunPosition = glm::vec4(sunLight.getPosition(), 0.0f);
+	frame.sunAmbient = glm::vec4(sunLight.getAmbient(), 0.0f);
+	frame.sunDiffuse = glm::vec4(sunLight.getDiffuse(), 0.0f);
+	frame.sunSpecular = glm::vec4(sunLight.getSpecular(), 0.0f);
+	sunLight.resetUpdate();
 }
 
 // Must be called every frame.
-// Function to update shader values of light if they changed.
-void LightsManager::updateLight(Shader& program, int index) {
+// Writes the light in the frame uniforms, every shader variant reads it from there.
+void LightsManager::updateLight(int index) {
+	static_assert(MAX_LIGHTS <= FrameUniforms::MAX_LIGHT_COUNT, "Frame uniforms must have room for every light.");
 	Light& l = lights[index];
-	switch (l.getUpdate()) {
-	case LightUpdate::FALSE:
-		break;
-	case LightUpdate::POSITION:
-		program.setVec3("lights[" + std::to_string(index) + "].position", l.getPosition());
-		l.resetUpdate();
-		break;
-	case LightUpdate::AMBIENT:
-		program.setVec3("lights[" + std::to_string(index) + "].ambient", l.getAmbient());
-		l.resetUpdate();
-		break;
-	case LightUpdate::DIFFUSE:
-		program.setVec3("lights[" + std::to_string(index) + "].diffuse", l.getDiffuse());
-		l.resetUpdate();
-		break;
-	case LightUpdate::SPECULAR:
-		program.setVec3("lights[" + std::to_string(index) + "].specular", l.getSpecular());
-		l.resetUpdate();
-		break;
-	case LightUpdate::CONSTANT:
-		program.setFloat("lights[" + std::to_string(index) + "].constant", l.getConstant());
-		l.resetUpdate();
-		break;
-	case LightUpdate::LINEAR:
-		program.setFloat("lights[" + std::to_string(index) + "].linear", l.getLinear());
-		l.resetUpdate();
-		break;
-	case LightUpdate::QUADRATIC:
-		program.setFloat("lights[" + std::to_string(index) + "].quadratic", l.getQuadratic());
-		l.resetUpdate();
-		break;
-	case LightUpdate::MULTIPLE:
-		program.setVec3("lights[" + std::to_string(index) + "].position", l.getPosition());
-		program.setVec3("lights[" + std::to_string(index) + "].ambient", l.getAmbient());
-		program.setVec3("lights[" + std::to_string(index) + "].diffuse", l.getDiffuse());
-		program.setVec3("lights[" + std::to_string(index) + "].specular", l.getSpecular());
-		program.setFloat("lights[" + std::to_string(index) + "].constant", l.getConstant());
-		program.setFloat("lights[" + std::to_string(index) + "].linear", l.getLinear());
-		program.setFloat("lights[" + std::to_string(index) + "].quadratic", l.getQuadratic());
-		l.resetUpdate();
-		break;
-	}
-}
+	FrameUniforms::Light& light = FrameUniforms::get().lights[index];
+	light.position = glm::vec4(l.getPosition(), 1.0f);
+	light.ambient = glm::vec4(l.getAmbient(), 0.0f);
+	light.diffuse = glm::vec4(l.getDiffuse(), 0.0f);
+	light.specular = glm::vec4(l.getSpecular(), 0.0f);
+	light.attenuation = glm::vec4(l.getConstant(), l.getLinear(), l.getQuadratic(), 0.0f);
+	l.resetUpdate();
+}
\ No newline at end of file
@@ -2,58 +2,63 @@
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include "ProjectDirectory.h"
+#include "jobs/JobSystem.h"
+#include "vfs/Vfs.h"
+#include <chrono>
+#include <limits>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
-void ModelInstancesManager::initialize() {
+// Refitted bvh cost over freshly built cost at which a background rebuild starts.
+static const float BVH_REBUILD_QUALITY = 1.5f;
+
+static bool rayTriangle(const glm::vec3& o, const glm::vec3& d, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t);
+
+void ModelInstancesManager::initialize(const SceneFile::Data& data) {
 	
-	// First check if file exists. If it doesn't create it and skip reading step.
+	// New scenes have neither a json file nor a binary one, the json file is created empty.
+	// Cooked scenes can be only a binary file, and packed scenes exist without a loose file.
 	try {
-		std::ifstream filePath(project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json");
-		if (!filePath) {
-			filePath.close();
+		if (!data.binary && !Vfs::exists(project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json")) {
 			std::fstream newFile;
 			newFile.open(project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json", std::ios::out);
 			newFile.close();
 			return;
 		}
-		else {
-			filePath.close();
-		}
 	}
 	catch (...) {
 		std::cout << "Error while checking existence/creating scene directory." << std::endl;
 	}
 
-	// Read ModelInstances and add them to modelInstances (instances to render).
-	try {
-		std::ifstream f(project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json");
-		json data = json::parse(f);
-
-		int modelInstancesNumber = data["modelInstances"].size();
-		for (int i = 0; i < modelInstancesNumber; ++i) {
-			float posX = data["modelInstances"][i]["position"][0], 
-				posY = data["modelInstances"][i]["position"][1], posZ = data["modelInstances"][i]["position"][2];
-			glm::vec3 scale(data["modelInstances"][i]["scale"][0], 
-				data["modelInstances"][i]["scale"][1], data["modelInstances"][i]["scale"][2]);
-			glm::vec3 rotation(data["modelInstances"][i]["rotation"][0], 
-				data["modelInstances"][i]["rotation"][1], data["modelInstances"][i]["rotation"][2]);
-			
-			modelInstances.push_back(ModelInstance(posX, posY, posZ, rotation, scale, getAssetModel(data["modelInstances"][i]["modelName"])));
-		}
-		// Remember to close the file.
-		f.close();
-	}
-	catch (...) {
-		std::cout << "Error while loading scene model instances." << std::endl;
+	// Add the instances of the scene file to modelInstances (instances to render).
+	// Models are looked up once per name, not once per instance.
+	std::vector<ModelHandle> models;
+	models.reserve(data.modelNames.size());
+	for (const std::string& name : data.modelNames)
+		models.push_back(getAssetModelHandle(name));
+	modelInstances.reserve(data.instanceCount);
+	for (uint32_t i = 0; i < data.instanceCount; ++i) {
+		const SceneFile::Instance& instance = data.instances[i];
+		ModelHandle model = instance.model < models.size() ? models[instance.model] : ModelHandle();
+		modelInstances.push_back(ModelInstance(instance.position.x, instance.position.y, instance.position.z, instance.rotation, instance.scale, model));
+		acquireAssetModel(model);
+		if (instance.parent >= 0 && (uint32_t)instance.parent < data.instanceCount)
+			modelInstances.back().setParent(instance.parent);
 	}
+	// Saved files are already ordered, but they can be edited by hand.
+	sortHierarchy();
 }
 
 void ModelInstancesManager::terminate() {
-	// Unload all loaded models.
-	// Could add a function to swap with another scene 
-	// so that you don't have to reload already loaded models.
-	deleteAllAssetModels();
+	waitForRebuild();
+	bvh.clear();
+	transforms.clear();
+	bvhStructureDirty = true;
+
+	// Models stay loaded without references, the next scene reuses the ones it shares with this one.
+	for (const auto& mi : modelInstances)
+		releaseAssetModel(mi.getModelHandle());
 
 	// Clear all model instances.
 	modelInstances.clear();
@@ -64,7 +69,7 @@ void ModelInstancesManager::save() {
 	try {
 		json sceneJson;
 		// Create json object and dump as string (int in parethesis represents indentation spaces).
-		for (int i = 0; i < modelInstances.size(); ++i) {
+		for (size_t i = 0; i < modelInstances.size(); ++i) {
 			const ModelInstance& mi = modelInstances[i];
 			sceneJson["modelInstances"][i]["position"][0] = mi.getX();
 			sceneJson["modelInstances"][i]["position"][1] = mi.getY();
@@ -76,6 +81,8 @@ void ModelInstancesManager::save() {
 			sceneJson["modelInstances"][i]["scale"][1] = mi.getScale().y;
 			sceneJson["modelInstances"][i]["scale"][2] = mi.getScale().z;
 			sceneJson["modelInstances"][i]["modelName"] = mi.getModel()->getName();
+			if (mi.getParent() >= 0)
+				sceneJson["modelInstances"][i]["parent"] = mi.getParent();
 		}
 		std::string outputText(sceneJson.dump(4));
 		outputFile.open(project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json", std::ofstream::out | std::ofstream::trunc);
@@ -87,7 +94,304 @@ void ModelInstancesManager::save() {
 	}
 }
 
+void ModelInstancesManager::writeSceneData(SceneFile::Data& data) const {
+	std::unordered_map<std::string, uint32_t> models;
+	for (const auto& model : data.modelNames)
+		models.emplace(model, (uint32_t)models.size());
+	data.parsedInstances.reserve(modelInstances.size());
+	for (const ModelInstance& mi : modelInstances) {
+		SceneFile::Instance instance;
+		instance.position = glm::vec3(mi.getX(), mi.getY(), mi.getZ());
+		instance.rotation = mi.getRotation();
+		instance.scale = mi.getScale();
+		instance.parent = mi.getParent();
+		const Model* model = mi.getModel();
+		if (model) {
+			auto it = models.emplace(model->getName(), (uint32_t)data.modelNames.size());
+			if (it.second)
+				data.modelNames.push_back(model->getName());
+			instance.model = it.first->second;
+		}
+		data.parsedInstances.push_back(instance);
+	}
+	data.setParsed();
+}
+
 // Return reference to modelInstances vector.
 std::vector<ModelInstance>& ModelInstancesManager::getModelInstances() {
 	return modelInstances;
+}
+
+const std::vector<ModelInstance>& ModelInstancesManager::getModelInstances() const {
+	return modelInstances;
+}
+
+// Adding and removing change indices, so the bvh is built again on the next update.
+void ModelInstancesManager::addModelInstance(const ModelInstance& mi) {
+	acquireAssetModel(mi.getModelHandle());
+	modelInstances.push_back(mi);
+	sortHierarchy();
+	bvhStructureDirty = true;
+	orderVersion++;
+}
+
+void ModelInstancesManager::removeModelInstance(int index) {
+	if (index < 0 || (size_t)index >= modelInstances.size())
+		return;
+	int removedParent = modelInstances[index].getParent();
+	for (auto& mi : modelInstances) {
+		int p = mi.getParent();
+		if (p == index)
+			mi.setParent(removedParent);
+		else if (p > index)
+			mi.setParent(p - 1);
+	}
+	releaseAssetModel(modelInstances[index].getModelHandle());
+	modelInstances.erase(modelInstances.begin() + index);
+	sortHierarchy();
+	bvhStructureDirty = true;
+	orderVersion++;
+}
+
+void ModelInstancesManager::setModel(int index, ModelHandle model) {
+	if (index < 0 || (size_t)index >= modelInstances.size())
+		return;
+	// New reference first, the old one may be the last of the same model.
+	acquireAssetModel(model);
+	releaseAssetModel(modelInstances[index].getModelHandle());
+	modelInstances[index].setModel(model);
+	instanceModelsVersion++;
+}
+
+int ModelInstancesManager::setParent(int index, int parent) {
+	if (index < 0 || (size_t)index >= modelInstances.size() || parent >= (int)modelInstances.size())
+		return index;
+	if (parent == index || (parent >= 0 && isDescendant(parent, index)))
+		return index;
+	modelInstances[index].setParent(parent < 0 ? -1 : parent);
+	std::vector<int> remap;
+	sortHierarchy(&remap);
+	bvhStructureDirty = true;
+	orderVersion++;
+	return remap[index];
+}
+
+bool ModelInstancesManager::isDescendant(int index, int ancestor) const {
+	// Bounded walk, in case parents were not sorted yet and form a cycle.
+	int p = modelInstances[index].getParent();
+	for (size_t steps = 0; p >= 0 && steps < modelInstances.size(); ++steps) {
+		if (p == ancestor)
+			return true;
+		p = modelInstances[p].getParent();
+	}
+	return false;
+}
+
+void ModelInstancesManager::sortHierarchy(std::vector<int>* remap) {
+	int count = (int)modelInstances.size();
+	std::vector<std::vector<int>> children(count);
+	std::vector<int> order;
+	std::vector<unsigned char> placed(count, 0);
+	order.reserve(count);
+	// Roots first, in their current order. Invalid parents become roots.
+	for (int i = 0; i < count; ++i) {
+		int p = modelInstances[i].getParent();
+		if (p < 0 || p >= count || p == i) {
+			modelInstances[i].setParent(-1);
+			order.push_back(i);
+			placed[i] = 1;
+		}
+		else
+			children[p].push_back(i);
+	}
+	// Then children level by level, siblings end up next to each other.
+	// Instances in a parent cycle are never reached, the first one left becomes a root.
+	size_t head = 0;
+	int next = 0;
+	while (order.size() < (size_t)count) {
+		if (head == order.size()) {
+			while (placed[next])
+				++next;
+			std::cout << "Model instance " << next << " is in a parent cycle, it is now a root." << std::endl;
+			modelInstances[next].setParent(-1);
+			order.push_back(next);
+			placed[next] = 1;
+		}
+		for (int c : children[order[head++]]) {
+			if (!placed[c]) {
+				placed[c] = 1;
+				order.push_back(c);
+			}
+		}
+	}
+
+	std::vector<int> newIndex(count);
+	for (int i = 0; i < count; ++i)
+		newIndex[order[i]] = i;
+	if (remap)
+		*remap = newIndex;
+	bool identity = true;
+	for (int i = 0; i < count && identity; ++i)
+		identity = order[i] == i;
+	if (identity)
+		return;
+	std::vector<ModelInstance> sorted;
+	sorted.reserve(count);
+	for (int i : order) {
+		sorted.push_back(modelInstances[i]);
+		int p = sorted.back().getParent();
+		sorted.back().setParent(p >= 0 ? newIndex[p] : -1);
+	}
+	modelInstances = std::move(sorted);
+}
+
+void ModelInstancesManager::update() {
+	// Instances added or removed, indices changed so everything is built again.
+	// Hot reloaded models can have other bounds, it's rare enough to build everything too.
+	if (modelsVersion != getAssetModelsVersion())
+		instanceModelsVersion++;
+	if (bvhStructureDirty || modelsVersion != getAssetModelsVersion()) {
+		rebuildAll();
+		return;
+	}
+
+	// Copy changed transforms in the cache, matrices are recomputed for them and their descendants.
+	for (unsigned int i = 0; i < modelInstances.size(); ++i) {
+		ModelInstance& mi = modelInstances[i];
+		if (!mi.hasChanged())
+			continue;
+		mi.clearChanged();
+		transforms.setTransform(i, glm::vec3(mi.getX(), mi.getY(), mi.getZ()), mi.getRotation(), mi.getScale());
+	}
+	transforms.update();
+	const std::vector<unsigned int>& changedInstances = transforms.getUpdatedList();
+	if (!changedInstances.empty())
+		transformsVersion++;
+
+	// Swap in the background rebuild, replaying what moved while it was running.
+	if (rebuildJob.valid() && rebuildJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		rebuildJob.get();
+		bvh = std::move(*rebuiltBvh);
+		rebuiltBvh.reset();
+		rebuildJob = std::shared_future<void>();
+		for (unsigned int i : changedDuringRebuild)
+			bvh.update(i, computeWorldBounds(i));
+		changedDuringRebuild.clear();
+	}
+
+	for (unsigned int i : changedInstances) {
+		// Instances without a model aren't in the tree, getting one needs a rebuild.
+		if (!bvh.update(i, computeWorldBounds(i))) {
+			rebuildAll();
+			return;
+		}
+		if (rebuildJob.valid())
+			changedDuringRebuild.push_back(i);
+	}
+	bvh.refit();
+
+	if (!rebuildJob.valid() && bvh.getQuality() > BVH_REBUILD_QUALITY) {
+		auto boxes = std::make_shared<std::vector<BoundingBox>>();
+		for (unsigned int i = 0; i < modelInstances.size(); ++i)
+			boxes->push_back(computeWorldBounds(i));
+		rebuiltBvh = std::make_shared<Bvh>();
+		std::shared_ptr<Bvh> target = rebuiltBvh;
+		rebuildJob = JobSystem::submit([target, boxes]() { target->build(*boxes); }).share();
+	}
+}
+
+// Synchronous rebuild of transforms and bvh, used at load and when instances are added or removed.
+void ModelInstancesManager::rebuildAll() {
+	waitForRebuild();
+	std::vector<int> parents;
+	for (const auto& mi : modelInstances)
+		parents.push_back(mi.getParent());
+	transforms.setHierarchy(parents);
+	for (unsigned int i = 0; i < modelInstances.size(); ++i) {
+		ModelInstance& mi = modelInstances[i];
+		mi.clearChanged();
+		transforms.setTransform(i, glm::vec3(mi.getX(), mi.getY(), mi.getZ()), mi.getRotation(), mi.getScale());
+	}
+	transforms.update();
+
+	std::vector<BoundingBox> boxes;
+	boxes.reserve(modelInstances.size());
+	for (unsigned int i = 0; i < modelInstances.size(); ++i)
+		boxes.push_back(computeWorldBounds(i));
+	bvh.build(boxes);
+	bvhStructureDirty = false;
+	modelsVersion = getAssetModelsVersion();
+}
+
+BoundingBox ModelInstancesManager::computeWorldBounds(unsigned int index) const {
+	const Model* model = modelInstances[index].getModel();
+	if (model == nullptr)
+		return BoundingBox();
+	return model->getBounds().transformed(transforms.getWorldMatrix(index));
+}
+
+// Throw away a running background rebuild.
+void ModelInstancesManager::waitForRebuild() {
+	if (rebuildJob.valid())
+		rebuildJob.get();
+	rebuildJob = std::shared_future<void>();
+	rebuiltBvh.reset();
+	changedDuringRebuild.clear();
+}
+
+const Bvh& ModelInstancesManager::getBvh() const {
+	return bvh;
+}
+
+const TransformCache& ModelInstancesManager::getTransforms() const {
+	return transforms;
+}
+
+int ModelInstancesManager::pick(const glm::vec3& origin, const glm::vec3& dir) {
+	update();
+	float t;
+	return bvh.raycast(origin, dir, t, [&](unsigned int item, float& hitT) {
+		const ModelInstance& mi = modelInstances[item];
+		// The ray is moved to model space with a non normalized direction, so distances stay the same.
+		glm::mat4 inverse = glm::inverse(transforms.getWorldMatrix(item));
+		glm::vec3 o = glm::vec3(inverse * glm::vec4(origin, 1.0f)), d = glm::vec3(inverse * glm::vec4(dir, 0.0f));
+		float closest = std::numeric_limits<float>::max();
+		for (const auto& mesh : mi.getModel()->getMeshes()) {
+			// No cpu data, the box is the best we have.
+			if (mesh.vertices.empty()) {
+				closest = std::min(closest, hitT);
+				continue;
+			}
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+				float triangleT;
+				if (rayTriangle(o, d, mesh.vertices[mesh.indices[i]].Position, mesh.vertices[mesh.indices[i + 1]].Position,
+					mesh.vertices[mesh.indices[i + 2]].Position, triangleT) && triangleT < closest)
+					closest = triangleT;
+			}
+		}
+		if (closest == std::numeric_limits<float>::max())
+			return false;
+		hitT = closest;
+		return true;
+	});
+}
+
+// Moller-Trumbore, both faces.
+static bool rayTriangle(const glm::vec3& o, const glm::vec3& d, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t) {
+	glm::vec3 e1 = b - a, e2 = c - a;
+	glm::vec3 p = glm::cross(d, e2);
+	float det = glm::dot(e1, p);
+	if (std::abs(det) < 1e-12f)
+		return false;
+	float invDet = 1.0f / det;
+	glm::vec3 s = o - a;
+	float u = glm::dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+	glm::vec3 q = glm::cross(s, e1);
+	float v = glm::dot(d, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+	t = glm::dot(e2, q) * invDet;
+	return t >= 0.0f;
 }
\ No newline at end of file
@@ -0,0 +1,576 @@
+#include "Pvs.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "renderer/culling/DepthRasterizer.h"
+#include "jobs/JobSystem.h"
+#include "vfs/Vfs.h"
+
+using json = nlohmann::json;
+
+// World space positions of a mesh, baked once so every view only multiplies by view projection.
+struct BakeMesh {
+	std::vector<glm::vec3> positions;
+	const std::vector<unsigned int>* indices;
+	BoundingBox bounds;
+	unsigned int bit;
+};
+
+static const unsigned int PVS_MAGIC = 0x53565047; // "GPVS"
+static const unsigned int PVS_VERSION = 1;
+// Cube face resolution used while baking.
+static const int BAKE_FACE_SIZE = 128;
+static const int MAX_GRID_SIDE = 64;
+static const size_t MAX_VOXELS = 1 << 22;
+static const unsigned char VOXEL_FREE = 0, VOXEL_SOLID = 1, VOXEL_ENCLOSED = 2;
+
+static bool triangleIntersectsBox(const glm::vec3& center, const glm::vec3& half, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+static bool boxInFrustum(const BoundingBox& box, const glm::mat4& viewProj);
+static bool loadAuthoredCells(const std::string& cellsFile, Pvs::Data& out);
+
+bool Pvs::bake(const std::vector<ModelInstance>& instances, const TransformCache& transforms,
+	const std::string& cellsFile, const BakeSettings& settings, Data& out) {
+	auto start = std::chrono::high_resolution_clock::now();
+	out = Data();
+
+	// Collect world space geometry and the bit layout.
+	std::vector<BakeMesh> meshes;
+	std::vector<BoundingBox> instanceBounds;
+	BoundingBox sceneBounds;
+	out.instanceCount = (unsigned int)instances.size();
+	unsigned int meshBit = out.instanceCount;
+	for (unsigned int i = 0; i < instances.size(); ++i) {
+		const ModelInstance& mi = instances[i];
+		const Model* model = mi.isDrawable() ? mi.getModel() : nullptr;
+		unsigned int count = model ? (unsigned int)model->getMeshes().size() : 0;
+		out.instanceMeshCounts.push_back(count);
+		const glm::mat4& matrix = transforms.getWorldMatrix(i);
+		instanceBounds.push_back(model ? model->getBounds().transformed(matrix) : BoundingBox());
+		sceneBounds.expand(instanceBounds.back());
+		if (!model)
+			continue;
+		for (const auto& mesh : model->getMeshes()) {
+			BakeMesh bm;
+			bm.indices = &mesh.indices;
+			bm.bounds = mesh.getBounds().transformed(matrix);
+			bm.bit = meshBit++;
+			bm.positions.reserve(mesh.vertices.size());
+			for (const auto& v : mesh.vertices)
+				bm.positions.push_back(glm::vec3(matrix * glm::vec4(v.Position, 1.0f)));
+			meshes.push_back(std::move(bm));
+		}
+	}
+	out.meshCount = meshBit - out.instanceCount;
+	if (!sceneBounds.isValid()) {
+		std::cout << "PVS bake: scene is empty." << std::endl;
+		return false;
+	}
+
+	// Cells, either authored or one per grid cell.
+	bool authored = loadAuthoredCells(cellsFile, out);
+	glm::ivec3 cellGrid(0);
+	if (!authored) {
+		float cellSize = std::max(settings.cellSize, 0.01f);
+		glm::vec3 extent = sceneBounds.getExtent();
+		cellGrid = glm::clamp(glm::ivec3(glm::ceil(extent / cellSize)), glm::ivec3(1), glm::ivec3(MAX_GRID_SIDE));
+		// If the scene is too big for the grid cells get bigger.
+		cellSize = std::max(cellSize, std::max(extent.x / cellGrid.x, std::max(extent.y / cellGrid.y, extent.z / cellGrid.z)));
+		out.gridOrigin = sceneBounds.min;
+		out.voxelSize = cellSize;
+		out.gridSize = cellGrid;
+		for (int z = 0; z < cellGrid.z; ++z)
+			for (int y = 0; y < cellGrid.y; ++y)
+				for (int x = 0; x < cellGrid.x; ++x) {
+					Cell c;
+					c.bounds = BoundingBox(out.gridOrigin + glm::vec3(x, y, z) * cellSize, out.gridOrigin + glm::vec3(x + 1, y + 1, z + 1) * cellSize);
+					c.hasSamples = false;
+					out.cells.push_back(c);
+					out.lookup.push_back((int)out.lookup.size());
+				}
+	}
+	else {
+		// Lookup grid over the authored cells.
+		BoundingBox cellsBounds;
+		for (const auto& c : out.cells)
+			cellsBounds.expand(c.bounds);
+		out.voxelSize = std::max(settings.cellSize * 0.5f, 0.01f);
+		out.gridOrigin = cellsBounds.min;
+		out.gridSize = glm::clamp(glm::ivec3(glm::ceil(cellsBounds.getExtent() / out.voxelSize)), glm::ivec3(1), glm::ivec3(MAX_GRID_SIDE * 4));
+		out.lookup.assign(out.gridSize.x * out.gridSize.y * out.gridSize.z, -1);
+		for (int z = 0; z < out.gridSize.z; ++z)
+			for (int y = 0; y < out.gridSize.y; ++y)
+				for (int x = 0; x < out.gridSize.x; ++x) {
+					glm::vec3 p = out.gridOrigin + (glm::vec3(x, y, z) + 0.5f) * out.voxelSize;
+					for (size_t c = 0; c < out.cells.size(); ++c) {
+						const BoundingBox& b = out.cells[c].bounds;
+						if (glm::all(glm::greaterThanEqual(p, b.min)) && glm::all(glm::lessThanEqual(p, b.max))) {
+							out.lookup[(z * out.gridSize.y + y) * out.gridSize.x + x] = (int)c;
+							break;
+						}
+					}
+				}
+	}
+
+	// Voxelize the scene to find free space. Voxels touched by a triangle are solid
+	// and remember the average normal of their triangles.
+	int vpc = std::max(settings.voxelsPerCell, 1);
+	BoundingBox voxelBounds = authored ? BoundingBox(out.gridOrigin, out.gridOrigin + glm::vec3(out.gridSize) * out.voxelSize) : sceneBounds;
+	float voxelSize = out.voxelSize / vpc;
+	glm::ivec3 voxelGrid = glm::max(glm::ivec3(glm::ceil(voxelBounds.getExtent() / voxelSize)), glm::ivec3(1));
+	// Keep memory bounded on huge scenes by making voxels bigger.
+	while ((size_t)voxelGrid.x * voxelGrid.y * voxelGrid.z > MAX_VOXELS) {
+		voxelSize *= 1.25f;
+		voxelGrid = glm::max(glm::ivec3(glm::ceil(voxelBounds.getExtent() / voxelSize)), glm::ivec3(1));
+	}
+	size_t voxelCount = (size_t)voxelGrid.x * voxelGrid.y * voxelGrid.z;
+	std::unique_ptr<std::atomic<int>[]> normals(new std::atomic<int>[voxelCount * 3]);
+	for (size_t i = 0; i < voxelCount * 3; ++i)
+		normals[i].store(0, std::memory_order_relaxed);
+	std::unique_ptr<std::atomic<unsigned char>[]> solid(new std::atomic<unsigned char>[voxelCount]);
+	for (size_t i = 0; i < voxelCount; ++i)
+		solid[i].store(0, std::memory_order_relaxed);
+	auto voxelIndex = [&](int x, int y, int z) { return ((size_t)z * voxelGrid.y + y) * voxelGrid.x + x; };
+
+	JobSystem::parallelFor((unsigned int)meshes.size(), 1, [&](unsigned int begin, unsigned int end) {
+		glm::vec3 half(voxelSize * 0.5f);
+		for (unsigned int m = begin; m < end; ++m) {
+			const BakeMesh& bm = meshes[m];
+			const std::vector<unsigned int>& ind = *bm.indices;
+			for (size_t t = 0; t + 2 < ind.size(); t += 3) {
+				const glm::vec3& a = bm.positions[ind[t]], & b = bm.positions[ind[t + 1]], & c = bm.positions[ind[t + 2]];
+				glm::vec3 n = glm::cross(b - a, c - a);
+				if (glm::dot(n, n) < 1e-20f)
+					continue;
+				glm::ivec3 q = glm::ivec3(glm::normalize(n) * 256.0f);
+				glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor((glm::min(a, glm::min(b, c)) - voxelBounds.min) / voxelSize)), glm::ivec3(0), voxelGrid - 1);
+				glm::ivec3 hi = glm::clamp(glm::ivec3(glm::floor((glm::max(a, glm::max(b, c)) - voxelBounds.min) / voxelSize)), glm::ivec3(0), voxelGrid - 1);
+				for (int z = lo.z; z <= hi.z; ++z)
+					for (int y = lo.y; y <= hi.y; ++y)
+						for (int x = lo.x; x <= hi.x; ++x) {
+							glm::vec3 center = voxelBounds.min + (glm::vec3(x, y, z) + 0.5f) * voxelSize;
+							if (!triangleIntersectsBox(center, half, a, b, c))
+								continue;
+							size_t vi = voxelIndex(x, y, z);
+							normals[vi * 3].fetch_add(q.x, std::memory_order_relaxed);
+							normals[vi * 3 + 1].fetch_add(q.y, std::memory_order_relaxed);
+							normals[vi * 3 + 2].fetch_add(q.z, std::memory_order_relaxed);
+							solid[vi].store(1, std::memory_order_relaxed);
+						}
+			}
+		}
+	});
+
+	// Free voxels inside closed geometry (thick walls, pillars) would make useless samples.
+	// Each connected region of free voxels looks at the solid voxels around it,
+	// if it mostly sees back faces it is inside something.
+	std::vector<unsigned char> voxels(voxelCount);
+	for (size_t i = 0; i < voxelCount; ++i)
+		voxels[i] = solid[i].load(std::memory_order_relaxed) ? VOXEL_SOLID : VOXEL_FREE;
+	solid.reset();
+	{
+		const glm::ivec3 steps[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+		std::vector<unsigned char> visited(voxelCount, 0);
+		std::vector<glm::ivec3> stack, region;
+		for (int z = 0; z < voxelGrid.z; ++z)
+			for (int y = 0; y < voxelGrid.y; ++y)
+				for (int x = 0; x < voxelGrid.x; ++x) {
+					size_t start = voxelIndex(x, y, z);
+					if (voxels[start] != VOXEL_FREE || visited[start])
+						continue;
+					long long front = 0, back = 0;
+					region.clear();
+					stack.push_back(glm::ivec3(x, y, z));
+					visited[start] = 1;
+					while (!stack.empty()) {
+						glm::ivec3 v = stack.back();
+						stack.pop_back();
+						region.push_back(v);
+						for (const auto& s : steps) {
+							glm::ivec3 o = v + s;
+							if (glm::any(glm::lessThan(o, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(o, voxelGrid)))
+								continue;
+							size_t oi = voxelIndex(o.x, o.y, o.z);
+							if (voxels[oi] == VOXEL_SOLID) {
+								// Direction from the solid voxel towards the free one.
+								int d = -(normals[oi * 3].load() * s.x + normals[oi * 3 + 1].load() * s.y + normals[oi * 3 + 2].load() * s.z);
+								(d > 0 ? front : back) += std::abs(d);
+							}
+							else if (!visited[oi]) {
+								visited[oi] = 1;
+								stack.push_back(o);
+							}
+						}
+					}
+					if (back > front)
+						for (const auto& v : region)
+							voxels[voxelIndex(v.x, v.y, v.z)] = VOXEL_ENCLOSED;
+				}
+	}
+
+	// Sample points are centers of free voxels inside each cell.
+	std::vector<std::vector<glm::vec3>> samples(out.cells.size());
+	for (size_t c = 0; c < out.cells.size(); ++c) {
+		const BoundingBox& b = out.cells[c].bounds;
+		glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor((b.min - voxelBounds.min) / voxelSize)), glm::ivec3(0), voxelGrid - 1);
+		glm::ivec3 hi = glm::clamp(glm::ivec3(glm::ceil((b.max - voxelBounds.min) / voxelSize)) - 1, glm::ivec3(0), voxelGrid - 1);
+		std::vector<glm::vec3> freeVoxels;
+		for (int z = lo.z; z <= hi.z; ++z)
+			for (int y = lo.y; y <= hi.y; ++y)
+				for (int x = lo.x; x <= hi.x; ++x)
+					if (voxels[voxelIndex(x, y, z)] == VOXEL_FREE)
+						freeVoxels.push_back(voxelBounds.min + (glm::vec3(x, y, z) + 0.5f) * voxelSize);
+		// Spread samples evenly over the free voxels.
+		size_t wanted = (size_t)std::max(settings.samplesPerCell, 1);
+		float step = freeVoxels.size() > wanted ? (float)freeVoxels.size() / wanted : 1.0f;
+		for (float f = 0.0f; f < freeVoxels.size() && samples[c].size() < wanted; f += step)
+			samples[c].push_back(freeVoxels[(size_t)f]);
+		out.cells[c].hasSamples = !samples[c].empty();
+	}
+
+	// Auto portals connect neighbouring cells with free voxels on both sides of the shared face.
+	if (!authored) {
+		auto cellIndex = [&](int x, int y, int z) { return (z * cellGrid.y + y) * cellGrid.x + x; };
+		// Voxels may have been made bigger, so cell borders are not always a multiple of voxelsPerCell.
+		const float ratio = out.voxelSize / voxelSize;
+		auto toVoxel = [&](int cellCoordinate) { return (int)std::lround(cellCoordinate * ratio); };
+		for (int z = 0; z < cellGrid.z; ++z)
+			for (int y = 0; y < cellGrid.y; ++y)
+				for (int x = 0; x < cellGrid.x; ++x) {
+					glm::ivec3 cell(x, y, z);
+					for (int axis = 0; axis < 3; ++axis) {
+						glm::ivec3 other = cell;
+						other[axis]++;
+						if (other[axis] >= cellGrid[axis])
+							continue;
+						// Voxel layers on the two sides of the face.
+						int layer = toVoxel(other[axis]);
+						if (layer <= 0 || layer >= voxelGrid[axis])
+							continue;
+						bool open = false;
+						int u = (axis + 1) % 3, v = (axis + 2) % 3;
+						for (int i = toVoxel(cell[u]); i < std::min(toVoxel(cell[u] + 1), voxelGrid[u]) && !open; ++i)
+							for (int j = toVoxel(cell[v]); j < std::min(toVoxel(cell[v] + 1), voxelGrid[v]) && !open; ++j) {
+								glm::ivec3 a, b;
+								a[axis] = layer - 1; b[axis] = layer;
+								a[u] = b[u] = i;
+								a[v] = b[v] = j;
+								open = voxels[voxelIndex(a.x, a.y, a.z)] == VOXEL_FREE && voxels[voxelIndex(b.x, b.y, b.z)] == VOXEL_FREE;
+							}
+						if (open)
+							out.portals.push_back(glm::ivec2(cellIndex(x, y, z), cellIndex(other.x, other.y, other.z)));
+					}
+				}
+	}
+
+	// Render every sample as a cube with the cpu rasterizer and collect what is visible.
+	const unsigned int bitCount = out.instanceCount + out.meshCount;
+	std::vector<std::vector<unsigned char>> cellBits(out.cells.size());
+	const float farPlane = glm::length(sceneBounds.getExtent()) * 2.0f + 1.0f;
+	const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, farPlane);
+	const glm::vec3 directions[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+	const glm::vec3 ups[6] = { {0, 1, 0}, {0, 1, 0}, {0, 0, 1}, {0, 0, 1}, {0, 1, 0}, {0, 1, 0} };
+	std::atomic<unsigned int> cellsDone(0);
+
+	JobSystem::parallelFor((unsigned int)out.cells.size(), 1, [&](unsigned int begin, unsigned int end) {
+		DepthRasterizer rasterizer(BAKE_FACE_SIZE, BAKE_FACE_SIZE);
+		std::vector<ScreenTriangle> tris;
+		for (unsigned int c = begin; c < end; ++c) {
+			std::vector<unsigned char>& bits = cellBits[c];
+			bits.assign(bitCount, 0);
+			// Meshes without cpu geometry can't be tested, keep them always visible.
+			for (const auto& bm : meshes)
+				if (bm.positions.empty())
+					bits[bm.bit] = 1;
+
+			for (const auto& s : samples[c]) {
+				for (int d = 0; d < 6; ++d) {
+					glm::mat4 viewProj = projection * glm::lookAt(s, s + directions[d], ups[d]);
+					rasterizer.clear(viewProj);
+					for (const auto& bm : meshes) {
+						if (bm.positions.empty() || !boxInFrustum(bm.bounds, viewProj))
+							continue;
+						tris.clear();
+						rasterizer.setupTriangles(bm.positions.data(), sizeof(glm::vec3), (unsigned int)bm.positions.size(),
+							bm.indices->data(), (unsigned int)bm.indices->size(), glm::mat4(1.0f), tris);
+						rasterizer.binTriangles(tris);
+					}
+					rasterizer.rasterize();
+					for (unsigned int i = 0; i < out.instanceCount; ++i)
+						if (!bits[i] && rasterizer.isBoxVisible(instanceBounds[i]))
+							bits[i] = 1;
+					for (const auto& bm : meshes)
+						if (!bits[bm.bit] && rasterizer.isBoxVisible(bm.bounds))
+							bits[bm.bit] = 1;
+				}
+			}
+			unsigned int done = ++cellsDone;
+			if (done % 16 == 0)
+				std::cout << "PVS bake: " << done << "/" << out.cells.size() << " cells" << std::endl;
+		}
+	});
+
+	// Dilate through portals so walking into a neighbour cell never shows missing geometry.
+	std::vector<std::vector<unsigned char>> dilated = cellBits;
+	for (const auto& p : out.portals) {
+		for (unsigned int b = 0; b < bitCount; ++b) {
+			dilated[p.x][b] |= cellBits[p.y][b];
+			dilated[p.y][b] |= cellBits[p.x][b];
+		}
+	}
+	for (size_t c = 0; c < out.cells.size(); ++c)
+		compress(dilated[c], out.cells[c].compressedBits);
+
+	float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "PVS bake: " << out.cells.size() << " cells, " << out.portals.size() << " portals in " << seconds << " s." << std::endl;
+	return true;
+}
+
+// Authored cells file looks like this:
+// { "cells": [ { "min": [x, y, z], "max": [x, y, z] }, ... ], "portals": [ [0, 1], ... ] }
+static bool loadAuthoredCells(const std::string& cellsFile, Pvs::Data& out) {
+	Vfs::File f = Vfs::open(cellsFile);
+	if (!f.isOpen())
+		return false;
+	try {
+		json data = json::parse(f.getData(), f.getData() + f.getSize());
+		for (const auto& c : data["cells"]) {
+			Pvs::Cell cell;
+			cell.bounds = BoundingBox(glm::vec3(c["min"][0], c["min"][1], c["min"][2]), glm::vec3(c["max"][0], c["max"][1], c["max"][2]));
+			cell.hasSamples = false;
+			out.cells.push_back(cell);
+		}
+		if (data.contains("portals"))
+			for (const auto& p : data["portals"])
+				out.portals.push_back(glm::ivec2(p[0], p[1]));
+	}
+	catch (...) {
+		std::cout << "Error while reading authored PVS cells." << std::endl;
+		out.cells.clear();
+		out.portals.clear();
+		return false;
+	}
+	return !out.cells.empty();
+}
+
+int Pvs::findCell(const Data& data, const glm::vec3& position) {
+	glm::ivec3 v = glm::ivec3(glm::floor((position - data.gridOrigin) / data.voxelSize));
+	if (glm::any(glm::lessThan(v, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(v, data.gridSize)))
+		return -1;
+	return data.lookup[(v.z * data.gridSize.y + v.y) * data.gridSize.x + v.x];
+}
+
+// Runs of equal bits, alternating and starting with zeros, stored as variable length integers.
+void Pvs::compress(const std::vector<unsigned char>& bits, std::vector<unsigned char>& out) {
+	out.clear();
+	unsigned char current = 0;
+	size_t i = 0;
+	while (i < bits.size()) {
+		unsigned int run = 0;
+		while (i < bits.size() && (bits[i] != 0) == (current != 0)) {
+			++run;
+			++i;
+		}
+		do {
+			unsigned char byte = run & 0x7F;
+			run >>= 7;
+			out.push_back(byte | (run ? 0x80 : 0));
+		} while (run);
+		current ^= 1;
+	}
+}
+
+void Pvs::decompress(const std::vector<unsigned char>& compressed, unsigned int bitCount, std::vector<unsigned char>& bits) {
+	bits.assign(bitCount, 0);
+	unsigned char current = 0;
+	unsigned int position = 0;
+	size_t i = 0;
+	while (i < compressed.size() && position < bitCount) {
+		unsigned int run = 0, shift = 0;
+		while (i < compressed.size()) {
+			unsigned char byte = compressed[i++];
+			run |= (byte & 0x7F) << shift;
+			shift += 7;
+			if (!(byte & 0x80))
+				break;
+		}
+		unsigned int end = std::min(position + run, bitCount);
+		if (current)
+			std::fill(bits.begin() + position, bits.begin() + end, 1);
+		position = end;
+		current ^= 1;
+	}
+}
+
+template<typename T>
+static void writeValue(std::ofstream& f, const T& v) {
+	f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<typename T>
+static void writeVector(std::ofstream& f, const std::vector<T>& v) {
+	writeValue(f, (unsigned int)v.size());
+	if (!v.empty())
+		f.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template<typename T>
+static bool readValue(std::istream& f, T& v) {
+	return (bool)f.read(reinterpret_cast<char*>(&v), sizeof(T));
+}
+
+// Bytes between the read position and the end of the stream.
+static size_t bytesLeft(std::istream& f) {
+	std::streampos position = f.tellg();
+	if (position < 0)
+		return 0;
+	f.seekg(0, std::ios::end);
+	std::streampos end = f.tellg();
+	f.seekg(position);
+	return end > position ? (size_t)(end - position) : 0;
+}
+
+// The size comes from the file, it can't ask for more elements than the bytes left.
+template<typename T>
+static bool readVector(std::istream& f, std::vector<T>& v) {
+	unsigned int size;
+	if (!readValue(f, size) || size > bytesLeft(f) / sizeof(T))
+		return false;
+	v.resize(size);
+	return size == 0 || (bool)f.read(reinterpret_cast<char*>(v.data()), size * sizeof(T));
+}
+
+bool Pvs::save(const std::string& path, const Data& data) {
+	std::ofstream f(path, std::ios::binary | std::ios::trunc);
+	if (!f) {
+		std::cout << "Error while saving PVS file." << std::endl;
+		return false;
+	}
+	writeValue(f, PVS_MAGIC);
+	writeValue(f, PVS_VERSION);
+	writeValue(f, data.instanceCount);
+	writeValue(f, data.meshCount);
+	writeVector(f, data.instanceMeshCounts);
+	writeValue(f, data.gridOrigin);
+	writeValue(f, data.voxelSize);
+	writeValue(f, data.gridSize);
+	writeVector(f, data.lookup);
+	writeVector(f, data.portals);
+	writeValue(f, (unsigned int)data.cells.size());
+	for (const auto& c : data.cells) {
+		writeValue(f, c.bounds.min);
+		writeValue(f, c.bounds.max);
+		writeValue(f, (unsigned char)c.hasSamples);
+		writeVector(f, c.compressedBits);
+	}
+	return (bool)f;
+}
+
+bool Pvs::load(const std::string& path, Data& data) {
+	Vfs::File file = Vfs::open(path);
+	if (!file.isOpen())
+		return false;
+	std::istringstream f(file.toString(), std::ios::binary);
+	unsigned int magic, version, cellCount;
+	if (!readValue(f, magic) || magic != PVS_MAGIC || !readValue(f, version) || version != PVS_VERSION)
+		return false;
+	data = Data();
+	bool ok = readValue(f, data.instanceCount) && readValue(f, data.meshCount) && readVector(f, data.instanceMeshCounts) &&
+		readValue(f, data.gridOrigin) && readValue(f, data.voxelSize) && readValue(f, data.gridSize) &&
+		readVector(f, data.lookup) && readVector(f, data.portals) && readValue(f, cellCount);
+	// Smallest cell on disk: bounds, hasSamples and an empty compressedBits.
+	const size_t minCellBytes = 2 * sizeof(glm::vec3) + sizeof(unsigned char) + sizeof(unsigned int);
+	ok = ok && cellCount <= bytesLeft(f) / minCellBytes;
+	if (ok)
+		data.cells.reserve(cellCount);
+	for (unsigned int i = 0; ok && i < cellCount; ++i) {
+		Cell c;
+		unsigned char hasSamples;
+		ok = readValue(f, c.bounds.min) && readValue(f, c.bounds.max) && readValue(f, hasSamples) && readVector(f, c.compressedBits);
+		c.hasSamples = hasSamples != 0;
+		data.cells.push_back(std::move(c));
+	}
+	// Indices are used without checks at runtime, so everything they point to must exist.
+	// The grid product is done in steps that can't overflow, findCell computes the index as int.
+	ok = ok && data.voxelSize > 0.0f && glm::all(glm::greaterThanEqual(data.gridSize, glm::ivec3(0))) &&
+		data.lookup.size() <= (size_t)std::numeric_limits<int>::max() &&
+		((uint64_t)data.gridSize.x * data.gridSize.y <= data.lookup.size() || data.gridSize.z == 0) &&
+		data.lookup.size() == (uint64_t)data.gridSize.x * data.gridSize.y * data.gridSize.z &&
+		data.instanceMeshCounts.size() == data.instanceCount;
+	for (size_t i = 0; ok && i < data.lookup.size(); ++i)
+		ok = data.lookup[i] == -1 || (data.lookup[i] >= 0 && (size_t)data.lookup[i] < data.cells.size());
+	for (size_t i = 0; ok && i < data.portals.size(); ++i)
+		ok = data.portals[i].x >= 0 && (size_t)data.portals[i].x < data.cells.size() &&
+			data.portals[i].y >= 0 && (size_t)data.portals[i].y < data.cells.size();
+	uint64_t meshSum = 0;
+	for (unsigned int count : data.instanceMeshCounts)
+		meshSum += count;
+	ok = ok && meshSum == data.meshCount;
+	if (!ok) {
+		std::cout << "PVS file is corrupted." << std::endl;
+		data = Data();
+		return false;
+	}
+	return true;
+}
+
+// Box against clip space, false only if all corners are outside the same plane.
+static bool boxInFrustum(const BoundingBox& box, const glm::mat4& viewProj) {
+	int outside[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 8; ++i) {
+		glm::vec4 c = viewProj * glm::vec4(box.getCorner(i), 1.0f);
+		outside[0] += c.x < -c.w;
+		outside[1] += c.x > c.w;
+		outside[2] += c.y < -c.w;
+		outside[3] += c.y > c.w;
+		outside[4] += c.z < -c.w;
+		outside[5] += c.z > c.w;
+	}
+	for (int i = 0; i < 6; ++i)
+		if (outside[i] == 8)
+			return false;
+	return true;
+}
+
+// Separating axis test between a triangle and a box (Akenine-Moller).
+static bool triangleIntersectsBox(const glm::vec3& center, const glm::vec3& half, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2) {
+	v0 -= center;
+	v1 -= center;
+	v2 -= center;
+	const glm::vec3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+
+	// Box face normals.
+	for (int k = 0; k < 3; ++k) {
+		if (std::min({ v0[k], v1[k], v2[k] }) > half[k] || std::max({ v0[k], v1[k], v2[k] }) < -half[k])
+			return false;
+	}
+
+	// Triangle normal.
+	glm::vec3 n = glm::cross(edges[0], edges[1]);
+	float r = glm::dot(half, glm::abs(n));
+	if (std::abs(glm::dot(n, v0)) > r)
+		return false;
+
+	// Cross products of edges and box axes.
+	for (int e = 0; e < 3; ++e) {
+		for (int k = 0; k < 3; ++k) {
+			glm::vec3 boxAxis(0.0f);
+			boxAxis[k] = 1.0f;
+			glm::vec3 axis = glm::cross(boxAxis, edges[e]);
+			if (glm::dot(axis, axis) < 1e-12f)
+				continue;
+			float p0 = glm::dot(v0, axis), p1 = glm::dot(v1, axis), p2 = glm::dot(v2, axis);
+			float rad = glm::dot(half, glm::abs(axis));
+			if (std::min({ p0, p1, p2 }) > rad || std::max({ p0, p1, p2 }) < -rad)
+				return false;
+		}
+	}
+	return true;
+}
\ No newline at end of file
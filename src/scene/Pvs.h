@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include "math/BoundingBox.h"
+#include "model/ModelInstance.h"
+#include "scene/TransformCache.h"
+
+// Potentially visible sets.
+// The scene is split in cells, each cell stores a compressed bitset of what can be seen from inside it.
+// Bits 0..instanceCount-1 are model instances, the following ones are meshes of each instance
+// in instance order (same layout used by occlusion culling).
+namespace Pvs {
+
+	struct Cell {
+		BoundingBox bounds;
+		// False if no sample point could be placed in the cell (all solid).
+		// Those cells see everything at runtime.
+		bool hasSamples;
+		std::vector<unsigned char> compressedBits;
+	};
+
+	struct Data {
+		// Used to check the baked data still matches the scene.
+		unsigned int instanceCount = 0, meshCount = 0;
+		std::vector<unsigned int> instanceMeshCounts;
+
+		// Lookup grid, maps a position to a cell index (-1 for none) in O(1).
+		glm::vec3 gridOrigin = glm::vec3(0.0f);
+		float voxelSize = 1.0f;
+		glm::ivec3 gridSize = glm::ivec3(0);
+		std::vector<int> lookup;
+
+		std::vector<Cell> cells;
+		// Pairs of cell indices connected by a portal.
+		std::vector<glm::ivec2> portals;
+	};
+
+	struct BakeSettings {
+		// Size of auto generated cells. Also used as lookup grid resolution for authored cells.
+		float cellSize = 4.0f;
+		// Voxels per cell side used to find free space for samples and portals.
+		int voxelsPerCell = 4;
+		// Maximum number of sample points per cell. Each sample renders 6 cube faces.
+		int samplesPerCell = 8;
+	};
+
+	// Bake visibility for the instances, placed with their cached world matrices.
+	// Cells are read from cellsFile (json) if it exists, otherwise they are derived from a voxelization of the scene.
+	bool bake(const std::vector<ModelInstance>& instances, const TransformCache& transforms,
+		const std::string& cellsFile, const BakeSettings& settings, Data& out);
+
+	bool save(const std::string& path, const Data& data);
+	bool load(const std::string& path, Data& data);
+
+	// Returns cell index containing position, -1 if none.
+	int findCell(const Data& data, const glm::vec3& position);
+
+	// Run length compression of a bitset stored as one byte per bit.
+	void compress(const std::vector<unsigned char>& bits, std::vector<unsigned char>& out);
+	void decompress(const std::vector<unsigned char>& compressed, unsigned int bitCount, std::vector<unsigned char>& bits);
+}
\ No newline at end of file
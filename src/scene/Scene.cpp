@@ -1,6 +1,7 @@
 #include "Scene.h"
 #include <filesystem>
 #include "ProjectDirectory.h"
+#include "vfs/Vfs.h"
 
 // Function used to load everything needed in the scene.
 // For example by reading a file, or simply creating every model instance by hand.
@@ -12,21 +13,26 @@ void Scene::initialize() {
 	// but with their respective .json files.
 	try {
 		std::filesystem::path folderPath(project_directory + "\\assets\\scenes\\" + sceneName);
-		if (!std::filesystem::exists(folderPath))
+		if (!Vfs::exists(folderPath.string()))
 			std::filesystem::create_directory(folderPath);
 	}
 	catch (...) {
 		std::cout << "Error while checking existence/creating scene directory." << std::endl;
 	}
 
-	modelInstancesManager.initialize();
-	lightsManager.initialize();
+	// Both managers read the same scene file, binary or json.
+	SceneFile::Data data;
+	SceneFile::load(sceneName, data);
+	modelInstancesManager.initialize(data);
+	lightsManager.initialize(data);
+	visibilityManager.initialize(modelInstancesManager);
 }
 
 // Terminate everything that needs to be terminated.
 // For example all models.
 // This function will call all terminate functions, if present, of all managers in the class.
 void Scene::terminate() {
+	visibilityManager.terminate();
 	modelInstancesManager.terminate();
 	lightsManager.terminate();
 }
@@ -37,4 +43,10 @@ void Scene::terminate() {
 void Scene::save() {
 	modelInstancesManager.save();
 	lightsManager.save();
+
+	// Binary copy of what was just saved, the next load uses it while the json files don't change.
+	SceneFile::Data data;
+	modelInstancesManager.writeSceneData(data);
+	lightsManager.writeSceneData(data);
+	SceneFile::save(sceneName, data);
 }
\ No newline at end of file
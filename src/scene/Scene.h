@@ -1,10 +1,16 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
+#include <future>
 #include "model/ModelInstance.h"
 #include "renderer/SunLight.h"
 #include "renderer/Light.h"
 #include "shader/Shader.h"
+#include "scene/Pvs.h"
+#include "math/Bvh.h"
+#include "scene/TransformCache.h"
+#include "scene/SceneFile.h"
 #ifndef MAX_LIGHTS
 #define MAX_LIGHTS 8
 #endif
@@ -13,13 +19,60 @@ class ModelInstancesManager {
 private:
 	std::vector<ModelInstance> modelInstances;
 	std::string sceneName;
+	// Cached world and normal matrices, entry i is modelInstances[i].
+	// modelInstances is kept in breadth first hierarchy order, so parents come before their children.
+	TransformCache transforms;
+	// Spatial index over instance world bounds, item i is modelInstances[i].
+	Bvh bvh;
+	bool bvhStructureDirty;
+	// getAssetModelsVersion when the bvh was built, a reloaded model can have other bounds.
+	unsigned int modelsVersion = 0;
+	// Changed when instances are reordered (added, removed, parented), when their models change and when they move.
+	unsigned int orderVersion = 0, instanceModelsVersion = 0, transformsVersion = 0;
+	// Background rebuild started when refits make the bvh too slow.
+	// Shared so that the manager stays copyable.
+	std::shared_ptr<Bvh> rebuiltBvh;
+	std::shared_future<void> rebuildJob;
+	std::vector<unsigned int> changedDuringRebuild;
+	void rebuildAll();
+	void waitForRebuild();
+	// Reorder instances breadth first, which is the order TransformCache needs.
+	// remap receives the new index of every old index.
+	void sortHierarchy(std::vector<int>* remap = nullptr);
+	BoundingBox computeWorldBounds(unsigned int index) const;
 public:
-	ModelInstancesManager(const std::string& name) : sceneName(name), modelInstances() { };
-	void initialize();
+	ModelInstancesManager(const std::string& name) : sceneName(name), modelInstances(), bvhStructureDirty(true) { };
+	void initialize(const SceneFile::Data&);
 	void terminate();
 	void save();
+	// Instances and their model names for the binary scene file.
+	void writeSceneData(SceneFile::Data&) const;
 	// Return a reference to the vector which contains all modelInstances.
+	// Transforms can be changed through it, adding, removing and changing models must use the functions below.
 	std::vector<ModelInstance>& getModelInstances();
+	const std::vector<ModelInstance>& getModelInstances() const;
+	// Data indexed by instance (baked visibility) compares these to know it's stale.
+	unsigned int getOrderVersion() const { return orderVersion; }
+	// Models set on instances, and asset models reloaded or deleted.
+	unsigned int getInstanceModelsVersion() const { return instanceModelsVersion; }
+	// Instances moved, rotated or scaled after they were placed (loading and reordering don't count).
+	unsigned int getTransformsVersion() const { return transformsVersion; }
+	void addModelInstance(const ModelInstance&);
+	// Children of the removed instance are moved to its parent.
+	void removeModelInstance(int index);
+	// Instances hold a reference to their model, so it's changed here.
+	void setModel(int index, ModelHandle model);
+	// Change the parent (-1 for none), refused if parent is index or one of its descendants.
+	// Instances are reordered, the new index of the instance is returned.
+	int setParent(int index, int parent);
+	bool isDescendant(int index, int ancestor) const;
+	// To be called every frame before using transforms or the bvh.
+	// Recomputes matrices of changed instances, refits the bvh with them and swaps in a rebuilt one when ready.
+	void update();
+	const Bvh& getBvh() const;
+	const TransformCache& getTransforms() const;
+	// Closest instance hit by the ray (triangle precise), -1 if none.
+	int pick(const glm::vec3& origin, const glm::vec3& dir);
 };
 
 class LightsManager {
@@ -30,32 +83,74 @@ private:
 	std::string sceneName;
 public:
 	LightsManager(const std::string& name) : sceneName(name), useSunLight(false) { };
-	void initialize();
+	void initialize(const SceneFile::Data&);
 	void terminate();
 	void save();
+	// Lights and sun light for the binary scene file.
+	void writeSceneData(SceneFile::Data&);
 	int getSize();
 	Light& getLight(int);
 	void addLight(Light);
 	void removeLight(int);
 	// To be called for each light every frame.
-	void updateLight(Shader&, int index);
+	void updateLight(int index);
 	std::vector<Light>& getLights();
 	// To be called every frame.
-	void updateSunLight(Shader&);
+	void updateSunLight();
 	SunLight& getSunLight();
 	bool getUseSunLight();
 	void setUseSunLight(bool);
 };
 
+// Baked potentially visible sets of the scene, stored in pvs.bin in the scene folder.
+// The bake is for static geometry, if instances, their meshes or their transforms change it is ignored until baked again.
+class VisibilityManager {
+private:
+	Pvs::Data data;
+	std::string sceneName;
+	bool hasData, valid, usePvs;
+	Pvs::BakeSettings bakeSettings;
+	// Decompressed bits of the cell the camera is in, only updated when the cell changes.
+	int currentCell;
+	std::vector<unsigned char> currentBits;
+	std::vector<unsigned int> meshOffsets;
+	// Versions of the instances the data was checked against.
+	unsigned int orderVersion, instanceModelsVersion, transformsVersion;
+	bool checkValidity(const std::vector<ModelInstance>&);
+	void validate(const ModelInstancesManager&);
+	void setData();
+public:
+	VisibilityManager(const std::string& name) : sceneName(name), hasData(false), valid(false), usePvs(true), currentCell(-1),
+		orderVersion(0), instanceModelsVersion(0), transformsVersion(0) { };
+	void initialize(const ModelInstancesManager&);
+	void terminate();
+	// Bake, save and use the new data. Instances must be updated (transforms).
+	bool bake(const ModelInstancesManager&);
+	// To be called every frame before using visibility, after the instances are updated.
+	// Reordered or moved instances make the data unusable until baked again, changed models are checked again.
+	void update(const glm::vec3& cameraPosition, const ModelInstancesManager&);
+	// Both return true if there is no usable data or the camera is outside every cell.
+	bool isInstanceVisible(unsigned int instance);
+	bool isMeshVisible(unsigned int instance, unsigned int mesh);
+	bool getUsePvs();
+	void setUsePvs(bool);
+	Pvs::BakeSettings& getBakeSettings();
+	bool isValid();
+	int getCurrentCell();
+	int getCellCount();
+	int getPortalCount();
+};
+
 class Scene {
 private:
 	ModelInstancesManager modelInstancesManager;
 	LightsManager lightsManager;
+	VisibilityManager visibilityManager;
 	std::string sceneName;
 public:
-	Scene(const std::string& name) : sceneName(name), modelInstancesManager(name), lightsManager(name) { };
-	Scene(const Scene& s) : sceneName(s.sceneName), modelInstancesManager(s.sceneName), lightsManager(s.sceneName) { };
-	Scene() : sceneName(""), modelInstancesManager(""), lightsManager("") { };
+	Scene(const std::string& name) : sceneName(name), modelInstancesManager(name), lightsManager(name), visibilityManager(name) { };
+	Scene(const Scene& s) : sceneName(s.sceneName), modelInstancesManager(s.sceneName), lightsManager(s.sceneName), visibilityManager(s.sceneName) { };
+	Scene() : sceneName(""), modelInstancesManager(""), lightsManager(""), visibilityManager("") { };
 
 	// Load everything needed by reading scene file with name stored in the class.
 	// This function will call all initialize functions, if present, of all managers in the class.
@@ -70,4 +165,5 @@ public:
 
 	ModelInstancesManager& getModelInstancesManager() { return modelInstancesManager; }
 	LightsManager& getLightsManager() { return lightsManager; }
+	VisibilityManager& getVisibilityManager() { return visibilityManager; }
 };
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "SceneFile.h"
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+#include "ProjectDirectory.h"
+
+using json = nlohmann::json;
+
+static const uint32_t MAGIC = 0x4E435347, VERSION = 1;
+
+// Start of the binary file. The arrays follow without padding: instances, lights, modelCount + 1 offsets
+// of the model names (uint32) and the name characters.
+struct Header {
+	uint32_t magic, version;
+	// Json files it was made from, as Vfs::stat gives them. A json file that doesn't exist isn't checked.
+	uint64_t instancesSize, lightsSize;
+	int64_t instancesTime, lightsTime;
+	uint32_t instanceCount, lightCount, modelCount, nameBytes;
+	SceneFile::Sun sun;
+};
+
+static_assert(std::is_trivially_copyable<SceneFile::Instance>::value && std::is_trivially_copyable<SceneFile::Light>::value &&
+	std::is_trivially_copyable<Header>::value, "Scene arrays are saved as they are in memory");
+static_assert(sizeof(SceneFile::Instance) == 44 && sizeof(SceneFile::Light) == 60 && sizeof(Header) % 4 == 0,
+	"Scene arrays must have no padding");
+
+namespace {
+	// Sax handler that knows where the current value is: the key of every object and the index of every array above it.
+	// Values are written in place as they are read, nothing else of the json files is kept.
+	class SceneSax : public json::json_sax_t {
+	protected:
+		struct Level {
+			bool array;
+			uint32_t index;
+			std::string key;
+		};
+		std::vector<Level> levels;
+		bool isKey(size_t depth, const char* key) const {
+			return levels.size() > depth && !levels[depth].array && levels[depth].key == key;
+		}
+		bool isArray(size_t depth) const {
+			return levels.size() > depth && levels[depth].array;
+		}
+		// Numbers and booleans, and strings.
+		virtual void onNumber(double value) = 0;
+		virtual void onString(const std::string&) { }
+		// Before the object is entered, levels are the ones of its parent.
+		virtual void onObject() { }
+	private:
+		// Array elements are counted as they end.
+		bool next() {
+			if (!levels.empty() && levels.back().array)
+				levels.back().index++;
+			return true;
+		}
+	public:
+		std::string error;
+		bool null() override { return next(); }
+		bool boolean(bool value) override { onNumber(value ? 1.0 : 0.0); return next(); }
+		bool number_integer(number_integer_t value) override { onNumber((double)value); return next(); }
+		bool number_unsigned(number_unsigned_t value) override { onNumber((double)value); return next(); }
+		bool number_float(number_float_t value, const string_t&) override { onNumber(value); return next(); }
+		bool string(string_t& value) override { onString(value); return next(); }
+		bool binary(binary_t&) override { return next(); }
+		bool start_object(std::size_t) override {
+			onObject();
+			levels.push_back({ false, 0, "" });
+			return true;
+		}
+		bool key(string_t& key) override {
+			levels.back().key = key;
+			return true;
+		}
+		bool end_object() override {
+			levels.pop_back();
+			return next();
+		}
+		bool start_array(std::size_t) override {
+			levels.push_back({ true, 0, "" });
+			return true;
+		}
+		bool end_array() override {
+			levels.pop_back();
+			return next();
+		}
+		bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+			error = e.what();
+			return false;
+		}
+	};
+
+	template<typename T>
+	glm::vec3* findVector(T& light, const std::string& field) {
+		if (field == "position")
+			return &light.position;
+		if (field == "ambient")
+			return &light.ambient;
+		if (field == "diffuse")
+			return &light.diffuse;
+		if (field == "specular")
+			return &light.specular;
+		return nullptr;
+	}
+
+	// {"modelInstances": [{"position": [x, y, z], "rotation": [...], "scale": [...], "modelName": "...", "parent": i}, ...]}
+	class InstancesSax : public SceneSax {
+	private:
+		SceneFile::Data& data;
+		std::unordered_map<std::string, uint32_t> models;
+		SceneFile::Instance* getInstance() {
+			bool inInstance = isKey(0, "modelInstances") && isArray(1) && levels.size() >= 3;
+			return inInstance && !data.parsedInstances.empty() ? &data.parsedInstances.back() : nullptr;
+		}
+	protected:
+		void onObject() override {
+			if (levels.size() == 2 && isKey(0, "modelInstances") && isArray(1))
+				data.parsedInstances.emplace_back();
+		}
+		void onNumber(double value) override {
+			SceneFile::Instance* instance = getInstance();
+			if (!instance)
+				return;
+			if (levels.size() == 4 && isArray(3) && levels[3].index < 3) {
+				const std::string& field = levels[2].key;
+				glm::vec3* v = field == "position" ? &instance->position : field == "rotation" ? &instance->rotation :
+					field == "scale" ? &instance->scale : nullptr;
+				if (v)
+					(*v)[levels[3].index] = (float)value;
+			}
+			else if (levels.size() == 3 && levels[2].key == "parent")
+				instance->parent = (int32_t)value;
+		}
+		void onString(const std::string& value) override {
+			SceneFile::Instance* instance = getInstance();
+			if (!instance || levels.size() != 3 || levels[2].key != "modelName")
+				return;
+			auto it = models.emplace(value, (uint32_t)data.modelNames.size());
+			if (it.second)
+				data.modelNames.push_back(value);
+			instance->model = it.first->second;
+		}
+	public:
+		// Saved files take about 400 bytes per instance, so the array is rarely grown.
+		InstancesSax(SceneFile::Data& data, size_t fileSize) : data(data) {
+			data.parsedInstances.reserve(fileSize / 400 + 1);
+		}
+	};
+
+	// {"sunLight": {"position": [...], "ambient": [...], "diffuse": [...], "specular": [...], "useSunLight": b},
+	//  "lights": [{"position": [...], ..., "constant": c, "linear": l, "quadratic": q}, ...]}
+	class LightsSax : public SceneSax {
+	private:
+		SceneFile::Data& data;
+	protected:
+		void onObject() override {
+			if (levels.size() == 1 && isKey(0, "sunLight"))
+				data.sun.present = 1;
+			else if (levels.size() == 2 && isKey(0, "lights") && isArray(1))
+				data.parsedLights.emplace_back();
+		}
+		void onNumber(double value) override {
+			if (isKey(0, "sunLight")) {
+				if (levels.size() == 3 && isArray(2) && levels[2].index < 3) {
+					glm::vec3* v = findVector(data.sun, levels[1].key);
+					if (v)
+						(*v)[levels[2].index] = (float)value;
+				}
+				else if (levels.size() == 2 && levels[1].key == "useSunLight")
+					data.sun.use = value != 0.0 ? 1 : 0;
+				return;
+			}
+			if (!isKey(0, "lights") || !isArray(1) || data.parsedLights.empty())
+				return;
+			SceneFile::Light& light = data.parsedLights.back();
+			if (levels.size() == 4 && isArray(3) && levels[3].index < 3) {
+				glm::vec3* v = findVector(light, levels[2].key);
+				if (v)
+					(*v)[levels[3].index] = (float)value;
+			}
+			else if (levels.size() == 3) {
+				const std::string& field = levels[2].key;
+				if (field == "constant")
+					light.constant = (float)value;
+				else if (field == "linear")
+					light.linear = (float)value;
+				else if (field == "quadratic")
+					light.quadratic = (float)value;
+			}
+		}
+	public:
+		LightsSax(SceneFile::Data& data) : data(data) { };
+	};
+}
+
+static bool isSource(uint64_t size, int64_t time, const Vfs::Info& info) {
+	return !info.exists || (info.size == size && info.writeTime == time);
+}
+
+// The arrays are used in the mapped file. Loose files are mapped at page boundaries and pack entries are aligned,
+// the copy is only there in case a file isn't.
+static bool loadBinary(const std::string& path, const Vfs::Info& instancesSource, const Vfs::Info& lightsSource, SceneFile::Data& data) {
+	Vfs::File file = Vfs::open(path);
+	Header header;
+	if (file.getSize() < sizeof(Header))
+		return false;
+	std::memcpy(&header, file.getData(), sizeof(Header));
+	if (header.magic != MAGIC || header.version != VERSION ||
+		!isSource(header.instancesSize, header.instancesTime, instancesSource) || !isSource(header.lightsSize, header.lightsTime, lightsSource))
+		return false;
+	uint64_t instancesOffset = sizeof(Header);
+	uint64_t lightsOffset = instancesOffset + (uint64_t)header.instanceCount * sizeof(SceneFile::Instance);
+	uint64_t namesOffset = lightsOffset + (uint64_t)header.lightCount * sizeof(SceneFile::Light);
+	uint64_t charactersOffset = namesOffset + ((uint64_t)header.modelCount + 1) * sizeof(uint32_t);
+	if (charactersOffset + header.nameBytes != file.getSize())
+		return false;
+
+	const char* base = file.getData();
+	std::vector<uint32_t> offsets(header.modelCount + 1);
+	std::memcpy(offsets.data(), base + namesOffset, offsets.size() * sizeof(uint32_t));
+	data.modelNames.resize(header.modelCount);
+	for (uint32_t i = 0; i < header.modelCount; ++i) {
+		if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.nameBytes)
+			return false;
+		data.modelNames[i].assign(base + charactersOffset + offsets[i], offsets[i + 1] - offsets[i]);
+	}
+	if ((uintptr_t)base % alignof(SceneFile::Instance) == 0) {
+		data.instances = reinterpret_cast<const SceneFile::Instance*>(base + instancesOffset);
+		data.lights = reinterpret_cast<const SceneFile::Light*>(base + lightsOffset);
+		data.instanceCount = header.instanceCount;
+		data.lightCount = header.lightCount;
+	}
+	else {
+		data.parsedInstances.resize(header.instanceCount);
+		data.parsedLights.resize(header.lightCount);
+		std::memcpy(data.parsedInstances.data(), base + instancesOffset, (size_t)(lightsOffset - instancesOffset));
+		std::memcpy(data.parsedLights.data(), base + lightsOffset, (size_t)(namesOffset - lightsOffset));
+		data.setParsed();
+	}
+	data.sun = header.sun;
+	data.binary = true;
+	data.file = std::move(file);
+	return true;
+}
+
+static bool parseJson(const std::string& path, SceneSax& sax, const Vfs::File& file) {
+	// Files created empty for new scenes.
+	if (file.getSize() == 0)
+		return true;
+	if (json::sax_parse(file.getData(), file.getData() + file.getSize(), &sax))
+		return true;
+	std::cout << "Error while parsing " << path << ": " << sax.error << std::endl;
+	return false;
+}
+
+void SceneFile::Data::setParsed() {
+	instances = parsedInstances.data();
+	instanceCount = (uint32_t)parsedInstances.size();
+	lights = parsedLights.data();
+	lightCount = (uint32_t)parsedLights.size();
+}
+
+std::string SceneFile::getPath(const std::string& sceneName) {
+	return project_directory + "\\cooked\\scenes\\" + sceneName + ".gscene";
+}
+
+std::string SceneFile::getInstancesPath(const std::string& sceneName) {
+	return project_directory + "\\assets\\scenes\\" + sceneName + "\\model_instances.json";
+}
+
+std::string SceneFile::getLightsPath(const std::string& sceneName) {
+	return project_directory + "\\assets\\scenes\\" + sceneName + "\\lights.json";
+}
+
+void SceneFile::load(const std::string& sceneName, Data& data) {
+	auto start = std::chrono::high_resolution_clock::now();
+	Vfs::Info instancesInfo = Vfs::stat(getInstancesPath(sceneName)), lightsInfo = Vfs::stat(getLightsPath(sceneName));
+	if (!loadBinary(getPath(sceneName), instancesInfo, lightsInfo, data)) {
+		data = Data();
+		// Edited scenes get their binary copy back, packed ones are only cooked.
+		if (loadJson(sceneName, data) && !instancesInfo.packed && !lightsInfo.packed)
+			save(sceneName, data);
+	}
+	std::cout << "Scene " << sceneName << " loaded in " <<
+		std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms (" <<
+		(data.binary ? "binary" : "json") << "), " << data.instanceCount << " instances, " << data.lightCount << " lights." << std::endl;
+}
+
+bool SceneFile::loadJson(const std::string& sceneName, Data& data) {
+	std::string instancesPath = getInstancesPath(sceneName), lightsPath = getLightsPath(sceneName);
+	Vfs::File instancesFile = Vfs::open(instancesPath), lightsFile = Vfs::open(lightsPath);
+	InstancesSax instancesSax(data, instancesFile.getSize());
+	LightsSax lightsSax(data);
+	bool instancesParsed = parseJson(instancesPath, instancesSax, instancesFile);
+	bool lightsParsed = parseJson(lightsPath, lightsSax, lightsFile);
+	data.setParsed();
+	data.binary = false;
+	return instancesParsed && lightsParsed;
+}
+
+bool SceneFile::save(const std::string& sceneName, const Data& data) {
+	Vfs::Info instancesInfo = Vfs::stat(getInstancesPath(sceneName)), lightsInfo = Vfs::stat(getLightsPath(sceneName));
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.instancesSize = instancesInfo.size;
+	header.instancesTime = instancesInfo.writeTime;
+	header.lightsSize = lightsInfo.size;
+	header.lightsTime = lightsInfo.writeTime;
+	header.instanceCount = data.instanceCount;
+	header.lightCount = data.lightCount;
+	header.modelCount = (uint32_t)data.modelNames.size();
+	header.sun = data.sun;
+	std::vector<uint32_t> offsets = { 0 };
+	for (const std::string& name : data.modelNames)
+		offsets.push_back(offsets.back() + (uint32_t)name.size());
+	header.nameBytes = offsets.back();
+
+	std::string path = getPath(sceneName);
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	std::ofstream f(path, std::ofstream::binary | std::ofstream::trunc);
+	if (!f.is_open()) {
+		std::cout << "Scene binary file can't be written at path: " << path << std::endl;
+		return false;
+	}
+	f.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	f.write(reinterpret_cast<const char*>(data.instances), (std::streamsize)data.instanceCount * sizeof(Instance));
+	f.write(reinterpret_cast<const char*>(data.lights), (std::streamsize)data.lightCount * sizeof(Light));
+	f.write(reinterpret_cast<const char*>(offsets.data()), (std::streamsize)offsets.size() * sizeof(uint32_t));
+	for (const std::string& name : data.modelNames)
+		f.write(name.data(), name.size());
+	return f.good();
+}
\ No newline at end of file
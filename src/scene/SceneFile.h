@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "vfs/Vfs.h"
+
+// Scene content as flat arrays: model instances with their transforms, lights and the sun light.
+// The json files of a scene folder (model_instances.json, lights.json) are the ones edited and saved, a binary copy
+// in cooked\scenes is loaded in their place while they don't change. It's read with one mapping through the Vfs and
+// the arrays are used where they are. Without a current binary copy the json files are parsed with nlohmann's sax
+// interface straight into the arrays, and the binary copy is written for the next load.
+namespace SceneFile {
+	const uint32_t NO_MODEL = 0xFFFFFFFF;
+
+	// Fields missing from the json files keep these values, the same as the default lights.
+	struct Instance {
+		glm::vec3 position = glm::vec3(0.0f), rotation = glm::vec3(0.0f), scale = glm::vec3(1.0f);
+		int32_t parent = -1;
+		// Index in Data::modelNames, NO_MODEL if the json file doesn't name one.
+		uint32_t model = 0xFFFFFFFF;
+	};
+
+	struct Light {
+		glm::vec3 position = glm::vec3(0.0f), ambient = glm::vec3(0.1f), diffuse = glm::vec3(1.0f), specular = glm::vec3(0.5f);
+		float constant = 1.0f, linear = 0.7f, quadratic = 1.8f;
+	};
+
+	struct Sun {
+		glm::vec3 position = glm::vec3(0.0f), ambient = glm::vec3(0.1f), diffuse = glm::vec3(1.0f), specular = glm::vec3(0.5f);
+		// Present is false if lights.json has no sun light, the default one is kept then.
+		uint32_t present = 0, use = 0;
+	};
+
+	struct Data {
+		// In the mapped binary file, or in the parsed vectors.
+		const Instance* instances = nullptr;
+		const Light* lights = nullptr;
+		uint32_t instanceCount = 0, lightCount = 0;
+		Sun sun;
+		std::vector<std::string> modelNames;
+		bool binary = false;
+		Vfs::File file;
+		std::vector<Instance> parsedInstances;
+		std::vector<Light> parsedLights;
+		// Point the arrays at the parsed vectors, after filling them.
+		void setParsed();
+	};
+
+	// project_directory\cooked\scenes\<name>.gscene
+	std::string getPath(const std::string& sceneName);
+	std::string getInstancesPath(const std::string& sceneName);
+	std::string getLightsPath(const std::string& sceneName);
+
+	// Binary copy if it's current, json files otherwise. Missing or empty files give an empty scene.
+	// Prints the time it took.
+	void load(const std::string& sceneName, Data& data);
+	// Only the json files. False if one of them can't be parsed, what was read before the error is kept.
+	bool loadJson(const std::string& sceneName, Data& data);
+	// Binary copy of the data, made current with the json files as they are now.
+	bool save(const std::string& sceneName, const Data& data);
+}
\ No newline at end of file
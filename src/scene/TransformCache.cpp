@@ -0,0 +1,270 @@
+#include "TransformCache.h"
+#include <emmintrin.h>
+#include "jobs/JobSystem.h"
+#include <algorithm>
+
+// Dirty entries per job, smaller updates (the usual gizmo drag) stay on the calling thread.
+static const unsigned int BATCH_SIZE = 256;
+
+static void sinCos4(__m128 x, __m128& s, __m128& c);
+
+void TransformCache::resize(unsigned int count) {
+	unsigned int old = getSize();
+	positionX.resize(count, 0.0f);
+	positionY.resize(count, 0.0f);
+	positionZ.resize(count, 0.0f);
+	rotationX.resize(count, 0.0f);
+	rotationY.resize(count, 0.0f);
+	rotationZ.resize(count, 0.0f);
+	scaleX.resize(count, 1.0f);
+	scaleY.resize(count, 1.0f);
+	scaleZ.resize(count, 1.0f);
+	localMatrices.resize(count, glm::mat4(1.0f));
+	worldMatrices.resize(count, glm::mat4(1.0f));
+	localNormals.resize(count, glm::mat3(1.0f));
+	normalMatrices.resize(count, glm::mat3(1.0f));
+	dirty.resize(count, 0);
+	worldDirty.resize(count, 0);
+	parents.resize(count, -1);
+	levels.resize(count, 0);
+	firstChild.resize(count, 0);
+	childCount.resize(count, 0);
+	if (levelLists.empty())
+		levelLists.resize(1);
+	// Indices past the new size may be in the dirty list.
+	if (count < old) {
+		dirtyList.clear();
+		for (unsigned int i = 0; i < count; ++i)
+			if (dirty[i])
+				dirtyList.push_back(i);
+	}
+	for (unsigned int i = old; i < count; ++i) {
+		dirty[i] = 1;
+		dirtyList.push_back(i);
+	}
+}
+
+void TransformCache::clear() {
+	resize(0);
+	dirtyList.clear();
+	updatedList.clear();
+	levelLists.clear();
+}
+
+void TransformCache::setHierarchy(const std::vector<int>& newParents) {
+	resize((unsigned int)newParents.size());
+	parents = newParents;
+	unsigned int maxLevel = 0;
+	std::fill(childCount.begin(), childCount.end(), 0);
+	for (unsigned int i = 0; i < parents.size(); ++i) {
+		int p = parents[i];
+		levels[i] = p >= 0 ? levels[p] + 1 : 0;
+		maxLevel = std::max(maxLevel, levels[i]);
+		if (p >= 0) {
+			if (childCount[p] == 0)
+				firstChild[p] = i;
+			childCount[p]++;
+		}
+	}
+	levelLists.assign(maxLevel + 1, std::vector<unsigned int>());
+	for (unsigned int i = 0; i < parents.size(); ++i) {
+		if (!dirty[i]) {
+			dirty[i] = 1;
+			dirtyList.push_back(i);
+		}
+	}
+}
+
+void TransformCache::setTransform(unsigned int index, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale) {
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+	if (!dirty[index]) {
+		dirty[index] = 1;
+		dirtyList.push_back(index);
+	}
+}
+
+void TransformCache::update() {
+	updatedList.clear();
+	lastUpdateCount = 0;
+	if (dirtyList.empty())
+		return;
+
+	// Local matrices of what changed.
+	JobSystem::parallelFor((unsigned int)dirtyList.size(), BATCH_SIZE, [this](unsigned int begin, unsigned int end) {
+		computeBatch(&dirtyList[begin], end - begin);
+	});
+	for (unsigned int i : dirtyList) {
+		dirty[i] = 0;
+		if (!worldDirty[i]) {
+			worldDirty[i] = 1;
+			levelLists[levels[i]].push_back(i);
+		}
+	}
+	dirtyList.clear();
+
+	// World matrices level by level, a level only needs the one above to be done.
+	// Children of updated entries are added to the next level, so only dirty subtrees are visited.
+	for (unsigned int level = 0; level < levelLists.size(); ++level) {
+		std::vector<unsigned int>& list = levelLists[level];
+		if (list.empty())
+			continue;
+		JobSystem::parallelFor((unsigned int)list.size(), BATCH_SIZE, [this, &list](unsigned int begin, unsigned int end) {
+			for (unsigned int k = begin; k < end; ++k) {
+				unsigned int i = list[k];
+				int p = parents[i];
+				if (p < 0) {
+					worldMatrices[i] = localMatrices[i];
+					normalMatrices[i] = localNormals[i];
+				}
+				else {
+					worldMatrices[i] = worldMatrices[p] * localMatrices[i];
+					// Inverse transpose of a product is the product of inverse transposes.
+					normalMatrices[i] = normalMatrices[p] * localNormals[i];
+				}
+			}
+		});
+		for (unsigned int i : list) {
+			for (unsigned int c = firstChild[i]; c < firstChild[i] + childCount[i]; ++c) {
+				if (!worldDirty[c]) {
+					worldDirty[c] = 1;
+					levelLists[level + 1].push_back(c);
+				}
+			}
+		}
+		updatedList.insert(updatedList.end(), list.begin(), list.end());
+		list.clear();
+	}
+	for (unsigned int i : updatedList)
+		worldDirty[i] = 0;
+	lastUpdateCount = (unsigned int)updatedList.size();
+}
+
+const std::vector<unsigned int>& TransformCache::getUpdatedList() const {
+	return updatedList;
+}
+
+// Local = T * Rz * Rx * Ry * S, written out so that every element is a few multiplies on 4 lanes.
+void TransformCache::computeBatch(const unsigned int* indices, unsigned int count) {
+	const __m128 toRadians = _mm_set1_ps(0.017453292519943295f);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	for (unsigned int b = 0; b < count; b += 4) {
+		// Pad the last group by repeating its last entry.
+		unsigned int i0 = indices[b], i1 = indices[b + 1 < count ? b + 1 : b];
+		unsigned int i2 = indices[b + 2 < count ? b + 2 : b], i3 = indices[b + 3 < count ? b + 3 : b];
+		auto gather = [&](const std::vector<float>& v) { return _mm_setr_ps(v[i0], v[i1], v[i2], v[i3]); };
+
+		__m128 sx, cx, sy, cy, sz, cz;
+		sinCos4(_mm_mul_ps(gather(rotationX), toRadians), sx, cx);
+		sinCos4(_mm_mul_ps(gather(rotationY), toRadians), sy, cy);
+		sinCos4(_mm_mul_ps(gather(rotationZ), toRadians), sz, cz);
+
+		// Rotation columns.
+		__m128 sxsy = _mm_mul_ps(sx, sy), sxcy = _mm_mul_ps(sx, cy);
+		__m128 r00 = _mm_sub_ps(_mm_mul_ps(cz, cy), _mm_mul_ps(sz, sxsy));
+		__m128 r10 = _mm_add_ps(_mm_mul_ps(sz, cy), _mm_mul_ps(cz, sxsy));
+		__m128 r20 = _mm_sub_ps(zero, _mm_mul_ps(cx, sy));
+		__m128 r01 = _mm_sub_ps(zero, _mm_mul_ps(sz, cx));
+		__m128 r11 = _mm_mul_ps(cz, cx);
+		__m128 r21 = sx;
+		__m128 r02 = _mm_add_ps(_mm_mul_ps(cz, sy), _mm_mul_ps(sz, sxcy));
+		__m128 r12 = _mm_sub_ps(_mm_mul_ps(sz, sy), _mm_mul_ps(cz, sxcy));
+		__m128 r22 = _mm_mul_ps(cx, cy);
+
+		__m128 scale[3] = { gather(scaleX), gather(scaleY), gather(scaleZ) };
+		__m128 columns[3][3] = { { r00, r10, r20 }, { r01, r11, r21 }, { r02, r12, r22 } };
+		__m128 translation[3] = { gather(positionX), gather(positionY), gather(positionZ) };
+		const unsigned int lanes[4] = { i0, i1, i2, i3 };
+
+		// World matrix columns, transposed from lanes to instances 4 floats at a time.
+		for (int col = 0; col < 4; ++col) {
+			__m128 e0, e1, e2, e3 = col == 3 ? one : zero;
+			if (col < 3) {
+				e0 = _mm_mul_ps(columns[col][0], scale[col]);
+				e1 = _mm_mul_ps(columns[col][1], scale[col]);
+				e2 = _mm_mul_ps(columns[col][2], scale[col]);
+			}
+			else {
+				e0 = translation[0];
+				e1 = translation[1];
+				e2 = translation[2];
+			}
+			_MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+			_mm_storeu_ps(&localMatrices[lanes[0]][col][0], e0);
+			_mm_storeu_ps(&localMatrices[lanes[1]][col][0], e1);
+			_mm_storeu_ps(&localMatrices[lanes[2]][col][0], e2);
+			_mm_storeu_ps(&localMatrices[lanes[3]][col][0], e3);
+		}
+
+		// Normal matrix is R * S^-1. A zero scale would divide by zero, it is treated as a tiny one.
+		alignas(16) float normal[3][3][4];
+		for (int col = 0; col < 3; ++col) {
+			__m128 s = scale[col];
+			s = _mm_or_ps(_mm_and_ps(_mm_cmpneq_ps(s, zero), s), _mm_and_ps(_mm_cmpeq_ps(s, zero), _mm_set1_ps(1e-6f)));
+			__m128 inverse = _mm_div_ps(one, s);
+			for (int row = 0; row < 3; ++row)
+				_mm_store_ps(normal[col][row], _mm_mul_ps(columns[col][row], inverse));
+		}
+		for (int l = 0; l < 4; ++l) {
+			glm::mat3& n = localNormals[lanes[l]];
+			for (int col = 0; col < 3; ++col)
+				for (int row = 0; row < 3; ++row)
+					n[col][row] = normal[col][row][l];
+		}
+	}
+}
+
+// Sine and cosine of 4 angles. Reduced to [-pi/4, pi/4] around the nearest multiple of pi/2,
+// then minimax polynomials (same as cephes sinf/cosf), error is around 1e-7.
+static void sinCos4(__m128 x, __m128& s, __m128& c) {
+	__m128 q = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236758134f))));
+	__m128i quadrant = _mm_cvtps_epi32(q);
+	// pi/2 split in three parts so that the reduction stays exact for big angles.
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(1.5703125f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(4.837512969970703125e-4f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(7.54978995489188216e-8f)));
+	__m128 r2 = _mm_mul_ps(r, r);
+
+	__m128 ps = _mm_set1_ps(-1.9515295891e-4f);
+	ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(8.3321608736e-3f));
+	ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(-1.6666654611e-1f));
+	ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+
+	__m128 pc = _mm_set1_ps(2.443315711809948e-5f);
+	pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(-1.388731625493765e-3f));
+	pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(4.166664568298827e-2f));
+	pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+	pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	// Odd quadrants swap sine and cosine, quadrants 2 and 3 negate the sine, 1 and 2 the cosine.
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 sinValue = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+	__m128 cosValue = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+	__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+	s = _mm_xor_ps(sinValue, sinSign);
+	c = _mm_xor_ps(cosValue, cosSign);
+}
+
+const glm::mat4& TransformCache::getWorldMatrix(unsigned int index) const {
+	return worldMatrices[index];
+}
+
+const glm::mat3& TransformCache::getNormalMatrix(unsigned int index) const {
+	return normalMatrices[index];
+}
+
+unsigned int TransformCache::getSize() const {
+	return (unsigned int)positionX.size();
+}
+
+unsigned int TransformCache::getLastUpdateCount() const {
+	return lastUpdateCount;
+}
\ No newline at end of file
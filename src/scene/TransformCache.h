@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// World and normal matrices of every model instance, recomputed only when an instance changes.
+// Inputs are kept in structure of arrays form so that 4 local matrices are built at once with SSE,
+// batches of dirty instances are spread on the job system workers.
+// Entries are in breadth first order (parents before children, children of a parent next to each other),
+// so world matrices are propagated one depth level at a time, only through dirty subtrees.
+class TransformCache {
+private:
+	std::vector<float> positionX, positionY, positionZ;
+	// Degrees, like ModelInstance.
+	std::vector<float> rotationX, rotationY, rotationZ;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<glm::mat4> localMatrices, worldMatrices;
+	std::vector<glm::mat3> localNormals, normalMatrices;
+	std::vector<unsigned char> dirty, worldDirty;
+	std::vector<unsigned int> dirtyList, updatedList;
+
+	// Hierarchy, parent is -1 for roots.
+	std::vector<int> parents;
+	std::vector<unsigned int> levels, firstChild, childCount;
+	std::vector<std::vector<unsigned int>> levelLists;
+	unsigned int lastUpdateCount;
+
+	void computeBatch(const unsigned int* indices, unsigned int count);
+public:
+	TransformCache() : lastUpdateCount(0) { };
+	// New entries are identity root transforms marked dirty.
+	void resize(unsigned int count);
+	void clear();
+	// Parent of each entry, it must be breadth first (parents[i] < i and siblings contiguous).
+	// Marks everything dirty.
+	void setHierarchy(const std::vector<int>& parents);
+	// Local transform, relative to the parent.
+	void setTransform(unsigned int index, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+	// Recompute local matrices of dirty entries and world matrices of their subtrees.
+	void update();
+	// Entries whose world matrix changed in the last update.
+	const std::vector<unsigned int>& getUpdatedList() const;
+	// Parent world matrix times ModelInstance::buildModelMatrix().
+	const glm::mat4& getWorldMatrix(unsigned int index) const;
+	// Inverse transpose of the upper 3x3 of the world matrix.
+	// The view matrix has no scale, so mat3(view) * this is the view space normal matrix.
+	const glm::mat3& getNormalMatrix(unsigned int index) const;
+	unsigned int getSize() const;
+	// Number of world matrices recomputed by the last update.
+	unsigned int getLastUpdateCount() const;
+};
\ No newline at end of file
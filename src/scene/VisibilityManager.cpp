@@ -0,0 +1,137 @@
+#include "Scene.h"
+#include <iostream>
+#include "ProjectDirectory.h"
+
+void VisibilityManager::initialize(const ModelInstancesManager& instances) {
+	hasData = Pvs::load(project_directory + "\\assets\\scenes\\" + sceneName + "\\pvs.bin", data);
+	setData();
+	validate(instances);
+	if (hasData && !valid)
+		std::cout << "PVS of scene " << sceneName << " doesn't match its instances, bake it again." << std::endl;
+}
+
+void VisibilityManager::terminate() {
+	data = Pvs::Data();
+	hasData = valid = false;
+	currentCell = -1;
+	currentBits.clear();
+	meshOffsets.clear();
+}
+
+bool VisibilityManager::bake(const ModelInstancesManager& instances) {
+	std::string folder = project_directory + "\\assets\\scenes\\" + sceneName;
+	Pvs::Data baked;
+	if (!Pvs::bake(instances.getModelInstances(), instances.getTransforms(), folder + "\\cells.json", bakeSettings, baked))
+		return false;
+	Pvs::save(folder + "\\pvs.bin", baked);
+	data = std::move(baked);
+	hasData = true;
+	setData();
+	validate(instances);
+	return true;
+}
+
+// Data is checked against the instances as they are now, later changes are compared to their versions.
+void VisibilityManager::validate(const ModelInstancesManager& instances) {
+	valid = hasData && checkValidity(instances.getModelInstances());
+	orderVersion = instances.getOrderVersion();
+	instanceModelsVersion = instances.getInstanceModelsVersion();
+	transformsVersion = instances.getTransformsVersion();
+}
+
+// Reset cached cell and compute where meshes of each instance start in the bitset.
+void VisibilityManager::setData() {
+	currentCell = -1;
+	currentBits.clear();
+	meshOffsets.clear();
+	unsigned int offset = data.instanceCount;
+	for (unsigned int count : data.instanceMeshCounts) {
+		meshOffsets.push_back(offset);
+		offset += count;
+	}
+}
+
+// Baked data can only be used if instances and meshes are the same.
+// Transforms are the ones of the bake, update() compares their version.
+bool VisibilityManager::checkValidity(const std::vector<ModelInstance>& instances) {
+	if (!hasData || instances.size() != data.instanceCount || data.instanceMeshCounts.size() != data.instanceCount)
+		return false;
+	for (size_t i = 0; i < instances.size(); ++i) {
+		const Model* m = instances[i].isDrawable() ? instances[i].getModel() : nullptr;
+		unsigned int count = m ? (unsigned int)m->getMeshes().size() : 0;
+		if (count != data.instanceMeshCounts[i])
+			return false;
+	}
+	return true;
+}
+
+void VisibilityManager::update(const glm::vec3& cameraPosition, const ModelInstancesManager& instances) {
+	if (!hasData)
+		return;
+	bool wasValid = valid;
+	// Instances added, removed or parented from the gui are reordered, the bits would go to other instances.
+	// Moved instances (or walls) would keep the visibility of where they were baked.
+	// The versions aren't taken, so the data stays unusable until the next bake.
+	if (instances.getOrderVersion() != orderVersion || instances.getTransformsVersion() != transformsVersion ||
+		instances.getModelInstances().size() != data.instanceCount)
+		valid = false;
+	// Other models, or reloaded ones, can have another number of meshes.
+	else if (instances.getInstanceModelsVersion() != instanceModelsVersion) {
+		valid = checkValidity(instances.getModelInstances());
+		instanceModelsVersion = instances.getInstanceModelsVersion();
+		currentCell = -1;
+	}
+	if (wasValid && !valid)
+		std::cout << "PVS of scene " << sceneName << " doesn't match its instances anymore, bake it again." << std::endl;
+	if (!valid)
+		return;
+
+	int cell = Pvs::findCell(data, cameraPosition);
+	if (cell == currentCell)
+		return;
+	currentCell = cell;
+	if (cell >= 0 && data.cells[cell].hasSamples)
+		Pvs::decompress(data.cells[cell].compressedBits, data.instanceCount + data.meshCount, currentBits);
+	else
+		currentBits.clear();
+}
+
+bool VisibilityManager::isInstanceVisible(unsigned int instance) {
+	if (!usePvs || !valid || currentBits.empty() || instance >= data.instanceCount)
+		return true;
+	return currentBits[instance] != 0;
+}
+
+bool VisibilityManager::isMeshVisible(unsigned int instance, unsigned int mesh) {
+	if (!usePvs || !valid || currentBits.empty() || instance >= data.instanceCount || mesh >= data.instanceMeshCounts[instance])
+		return true;
+	return currentBits[meshOffsets[instance] + mesh] != 0;
+}
+
+bool VisibilityManager::getUsePvs() {
+	return usePvs;
+}
+
+void VisibilityManager::setUsePvs(bool b) {
+	usePvs = b;
+}
+
+Pvs::BakeSettings& VisibilityManager::getBakeSettings() {
+	return bakeSettings;
+}
+
+bool VisibilityManager::isValid() {
+	return valid;
+}
+
+int VisibilityManager::getCurrentCell() {
+	return valid ? currentCell : -1;
+}
+
+int VisibilityManager::getCellCount() {
+	return (int)data.cells.size();
+}
+
+int VisibilityManager::getPortalCount() {
+	return (int)data.portals.size();
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "ProgramCache.h"
+#include <glad/glad.h>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <cstdio>
+#include "ProjectDirectory.h"
+
+struct BinaryHeader {
+	uint32_t magic;
+	uint32_t format;
+	uint64_t key;
+	uint32_t length;
+	uint32_t padding;
+};
+
+static const uint32_t MAGIC = 0x43425047;
+
+static bool enabled = true;
+static ProgramCache::Stats stats;
+// Vendor, renderer and version, binaries only work on the driver that made them.
+static std::string driver;
+
+static std::string getPath(uint64_t key);
+
+uint64_t ProgramCache::makeKey(const std::vector<std::string>& sources) {
+	if (driver.empty())
+		driver = std::string((const char*)glGetString(GL_VENDOR)) + "\n" + (const char*)glGetString(GL_RENDERER) + "\n" +
+			(const char*)glGetString(GL_VERSION);
+	// FNV-1a, a stage ends with a 0 byte so that moving text between stages changes the key.
+	uint64_t h = 14695981039346656037ull;
+	auto add = [&h](const std::string& s) {
+		for (unsigned char c : s) {
+			h ^= c;
+			h *= 1099511628211ull;
+		}
+		h *= 1099511628211ull;
+	};
+	add(driver);
+	for (const std::string& source : sources)
+		add(source);
+	return h;
+}
+
+bool ProgramCache::load(uint64_t key, unsigned int program) {
+	if (!enabled)
+		return false;
+	std::string path = getPath(key);
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		return false;
+	BinaryHeader header;
+	std::vector<char> binary;
+	if (f.read((char*)&header, sizeof(header)) && header.magic == MAGIC && header.key == key) {
+		binary.resize(header.length);
+		f.read(binary.data(), binary.size());
+	}
+	f.close();
+
+	int success = 0;
+	if (!binary.empty() && f) {
+		glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+	}
+	if (!success) {
+		// Drivers can refuse binaries of the same version, it's compiled and saved again.
+		stats.rejected++;
+		std::remove(path.c_str());
+	}
+	return success != 0;
+}
+
+void ProgramCache::save(uint64_t key, unsigned int program) {
+	if (!enabled)
+		return;
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	BinaryHeader header = {};
+	header.magic = MAGIC;
+	header.key = key;
+	GLenum format;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.format = format;
+	header.length = (uint32_t)length;
+	std::string path = getPath(key);
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+		std::ofstream f(path, std::ios::binary | std::ios::trunc);
+		f.write((const char*)&header, sizeof(header));
+		f.write(binary.data(), header.length);
+		if (!f)
+			std::cout << "Error while writing program binary " << path << std::endl;
+	}
+	catch (...) {
+		std::cout << "Error while writing program binary " << path << std::endl;
+	}
+}
+
+void ProgramCache::addProgram(bool loaded, float milliseconds) {
+	stats.programs++;
+	if (loaded)
+		stats.loaded++;
+	stats.milliseconds += milliseconds;
+}
+
+void ProgramCache::addTime(float milliseconds) {
+	stats.milliseconds += milliseconds;
+}
+
+bool ProgramCache::getEnabled() {
+	return enabled;
+}
+
+void ProgramCache::setEnabled(bool b) {
+	enabled = b;
+}
+
+ProgramCache::Stats ProgramCache::getStats() {
+	return stats;
+}
+
+static std::string getPath(uint64_t key) {
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+	return project_directory + "\\cache\\shaders\\" + name + ".bin";
+}
\ No newline at end of file
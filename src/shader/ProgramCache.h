@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked program binaries saved in cache/shaders and loaded with glProgramBinary on later runs.
+// Binaries are keyed by the final source of every stage (includes and defines expanded) and by the driver,
+// a driver update or an edited shader gives a new key. Rejected binaries are deleted and the program is compiled.
+namespace ProgramCache {
+	struct Stats {
+		unsigned int programs = 0, loaded = 0, rejected = 0;
+		// Time the caller spent creating programs, loaded or compiled.
+		float milliseconds = 0.0f;
+	};
+
+	uint64_t makeKey(const std::vector<std::string>& sources);
+	// Load the binary in program, false if there is none or the driver doesn't accept it.
+	bool load(uint64_t key, unsigned int program);
+	// Program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	void save(uint64_t key, unsigned int program);
+	void addProgram(bool loaded, float milliseconds);
+	// Time spent checking a compiled program, waiting for the driver included.
+	void addTime(float milliseconds);
+
+	// Off always compiles, existing binaries are kept.
+	bool getEnabled();
+	void setEnabled(bool);
+	Stats getStats();
+}
\ No newline at end of file
@@ -3,200 +3,413 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <filesystem>
+#include <set>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
 #include <glm/gtc/type_ptr.hpp>
+#include "ProgramCache.h"
+#include "renderer/GLExtensions.h"
+#include "vfs/Vfs.h"
 
-// Create opengl program from vertex and fragment path.
-// Will make it better. Messy for now.
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) : shaderID(0) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+// Program whose stages were submitted to the driver but not checked yet.
+struct PendingProgram {
+    uint64_t key;
+    std::vector<unsigned int> shaders, types;
+};
 
-    unsigned int vertexShader, fragmentShader;
+// Stages of a program, kept to compile it again when one of its files changes.
+struct ProgramRecord {
+    unsigned int id = 0;
+    std::vector<std::string> paths, defines;
+    std::vector<unsigned int> types;
+    // Vfs keys of every file read, included files too.
+    std::set<std::string> files;
+    // Program compiling to replace id, 0 if none.
+    unsigned int replacement = 0;
+    std::chrono::high_resolution_clock::time_point reloadStart;
+    bool deleted = false;
+};
 
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-    glCompileShader(vertexShader);
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+static bool appendFile(const std::filesystem::path& path, std::string& out, std::set<std::string>& included, std::vector<std::string>* keywords, int depth);
+static unsigned int createProgram(const std::vector<std::string>& sources, const std::vector<unsigned int>& types);
+static unsigned int addRecord(const std::vector<std::string>& paths, const std::vector<unsigned int>& types, const std::vector<std::string>& defines);
+static unsigned int compileRecord(ProgramRecord& record);
+static void finishReplacement(ProgramRecord& record);
+static void copyUniforms(unsigned int from, unsigned int to);
+static void finishProgram(unsigned int program);
+static const char* getStageName(unsigned int type);
 
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+static std::unordered_map<unsigned int, PendingProgram> pending;
+// Never shrinks, copies of a Shader keep their index.
+static std::deque<ProgramRecord> programs;
+static unsigned int replacements = 0;
+static unsigned int deletedPrograms = 0;
+
+// Insert a #define line for each define after the #version line.
+static void addDefines(std::string& code, const std::vector<std::string>& defines) {
+    if (defines.empty())
+        return;
+    std::string lines;
+    for (const std::string& d : defines)
+        lines += "#define " + d + "\n";
+    size_t position = 0;
+    size_t version = code.find("#version");
+    if (version != std::string::npos) {
+        position = code.find('\n', version);
+        if (position == std::string::npos) {
+            code += '\n';
+            position = code.size() - 1;
+        }
+        ++position;
     }
+    code.insert(position, lines);
+}
 
-    shaderID = glCreateProgram();
-    glAttachShader(shaderID, vertexShader);
-    glAttachShader(shaderID, fragmentShader);
-    glLinkProgram(shaderID);
+std::string Shader::readSource(const std::string& path, std::vector<std::string>* keywords) {
+    std::string source;
+    std::set<std::string> included;
+    included.insert(std::filesystem::path(path).lexically_normal().string());
+    if (!appendFile(path, source, included, keywords, 0))
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+    return source;
+}
 
-    glGetProgramiv(shaderID, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderID, 512, NULL, infoLog);
-        std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// Append the lines of a file, #include lines are replaced by the included file (once per source).
+static bool appendFile(const std::filesystem::path& path, std::string& out, std::set<std::string>& included, std::vector<std::string>* keywords, int depth) {
+    Vfs::File source = Vfs::open(path.string());
+    if (!source.isOpen())
+        return false;
+    std::istringstream file(source.toString());
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cout << "ERROR::SHADER::INVALID_INCLUDE " << line << std::endl;
+                continue;
+            }
+            std::filesystem::path child = (path.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+            if (included.insert(child.string()).second && (depth >= 16 || !appendFile(child, out, included, keywords, depth + 1)))
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << child.string() << std::endl;
+            continue;
+        }
+        // Keywords aren't glsl, the line is only read here.
+        if (start != std::string::npos && line.compare(start, 16, "#pragma keywords") == 0) {
+            std::istringstream words(line.substr(start + 16));
+            std::string word;
+            while (keywords && words >> word)
+                if (std::find(keywords->begin(), keywords->end(), word) == keywords->end())
+                    keywords->push_back(word);
+            continue;
+        }
+        out += line;
+        out += '\n';
     }
+    return true;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+// Create opengl program from vertex and fragment path.
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+    : program(addRecord({ vertexPath, fragmentPath }, { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER }, defines)) {
 }
 
 // Create opengl program from vertex, geometry and fragment path.
-// Will make it better. Messy for now.
-Shader::Shader(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath) : shaderID(0) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string geometryCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream gShaderFile;
-    std::ifstream fShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // open files
-        vShaderFile.open(vertexPath);
-        gShaderFile.open(geometryPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, gShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        gShaderStream << gShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        gShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        geometryCode = gShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+Shader::Shader(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+    : program(addRecord({ vertexPath, geometryPath, fragmentPath }, { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER }, defines)) {
+}
+
+static unsigned int addRecord(const std::vector<std::string>& paths, const std::vector<unsigned int>& types, const std::vector<std::string>& defines) {
+    ProgramRecord record;
+    record.paths = paths;
+    record.types = types;
+    record.defines = defines;
+    record.id = compileRecord(record);
+    programs.push_back(record);
+    return (unsigned int)programs.size();
+}
+
+// Includes are expanded while reading, the files read are remembered for reloads.
+static unsigned int compileRecord(ProgramRecord& record) {
+    std::vector<std::string> sources;
+    record.files.clear();
+    for (const std::string& path : record.paths) {
+        std::string source;
+        std::set<std::string> included;
+        included.insert(std::filesystem::path(path).lexically_normal().string());
+        if (!appendFile(path, source, included, nullptr, 0))
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        addDefines(source, record.defines);
+        sources.push_back(source);
+        // Includes that weren't found are kept too, creating them reloads the program.
+        for (const std::string& file : included)
+            record.files.insert(Vfs::getKey(file));
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* gShaderCode = geometryCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    return createProgram(sources, record.types);
+}
 
-    unsigned int vertexShader, geometryShader, fragmentShader;
+// Load the program from the binary cache, or start compiling and linking the stages.
+// Nothing waits for the driver here, the program is checked by finishProgram.
+static unsigned int createProgram(const std::vector<std::string>& sources, const std::vector<unsigned int>& types) {
+    auto start = std::chrono::high_resolution_clock::now();
+    unsigned int program = glCreateProgram();
+    uint64_t key = ProgramCache::makeKey(sources);
+    bool loaded = ProgramCache::load(key, program);
+    if (!loaded) {
+        PendingProgram& p = pending[program];
+        p.key = key;
+        p.types = types;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const char* code = sources[i].c_str();
+            unsigned int shader = glCreateShader(types[i]);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            glAttachShader(program, shader);
+            p.shaders.push_back(shader);
+        }
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+    }
+    ProgramCache::addProgram(loaded, std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return program;
+}
 
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-    glCompileShader(vertexShader);
+// Check compile and link status of a pending program, waits if the driver isn't done.
+static void finishProgram(unsigned int program) {
+    auto it = pending.find(program);
+    if (it == pending.end())
+        return;
+    auto start = std::chrono::high_resolution_clock::now();
+    const PendingProgram& p = it->second;
     int success;
     char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    for (size_t i = 0; i < p.shaders.size(); ++i) {
+        glGetShaderiv(p.shaders[i], GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(p.shaders[i], 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::" << getStageName(p.types[i]) << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
     }
 
-    geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-    glShaderSource(geometryShader, 1, &gShaderCode, NULL);
-    glCompileShader(geometryShader);
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetShaderInfoLog(geometryShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
+    else
+        ProgramCache::save(p.key, program);
 
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    for (unsigned int shader : p.shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
     }
+    pending.erase(it);
+    ProgramCache::addTime(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+}
 
-    shaderID = glCreateProgram();
-    glAttachShader(shaderID, vertexShader);
-    glAttachShader(shaderID, geometryShader);
-    glAttachShader(shaderID, fragmentShader);
-    glLinkProgram(shaderID);
+bool Shader::isReady() const {
+    unsigned int id = getShaderID();
+    if (pending.find(id) == pending.end())
+        return true;
+    if (!GLExtensions::isProgramComplete(id))
+        return false;
+    finishProgram(id);
+    return true;
+}
 
-    glGetProgramiv(shaderID, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderID, 512, NULL, infoLog);
-        std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+void Shader::wait() const {
+    finishProgram(getShaderID());
+}
+
+unsigned int Shader::getShaderID() const {
+    return program ? programs[program - 1].id : 0;
+}
+
+void Shader::deleteProgram() {
+    if (program == 0)
+        return;
+    ProgramRecord& record = programs[program - 1];
+    // Programs still compiling are tracked by id, they are checked before the id can be reused.
+    if (record.replacement != 0) {
+        finishProgram(record.replacement);
+        glDeleteProgram(record.replacement);
+        record.replacement = 0;
+        replacements--;
+    }
+    finishProgram(record.id);
+    glDeleteProgram(record.id);
+    record.id = 0;
+    record.deleted = true;
+    deletedPrograms++;
+}
+
+unsigned int Shader::reloadFile(const std::string& path) {
+    std::string key = Vfs::getKey(path);
+    unsigned int count = 0;
+    for (ProgramRecord& record : programs) {
+        if (record.deleted || record.files.find(key) == record.files.end())
+            continue;
+        // A newer edit wins over a reload still compiling.
+        if (record.replacement != 0) {
+            finishProgram(record.replacement);
+            glDeleteProgram(record.replacement);
+        }
+        else
+            replacements++;
+        record.reloadStart = std::chrono::high_resolution_clock::now();
+        record.replacement = compileRecord(record);
+        count++;
     }
+    return count;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(geometryShader);
-    glDeleteShader(fragmentShader);
+// Swap in the new program if it linked, otherwise keep the one that works.
+static void finishReplacement(ProgramRecord& record) {
+    finishProgram(record.replacement);
+    int success;
+    glGetProgramiv(record.replacement, GL_LINK_STATUS, &success);
+    if (success) {
+        copyUniforms(record.id, record.replacement);
+        glDeleteProgram(record.id);
+        record.id = record.replacement;
+        deletedPrograms++;
+        std::cout << "Program " << record.paths.back() << " reloaded in " <<
+            std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - record.reloadStart).count() << " ms." << std::endl;
+    }
+    else {
+        glDeleteProgram(record.replacement);
+        std::cout << "Program " << record.paths.back() << " failed to reload, the previous one is kept." << std::endl;
+    }
+    record.replacement = 0;
+    replacements--;
+}
+
+// Uniforms are only set when they change or once at startup (sampler units), the new program gets the old values.
+static void copyUniforms(unsigned int from, unsigned int to) {
+    int count = 0;
+    glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; ++i) {
+        char name[256];
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(from, i, sizeof(name), &length, &size, &type, name);
+        std::string base(name, length);
+        if (size > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+            base.resize(base.size() - 3);
+        for (GLint element = 0; element < size; ++element) {
+            std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+            // Members of uniform blocks have no location, their buffer stays bound.
+            GLint source = glGetUniformLocation(from, elementName.c_str()), target = glGetUniformLocation(to, elementName.c_str());
+            if (source < 0 || target < 0)
+                continue;
+            GLfloat f[16];
+            GLint n[4];
+            GLuint u[4];
+            switch (type) {
+            case GL_FLOAT: glGetUniformfv(from, source, f); glProgramUniform1fv(to, target, 1, f); break;
+            case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glProgramUniform2fv(to, target, 1, f); break;
+            case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glProgramUniform3fv(to, target, 1, f); break;
+            case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glProgramUniform4fv(to, target, 1, f); break;
+            case GL_FLOAT_MAT2: glGetUniformfv(from, source, f); glProgramUniformMatrix2fv(to, target, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glProgramUniformMatrix3fv(to, target, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glProgramUniformMatrix4fv(to, target, 1, GL_FALSE, f); break;
+            case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, source, n); glProgramUniform2iv(to, target, 1, n); break;
+            case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, source, n); glProgramUniform3iv(to, target, 1, n); break;
+            case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, source, n); glProgramUniform4iv(to, target, 1, n); break;
+            case GL_UNSIGNED_INT: glGetUniformuiv(from, source, u); glProgramUniform1uiv(to, target, 1, u); break;
+            case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glProgramUniform2uiv(to, target, 1, u); break;
+            case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glProgramUniform3uiv(to, target, 1, u); break;
+            case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glProgramUniform4uiv(to, target, 1, u); break;
+            // Ints, bools, samplers and images.
+            default: glGetUniformiv(from, source, n); glProgramUniform1iv(to, target, 1, n); break;
+            }
+        }
+    }
+}
+
+void Shader::waitAll() {
+    while (!pending.empty())
+        finishProgram(pending.begin()->first);
+}
+
+void Shader::update() {
+    std::vector<unsigned int> complete;
+    for (const auto& pair : pending)
+        if (GLExtensions::isProgramComplete(pair.first))
+            complete.push_back(pair.first);
+    for (unsigned int program : complete)
+        finishProgram(program);
+    if (replacements == 0)
+        return;
+    for (ProgramRecord& record : programs)
+        if (record.replacement != 0 && pending.find(record.replacement) == pending.end())
+            finishReplacement(record);
+}
+
+unsigned int Shader::getDeletedCount() {
+    return deletedPrograms;
+}
+
+unsigned int Shader::getPendingCount() {
+    return (unsigned int)pending.size();
+}
+
+static const char* getStageName(unsigned int type) {
+    switch (type) {
+    case GL_VERTEX_SHADER:
+        return "VERTEX";
+    case GL_GEOMETRY_SHADER:
+        return "GEOMETRY";
+    default:
+        return "FRAGMENT";
+    }
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glProgramUniform1i(shaderID, glGetUniformLocation(shaderID, name.c_str()), value);
+    unsigned int id = getShaderID();
+    glProgramUniform1i(id, glGetUniformLocation(id, name.c_str()), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glProgramUniform1i(shaderID, glGetUniformLocation(shaderID, name.c_str()), value);
+    unsigned int id = getShaderID();
+    glProgramUniform1i(id, glGetUniformLocation(id, name.c_str()), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glProgramUniform1f(shaderID, glGetUniformLocation(shaderID, name.c_str()), value);
+    unsigned int id = getShaderID();
+    glProgramUniform1f(id, glGetUniformLocation(id, name.c_str()), value);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const 
 {
-    glProgramUniformMatrix4fv(shaderID,
-        glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    unsigned int id = getShaderID();
+    glProgramUniformMatrix4fv(id,
+        glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glProgramUniformMatrix3fv(shaderID,
-        glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    unsigned int id = getShaderID();
+    glProgramUniformMatrix3fv(id,
+        glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& vec) const {
-    glProgramUniform3f(shaderID, glGetUniformLocation(shaderID, name.c_str()), vec.x, vec.y, vec.z);
+    unsigned int id = getShaderID();
+    glProgramUniform3f(id, glGetUniformLocation(id, name.c_str()), vec.x, vec.y, vec.z);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& vec) const {
-    glProgramUniform2f(shaderID, glGetUniformLocation(shaderID, name.c_str()), vec.x, vec.y);
+    unsigned int id = getShaderID();
+    glProgramUniform2f(id, glGetUniformLocation(id, name.c_str()), vec.x, vec.y);
 }
\ No newline at end of file
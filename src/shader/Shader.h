@@ -1,14 +1,20 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
+// Copies of a Shader share one program. Programs are recorded with their files, so hot reload can compile them
+// again and every copy uses the new program once it's linked.
 class Shader {
 private:
-	unsigned int shaderID;
+	// Index of the program record plus one, 0 for no program.
+	unsigned int program = 0;
 public:
-	Shader(const std::string& vertexPath, const std::string& fragmentPath);
-	Shader(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath);
-	Shader(const Shader& s) : shaderID(s.shaderID) {};
+	// Defines are added as #define lines right after the #version line of every stage.
+	// Programs that aren't in the binary cache are only submitted to the driver, which can compile them in parallel.
+	Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+	Shader(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+	Shader(const Shader& s) : program(s.program) {};
 	Shader() = default;	
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
@@ -17,7 +23,26 @@ public:
 	void setMat3(const std::string& name, const glm::mat3& mat) const;
 	void setVec3(const std::string& name, const glm::vec3& vec) const;
 	void setVec2(const std::string& name, const glm::vec2& vec) const;
-	unsigned int getShaderID() const {
-		return shaderID;
-	}
-};
+	// Source of a shader file with #include "path" lines (relative to the file) replaced by the files.
+	// Keywords declared with #pragma keywords are added to keywords, the line is removed.
+	static std::string readSource(const std::string& path, std::vector<std::string>* keywords = nullptr);
+	// False while the driver is still compiling, errors are printed once it's done.
+	bool isReady() const;
+	// Wait for the program and check it.
+	void wait() const;
+	// Wait for every program still compiling.
+	static void waitAll();
+	// Check the programs the driver finished, once per frame.
+	static void update();
+	// Programs still compiling.
+	static unsigned int getPendingCount();
+	// Compile again every program that reads the file (includes too). The programs are replaced by update
+	// once the new ones are linked, if they fail the old ones stay. Returns how many are compiling.
+	static unsigned int reloadFile(const std::string& path);
+	// Delete the program of every copy.
+	void deleteProgram();
+	// Changes every time a program in use is deleted or replaced by a reload. OpenGL reuses the names of deleted
+	// programs, so what is cached by program id (uniform locations) must be dropped when it changes.
+	static unsigned int getDeletedCount();
+	unsigned int getShaderID() const;
+};
\ No newline at end of file
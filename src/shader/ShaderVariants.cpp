@@ -0,0 +1,80 @@
+#include "ShaderVariants.h"
+#include <glad/glad.h>
+#include <iostream>
+#include <bitset>
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+	: ShaderVariants(vertexPath, "", fragmentPath, defines) {
+}
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+	: vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath), defines(defines) {
+	// Only keywords are needed here, sources are read again when a variant is compiled.
+	Shader::readSource(vertexPath, &keywords);
+	if (!geometryPath.empty())
+		Shader::readSource(geometryPath, &keywords);
+	Shader::readSource(fragmentPath, &keywords);
+	if (keywords.size() > 32) {
+		std::cout << "Shader " << fragmentPath << " declares more than 32 keywords, the others are ignored." << std::endl;
+		keywords.resize(32);
+	}
+}
+
+unsigned int ShaderVariants::getKeywordMask(const std::string& keyword) const {
+	for (unsigned int i = 0; i < keywords.size(); ++i)
+		if (keywords[i] == keyword)
+			return 1u << i;
+	return 0;
+}
+
+const Shader& ShaderVariants::prepare(unsigned int mask) {
+	const auto& it = variants.find(mask);
+	if (it != variants.end())
+		return it->second;
+	std::vector<std::string> variantDefines = defines;
+	for (unsigned int i = 0; i < keywords.size(); ++i)
+		if (mask & (1u << i))
+			variantDefines.push_back(keywords[i]);
+	Shader shader = geometryPath.empty() ? Shader(vertexPath, fragmentPath, variantDefines) :
+		Shader(vertexPath, geometryPath, fragmentPath, variantDefines);
+	return variants.emplace(mask, shader).first->second;
+}
+
+const Shader& ShaderVariants::get(unsigned int mask, unsigned int required) {
+	const Shader& shader = prepare(mask);
+	if (shader.isReady())
+		return shader;
+	const Shader* fallback = nullptr;
+	size_t fallbackKeywords = 0;
+	for (const auto& pair : variants) {
+		if ((pair.first & ~mask) != 0 || (pair.first & required) != required)
+			continue;
+		size_t count = std::bitset<32>(pair.first).count();
+		if ((!fallback || count > fallbackKeywords) && pair.second.isReady()) {
+			fallback = &pair.second;
+			fallbackKeywords = count;
+		}
+	}
+	if (fallback)
+		return *fallback;
+	shader.wait();
+	return shader;
+}
+
+const Shader& ShaderVariants::get(unsigned int mask) {
+	return get(mask, mask);
+}
+
+const std::vector<std::string>& ShaderVariants::getKeywords() const {
+	return keywords;
+}
+
+unsigned int ShaderVariants::getVariantCount() const {
+	return (unsigned int)variants.size();
+}
+
+void ShaderVariants::clear() {
+	for (auto& pair : variants)
+		pair.second.deleteProgram();
+	variants.clear();
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Shader.h"
+
+// Permutations of a shader specialized with #define.
+// Shader files declare their feature keywords with "#pragma keywords A B ...", a variant is a mask of keywords
+// and gets compiled the first time it is asked for. Code that is constant for a whole pass or material is
+// chosen with #ifdef instead of branching on uniforms.
+class ShaderVariants {
+private:
+	std::string vertexPath, geometryPath, fragmentPath;
+	// Defined in every variant.
+	std::vector<std::string> defines;
+	std::vector<std::string> keywords;
+	std::unordered_map<unsigned int, Shader> variants;
+public:
+	ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+	ShaderVariants(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+	ShaderVariants() = default;
+	// Bit of a declared keyword, 0 if no stage declares it.
+	unsigned int getKeywordMask(const std::string& keyword) const;
+	// Start compiling the variant of mask, without waiting for it.
+	const Shader& prepare(unsigned int mask);
+	// Program with the keywords of mask defined. While it's compiling, the ready variant with the most keywords
+	// of mask and all of required is used instead. If there is none it waits, so by default it always waits.
+	const Shader& get(unsigned int mask, unsigned int required);
+	const Shader& get(unsigned int mask);
+	const std::vector<std::string>& getKeywords() const;
+	unsigned int getVariantCount() const;
+	// Delete every compiled program.
+	void clear();
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "AssimpIOSystem.h"
+#include "Vfs.h"
+#include <assimp/IOStream.hpp>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	class VfsIOStream : public Assimp::IOStream {
+	private:
+		Vfs::File file;
+		size_t position = 0;
+	public:
+		explicit VfsIOStream(Vfs::File file) : file(std::move(file)) { };
+		size_t Read(void* buffer, size_t size, size_t count) override {
+			if (size == 0)
+				return 0;
+			count = std::min(count, (file.getSize() - position) / size);
+			if (count > 0)
+				std::memcpy(buffer, file.getData() + position, size * count);
+			position += size * count;
+			return count;
+		}
+		size_t Write(const void*, size_t, size_t) override {
+			return 0;
+		}
+		aiReturn Seek(size_t offset, aiOrigin origin) override {
+			size_t target = origin == aiOrigin_SET ? offset : origin == aiOrigin_CUR ? position + offset : file.getSize() + offset;
+			if (target > file.getSize())
+				return aiReturn_FAILURE;
+			position = target;
+			return aiReturn_SUCCESS;
+		}
+		size_t Tell() const override {
+			return position;
+		}
+		size_t FileSize() const override {
+			return file.getSize();
+		}
+		void Flush() override { }
+	};
+}
+
+bool VfsIOSystem::Exists(const char* file) const {
+	Vfs::Info info = Vfs::stat(file);
+	return info.exists && !info.directory;
+}
+
+char VfsIOSystem::getOsSeparator() const {
+	return '\\';
+}
+
+// Writing isn't supported, assimp only needs it for exporting.
+Assimp::IOStream* VfsIOSystem::Open(const char* file, const char* mode) {
+	if (std::strchr(mode, 'w') || std::strchr(mode, 'a'))
+		return nullptr;
+	Vfs::File f = Vfs::open(file);
+	return f.isOpen() ? new VfsIOStream(std::move(f)) : nullptr;
+}
+
+void VfsIOSystem::Close(Assimp::IOStream* stream) {
+	delete stream;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+#include <assimp/IOSystem.hpp>
+
+// Lets assimp read models, and the files they reference, through the Vfs. Read only.
+class VfsIOSystem : public Assimp::IOSystem {
+public:
+	bool Exists(const char* file) const override;
+	char getOsSeparator() const override;
+	Assimp::IOStream* Open(const char* file, const char* mode = "rb") override;
+	void Close(Assimp::IOStream* stream) override;
+};
\ No newline at end of file
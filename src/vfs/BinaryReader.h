@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// Reads values from a buffer in memory (usually a mapped file), every read fails instead of going past its end.
+class BinaryReader {
+private:
+	const char* data;
+	size_t size, position = 0;
+public:
+	BinaryReader(const char* data, size_t size) : data(data), size(size) { };
+	template<typename T>
+	bool read(T& value) {
+		if (size - position < sizeof(T))
+			return false;
+		std::memcpy(&value, data + position, sizeof(T));
+		position += sizeof(T);
+		return true;
+	}
+	// uint16 length then the characters.
+	bool readString(std::string& s) {
+		uint16_t length;
+		if (!read(length) || size - position < length)
+			return false;
+		s.assign(data + position, length);
+		position += length;
+		return true;
+	}
+	// uint32 count then the elements, the count is checked against what's left before allocating.
+	template<typename T>
+	bool readVector(std::vector<T>& v) {
+		uint32_t count;
+		if (!read(count) || (size - position) / sizeof(T) < count)
+			return false;
+		v.resize(count);
+		if (count > 0)
+			std::memcpy(v.data(), data + position, (size_t)count * sizeof(T));
+		position += (size_t)count * sizeof(T);
+		return true;
+	}
+	size_t getPosition() const { return position; }
+	bool isAtEnd() const { return position == size; }
+};
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "FileWatcher.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+// Time without changes before a file is reported.
+static const std::chrono::milliseconds QUIET_TIME(150);
+
+static std::thread thread;
+static bool running = false;
+static std::mutex mutex;
+// Changed files and their last change.
+static std::unordered_map<std::string, std::chrono::steady_clock::time_point> changes;
+
+static void addChange(const std::string& path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	changes[path] = std::chrono::steady_clock::now();
+}
+
+#ifdef _WIN32
+struct WatchedFolder {
+	std::string path;
+	HANDLE directory = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	// FILE_NOTIFY_INFORMATION records, they must be DWORD aligned.
+	alignas(DWORD) char buffer[64 * 1024];
+};
+
+static std::vector<std::unique_ptr<WatchedFolder>> folders;
+static HANDLE stopEvent = nullptr;
+
+static bool readChanges(WatchedFolder& folder) {
+	ResetEvent(folder.overlapped.hEvent);
+	return ReadDirectoryChangesW(folder.directory, folder.buffer, sizeof(folder.buffer), TRUE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &folder.overlapped, nullptr) != 0;
+}
+
+static void watch() {
+	std::vector<HANDLE> events = { stopEvent };
+	for (const auto& folder : folders)
+		events.push_back(folder->overlapped.hEvent);
+	while (true) {
+		DWORD result = WaitForMultipleObjects((DWORD)events.size(), events.data(), FALSE, INFINITE);
+		if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + events.size())
+			return;
+		WatchedFolder& folder = *folders[result - WAIT_OBJECT_0 - 1];
+		DWORD bytes = 0;
+		// No bytes means the buffer overflowed and the changes are lost, they'll show up on the next write.
+		if (GetOverlappedResult(folder.directory, &folder.overlapped, &bytes, FALSE) && bytes > 0) {
+			const char* record = folder.buffer;
+			while (true) {
+				const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)record;
+				if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+					int length = (int)(info->FileNameLength / sizeof(WCHAR));
+					int size = WideCharToMultiByte(CP_ACP, 0, info->FileName, length, nullptr, 0, nullptr, nullptr);
+					std::string name(size, '\0');
+					WideCharToMultiByte(CP_ACP, 0, info->FileName, length, name.data(), size, nullptr, nullptr);
+					addChange(folder.path + "\\" + name);
+				}
+				if (info->NextEntryOffset == 0)
+					break;
+				record += info->NextEntryOffset;
+			}
+		}
+		if (!readChanges(folder)) {
+			std::cout << "Stopped watching " << folder.path << std::endl;
+			return;
+		}
+	}
+}
+
+bool FileWatcher::start(const std::vector<std::string>& paths) {
+	stop();
+	for (const std::string& path : paths) {
+		std::unique_ptr<WatchedFolder> folder = std::make_unique<WatchedFolder>();
+		folder->path = path;
+		folder->directory = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (folder->directory == INVALID_HANDLE_VALUE)
+			continue;
+		folder->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!readChanges(*folder)) {
+			CloseHandle(folder->overlapped.hEvent);
+			CloseHandle(folder->directory);
+			continue;
+		}
+		folders.push_back(std::move(folder));
+	}
+	if (folders.empty())
+		return false;
+	stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	running = true;
+	thread = std::thread(watch);
+	return true;
+}
+
+void FileWatcher::stop() {
+	if (running) {
+		SetEvent(stopEvent);
+		thread.join();
+		CloseHandle(stopEvent);
+		stopEvent = nullptr;
+		running = false;
+	}
+	// Reads still pending write in the buffers, they're cancelled and waited for before the buffers go.
+	for (const auto& folder : folders) {
+		DWORD bytes;
+		CancelIoEx(folder->directory, &folder->overlapped);
+		GetOverlappedResult(folder->directory, &folder->overlapped, &bytes, TRUE);
+		CloseHandle(folder->overlapped.hEvent);
+		CloseHandle(folder->directory);
+	}
+	folders.clear();
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.clear();
+}
+#else
+static int inotifyFile = -1;
+// Written to wake the thread up when stopping.
+static int stopPipe[2] = { -1, -1 };
+// inotify isn't recursive, every folder has its own watch.
+static std::unordered_map<int, std::string> watches;
+
+static void addWatches(const std::string& path) {
+	int watch = inotify_add_watch(inotifyFile, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watch < 0)
+		return;
+	watches[watch] = path;
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+		if (it->is_directory(error))
+			addWatches(it->path().string());
+}
+
+static void watch() {
+	alignas(inotify_event) char buffer[64 * 1024];
+	pollfd files[2] = { { inotifyFile, POLLIN, 0 }, { stopPipe[0], POLLIN, 0 } };
+	while (poll(files, 2, -1) >= 0 && !(files[1].revents & POLLIN)) {
+		ssize_t bytes = read(inotifyFile, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < bytes;) {
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			const auto& it = watches.find(event->wd);
+			if (it == watches.end() || event->len == 0)
+				continue;
+			std::string path = (std::filesystem::path(it->second) / event->name).string();
+			// New folders are watched too, files created empty are reported when they're written.
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					addWatches(path);
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				addChange(path);
+		}
+	}
+}
+
+bool FileWatcher::start(const std::vector<std::string>& paths) {
+	stop();
+	inotifyFile = inotify_init1(IN_NONBLOCK);
+	if (inotifyFile < 0)
+		return false;
+	for (const std::string& path : paths)
+		addWatches(path);
+	if (watches.empty() || pipe(stopPipe) != 0) {
+		stop();
+		return false;
+	}
+	running = true;
+	thread = std::thread(watch);
+	return true;
+}
+
+void FileWatcher::stop() {
+	if (running) {
+		char wake = 0;
+		ssize_t written = write(stopPipe[1], &wake, 1);
+		(void)written;
+		thread.join();
+		running = false;
+	}
+	for (int& file : stopPipe) {
+		if (file >= 0)
+			close(file);
+		file = -1;
+	}
+	if (inotifyFile >= 0)
+		close(inotifyFile);
+	inotifyFile = -1;
+	watches.clear();
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.clear();
+}
+#endif
+
+bool FileWatcher::isRunning() {
+	return running;
+}
+
+std::vector<std::string> FileWatcher::poll() {
+	std::vector<std::string> quiet;
+	auto now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = changes.begin(); it != changes.end();) {
+		if (now - it->second >= QUIET_TIME) {
+			quiet.push_back(it->first);
+			it = changes.erase(it);
+		}
+		else
+			++it;
+	}
+	return quiet;
+}
\ No newline at end of file
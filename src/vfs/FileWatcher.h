@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Reports the files that change under some folders, used by hot reload.
+// A thread waits on the system for changes: ReadDirectoryChangesW on windows, inotify elsewhere.
+// Editors often write a file in more than one step, so a file is reported once it had no change for a short while.
+namespace FileWatcher {
+	// Watch the folders and everything under them. False if none of them can be watched.
+	bool start(const std::vector<std::string>& folders);
+	void stop();
+	bool isRunning();
+	// Paths of the files written, created or renamed since the last call, each once.
+	std::vector<std::string> poll();
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "Lz4.h"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+static const size_t MIN_MATCH = 4;
+// The format wants the last 5 bytes as literals and no match starting in the last 12.
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+static const unsigned int HASH_BITS = 16;
+
+static uint32_t read32(const unsigned char* p) {
+	uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+static uint32_t hash(uint32_t sequence) {
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths above 15 continue in bytes of 255 and a last smaller one.
+static bool writeLength(unsigned char*& out, const unsigned char* end, size_t length) {
+	while (length >= 255) {
+		if (out >= end)
+			return false;
+		*out++ = 255;
+		length -= 255;
+	}
+	if (out >= end)
+		return false;
+	*out++ = (unsigned char)length;
+	return true;
+}
+
+// Token, literals and, when matchLength isn't 0, the match.
+static bool writeSequence(unsigned char*& out, const unsigned char* end, const unsigned char* literals, size_t literalLength,
+	size_t offset, size_t matchLength) {
+	if (out >= end)
+		return false;
+	unsigned char* token = out++;
+	*token = (unsigned char)(std::min<size_t>(literalLength, 15) << 4);
+	if (literalLength >= 15 && !writeLength(out, end, literalLength - 15))
+		return false;
+	if ((size_t)(end - out) < literalLength)
+		return false;
+	if (literalLength > 0)
+		std::memcpy(out, literals, literalLength);
+	out += literalLength;
+	if (matchLength == 0)
+		return true;
+
+	if (end - out < 2)
+		return false;
+	*out++ = (unsigned char)(offset & 0xFF);
+	*out++ = (unsigned char)(offset >> 8);
+	size_t code = matchLength - MIN_MATCH;
+	*token |= (unsigned char)std::min<size_t>(code, 15);
+	if (code >= 15 && !writeLength(out, end, code - 15))
+		return false;
+	return true;
+}
+
+size_t Lz4::getMaxCompressedSize(size_t size) {
+	return size + size / 255 + 16;
+}
+
+size_t Lz4::compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity) {
+	unsigned char* out = destination;
+	const unsigned char* end = destination + capacity;
+	// Last position each hashed sequence was seen at, plus one so that 0 is empty.
+	std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+	size_t position = 0, anchor = 0;
+	while (size >= MATCH_LIMIT && position + MATCH_LIMIT <= size) {
+		uint32_t sequence = read32(source + position);
+		uint32_t& slot = table[hash(sequence)];
+		size_t candidate = slot;
+		slot = (uint32_t)(position + 1);
+		if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(source + candidate - 1) != sequence) {
+			position++;
+			continue;
+		}
+		size_t match = candidate - 1;
+		size_t length = MIN_MATCH, limit = size - LAST_LITERALS;
+		while (position + length < limit && source[match + length] == source[position + length])
+			length++;
+		if (!writeSequence(out, end, source + anchor, position - anchor, position - match, length))
+			return 0;
+		position += length;
+		anchor = position;
+	}
+	if (!writeSequence(out, end, source + anchor, size - anchor, 0, 0))
+		return 0;
+	return out - destination;
+}
+
+bool Lz4::decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t size) {
+	size_t in = 0, out = 0;
+	while (in < sourceSize) {
+		unsigned char token = source[in++];
+		size_t literalLength = token >> 4;
+		if (literalLength == 15) {
+			unsigned char b;
+			do {
+				if (in >= sourceSize)
+					return false;
+				b = source[in++];
+				literalLength += b;
+			} while (b == 255);
+		}
+		if (literalLength > sourceSize - in || literalLength > size - out)
+			return false;
+		std::memcpy(destination + out, source + in, literalLength);
+		in += literalLength;
+		out += literalLength;
+		// The last sequence has no match.
+		if (in == sourceSize)
+			return out == size;
+
+		if (sourceSize - in < 2)
+			return false;
+		size_t offset = source[in] | ((size_t)source[in + 1] << 8);
+		in += 2;
+		if (offset == 0 || offset > out)
+			return false;
+		size_t matchLength = token & 15;
+		if (matchLength == 15) {
+			unsigned char b;
+			do {
+				if (in >= sourceSize)
+					return false;
+				b = source[in++];
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += MIN_MATCH;
+		if (matchLength > size - out)
+			return false;
+		// Matches can overlap what they write, short offsets repeat a pattern.
+		unsigned char* target = destination + out;
+		const unsigned char* from = target - offset;
+		if (offset >= matchLength)
+			std::memcpy(target, from, matchLength);
+		else
+			for (size_t i = 0; i < matchLength; ++i)
+				target[i] = from[i];
+		out += matchLength;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+
+// LZ4 block format (no frame header), used for compressed entries of pack files.
+// Compression is the fast greedy one, good enough for cooking, decompression checks every bound.
+namespace Lz4 {
+	// Worst case size of compress output.
+	size_t getMaxCompressedSize(size_t size);
+	// Returns the compressed size, 0 if it doesn't fit in capacity.
+	size_t compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity);
+	// False if the data is corrupted or doesn't decompress to exactly size bytes.
+	bool decompress(const unsigned char* source, size_t sourceSize, unsigned char* destination, size_t size);
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "PackFile.h"
+#include <cstring>
+#include <iostream>
+#include "BinaryReader.h"
+
+PackFile::PackFile(const std::string& path) : path(path), mapping(std::make_shared<MappedFile>(path)) {
+	Header header;
+	if (!mapping->isOpen() || mapping->getSize() < sizeof(Header)) {
+		std::cout << "Pack file couldn't be opened at path: " << path << std::endl;
+		return;
+	}
+	std::memcpy(&header, mapping->getData(), sizeof(Header));
+	uint64_t fileSize = mapping->getSize();
+	// An entry takes at least 38 bytes of toc, a broken count is caught before allocating.
+	if (header.magic != MAGIC || header.version != VERSION || header.tocOffset > fileSize || header.tocSize > fileSize - header.tocOffset ||
+		header.entryCount > header.tocSize / 38) {
+		std::cout << "Pack file is not valid or of another version: " << path << std::endl;
+		return;
+	}
+
+	BinaryReader reader(mapping->getData() + header.tocOffset, (size_t)header.tocSize);
+	entries.resize(header.entryCount);
+	for (Entry& entry : entries) {
+		if (!reader.readString(entry.path) || !reader.read(entry.offset) || !reader.read(entry.storedSize) ||
+			!reader.read(entry.size) || !reader.read(entry.writeTime) || !reader.read(entry.flags) ||
+			entry.offset > fileSize || entry.storedSize > fileSize - entry.offset ||
+			(!(entry.flags & FLAG_LZ4) && entry.storedSize != entry.size)) {
+			std::cout << "Pack file has a broken table of contents: " << path << std::endl;
+			entries.clear();
+			return;
+		}
+	}
+	open = true;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "model/MappedFile.h"
+
+// Read only archive of cooked assets (.gpak), mapped whole.
+// Layout: 32 byte header (magic, version, entry count, 0, toc offset and size as uint64), blobs aligned to
+// ALIGNMENT bytes, then the table of contents. Each toc entry is a uint16 length and path relative to the
+// project directory, then offset, stored size, size, write time of the source (uint64 each, write time signed)
+// and uint32 flags. Entries with FLAG_LZ4 are LZ4 blocks, the others are the file bytes as they are.
+class PackFile {
+public:
+	static const uint32_t MAGIC = 0x4B415047, VERSION = 1;
+	static const uint32_t FLAG_LZ4 = 1;
+	static const uint64_t ALIGNMENT = 16;
+
+	struct Header {
+		uint32_t magic, version, entryCount, reserved;
+		uint64_t tocOffset, tocSize;
+	};
+
+	struct Entry {
+		std::string path;
+		uint64_t offset = 0, storedSize = 0, size = 0;
+		int64_t writeTime = 0;
+		uint32_t flags = 0;
+	};
+private:
+	std::string path;
+	std::shared_ptr<MappedFile> mapping;
+	std::vector<Entry> entries;
+	bool open = false;
+public:
+	// Prints what's wrong if the file isn't a valid pack.
+	explicit PackFile(const std::string& path);
+	bool isOpen() const { return open; }
+	const std::string& getPath() const { return path; }
+	const std::vector<Entry>& getEntries() const { return entries; }
+	// Bytes of an entry as stored in the pack, in bounds once the pack is open.
+	const char* getStoredData(const Entry& entry) const { return mapping->getData() + entry.offset; }
+	// Shared by the files read from the pack, they stay valid if the pack is unmounted.
+	const std::shared_ptr<MappedFile>& getMapping() const { return mapping; }
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "PackWriter.h"
+#include "Lz4.h"
+#include <filesystem>
+#include <iostream>
+
+PackWriter::Blob PackWriter::makeBlob(const std::string& path, const char* data, size_t size, int64_t writeTime, bool compress) {
+	Blob blob;
+	blob.path = path;
+	blob.size = size;
+	blob.writeTime = writeTime;
+	if (compress && size > 0) {
+		blob.stored.resize(Lz4::getMaxCompressedSize(size));
+		size_t compressed = Lz4::compress((const unsigned char*)data, size, (unsigned char*)blob.stored.data(), blob.stored.size());
+		if (compressed > 0 && compressed <= size - size / 8) {
+			blob.stored.resize(compressed);
+			blob.flags = PackFile::FLAG_LZ4;
+			return blob;
+		}
+	}
+	blob.stored.assign(data, data + size);
+	return blob;
+}
+
+PackWriter::PackWriter(const std::string& path) : path(path), temporaryPath(path + ".tmp") {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	file.open(temporaryPath, std::ios::binary | std::ios::trunc);
+	// The header is written again at the end, with the toc position.
+	PackFile::Header header = {};
+	file.write((const char*)&header, sizeof(header));
+	offset = sizeof(header);
+	failed = !file;
+}
+
+bool PackWriter::add(const Blob& blob) {
+	if (failed)
+		return false;
+	static const char zeros[PackFile::ALIGNMENT] = {};
+	uint64_t padding = (PackFile::ALIGNMENT - offset % PackFile::ALIGNMENT) % PackFile::ALIGNMENT;
+	file.write(zeros, padding);
+	offset += padding;
+
+	PackFile::Entry entry;
+	entry.path = blob.path;
+	entry.offset = offset;
+	entry.storedSize = blob.stored.size();
+	entry.size = blob.size;
+	entry.writeTime = blob.writeTime;
+	entry.flags = blob.flags;
+	file.write(blob.stored.data(), blob.stored.size());
+	offset += blob.stored.size();
+	entries.push_back(entry);
+	failed = !file;
+	return !failed;
+}
+
+bool PackWriter::finish() {
+	PackFile::Header header = {};
+	header.magic = PackFile::MAGIC;
+	header.version = PackFile::VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.tocOffset = offset;
+	for (const PackFile::Entry& entry : entries) {
+		uint16_t length = (uint16_t)entry.path.size();
+		file.write((const char*)&length, sizeof(length));
+		file.write(entry.path.data(), length);
+		file.write((const char*)&entry.offset, sizeof(entry.offset));
+		file.write((const char*)&entry.storedSize, sizeof(entry.storedSize));
+		file.write((const char*)&entry.size, sizeof(entry.size));
+		file.write((const char*)&entry.writeTime, sizeof(entry.writeTime));
+		file.write((const char*)&entry.flags, sizeof(entry.flags));
+		header.tocSize += sizeof(length) + length + sizeof(uint64_t) * 4 + sizeof(uint32_t);
+	}
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.close();
+	if (failed || !file) {
+		std::cout << "Error while writing pack file " << path << std::endl;
+		return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		std::cout << "Pack file couldn't replace " << path << ": " << error.message() << std::endl;
+		return false;
+	}
+	offset += header.tocSize;
+	return true;
+}
\ No newline at end of file
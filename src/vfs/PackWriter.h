@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "PackFile.h"
+
+// Writes a pack file (see PackFile), used by the cooker. Blobs go to disk as they are added, the table of
+// contents at finish. The pack is written next to its path and renamed over it at the end, so a pack that is
+// mounted or a previous good one is never left half written.
+class PackWriter {
+public:
+	// An entry ready to be written, blobs can be made on any thread.
+	struct Blob {
+		// Relative to the project directory.
+		std::string path;
+		std::vector<char> stored;
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		uint32_t flags = 0;
+	};
+	// LZ4 is kept only if it saves at least an eighth of the size.
+	static Blob makeBlob(const std::string& path, const char* data, size_t size, int64_t writeTime, bool compress);
+private:
+	std::string path, temporaryPath;
+	std::ofstream file;
+	std::vector<PackFile::Entry> entries;
+	uint64_t offset = 0;
+	bool failed = false;
+public:
+	explicit PackWriter(const std::string& path);
+	bool add(const Blob& blob);
+	// Writes the table of contents and replaces the pack. False if any write failed, the old pack stays then.
+	bool finish();
+	uint64_t getSize() const { return offset; }
+};
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "Vfs.h"
+#include "PackFile.h"
+#include "Lz4.h"
+#include "jobs/JobSystem.h"
+#include "ProjectDirectory.h"
+#include <filesystem>
+#include <unordered_map>
+#include <set>
+#include <atomic>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace {
+	struct PackedFile {
+		const PackFile* pack;
+		const PackFile::Entry* entry;
+	};
+}
+
+static std::vector<std::unique_ptr<PackFile>> packs;
+// Keys are lowercase paths relative to the project directory, with backslashes.
+static std::unordered_map<std::string, PackedFile> packedFiles;
+// Names (as stored) of the files and folders in each packed folder, true for folders.
+static std::unordered_map<std::string, std::set<std::pair<std::string, bool>>> packedFolders;
+static std::string root;
+static std::atomic<unsigned int> looseReads(0), packedReads(0), asyncReads(0);
+static std::atomic<uint64_t> decompressedBytes(0);
+static std::atomic<char> prefaultSink(0);
+
+static std::string toLower(std::string s);
+
+void Vfs::initialize() {
+	root = getKey(project_directory);
+	std::vector<std::string> found;
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(project_directory + "\\packs", error), end; !error && it != end; it.increment(error))
+		if (toLower(it->path().extension().string()) == ".gpak")
+			found.push_back(it->path().string());
+	// Name order, so that a later pack (patch_1.gpak over base.gpak) wins.
+	std::sort(found.begin(), found.end());
+	for (const std::string& path : found)
+		mountPack(path);
+}
+
+void Vfs::terminate() {
+	packedFiles.clear();
+	packedFolders.clear();
+	packs.clear();
+	looseReads = packedReads = asyncReads = 0;
+	decompressedBytes = 0;
+}
+
+bool Vfs::mountPack(const std::string& path) {
+	std::unique_ptr<PackFile> pack = std::make_unique<PackFile>(path);
+	if (!pack->isOpen())
+		return false;
+	for (const PackFile::Entry& entry : pack->getEntries()) {
+		std::string name = entry.path;
+		std::replace(name.begin(), name.end(), '/', '\\');
+		std::string key = toLower(name);
+		packedFiles[key] = { pack.get(), &entry };
+		// The file and every folder above it, up to the project directory.
+		bool folder = false;
+		while (true) {
+			size_t slash = key.rfind('\\');
+			std::string parent = slash == std::string::npos ? "" : key.substr(0, slash);
+			packedFolders[parent].insert({ slash == std::string::npos ? name : name.substr(slash + 1), folder });
+			if (slash == std::string::npos)
+				break;
+			key.resize(slash);
+			name.resize(slash);
+			folder = true;
+		}
+	}
+	packs.push_back(std::move(pack));
+	return true;
+}
+
+Vfs::File Vfs::open(const std::string& path) {
+	const auto& it = packedFiles.find(getKey(path));
+	if (it != packedFiles.end()) {
+		packedReads++;
+		const PackFile& pack = *it->second.pack;
+		const PackFile::Entry& entry = *it->second.entry;
+		const char* stored = pack.getStoredData(entry);
+		if (!(entry.flags & PackFile::FLAG_LZ4))
+			return File(pack.getMapping(), stored, (size_t)entry.size);
+		std::shared_ptr<std::vector<char>> buffer = std::make_shared<std::vector<char>>((size_t)entry.size);
+		if (!Lz4::decompress((const unsigned char*)stored, (size_t)entry.storedSize, (unsigned char*)buffer->data(), buffer->size())) {
+			std::cout << "Corrupted entry " << entry.path << " in pack file: " << pack.getPath() << std::endl;
+			return File();
+		}
+		decompressedBytes += entry.size;
+		return File(buffer, buffer->data(), buffer->size());
+	}
+
+	looseReads++;
+	std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>(path);
+	if (mapping->isOpen())
+		return File(mapping, mapping->getData(), mapping->getSize());
+	// Empty files aren't mapped but they exist.
+	std::error_code error;
+	if (std::filesystem::is_regular_file(path, error) && std::filesystem::file_size(path, error) == 0 && !error)
+		return File(nullptr, nullptr, 0);
+	return File();
+}
+
+std::shared_future<Vfs::File> Vfs::openAsync(const std::string& path) {
+	std::shared_ptr<std::promise<File>> promise = std::make_shared<std::promise<File>>();
+	std::shared_future<File> future = promise->get_future().share();
+	asyncReads++;
+	JobSystem::submit([promise, path]() {
+		File file;
+		try {
+			file = open(path);
+		}
+		catch (...) {
+			file = File();
+		}
+		// One byte per page.
+		char touched = 0;
+		for (size_t i = 0; i < file.getSize(); i += 4096)
+			touched ^= file.getData()[i];
+		prefaultSink.store(touched, std::memory_order_relaxed);
+		promise->set_value(std::move(file));
+	});
+	return future;
+}
+
+Vfs::Info Vfs::stat(const std::string& path) {
+	Info info;
+	std::string key = getKey(path);
+	const auto& it = packedFiles.find(key);
+	if (it != packedFiles.end()) {
+		info.exists = info.packed = true;
+		info.size = it->second.entry->size;
+		info.writeTime = it->second.entry->writeTime;
+		return info;
+	}
+	if (packedFolders.count(key)) {
+		info.exists = info.packed = info.directory = true;
+		return info;
+	}
+
+	std::error_code error;
+	std::filesystem::file_status status = std::filesystem::status(path, error);
+	if (error || !std::filesystem::exists(status))
+		return info;
+	info.exists = true;
+	info.directory = std::filesystem::is_directory(status);
+	if (info.directory)
+		return info;
+	info.size = std::filesystem::file_size(path, error);
+	auto time = std::filesystem::last_write_time(path, error);
+	info.writeTime = error ? 0 : (int64_t)time.time_since_epoch().count();
+	return info;
+}
+
+bool Vfs::exists(const std::string& path) {
+	return stat(path).exists;
+}
+
+std::vector<std::string> Vfs::list(const std::string& folder, bool folders) {
+	std::vector<std::string> names;
+	std::set<std::string> keys;
+	const auto& it = packedFolders.find(getKey(folder));
+	if (it != packedFolders.end())
+		for (const auto& child : it->second)
+			if (child.second == folders && keys.insert(toLower(child.first)).second)
+				names.push_back(child.first);
+	std::error_code error;
+	for (std::filesystem::directory_iterator d(folder, error), end; !error && d != end; d.increment(error)) {
+		std::error_code typeError;
+		std::string name = d->path().filename().string();
+		if (d->is_directory(typeError) == folders && keys.insert(toLower(name)).second)
+			names.push_back(name);
+	}
+	return names;
+}
+
+Vfs::Stats Vfs::getStats() {
+	Stats s;
+	s.packs = (unsigned int)packs.size();
+	s.packedFiles = (unsigned int)packedFiles.size();
+	s.looseReads = looseReads;
+	s.packedReads = packedReads;
+	s.asyncReads = asyncReads;
+	s.decompressedBytes = decompressedBytes;
+	return s;
+}
+
+static std::string toLower(std::string s) {
+	for (char& c : s)
+		c = (char)std::tolower((unsigned char)c);
+	return s;
+}
+
+// Relative to the project directory when inside it, otherwise the whole normalized path.
+std::string Vfs::getKey(const std::string& path) {
+	std::string key = toLower(std::filesystem::path(path).lexically_normal().string());
+	std::replace(key.begin(), key.end(), '/', '\\');
+	while (!key.empty() && key.back() == '\\')
+		key.pop_back();
+	if (!root.empty() && key.size() > root.size() && key.compare(0, root.size(), root) == 0 && key[root.size()] == '\\')
+		key.erase(0, root.size() + 1);
+	else if (!root.empty() && key == root)
+		key.clear();
+	return key;
+}
\ No newline at end of file
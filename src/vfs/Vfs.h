@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <cstdint>
+
+// Every asset read goes through here: the loose files under the project directory, and the cooked pack files
+// mounted over them (a file in a pack hides the loose one, the last mounted pack wins).
+// Paths are the usual absolute ones (project_directory + "\\assets\\..."), matched against packs without case.
+// Uncompressed entries and loose files are mapped, compressed entries are decompressed in memory.
+// Reads can be queued on the job system with openAsync. Everything but mounting is safe from any thread.
+namespace Vfs {
+	// Content of a file, valid as long as any copy of it is alive.
+	class File {
+	private:
+		std::shared_ptr<const void> owner;
+		const char* data = nullptr;
+		size_t size = 0;
+		bool open = false;
+	public:
+		File() { };
+		File(std::shared_ptr<const void> owner, const char* data, size_t size) : owner(std::move(owner)), data(data), size(size), open(true) { };
+		// True for empty files too, they have no data.
+		bool isOpen() const { return open; }
+		const char* getData() const { return data; }
+		size_t getSize() const { return size; }
+		std::string toString() const { return std::string(data ? data : "", size); }
+	};
+
+	struct Info {
+		bool exists = false, directory = false, packed = false;
+		uint64_t size = 0;
+		// Same number as std::filesystem::last_write_time, packs keep the one of the source file.
+		int64_t writeTime = 0;
+	};
+
+	struct Stats {
+		unsigned int packs = 0, packedFiles = 0;
+		unsigned int looseReads = 0, packedReads = 0, asyncReads = 0;
+		uint64_t decompressedBytes = 0;
+	};
+
+	// Mounts every pack in project_directory\packs.
+	void initialize();
+	// Files already open stay valid.
+	void terminate();
+	// Main thread only, not while reads are running. False if it isn't a valid pack.
+	bool mountPack(const std::string& path);
+
+	// Closed file if it doesn't exist or can't be read.
+	File open(const std::string& path);
+	// Read on a worker, pages of mapped files are touched there so that parsing doesn't wait on the disk.
+	std::shared_future<File> openAsync(const std::string& path);
+	Info stat(const std::string& path);
+	bool exists(const std::string& path);
+	// Names of the files, or of the folders, directly in a folder, loose and packed.
+	std::vector<std::string> list(const std::string& folder, bool folders);
+	// Lowercase path relative to the project directory with backslashes, the same for every spelling of a file.
+	std::string getKey(const std::string& path);
+
+	Stats getStats();
+}
\ No newline at end of file
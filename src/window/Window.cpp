@@ -237,4 +237,8 @@ int getWindowHeight() {
 
 unsigned int Window::getFps() {
 	return lastFps;
+}
+
+bool Window::getCursorEnabled() {
+	return cursorEnabled;
 }
\ No newline at end of file
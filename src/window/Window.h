@@ -7,4 +7,6 @@ int getWindowHeight();
 
 namespace Window {
 	unsigned int getFps();
+	// True when the cursor is free to use the gui, false when it moves the camera.
+	bool getCursorEnabled();
 };
\ No newline at end of file
@@ -0,0 +1,390 @@
+// Offline asset cooker, a console program next to the engine.
+// Build it from this file and every engine source but src\Main.cpp, with the same include paths and libraries.
+// It never creates a window or an OpenGL context, the OpenGL functions linked in with the engine are never called.
+//
+// Run it from the project directory. In parallel it cooks:
+// - the models of assets\models to cooked\models (the ModelImport result, see CookedAssets),
+// - their textures to cooked\textures (compressed with mipmaps, occlusion, roughness and metallic packed),
+// - the cubemaps of assets\cubemaps to cooked\cubemaps (decoded faces),
+// - the scenes of assets\scenes to cooked\scenes (binary scene files, see SceneFile).
+// Then the cooked files, the model property files, the scenes and the shaders are written to ship\packs\cooked.gpak.
+// The ship folder is a project directory of its own: the engine run from it finds only cooked data, so it never
+// reads a model with assimp or decodes an image with stb_image.
+//
+// Outputs whose sources have the same content hash as in cooked\manifest.json are not cooked again.
+// Every asset is printed with its time and size.
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <nlohmann/json.hpp>
+#include <stb_image.h>
+#include "ProjectDirectory.h"
+#include "jobs/JobSystem.h"
+#include "vfs/Vfs.h"
+#include "vfs/PackWriter.h"
+#include "model/AssetDatabase.h"
+#include "model/ModelImport.h"
+#include "model/CookedAssets.h"
+#include "model/TextureCache.h"
+#include "model/TextureCompression.h"
+#include "scene/SceneFile.h"
+
+using json = nlohmann::json;
+
+// One cooked output and what it was made from.
+struct CookedAsset {
+	// Relative to the project directory.
+	std::string source, output;
+	uint64_t hash = 0, bytes = 0;
+	float milliseconds = 0.0f;
+	// Not cooked if the manifest has it with the same hash.
+	bool cooked = false, failed = false;
+};
+
+// Texture used by a cooked model, occlusion, roughness and metallic make one.
+struct TextureJob {
+	std::string paths[3];
+	bool orm = false, srgb = false;
+	TextureCompression::Usage usage = TextureCompression::Usage::COLOR;
+	const int* sourceChannels = nullptr;
+	// Absolute, it's the cookedPath of the model.
+	std::string output;
+};
+
+static const int gltfSourceChannels[3] = { 0, 1, 2 };
+static const char* cubemapFaces[6] = { "right", "left", "top", "bottom", "front", "back" };
+static const char* cubemapExtensions[] = { "png", "jpg", "jpeg", "tga", "bmp" };
+
+static json manifest;
+static std::mutex texturesMutex;
+static std::map<std::string, TextureJob> textureJobs;
+
+static std::string relative(const std::string& path) {
+	std::string prefix = project_directory + "\\";
+	return path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : path;
+}
+
+// FNV-1a.
+static uint64_t hashBytes(uint64_t h, const char* data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// Content of the files and the settings the output depends on. Empty paths are allowed.
+static uint64_t hashSources(const std::string* paths, size_t count, const std::string& settings) {
+	uint64_t h = hashBytes(14695981039346656037ull, settings.data(), settings.size());
+	for (size_t i = 0; i < count; ++i) {
+		Vfs::File file = paths[i].empty() ? Vfs::File() : Vfs::open(paths[i]);
+		h = hashBytes(h, file.getData(), file.getSize());
+		uint64_t size = file.isOpen() ? file.getSize() : ~0ull;
+		h = hashBytes(h, reinterpret_cast<const char*>(&size), sizeof(size));
+	}
+	return h;
+}
+
+static bool isUpToDate(const CookedAsset& asset) {
+	auto it = manifest.find(asset.output);
+	return it != manifest.end() && it->value("hash", (uint64_t)0) == asset.hash &&
+		std::filesystem::exists(project_directory + "\\" + asset.output);
+}
+
+static uint64_t getFileSize(const std::string& path) {
+	std::error_code error;
+	uint64_t size = std::filesystem::file_size(path, error);
+	return error ? 0 : size;
+}
+
+// Same name as the engine cache, the settings and the sources are in it.
+static std::string getTexturePath(const std::vector<std::string>& sources, TextureCompression::Usage usage, bool srgb) {
+	std::string cachePath = TextureCompression::getCachePath(sources, usage, srgb);
+	return project_directory + "\\cooked\\textures\\" + std::filesystem::path(cachePath).filename().string();
+}
+
+// Sets the cooked path of the textures of a model and queues them.
+static void addTextureJobs(ModelImport::ModelData& data) {
+	std::lock_guard<std::mutex> lock(texturesMutex);
+	auto addFiles = [](std::vector<ModelImport::TextureFile>& files, TextureType type) {
+		for (auto& file : files) {
+			TextureJob job;
+			job.paths[0] = file.path;
+			job.srgb = file.srgb;
+			job.usage = ModelImport::getUsage(type);
+			job.output = getTexturePath({ file.path }, job.usage, job.srgb);
+			file.cookedPath = job.output;
+			textureJobs.emplace(job.output, job);
+		}
+	};
+	for (auto& mesh : data.meshes) {
+		addFiles(mesh.textures.diffuse, TextureType::DIFFUSE);
+		addFiles(mesh.textures.normals, TextureType::NORMAL);
+		if (!mesh.textures.hasOrm())
+			continue;
+		TextureJob job;
+		job.orm = true;
+		job.paths[0] = mesh.textures.ao;
+		job.paths[1] = mesh.textures.roughness;
+		job.paths[2] = mesh.textures.metallic;
+		job.usage = TextureCompression::Usage::PACKED;
+		job.sourceChannels = mesh.textures.gltfChannels ? gltfSourceChannels : nullptr;
+		std::vector<std::string> sources(job.paths, job.paths + 3);
+		if (job.sourceChannels)
+			sources.push_back("channels 012");
+		job.output = getTexturePath(sources, job.usage, false);
+		mesh.textures.ormCookedPath = job.output;
+		textureJobs.emplace(job.output, job);
+	}
+}
+
+static void cookModel(const AssetDatabase::ModelRecord& record, CookedAsset& asset) {
+	std::string path = CookedAssets::getModelPath(record.name);
+	asset.source = "assets\\models\\" + record.name;
+	asset.output = relative(path);
+	asset.hash = CookedAssets::getSourceHash(record.name);
+	if (asset.hash == 0) {
+		asset.failed = true;
+		return;
+	}
+	// Up to date models are still read, their textures are checked too.
+	ModelImport::ModelData data;
+	if (isUpToDate(asset) && CookedAssets::loadModel(path, asset.hash, data)) {
+		addTextureJobs(data);
+		return;
+	}
+	asset.cooked = true;
+	if (!ModelImport::import(record.name, record.extension, data)) {
+		asset.failed = true;
+		return;
+	}
+	addTextureJobs(data);
+	asset.failed = !CookedAssets::saveModel(path, asset.hash, data);
+}
+
+static void cookTexture(const TextureJob& job, CookedAsset& asset) {
+	asset.source = relative(job.paths[0]);
+	for (int i = 1; i < 3; ++i)
+		if (!job.paths[i].empty())
+			asset.source += (asset.source.empty() ? "" : " + ") + relative(job.paths[i]);
+	asset.output = relative(job.output);
+	std::string settings = std::to_string((int)job.usage) + (job.srgb ? "|srgb" : "|linear") + (job.sourceChannels ? "|channels" : "");
+	asset.hash = hashSources(job.paths, 3, settings);
+	if (isUpToDate(asset))
+		return;
+	asset.cooked = true;
+
+	std::vector<unsigned char> rgba;
+	int width = 0, height = 0;
+	if (job.orm) {
+		Vfs::File files[3];
+		for (int i = 0; i < 3; ++i)
+			if (!job.paths[i].empty())
+				files[i] = Vfs::open(job.paths[i]);
+		asset.failed = !TextureCache::packOrm(job.paths, files, job.sourceChannels, rgba, width, height);
+	}
+	else {
+		Vfs::File file = Vfs::open(job.paths[0]);
+		int components;
+		unsigned char* data = file.getSize() == 0 ? nullptr :
+			stbi_load_from_memory((const unsigned char*)file.getData(), (int)file.getSize(), &width, &height, &components, 4);
+		if (data)
+			rgba.assign(data, data + (size_t)width * height * 4);
+		else
+			std::cout << "Texture failed to load at path: " << job.paths[0] << std::endl;
+		asset.failed = !data;
+		stbi_image_free(data);
+	}
+	if (asset.failed)
+		return;
+	TextureCompression::Image image;
+	TextureCompression::compress(rgba.data(), width, height, job.usage, job.srgb, image);
+	std::filesystem::create_directories(std::filesystem::path(job.output).parent_path());
+	asset.failed = !TextureCompression::saveDds(job.output, image);
+}
+
+static void cookCubemap(const std::string& name, CookedAsset& asset) {
+	std::string folder = project_directory + "\\assets\\cubemaps\\" + name + "\\";
+	std::string paths[6];
+	for (int i = 0; i < 6; ++i)
+		for (const char* extension : cubemapExtensions)
+			if (paths[i].empty() && Vfs::exists(folder + cubemapFaces[i] + "." + extension))
+				paths[i] = folder + cubemapFaces[i] + "." + extension;
+	std::string path = CookedAssets::getCubemapPath(name);
+	asset.source = relative(folder.substr(0, folder.size() - 1));
+	asset.output = relative(path);
+	asset.hash = hashSources(paths, 6, "cubemap");
+	if (isUpToDate(asset))
+		return;
+	asset.cooked = true;
+
+	CookedAssets::CubemapFace faces[6];
+	for (int i = 0; i < 6 && !asset.failed; ++i) {
+		Vfs::File file = paths[i].empty() ? Vfs::File() : Vfs::open(paths[i]);
+		int width, height, components;
+		unsigned char* data = file.getSize() == 0 ? nullptr :
+			stbi_load_from_memory((const unsigned char*)file.getData(), (int)file.getSize(), &width, &height, &components, 0);
+		if (data) {
+			faces[i].width = width;
+			faces[i].height = height;
+			faces[i].components = components;
+			faces[i].pixels.assign(data, data + (size_t)width * height * components);
+		}
+		else
+			std::cout << "Cubemap face " << cubemapFaces[i] << " of " << name << " can't be read." << std::endl;
+		asset.failed = !data;
+		stbi_image_free(data);
+	}
+	if (!asset.failed)
+		asset.failed = !CookedAssets::saveCubemap(path, faces);
+}
+
+static void cookScene(const std::string& name, CookedAsset& asset) {
+	std::string paths[2] = { SceneFile::getInstancesPath(name), SceneFile::getLightsPath(name) };
+	asset.source = "assets\\scenes\\" + name;
+	asset.output = relative(SceneFile::getPath(name));
+	// The binary file is only used with json files of the same size and time, so a touched file is cooked again.
+	std::string settings = "scene";
+	for (const auto& path : paths) {
+		Vfs::Info info = Vfs::stat(path);
+		settings += "|" + std::to_string(info.size) + "|" + std::to_string(info.writeTime);
+	}
+	asset.hash = hashSources(paths, 2, settings);
+	if (isUpToDate(asset))
+		return;
+	asset.cooked = true;
+	SceneFile::Data data;
+	asset.failed = !SceneFile::loadJson(name, data) || !SceneFile::save(name, data);
+}
+
+// Runs cook on every asset in parallel, then sets time and size.
+static void cookAll(std::vector<CookedAsset>& assets, const std::function<void(unsigned int, CookedAsset&)>& cook) {
+	JobSystem::parallelFor((unsigned int)assets.size(), 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i) {
+			auto start = std::chrono::high_resolution_clock::now();
+			cook(i, assets[i]);
+			assets[i].milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			assets[i].bytes = getFileSize(project_directory + "\\" + assets[i].output);
+		}
+	});
+}
+
+static void printAssets(const char* title, const std::vector<CookedAsset>& assets) {
+	std::cout << title << ":" << std::endl;
+	for (const auto& asset : assets) {
+		char line[64];
+		std::snprintf(line, sizeof(line), "%12llu bytes %10.1f ms  ", (unsigned long long)asset.bytes, asset.milliseconds);
+		std::cout << "  " << (asset.failed ? "failed " : asset.cooked ? "cooked " : "skipped") << line << asset.source << " -> " << asset.output << std::endl;
+	}
+}
+
+// Loose files of a folder, relative to the project directory, subfolders included.
+static void addFolderFiles(const std::string& folder, std::vector<std::string>& files) {
+	for (const auto& name : Vfs::list(folder, false))
+		files.push_back(relative(folder + "\\" + name));
+	for (const auto& name : Vfs::list(folder, true))
+		addFolderFiles(folder + "\\" + name, files);
+}
+
+static bool writePack(const std::string& path, const std::vector<std::string>& files) {
+	std::vector<PackWriter::Blob> blobs(files.size());
+	JobSystem::parallelFor((unsigned int)files.size(), 4, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i) {
+			std::string file = project_directory + "\\" + files[i];
+			Vfs::File data = Vfs::open(file);
+			blobs[i] = PackWriter::makeBlob(files[i], data.getData(), data.getSize(), Vfs::stat(file).writeTime, true);
+		}
+	});
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+	PackWriter writer(path);
+	for (const auto& blob : blobs)
+		writer.add(blob);
+	return writer.finish();
+}
+
+int main() {
+	auto start = std::chrono::high_resolution_clock::now();
+	// Packs aren't mounted, the cooker only reads loose sources.
+	JobSystem::initialize();
+	AssetDatabase::initialize();
+	std::string manifestPath = project_directory + "\\cooked\\manifest.json";
+	std::ifstream manifestFile(manifestPath);
+	if (manifestFile.is_open())
+		manifest = json::parse(manifestFile, nullptr, false);
+	if (!manifest.is_object())
+		manifest = json::object();
+	manifestFile.close();
+
+	// Models first, they say which textures are needed.
+	const auto& records = AssetDatabase::getModels();
+	std::vector<CookedAsset> models(records.size()), textures, cubemaps, scenes;
+	cookAll(models, [&](unsigned int i, CookedAsset& asset) { cookModel(records[i], asset); });
+	std::vector<TextureJob> jobs;
+	for (const auto& it : textureJobs)
+		jobs.push_back(it.second);
+	textures.resize(jobs.size());
+	cookAll(textures, [&](unsigned int i, CookedAsset& asset) { cookTexture(jobs[i], asset); });
+	std::vector<std::string> cubemapNames = Vfs::list(project_directory + "\\assets\\cubemaps", true);
+	cubemaps.resize(cubemapNames.size());
+	cookAll(cubemaps, [&](unsigned int i, CookedAsset& asset) { cookCubemap(cubemapNames[i], asset); });
+	std::vector<std::string> sceneNames = Vfs::list(project_directory + "\\assets\\scenes", true);
+	scenes.resize(sceneNames.size());
+	cookAll(scenes, [&](unsigned int i, CookedAsset& asset) { cookScene(sceneNames[i], asset); });
+
+	printAssets("Models", models);
+	printAssets("Textures", textures);
+	printAssets("Cubemaps", cubemaps);
+	printAssets("Scenes", scenes);
+
+	// Failed assets are left out of the manifest, so they are cooked again next time.
+	json newManifest = json::object();
+	std::vector<std::string> packFiles;
+	unsigned int cooked = 0, failed = 0, upToDate = 0;
+	uint64_t bytes = 0;
+	for (const auto* group : { &models, &textures, &cubemaps, &scenes }) {
+		for (const auto& asset : *group) {
+			cooked += asset.cooked ? 1 : 0;
+			failed += asset.failed ? 1 : 0;
+			upToDate += !asset.cooked && !asset.failed ? 1 : 0;
+			if (asset.failed)
+				continue;
+			bytes += asset.bytes;
+			newManifest[asset.output] = { { "source", asset.source }, { "hash", asset.hash }, { "bytes", asset.bytes }, { "ms", asset.milliseconds } };
+			packFiles.push_back(asset.output);
+		}
+	}
+	std::ofstream output(manifestPath, std::ofstream::out | std::ofstream::trunc);
+	output << newManifest.dump(4);
+	output.close();
+
+	// Property files let the engine list the model folders, shaders are read as they are.
+	// Scene json files go too, the binary scene files are only used with the json files they were made from.
+	for (const auto& record : records)
+		for (const char* properties : { "model_properties.txt", "texture_properties.txt" })
+			if (Vfs::exists(project_directory + "\\assets\\models\\" + record.name + "\\" + properties))
+				packFiles.push_back("assets\\models\\" + record.name + "\\" + properties);
+	addFolderFiles(project_directory + "\\assets\\scenes", packFiles);
+	addFolderFiles(project_directory + "\\shaders", packFiles);
+	std::string packPath = project_directory + "\\ship\\packs\\cooked.gpak";
+	bool packed = writePack(packPath, packFiles);
+
+	std::cout << cooked << " cooked, " << failed << " failed, " << upToDate << " up to date, " <<
+		bytes << " bytes of cooked data." << std::endl;
+	if (packed)
+		std::cout << packFiles.size() << " files packed in " << packPath << " (" << getFileSize(packPath) << " bytes)." << std::endl;
+	else
+		std::cout << "Pack couldn't be written at path: " << packPath << std::endl;
+	std::cout << "Cooked in " << std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms." << std::endl;
+
+	AssetDatabase::terminate();
+	JobSystem::terminate();
+	return failed == 0 && packed ? 0 : 1;
+}
\ No newline at end of file